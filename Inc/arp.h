@@ -4,10 +4,58 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "enc28_j60.h"
+#include "txq.h"
 #include "eth.h"
+#include "route.h"
+#include "ratelimit.h"
 
 /* Defines ------------------------------------------------------------------*/
-#define ARP_TABLE_SIZE 10
+// Kapazitt des Neighbor-Caches (auf dem Host-Build z.B. 512)
+#ifndef ARP_TABLE_SIZE
+#define ARP_TABLE_SIZE 16
+#endif
+// Anzahl der Hash-Buckets als Zweierpotenz (2^ARP_HASH_BITS >= ARP_TABLE_SIZE)
+#ifndef ARP_HASH_BITS
+#define ARP_HASH_BITS 5
+#endif
+#define ARP_HASH_SIZE (1 << ARP_HASH_BITS)
+#define ARP_NONE 0xFFFF
+
+// Aging in ms
+#ifndef ARP_REACHABLE_TIME
+#define ARP_REACHABLE_TIME 30000 // REACHABLE -> STALE
+#endif
+#ifndef ARP_STALE_TIME
+#define ARP_STALE_TIME 600000 // STALE -> Eintrag wird verworfen
+#endif
+#ifndef ARP_NEGATIVE_TIME
+#define ARP_NEGATIVE_TIME 20000 // FAILED -> Eintrag wird verworfen (Negativ-Cache)
+#endif
+
+// Wiederholung von ARP-Anfragen
+#ifndef ARP_RETRY_INTERVAL
+#define ARP_RETRY_INTERVAL 250 // Minimaler Abstand zweier Anfragen an dasselbe Ziel in ms
+#endif
+#ifndef ARP_MAX_RETRIES
+#define ARP_MAX_RETRIES 4 // Anfragen, bevor das Ziel als unerreichbar gilt (Abstand verdoppelt sich)
+#endif
+
+// Warteschlange fr Frames, deren Ziel-MAC noch aufgelst wird
+#ifndef ARP_QUEUE_SIZE
+#define ARP_QUEUE_SIZE 4 // Gepufferte Frames insgesamt
+#endif
+#ifndef ARP_QUEUE_PER_ENTRY
+#define ARP_QUEUE_PER_ENTRY 2 // Gepufferte Frames je Nachbar
+#endif
+#ifndef ARP_QUEUE_FRAME_SIZE
+#define ARP_QUEUE_FRAME_SIZE 128 // Maximale Lnge eines gepufferten Frames
+#endif
+
+// Bestehende Eintrge anhand empfangener IPv4-Pakete besttigen
+#ifndef ARP_LEARN_FROM_IPV4
+#define ARP_LEARN_FROM_IPV4 1
+#endif
+
 //Little Endian
 #define ARP_TYPE 	0x0608
 #define ARP_HW_TYPE 0x0100
@@ -17,6 +65,13 @@
 #define ARP_REQ 0x0100
 #define ARP_REPLY 0x0200
 
+// Zustnde eines Eintrags im Neighbor-Cache
+#define ARP_STATE_FREE 0x00
+#define ARP_STATE_INCOMPLETE 0x01
+#define ARP_STATE_REACHABLE 0x02
+#define ARP_STATE_STALE 0x03
+#define ARP_STATE_FAILED 0x04
+
 typedef struct{
 	uint16_t hw_type;
 	uint16_t pr_type;
@@ -30,13 +85,51 @@ typedef struct{
 } arp_package;
 
 typedef struct{
-	ip_address dest_ip;
+	uint32_t ip; // IP-Adresse als 32-Bit-Schlssel (siehe ip_to_uint32)
 	mac_address dest_mac;
+	uint8_t state;
+	uint32_t timestamp; // HAL-Tick der letzten Besttigung bzw. des Zustandswechsels
+	uint32_t req_time; // HAL-Tick der letzten ARP-Anfrage an dieses Ziel
+	uint8_t retries; // Anzahl der Anfragen der laufenden Auflsung
+	uint16_t hash_next; // Nchster Eintrag im selben Bucket
+	uint16_t lru_prev;
+	uint16_t lru_next;
+	uint16_t queue_head; // Erster wartender Frame (ARP_NONE = keiner)
+	uint8_t queue_len;
+	uint16_t pending_next; // Nchster Eintrag mit laufender Auflsung
 } arp_entry;
 
+typedef struct{
+	uint16_t owner; // Eintrag im Neighbor-Cache, auf dessen Auflsung der Frame wartet
+	uint16_t next; // Nchster wartender Frame bzw. nchster freier Platz
+	uint16_t len;
+	uint8_t data[ARP_QUEUE_FRAME_SIZE];
+} arp_queued_frame;
+
+typedef struct{
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t evictions;
+	uint32_t requests; // Gesendete ARP-Anfragen
+	uint32_t failures; // Auflsungen, die nach ARP_MAX_RETRIES aufgegeben wurden
+	uint32_t negative_hits; // Zugriffe auf als unerreichbar gespeicherte Ziele
+	uint32_t queued; // Frames, die auf eine ARP-Antwort gewartet haben
+	uint32_t queue_flushed; // Nach Eintreffen der ARP-Antwort gesendete Frames
+	uint32_t queue_timeouts; // Verworfen, weil die Auflsung fehlgeschlagen ist
+	uint32_t queue_overflows; // Verworfen, weil die Warteschlange voll oder der Frame zu gro war
+} arp_stats;
+
 typedef struct {
-    arp_entry data[ARP_TABLE_SIZE];
-    int tail;
+	arp_entry data[ARP_TABLE_SIZE];
+	uint16_t buckets[ARP_HASH_SIZE];
+	uint16_t lru_head; // Zuletzt benutzter Eintrag
+	uint16_t lru_tail; // Am lngsten unbenutzter Eintrag
+	uint16_t free_head; // Freie Eintrge, verkettet ber hash_next
+	uint16_t pending_head; // Eintrge im Zustand INCOMPLETE, verkettet ber pending_next
+	uint16_t count;
+	arp_queued_frame queue[ARP_QUEUE_SIZE];
+	uint16_t queue_free; // Freie Pltze der Warteschlange, verkettet ber next
+	arp_stats stats;
 } arp_table;
 
 
@@ -45,5 +138,15 @@ void arp_table_init(arp_table* table_adr, ip_address* src_ip, mac_address src_ma
 
 int get_mac(ip_address ip, mac_address* mac_addr);
 
+int arp_learn(ip_address ip, mac_address mac, uint8_t create);
+
+int arp_output(ip_address ip, uint16_t len, uint8_t* frame);
+
+void arp_refresh(ip_address ip);
+
+void arp_tick(void);
+
+const arp_stats* arp_get_stats(void);
+
 
-#endif /* __ARP_H */
\ No newline at end of file
+#endif /* __ARP_H */
@@ -0,0 +1,30 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CHECKSUM_H
+#define __CHECKSUM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "eth.h"
+
+/* Defines ------------------------------------------------------------------*/
+// Alle Summen werden in Speicher-Byte-Order gebildet: das Ergebnis kann unverndert in das
+// Prfsummenfeld eines Headers geschrieben werden (wie die brigen Little-Endian-Felder).
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint32_t checksum_partial(const void* data, uint16_t length, uint32_t sum);
+
+uint32_t checksum_copy(void* dst, const void* src, uint16_t length, uint32_t sum);
+
+uint32_t checksum_stream(const void* data, uint16_t length, uint16_t position, uint32_t sum);
+
+uint32_t checksum_pseudo(ip_address src, ip_address dst, uint8_t prtcl, uint16_t length);
+
+uint16_t checksum_fold(uint32_t sum);
+
+uint16_t checksum(const void* data, uint16_t length);
+
+uint16_t checksum_update16(uint16_t check, uint16_t old_value, uint16_t new_value);
+
+uint16_t checksum_update32(uint16_t check, uint32_t old_value, uint32_t new_value);
+
+#endif /* __CHECKSUM_H */
\ No newline at end of file
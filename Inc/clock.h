@@ -0,0 +1,75 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLOCK_H
+#define __CLOCK_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32g0xx_hal.h"
+
+/* Defines ------------------------------------------------------------------*/
+// Abweichungen darber werden gesprungen statt langsam nachgefhrt (s, wie NTP: 128 ms)
+#ifndef CLOCK_STEP_THRESHOLD
+#define CLOCK_STEP_THRESHOLD 128000
+#endif
+// Geschwindigkeit, mit der eine Phasenabweichung abgebaut wird (ppm, wie adjtime: 500)
+#ifndef CLOCK_SLEW_PPM
+#define CLOCK_SLEW_PPM 500
+#endif
+// Obergrenze der Frequenzkorrektur in ppm. Der Takt kommt aus dem HSI (1 % ber die Temperatur),
+// daher deutlich mehr als die 500 ppm von NTP, das einen Quarz voraussetzt.
+#ifndef CLOCK_FREQ_MAX_PPM
+#define CLOCK_FREQ_MAX_PPM 20000
+#endif
+// Krzester Abstand zweier Messungen in ms, aus dem die Frequenz geschtzt wird
+#ifndef CLOCK_FLL_MIN_INTERVAL
+#define CLOCK_FLL_MIN_INTERVAL 16000
+#endif
+// Gewicht einer neuen Frequenzschtzung als Schiebeweite (1 = halbe Korrektur)
+#ifndef CLOCK_FLL_SHIFT
+#define CLOCK_FLL_SHIFT 1
+#endif
+// Bezugspunkt der Umrechnung wird sptestens nach so vielen s nachgezogen (muss unter 2^31 bleiben)
+#define CLOCK_REBASE_US 1000000
+
+// Frequenzen werden als Anteil in Einheiten von 2^-32 gefhrt (1 ppm = 4295)
+#define CLOCK_PPM 4295
+
+typedef struct {
+	uint32_t updates; // bernommene Messungen
+	uint32_t steps; // Gesprungen (erste Messung oder Abweichung ber CLOCK_STEP_THRESHOLD)
+	uint32_t slews; // Langsam nachgefhrt
+	int32_t offset; // Letzte gemessene Abweichung in s (auf 2^31 begrenzt)
+	int32_t freq_ppb; // Aktuelle Frequenzkorrektur in ppb
+} clock_stats;
+
+typedef struct {
+	uint64_t base_utc; // Disziplinierte Zeit am Bezugspunkt in s seit 1970
+	uint32_t base_frac; // Bruchteil der s am Bezugspunkt in 2^-32
+	uint64_t base_uptime; // Monotone Zeit seit dem Start am Bezugspunkt in s
+	uint32_t base_raw; // Zhlerstand des Timers am Bezugspunkt
+	int32_t freq; // Frequenzkorrektur in 2^-32
+	int32_t slew; // Zustzliche Korrektur zum Abbau einer Phasenabweichung in 2^-32
+	uint32_t slew_left; // Verbleibende Dauer der Phasenkorrektur in s (Timerzeit)
+	uint32_t update_time; // HAL-Tick der letzten Messung
+	uint8_t synced;
+	clock_stats stats;
+} clock_state;
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void clock_init(clock_state* state_addr);
+
+uint32_t clock_now_us(void);
+
+uint64_t clock_uptime_us(void);
+
+uint64_t clock_utc_us(void);
+
+uint8_t clock_synced(void);
+
+void clock_adjust(int64_t offset);
+
+void clock_tick(void);
+
+const clock_stats* clock_get_stats(void);
+
+#endif /* __CLOCK_H */
\ No newline at end of file
@@ -8,9 +8,11 @@
 #include "ipv4.h"
 #include "arp.h"
 #include "udp.h"
+#include "dns.h"
+#include "sntp.h"
+#include "syslog.h"
 
 /* Defines ------------------------------------------------------------------*/
-#define UDP_SERVICES_SIZE 2
 //Little Endian
 #define DHCP_LPORT 	0x4400 // Port 68
 #define DHCP_RPORT 	0x4300 // Port 67
@@ -37,6 +39,15 @@ typedef struct{
 	ip_address router;
 } option_3;
 
+// Option 6 Domain Name Server (Liste von Adressen, an den DNS-Resolver bergeben)
+#define DHCP_OP_6			0x06
+
+// Option 42 Network Time Protocol Servers (Liste von Adressen, an den SNTP-Client bergeben)
+#define DHCP_OP_42			0x2A
+
+// Option 121 Classless Static Route (RFC 3442); ersetzt Option 3, wenn vorhanden
+#define DHCP_OP_121			0x79
+
 // Option 50 Request IP Address
 typedef struct{
 	uint8_t option_type; //50
@@ -73,6 +84,7 @@ typedef struct{
 	uint8_t router;
 	uint8_t dns;
 	uint8_t ntps;
+	uint8_t classless_routes;
 } option_55;
 
 // Option 58 Renewal Time Value
@@ -0,0 +1,135 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DNS_H
+#define __DNS_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "eth.h"
+#include "udp.h"
+
+/* Defines ------------------------------------------------------------------*/
+//Little Endian
+#define DNS_PORT 0x3500 // Port 53
+
+// Anzahl der DNS-Server (aus DHCP Option 6 oder dns_set_servers)
+#ifndef DNS_SERVERS
+#define DNS_SERVERS 3
+#endif
+// Eintrge im Cache (positive und negative Antworten)
+#ifndef DNS_CACHE_SIZE
+#define DNS_CACHE_SIZE 8
+#endif
+// Gleichzeitig ausstehende Anfragen und Wartende je Anfrage (gleiche Namen werden zusammengefasst)
+#ifndef DNS_PENDING
+#define DNS_PENDING 4
+#endif
+#ifndef DNS_WAITERS
+#define DNS_WAITERS 4
+#endif
+// Maximale Lnge eines Namens einschlielich Null (RFC 1035 erlaubt 253 Zeichen)
+#ifndef DNS_NAME_MAX
+#define DNS_NAME_MAX 64
+#endif
+// Wartezeit in ms auf eine Antwort; verdoppelt sich nach jedem Durchlauf ber alle Server
+#ifndef DNS_TIMEOUT
+#define DNS_TIMEOUT 1000
+#endif
+// Versuche je Anfrage insgesamt, reihum ber die Server verteilt
+#ifndef DNS_ATTEMPTS
+#define DNS_ATTEMPTS 4
+#endif
+// Obergrenze der TTL in s und Cache-Dauer negativer Antworten ohne SOA (RFC 2308)
+#ifndef DNS_TTL_MAX
+#define DNS_TTL_MAX 86400
+#endif
+#ifndef DNS_NEG_TTL
+#define DNS_NEG_TTL 60
+#endif
+
+#define DNS_MSG_MAX 512 // Antworten ber UDP ohne EDNS (RFC 1035, 4.2.1)
+
+// Header-Flags (Big Endian im Paket)
+#define DNS_FLAG_QR 0x8000
+#define DNS_FLAG_TC 0x0200
+#define DNS_FLAG_RD 0x0100
+#define DNS_RCODE_MASK 0x000F
+#define DNS_RCODE_SERVFAIL 2
+#define DNS_RCODE_NXDOMAIN 3
+
+#define DNS_TYPE_A 1
+#define DNS_TYPE_CNAME 5
+#define DNS_TYPE_SOA 6
+#define DNS_CLASS_IN 1
+
+// Ergebnis von dns_resolve und Status der Rckmeldung
+#define DNS_OK 0
+#define DNS_IN_PROGRESS 1 // Anfrage luft, das Ergebnis kommt ber den Handler
+#define DNS_ERR_NOT_FOUND -1 // NXDOMAIN oder kein A-Record (auch aus dem negativen Cache)
+#define DNS_ERR_TIMEOUT -2 // Kein Server hat geantwortet
+#define DNS_ERR_NO_SERVER -3
+#define DNS_ERR_BUSY -4 // Keine freie Anfrage bzw. kein freier Warteplatz
+#define DNS_ERR_NAME -5 // Ungltiger oder zu langer Name
+
+typedef void (*dns_handler)(const char* name, ip_address addr, int status);
+
+typedef struct {
+	char name[DNS_NAME_MAX]; // In Kleinbuchstaben
+	uint32_t hash;
+	ip_address addr;
+	int8_t status; // DNS_OK oder DNS_ERR_NOT_FOUND (negativer Eintrag)
+	uint8_t valid;
+	uint32_t expires; // HAL-Tick des Ablaufs
+	uint32_t used; // HAL-Tick der letzten Verwendung (LRU)
+} dns_cache_entry;
+
+typedef struct {
+	char name[DNS_NAME_MAX];
+	uint32_t hash;
+	uint16_t id;
+	uint8_t in_use;
+	uint8_t server; // Index des zuletzt gefragten Servers
+	uint8_t attempts;
+	uint32_t sent; // HAL-Tick des letzten Versuchs
+	uint32_t timeout;
+	dns_handler waiters[DNS_WAITERS];
+	uint8_t waiter_count;
+} dns_query;
+
+typedef struct {
+	uint32_t lookups;
+	uint32_t hits; // Aus dem Cache beantwortet (positiv)
+	uint32_t negative_hits; // Aus dem Cache beantwortet (negativ)
+	uint32_t coalesced; // An eine laufende Anfrage angehngt
+	uint32_t queries; // Gesendete Anfragen einschlielich Wiederholungen
+	uint32_t answers;
+	uint32_t not_found;
+	uint32_t failovers; // Wechsel zum nchsten Server (Zeitberschreitung, SERVFAIL, REFUSED, TC)
+	uint32_t timeouts; // Anfragen ohne Antwort nach DNS_ATTEMPTS
+	uint32_t bad_answers; // Unpassende ID, Frage oder Absender
+} dns_stats;
+
+typedef struct {
+	ip_address servers[DNS_SERVERS];
+	uint8_t server_count;
+	uint8_t preferred; // Server der letzten Antwort; neue Anfragen beginnen dort
+	int sock;
+	uint32_t seed;
+	dns_cache_entry cache[DNS_CACHE_SIZE];
+	dns_query pending[DNS_PENDING];
+	dns_stats stats;
+} dns_resolver;
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void dns_init(dns_resolver* resolver_addr);
+
+void dns_set_servers(const ip_address* servers, uint8_t count);
+
+int dns_resolve(const char* name, ip_address* addr, dns_handler func);
+
+void dns_cache_flush(void);
+
+void dns_tick(void);
+
+const dns_stats* dns_get_stats(void);
+
+#endif /* __DNS_H */
\ No newline at end of file
@@ -26,9 +26,18 @@
 #define RXSTART_INIT 0x0000
 #define RXSTOP_INIT 0x0BFF
 #define TXSTART_INIT 0x0C00
-#define TXSTOP_INIT 0x11FF
+#define TXSTOP_INIT 0x1FFF // Der gesamte Rest des 8-KB-Puffers dient als Sendewarteschlange (txq)
 
-#define MAX_FRAMELEN							1500
+#define MAX_FRAMELEN							1518 // Ethernet-Frame mit 1500 Bytes MTU inkl. Header und CRC
+// Vor der Vorprfung gelesene Bytes: MAC-Header, IPv4-Header mit Optionen und ICMP-Typ bzw. ARP-Paket
+#define ENC28_PEEK_SIZE						76
+
+// Beim Lesen eines Frames mitlaufend gebildete Internet-Summe (Speicher-Byte-Order)
+typedef struct {
+	uint32_t sum; // Ungefaltete Summe ber die Bytes from bis to - 1 des Frames
+	uint16_t from; // Gerade Position, ab der summiert wurde
+	uint16_t to; // Ende des Bereichs (= gelesene Framelnge); from == to, wenn nichts summiert wurde
+} enc28_rx_sum;
 
 
 // TABLE 3-1: ENC28J60 CONTROL REGISTER MAP
@@ -41,9 +50,20 @@
 #define ERXND 	0x0A
 #define ERXRDPT 0x0C
 #define ERXWRPT 0x0E
+#define EDMAST 	0x10
+#define EDMAND 	0x12
+#define EDMADST 0x14
 #define MISTAT_BUSY								0x01
 
 // Bank1 - control registers addresses
+#define EHT0 			0x00 | 0x20
+#define EHT1 			0x01 | 0x20
+#define EHT2 			0x02 | 0x20
+#define EHT3 			0x03 | 0x20
+#define EHT4 			0x04 | 0x20
+#define EHT5 			0x05 | 0x20
+#define EHT6 			0x06 | 0x20
+#define EHT7 			0x07 | 0x20
 #define ERXFCON 	0x18 | 0x20
 #define EPMM0 		0x08 | 0x20
 #define EPMCS 		0x10 | 0x20
@@ -91,12 +111,15 @@
 #define ECON1_RXEN								0x04
 #define ECON1_TXRST								0x80
 #define ECON1_TXRTS								0x08
+#define ECON1_DMAST								0x20
 
 #define ERXFCON_UCEN							0x80
 #define ERXFCON_CRCEN							0x20
 #define ERXFCON_PMEN							0x10
 #define ERXFCON_BCEN							0x01 
 #define ERXFCON_ANDOR							0x40
+#define ERXFCON_HTEN							0x04
+#define ERXFCON_MCEN							0x02
 
 #define MACON1_MARXEN							0x01
 #define MACON1_TXPAUS							0x08
@@ -136,7 +159,29 @@
 /* Exported functions prototypes ---------------------------------------------*/
 void enc28_init(mac_address mac);
 
-void enc28_packetSend(uint16_t len, uint8_t* dataBuf);
+void enc28_packetBegin(uint16_t addr);
+
+void enc28_packetWrite(uint16_t len, const uint8_t* data);
+
+void enc28_packetTransmit(uint16_t addr, uint16_t len);
+
+int enc28_packetDone(void);
+
+void enc28_setRxFilter(int (*filter)(const uint8_t* header, uint16_t len));
+
+void enc28_setRxSumFilter(int (*filter)(const uint8_t* header, uint16_t len));
+
+int enc28_packetHeld(const uint8_t* dataBuf, uint16_t len);
+
+void enc28_packetCopyRx(uint16_t addr, uint16_t len);
+
+void enc28_packetPatch(uint16_t addr, uint16_t len, const uint8_t* data);
+
+void enc28_packetSeek(uint16_t addr);
+
+const enc28_rx_sum* enc28_packetSum(const uint8_t* dataBuf);
+
+void enc28_setMulticastFilter(const mac_address* macs, uint8_t count);
 
 uint16_t enc28_packetReceive(uint16_t maxlen, uint8_t* dataBuf);
 
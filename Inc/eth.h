@@ -45,4 +45,8 @@ uint32_t swapEndian32(uint32_t value);
 
 uint16_t swapEndian16(uint16_t value);
 
+uint32_t ip_to_uint32(ip_address ip);
+
+ip_address uint32_to_ip(uint32_t value);
+
 #endif /* __ETH_H */
\ No newline at end of file
@@ -11,30 +11,27 @@
 //Little Endian
 #define ICMP_TYPE 	0x01
 #define ICMP_CODE	0x00
-#define ICMP_CHECKSUM	0x584d
-#define ICMP_IDENT 0x0100
-#define ICMP_SEQ 0x0300
 #define ICMP_REQ 0x08
 #define ICMP_REPLY 0x00
 
 
-typedef struct{
-	uint8_t data[32];
-} payload;
-
 typedef struct{
 	uint8_t type;
 	uint8_t code;
 	uint16_t checksum;
 	uint16_t ident;
 	uint16_t seq;
-	payload data;
 } __attribute__((packed)) icmp_package;
 
+// Verarbeitet eine Echo-Antwort (Beginn des ICMP-Headers bei offset, Prfsumme bereits geprft)
+typedef void (*icmp_reply_handler)(const uint8_t* buf, uint16_t length, uint16_t offset);
+
 
 /* Exported functions prototypes ---------------------------------------------*/
-void icmp_init(ip_address* src_ip, ip_address *my_subnet,ip_address *my_gateway, mac_address src_mac);
+void icmp_init(ip_address* src_ip, mac_address src_mac);
+
+int send_icmp_req(ip_address target_ip, uint16_t ident, uint16_t seq, const uint8_t* data, uint16_t len);
 
-void send_icmp_req(ip_address target_ip);
+void icmp_set_reply_handler(icmp_reply_handler handler);
 
 #endif /* __ICMP_H */
\ No newline at end of file
@@ -0,0 +1,68 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IGMP_H
+#define __IGMP_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "eth.h"
+#include "ipv4.h"
+#include "enc28_j60.h"
+
+/* Defines ------------------------------------------------------------------*/
+#define IGMP_TYPE 0x02
+#define IGMP_QUERY 0x11 // Membership Query
+#define IGMP_V1_REPORT 0x12
+#define IGMP_V2_REPORT 0x16
+#define IGMP_LEAVE 0x17
+#define IGMP_ALL_ROUTERS 0xE0000002 // 224.0.0.2, Ziel der Leave-Nachrichten
+
+// Zeit in ms, innerhalb der der unaufgeforderte Report nach einem Join wiederholt wird (RFC 2236, 8.10)
+#ifndef IGMP_UNSOLICITED_INTERVAL
+#define IGMP_UNSOLICITED_INTERVAL 10000
+#endif
+
+// Zustand einer Mitgliedschaft (RFC 2236, Abschnitt 6)
+#define IGMP_IDLE 0x00 // Mitglied, kein Report geplant
+#define IGMP_DELAYING 0x01 // Report zu report_time geplant
+
+typedef struct {
+	uint8_t type;
+	uint8_t max_resp; // Maximale Antwortzeit in 1/10 s (nur Query)
+	uint16_t checksum;
+	ip_address group;
+} __attribute__((packed)) igmp_package;
+
+typedef struct {
+	uint32_t group; // Gruppe als 32-Bit-Schlssel
+	uint32_t report_time; // HAL-Tick des geplanten Reports
+	uint8_t state;
+	uint8_t last_reporter; // 1, wenn der letzte Report der Gruppe von dieser Station kam
+	uint8_t in_use;
+} igmp_group;
+
+typedef struct {
+	uint32_t queries; // Empfangene Membership Queries
+	uint32_t reports_sent;
+	uint32_t leaves_sent;
+	uint32_t suppressed; // Eigene Reports, die wegen des Reports eines anderen Mitglieds entfallen
+	uint32_t bad_checksum;
+} igmp_stats;
+
+typedef struct {
+	igmp_group data[IPV4_GROUPS_SIZE];
+	uint32_t seed; // Zustand des Zufallsgenerators fr die Antwortverzgerung
+	igmp_stats stats;
+} igmp_groups;
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void igmp_init(igmp_groups* groups_addr, ip_address* src_ip, mac_address src_mac);
+
+int igmp_join(ip_address group);
+
+void igmp_leave(ip_address group);
+
+void igmp_tick(void);
+
+const igmp_stats* igmp_get_stats(void);
+
+#endif /* __IGMP_H */
\ No newline at end of file
@@ -3,22 +3,78 @@
 #define __IPV4_H
 
 #include "eth.h"
+#include "arp.h"
+#include "route.h"
+#include "ipv4_frag.h"
+#include "checksum.h"
+#include "txq.h"
 
 
 /* Defines -------------------------------------*/
-#define PRTCL_TYPE_SIZE 2
+#define PRTCL_TYPE_SIZE 3
 //Little Endian
 #define IPV4_TYPE 0x0008
 #define IPV4_VERSION 0x45
+#define IPV4_BROADCAST 0xFFFFFFFF
+#define IPV4_FLAG_MORE 0x2000 // More Fragments (Host-Byte-Order)
+
+// Link-MTU (maximale Lnge eines IPv4-Pakets ohne MAC-Header)
+#ifndef IPV4_MTU
+#define IPV4_MTU 1500
+#endif
+#ifndef IPV4_TTL
+#define IPV4_TTL 64
+#endif
+#define IPV4_ALL_HOSTS 0xE0000001 // 224.0.0.1
+
+// Anzahl der abonnierbaren Multicast-Gruppen (zustzlich zu 224.0.0.1)
+#ifndef IPV4_GROUPS_SIZE
+#define IPV4_GROUPS_SIZE 4
+#endif
 
 typedef struct {
 	uint8_t prtcl_type;
-	int (*func)(const uint8_t* buf, uint16_t length);
+	int (*func)(const uint8_t* buf, uint16_t length, uint16_t offset); // offset = Beginn des Layer-4-Headers
 } prtcl_type;
 
+typedef struct {
+	uint32_t received;
+	uint32_t delivered;
+	uint32_t bad_header; // Version ungleich 4 oder IHL kleiner 5
+	uint32_t bad_length; // Gesamtlnge passt nicht zum Header bzw. zum empfangenen Frame
+	uint32_t bad_checksum;
+	uint32_t not_for_us; // Weder eigene Adresse noch Broadcast noch abonnierte Gruppe
+	uint32_t no_protocol; // Kein Handler fr das Layer-4-Protokoll registriert
+	uint32_t fragments; // An die Reassemblierung bergebene Fragmente
+	uint32_t multicast; // An 224.0.0.1 oder eine abonnierte Gruppe adressiert
+	uint32_t multicast_leaked; // Trotz Hash-Filter empfangen, aber keine abonnierte Gruppe (Hash-Kollision)
+} ipv4_stats;
+
+typedef struct {
+	ip_address dst;
+	const uint8_t* header; // Layer-4-Header
+	const uint8_t* payload;
+	uint16_t header_len;
+	uint16_t payload_len;
+	uint8_t prtcl;
+	int8_t status; // Ergebnis wie bei ipv4_send (1 eingereiht, 0 ARP-Auflsung luft, -1 verworfen)
+} ipv4_datagram;
+
+typedef struct {
+	mac_header mac_header; // Ethernet-Header zum nchsten Hop aus route_lookup
+	ip_address dst;
+	uint16_t max_len; // Reservierte Lnge von Layer-4-Header und Nutzdaten
+	uint8_t prtcl;
+	uint8_t prio;
+	uint8_t active; // 1 zwischen ipv4_begin und ipv4_commit bzw. ipv4_abort
+} ipv4_pending;
+
 typedef struct {
 	prtcl_type types[PRTCL_TYPE_SIZE];
 	uint8_t idx;
+	ipv4_pending pending; // Datagramm, das gerade direkt im bertragungspuffer entsteht
+	uint32_t groups[IPV4_GROUPS_SIZE]; // Abonnierte Multicast-Gruppen als 32-Bit-Schlssel (0 = frei)
+	ipv4_stats stats;
 } prtcl_types;
 
 typedef struct {
@@ -35,12 +91,34 @@ typedef struct {
 } __attribute__((packed)) ipv4_header;
 
 /* Exported functions prototypes ---------------------------------------------*/
-void ipv4_init(prtcl_types* types_addr);
+void ipv4_init(prtcl_types* types_addr, ip_address* src_ip, ip_address* my_subnet);
 
 void ipv4_add_type(uint8_t type, void* func);
 
+int ipv4_add_group(ip_address group);
+
+void ipv4_del_group(ip_address group);
+
+const ipv4_stats* ipv4_get_stats(void);
+
+mac_address ipv4_multicast_mac(ip_address group);
+
 //int handle_ipv4(uint8_t* buf, uint16_t length);
 
 uint16_t calculate_next_id();
 
+int ipv4_output(uint16_t len, uint8_t* frame);
+
+uint32_t ipv4_pseudo_checksum(ip_address dst, uint8_t prtcl, uint16_t length);
+
+int ipv4_send(ip_address dst, uint8_t prtcl, const uint8_t* header, uint16_t header_len, const uint8_t* payload, uint16_t payload_len, uint8_t prio);
+
+int ipv4_send_batch(ipv4_datagram* dgrams, uint8_t count, uint8_t prio);
+
+int ipv4_begin(ip_address dst, uint8_t prtcl, uint16_t max_len, uint8_t prio);
+
+void ipv4_commit(uint16_t len);
+
+void ipv4_abort(void);
+
 #endif /* __IPV4_H */
\ No newline at end of file
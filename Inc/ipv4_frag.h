@@ -0,0 +1,70 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IPV4_FRAG_H
+#define __IPV4_FRAG_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "eth.h"
+#include "checksum.h"
+
+/* Defines ------------------------------------------------------------------*/
+// Anzahl gleichzeitig zusammengesetzter Datagramme
+#ifndef IPV4_FRAG_SLOTS
+#define IPV4_FRAG_SLOTS 2
+#endif
+// Maximale Nutzdatenlnge eines zusammengesetzten Datagramms (Vielfaches von 64).
+// Zusammen mit IPV4_FRAG_SLOTS ergibt sich die feste Speicherobergrenze der Reassemblierung.
+#ifndef IPV4_FRAG_MAX_SIZE
+#define IPV4_FRAG_MAX_SIZE 2048
+#endif
+// Zeit in ms, nach der ein unvollstndiges Datagramm verworfen wird
+#ifndef IPV4_FRAG_TIMEOUT
+#define IPV4_FRAG_TIMEOUT 5000
+#endif
+
+#define IPV4_FRAG_BLOCKS (IPV4_FRAG_MAX_SIZE / 8) // Fragmente sind in 8-Byte-Blcken adressiert
+#define IPV4_FRAG_HEADER_MAX 60 // Maximale Lnge des IPv4-Headers mit Optionen
+
+//Little Endian
+#define IPV4_FLAG_MF 0x0020 // More Fragments
+#define IPV4_FRAG_OFFSET_MASK 0xFF1F
+
+typedef struct {
+	uint32_t src; // Absender als 32-Bit-Schlssel
+	uint32_t dst;
+	uint16_t ident;
+	uint8_t prtcl;
+	uint8_t in_use;
+	uint8_t header_length; // Lnge des IP-Headers aus dem ersten Fragment (0 = noch nicht empfangen)
+	uint16_t total; // Nutzdatenlnge aus dem letzten Fragment (0 = noch nicht empfangen)
+	uint16_t blocks; // Anzahl der bereits empfangenen 8-Byte-Blcke
+	uint32_t timestamp; // HAL-Tick des ersten Fragments
+	uint8_t bitmap[IPV4_FRAG_BLOCKS / 8]; // Ein Bit je empfangenem 8-Byte-Block
+	// MAC- und IP-Header enden direkt vor den Nutzdaten, damit der Frame ohne Kopie zugestellt werden kann
+	uint8_t frame[sizeof(mac_header) + IPV4_FRAG_HEADER_MAX + IPV4_FRAG_MAX_SIZE];
+} ipv4_frag_slot;
+
+typedef struct {
+	uint32_t fragments; // Empfangene Fragmente
+	uint32_t reassembled; // Vollstndig zusammengesetzte Datagramme
+	uint32_t timeouts; // Wegen IPV4_FRAG_TIMEOUT verworfene Datagramme
+	uint32_t pool_full; // Verworfen, weil kein Slot frei war
+	uint32_t too_big; // Verworfen, weil das Datagramm IPV4_FRAG_MAX_SIZE berschreitet
+	uint32_t bad_fragment; // Fragmente mit ungltiger Lnge oder widersprchlichem Ende
+} ipv4_frag_stats;
+
+typedef struct {
+	ipv4_frag_slot slots[IPV4_FRAG_SLOTS];
+	ipv4_frag_stats stats;
+} ipv4_frag_pool;
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void ipv4_frag_init(ipv4_frag_pool* pool_addr);
+
+const uint8_t* ipv4_frag_input(const uint8_t* buf, uint16_t header_length, uint16_t total_length, uint16_t* frame_length);
+
+void ipv4_frag_tick(void);
+
+const ipv4_frag_stats* ipv4_frag_get_stats(void);
+
+#endif /* __IPV4_FRAG_H */
\ No newline at end of file
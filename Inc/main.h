@@ -5,9 +5,20 @@
 #include "eth.h"
 #include "ipv4.h"
 #include "enc28_j60.h"
+#include "pbuf.h"
+#include "txq.h"
+#include "ratelimit.h"
 #include "arp.h"
+#include "route.h"
 #include "icmp.h"
+#include "ping.h"
+#include "igmp.h"
 #include "udp.h"
+#include "syslog.h"
+#include "telemetry.h"
+#include "tftp.h"
+#include "dns.h"
+#include "sntp.h"
 #include "dhcp.h"
 
 
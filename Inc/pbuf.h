@@ -0,0 +1,49 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PBUF_H
+#define __PBUF_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "eth.h"
+#include "enc28_j60.h"
+
+/* Defines ------------------------------------------------------------------*/
+// Anzahl der Empfangspuffer; einer bleibt immer fr den nchsten Empfang frei
+#ifndef PBUF_POOL_SIZE
+#define PBUF_POOL_SIZE 4
+#endif
+#define PBUF_SIZE (MAX_FRAMELEN + 1) // enc28_packetReceive nutzt hchstens maxlen - 1 Bytes
+
+typedef struct {
+	uint8_t data[PBUF_SIZE];
+	uint16_t len; // Lnge des empfangenen Frames
+	uint8_t ref; // Anzahl der Besitzer (0 = frei)
+} pbuf;
+
+typedef struct {
+	uint32_t alloc_failed; // Kein freier Puffer beim Empfang
+	uint8_t in_use;
+	uint8_t max_in_use;
+} pbuf_stats;
+
+typedef struct {
+	pbuf bufs[PBUF_POOL_SIZE];
+	pbuf_stats stats;
+} pbuf_pool;
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void pbuf_init(pbuf_pool* pool_addr);
+
+pbuf* pbuf_alloc(void);
+
+void pbuf_ref(pbuf* p);
+
+void pbuf_free(pbuf* p);
+
+pbuf* pbuf_from_data(const uint8_t* data);
+
+uint8_t pbuf_available(void);
+
+const pbuf_stats* pbuf_get_stats(void);
+
+#endif /* __PBUF_H */
\ No newline at end of file
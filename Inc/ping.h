@@ -0,0 +1,77 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PING_H
+#define __PING_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "eth.h"
+#include "icmp.h"
+#include "clock.h"
+
+/* Defines ------------------------------------------------------------------*/
+// Maximale Nutzdatenlnge einer Anfrage (belegt einen Puffer dieser Gre)
+#ifndef PING_MAX_SIZE
+#define PING_MAX_SIZE 256
+#endif
+// Gleichzeitig ausstehende Anfragen (Zweierpotenz)
+#ifndef PING_WINDOW
+#define PING_WINDOW 8
+#endif
+// Zeit in ms, nach der eine unbeantwortete Anfrage als verloren zhlt
+#ifndef PING_TIMEOUT
+#define PING_TIMEOUT 1000
+#endif
+// Aufeinanderfolgende Verluste, ab denen das Ziel als nicht erreichbar gilt
+#ifndef PING_HEALTH_LOSS
+#define PING_HEALTH_LOSS 3
+#endif
+
+typedef struct {
+	uint32_t sent;
+	uint32_t received;
+	uint32_t lost; // Nach PING_TIMEOUT ohne Antwort
+	uint32_t late; // Antworten nach Ablauf von PING_TIMEOUT oder unbekannter Sequenz
+	uint32_t rtt_min; // Laufzeiten in s
+	uint32_t rtt_max;
+	uint32_t rtt_avg;
+	uint32_t rtt_last;
+	uint32_t jitter; // Mittlere Abweichung aufeinanderfolgender Laufzeiten in s (RFC 3550, 6.4.1)
+	uint64_t rtt_sum;
+	uint16_t consecutive_lost;
+	uint8_t healthy; // 0 nach PING_HEALTH_LOSS Verlusten in Folge, 1 nach der nchsten Antwort
+} ping_stats;
+
+typedef struct {
+	uint16_t seq;
+	uint8_t valid;
+	uint32_t sent_us; // Sendezeitpunkt (clock_now_us)
+	uint32_t sent_ms; // Sendezeitpunkt (HAL-Tick) fr die Zeitberschreitung
+} ping_request;
+
+typedef struct {
+	ip_address target;
+	uint16_t ident;
+	uint16_t seq; // Sequenznummer der nchsten Anfrage
+	uint16_t size; // Nutzdatenlnge
+	uint16_t remaining; // Noch zu sendende Anfragen (0 = periodisch ohne Ende)
+	uint8_t active;
+	uint8_t endless;
+	uint32_t interval; // Abstand der Anfragen in ms
+	uint32_t next_time; // HAL-Tick der nchsten Anfrage
+	ping_request window[PING_WINDOW];
+	uint8_t data[PING_MAX_SIZE];
+	ping_stats stats;
+} ping_session;
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void ping_init(ping_session* session_addr);
+
+int ping_start(ip_address target, uint16_t size, uint32_t interval, uint16_t count);
+
+void ping_stop(void);
+
+void ping_tick(void);
+
+const ping_stats* ping_get_stats(void);
+
+#endif /* __PING_H */
\ No newline at end of file
@@ -0,0 +1,68 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RATELIMIT_H
+#define __RATELIMIT_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "eth.h"
+#include "enc28_j60.h"
+
+/* Defines ------------------------------------------------------------------*/
+// Klassen der begrenzten Antworten
+#define RATELIMIT_ICMP_ECHO 0 // Echo-Antworten
+#define RATELIMIT_ARP_REPLY 1 // ARP-Antworten auf Anfragen nach der eigenen Adresse
+#define RATELIMIT_ICMP_ERROR 2 // ICMP-Fehlermeldungen (Destination Unreachable usw.)
+#define RATELIMIT_CLASSES 3
+
+// Voreinstellungen: Antworten je Sekunde und maximale Burstgre (0 Antworten/s = unbegrenzt)
+#ifndef RATELIMIT_ICMP_ECHO_RATE
+#define RATELIMIT_ICMP_ECHO_RATE 10
+#endif
+#ifndef RATELIMIT_ICMP_ECHO_BURST
+#define RATELIMIT_ICMP_ECHO_BURST 20
+#endif
+#ifndef RATELIMIT_ARP_REPLY_RATE
+#define RATELIMIT_ARP_REPLY_RATE 20
+#endif
+#ifndef RATELIMIT_ARP_REPLY_BURST
+#define RATELIMIT_ARP_REPLY_BURST 40
+#endif
+#ifndef RATELIMIT_ICMP_ERROR_RATE
+#define RATELIMIT_ICMP_ERROR_RATE 5
+#endif
+#ifndef RATELIMIT_ICMP_ERROR_BURST
+#define RATELIMIT_ICMP_ERROR_BURST 10
+#endif
+
+#define RATELIMIT_TOKEN 1000 // Ein Token in Tausendstel (Auffllen in ms-Schritten ohne Division)
+#define RATELIMIT_MAX_ELAPSED 60000 // Lnger ungenutzte Buckets sind ohnehin voll
+
+typedef struct {
+	uint32_t passed;
+	uint32_t dropped;
+} ratelimit_stats;
+
+typedef struct {
+	uint32_t tokens; // Fllstand in Tausendstel Token
+	uint32_t timestamp; // HAL-Tick des letzten Auffllens
+	uint16_t rate; // Token je Sekunde (0 = unbegrenzt)
+	uint16_t burst; // Kapazitt in Token
+	ratelimit_stats stats;
+} ratelimit_bucket;
+
+typedef struct {
+	ratelimit_bucket data[RATELIMIT_CLASSES];
+} ratelimit_buckets;
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void ratelimit_init(ratelimit_buckets* buckets_addr, ip_address* src_ip);
+
+void ratelimit_config(uint8_t cls, uint16_t rate, uint16_t burst);
+
+int ratelimit_allow(uint8_t cls);
+
+int ratelimit_peek(const uint8_t* header, uint16_t len);
+
+const ratelimit_stats* ratelimit_get_stats(uint8_t cls);
+
+#endif /* __RATELIMIT_H */
\ No newline at end of file
@@ -0,0 +1,108 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ROUTE_H
+#define __ROUTE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "eth.h"
+#include "arp.h"
+#include "ipv4.h"
+
+/* Defines ------------------------------------------------------------------*/
+// Anzahl der Eintrge im Next-Hop-Cache (Zweierpotenz, direkt adressiert)
+#ifndef ROUTE_CACHE_BITS
+#define ROUTE_CACHE_BITS 3
+#endif
+#define ROUTE_CACHE_SIZE (1 << ROUTE_CACHE_BITS)
+
+// Gltigkeit eines Cache-Eintrags in ms (nicht lnger als ein ARP-Eintrag REACHABLE bleibt)
+#ifndef ROUTE_CACHE_TIMEOUT
+#define ROUTE_CACHE_TIMEOUT ARP_REACHABLE_TIME
+#endif
+// Der Gateway-Eintrag wird so viele ms vor seinem Ablauf per ARP aufgefrischt
+#ifndef ROUTE_GW_REFRESH
+#define ROUTE_GW_REFRESH 5000
+#endif
+
+// Kapazitt der Routingtabelle (ohne die Route des eigenen Subnetzes)
+#ifndef ROUTE_TABLE_SIZE
+#define ROUTE_TABLE_SIZE 8
+#endif
+// Jede Route belegt hchstens zwei Knoten im Prfixbaum, dazu kommt die Wurzel (0.0.0.0/0)
+#define ROUTE_NODES (2 * (ROUTE_TABLE_SIZE + 1) + 1)
+#define ROUTE_NONE 0xFF
+
+// Metrik der per DHCP gelernten Routen (Option 3 erhlt je weiterem Router +1)
+#ifndef ROUTE_METRIC_DHCP
+#define ROUTE_METRIC_DHCP 10
+#endif
+
+// Herkunft einer Route
+#define ROUTE_ORIGIN_NONE 0x00 // Eintrag frei
+#define ROUTE_ORIGIN_CONNECTED 0x01 // Eigenes Subnetz (aus Adresse und Subnetzmaske)
+#define ROUTE_ORIGIN_STATIC 0x02
+#define ROUTE_ORIGIN_DHCP 0x03 // DHCP Option 3 bzw. 121
+
+typedef struct {
+	uint32_t prefix; // Netzadresse als 32-Bit-Schlssel
+	uint32_t gateway; // Nchster Hop; 0 = Ziel direkt erreichbar
+	uint16_t metric; // Bei gleichem Prfix gewinnt die kleinere Metrik
+	uint8_t length; // Prfixlnge in Bit
+	uint8_t origin;
+} route_entry;
+
+typedef struct {
+	uint32_t prefix;
+	uint8_t length;
+	uint8_t route; // Index der Route mit genau diesem Prfix (ROUTE_NONE = reiner Verzweigungsknoten)
+	uint8_t child[2]; // Unterbume nach dem Bit an Position length
+} route_node;
+
+typedef struct {
+	route_entry routes[ROUTE_TABLE_SIZE + 1]; // Letzter Eintrag: Route des eigenen Subnetzes
+	route_node nodes[ROUTE_NODES]; // Pfadkomprimierter Binrbaum, Knoten 0 ist die Wurzel
+	uint8_t node_count;
+} route_table;
+
+typedef struct {
+	uint32_t dst; // Ziel-IP als 32-Bit-Schlssel
+	uint32_t next_hop;
+	mac_header header; // Vorgefertigter Ethernet-Header zum nchsten Hop
+	uint32_t timestamp; // HAL-Tick der letzten Besttigung des nchsten Hops
+	uint8_t valid;
+	uint8_t via_gateway; // 1, wenn der Header des Gateway-Eintrags verwendet wird
+} route_cache_entry;
+
+typedef struct {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t no_route; // Verworfen, weil weder Subnetz noch Gateway passen
+} route_stats;
+
+typedef struct {
+	route_cache_entry gateway; // Angepinnter Eintrag des Gateways der Default-Route, wird nie verdrngt
+	route_cache_entry data[ROUTE_CACHE_SIZE];
+	uint32_t refresh_time; // HAL-Tick der letzten Auffrischung des Gateway-Eintrags
+	route_stats stats;
+} route_cache;
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void route_init(route_table* table_addr, route_cache* cache_addr, ip_address* src_ip, ip_address* my_subnet, mac_address src_mac);
+
+int route_add(ip_address prefix, uint8_t length, ip_address gateway, uint16_t metric, uint8_t origin);
+
+void route_del_origin(uint8_t origin);
+
+void route_rebuild(void);
+
+int route_lookup(ip_address dst, mac_header* header, ip_address* next_hop);
+
+void route_cache_update(ip_address ip, mac_address mac);
+
+void route_cache_flush(void);
+
+void route_tick(void);
+
+const route_stats* route_get_stats(void);
+
+#endif /* __ROUTE_H */
\ No newline at end of file
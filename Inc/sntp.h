@@ -0,0 +1,93 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SNTP_H
+#define __SNTP_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "eth.h"
+#include "udp.h"
+#include "clock.h"
+
+/* Defines ------------------------------------------------------------------*/
+//Little Endian
+#define SNTP_PORT 0x7B00 // Port 123
+
+// Anzahl der NTP-Server (aus DHCP Option 42 oder sntp_set_servers)
+#ifndef SNTP_SERVERS
+#define SNTP_SERVERS 2
+#endif
+// Abstand der Messungen in ms: verdoppelt sich bis SNTP_POLL_MAX, solange die gemessene
+// Abweichung unter SNTP_POLL_STABLE (s) bleibt, sonst halbiert er sich bis SNTP_POLL_MIN
+// (RFC 4330: nicht fter als einmal je Minute im Dauerbetrieb)
+#ifndef SNTP_POLL_MIN
+#define SNTP_POLL_MIN 64000
+#endif
+#ifndef SNTP_POLL_MAX
+#define SNTP_POLL_MAX 1024000
+#endif
+#ifndef SNTP_POLL_STABLE
+#define SNTP_POLL_STABLE 1000
+#endif
+// Anfragen je Messung; bernommen wird die mit der krzesten Laufzeit
+#ifndef SNTP_BURST
+#define SNTP_BURST 4
+#endif
+#ifndef SNTP_BURST_INTERVAL
+#define SNTP_BURST_INTERVAL 2000
+#endif
+// Wartezeit in ms auf eine Antwort
+#ifndef SNTP_TIMEOUT
+#define SNTP_TIMEOUT 1000
+#endif
+
+#define SNTP_MSG_LEN 48
+#define SNTP_UNIX_OFFSET 2208988800UL // Sekunden von 1900 bis 1970
+
+// Erstes Byte: Leap Indicator (2 Bit), Version (3 Bit), Mode (3 Bit)
+#define SNTP_LI_ALARM 3 // Server nicht synchronisiert
+#define SNTP_VERSION 4
+#define SNTP_MODE_CLIENT 3
+#define SNTP_MODE_SERVER 4
+
+#define SNTP_IDLE 0
+#define SNTP_WAIT 1 // Anfrage gesendet, Antwort ausstehend
+
+typedef struct {
+	uint32_t requests;
+	uint32_t responses; // Gltige Antworten
+	uint32_t timeouts;
+	uint32_t rejected; // Unpassender Absender oder Originate, falscher Mode, Server nicht synchronisiert
+	uint32_t kiss_of_death; // Stratum 0: der Server verweigert die Antwort (RFC 4330, 8)
+	uint32_t failovers; // Wechsel zum nchsten Server (Messung ohne Antwort oder Kiss-o'-Death)
+	uint32_t updates; // An die Uhr bergebene Messungen
+	uint32_t delay; // Laufzeit der letzten bernommenen Messung in s
+} sntp_stats;
+
+typedef struct {
+	ip_address servers[SNTP_SERVERS];
+	uint8_t server_count;
+	uint8_t server; // Index des aktuellen Servers
+	int sock;
+	uint8_t state;
+	uint8_t sent_count; // Anfragen der laufenden Messung
+	uint8_t samples; // Gltige Antworten der laufenden Messung
+	uint8_t origin[8]; // Transmit Timestamp der Anfrage, kommt als Originate Timestamp zurck
+	uint64_t t1; // Disziplinierte Zeit beim Senden in s
+	uint32_t sent; // HAL-Tick des Sendens
+	uint32_t next; // HAL-Tick der nchsten Anfrage
+	uint32_t poll; // Abstand der Messungen in ms
+	int64_t best_offset; // Abweichung der Antwort mit der krzesten Laufzeit in s
+	uint32_t best_delay;
+	sntp_stats stats;
+} sntp_client;
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void sntp_init(sntp_client* client_addr);
+
+void sntp_set_servers(const ip_address* servers, uint8_t count);
+
+void sntp_tick(void);
+
+const sntp_stats* sntp_get_stats(void);
+
+#endif /* __SNTP_H */
\ No newline at end of file
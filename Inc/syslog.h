@@ -0,0 +1,129 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SYSLOG_H
+#define __SYSLOG_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdarg.h>
+#include "eth.h"
+#include "udp.h"
+#include "clock.h"
+
+/* Defines ------------------------------------------------------------------*/
+//Little Endian
+#define SYSLOG_PORT 0x0202 // Port 514
+
+// Schweregrade (RFC 5424, 6.2.1)
+#define SYSLOG_EMERG 0
+#define SYSLOG_ALERT 1
+#define SYSLOG_CRIT 2
+#define SYSLOG_ERR 3
+#define SYSLOG_WARNING 4
+#define SYSLOG_NOTICE 5
+#define SYSLOG_INFO 6
+#define SYSLOG_DEBUG 7
+#define SYSLOG_OFF 0xFF // Fr syslog_set_level: nichts protokollieren
+
+// Schweregrade oberhalb dieser Grenze werden gar nicht erst bersetzt
+#ifndef SYSLOG_COMPILE_LEVEL
+#define SYSLOG_COMPILE_LEVEL SYSLOG_DEBUG
+#endif
+// Voreingestellter Schweregrad zur Laufzeit
+#ifndef SYSLOG_LEVEL
+#define SYSLOG_LEVEL SYSLOG_INFO
+#endif
+// Facility im PRI-Feld (16 = local0)
+#ifndef SYSLOG_FACILITY
+#define SYSLOG_FACILITY 16
+#endif
+#ifndef SYSLOG_APP_NAME
+#define SYSLOG_APP_NAME "enc28net"
+#endif
+
+// Gre des Rings in Bytes (Zweierpotenz)
+#ifndef SYSLOG_RING_SIZE
+#define SYSLOG_RING_SIZE 2048
+#endif
+#define SYSLOG_MASK (SYSLOG_RING_SIZE - 1)
+// Maximale Lnge einer formatierten Zeile, hchstens 255 (wird auf dem Stack des Aufrufers formatiert)
+#ifndef SYSLOG_LINE_MAX
+#define SYSLOG_LINE_MAX 96
+#endif
+// So lange in ms darf eine Zeile hchstens auf weitere warten
+#ifndef SYSLOG_DEADLINE
+#define SYSLOG_DEADLINE 100
+#endif
+// Voreingestelltes Bandbreitenbudget in Byte/s (Nutzdaten)
+#ifndef SYSLOG_BUDGET
+#define SYSLOG_BUDGET 2000
+#endif
+// Jede Nachricht ist ein eigenes Datagramm (RFC 5426, 3.1), hchstens SYSLOG_HEADER_MAX + SYSLOG_LINE_MAX
+// Byte und damit unter den 480 Byte, die Empfnger mindestens annehmen mssen. Gesendet wird in
+// Stapeln von hchstens SYSLOG_BATCH Nachrichten bzw. SYSLOG_BATCH_BYTES Nutzdaten
+#ifndef SYSLOG_BATCH
+#define SYSLOG_BATCH TXQ_DEPTH
+#endif
+#ifndef SYSLOG_BATCH_BYTES
+#define SYSLOG_BATCH_BYTES 1024
+#endif
+
+// Jede Zeile im Ring: Lnge, Zustand, Schweregrad, HAL-Tick (4 Byte, Little Endian), dann der Text
+#define SYSLOG_RECORD_HEADER 7
+#define SYSLOG_HEADER_MAX 128 // Kopf einer Nachricht von PRI bis Structured Data
+#define SYSLOG_RESERVED 0 // Platz belegt, der Schreiber kopiert noch
+#define SYSLOG_COMMITTED 1
+
+// Eine Zeile protokollieren; kostet bei abgeschaltetem Schweregrad einen Vergleich
+#define SYSLOG(severity, ...) do { \
+	if ((severity) <= SYSLOG_COMPILE_LEVEL && (severity) < syslog_threshold) { \
+		syslog_write((severity), __VA_ARGS__); \
+	} \
+} while (0)
+
+typedef struct {
+	uint32_t lines; // In den Ring geschriebene Zeilen
+	uint32_t dropped; // Verworfen, weil der Ring voll war
+	uint32_t truncated; // Auf SYSLOG_LINE_MAX gekrzt
+	uint32_t sent; // Gesendete Zeilen
+	uint32_t datagrams; // Gesendete Datagramme (eine Zeile bzw. Meldung ber verworfene Zeilen je Datagramm)
+	uint32_t bytes;
+	uint32_t budget_waits; // Senden wegen des Bandbreitenbudgets verschoben
+} syslog_stats;
+
+typedef struct {
+	uint8_t ring[SYSLOG_RING_SIZE];
+	volatile uint16_t head; // Reservierungsposition (freilaufend)
+	volatile uint16_t tail; // lteste ungesendete Zeile, nur vom Drain verndert
+	volatile uint16_t dropped_since; // Seit der letzten gesendeten Meldung darber verworfen
+	uint8_t active;
+	int sock;
+	ip_address* src_ip; // HOSTNAME der Nachrichten
+	ip_address collector;
+	uint16_t port; // Little Endian
+	uint32_t budget; // Byte/s (0 = unbegrenzt)
+	uint32_t tokens; // Verfgbares Budget in Tausendstel Byte
+	uint32_t timestamp; // HAL-Tick des letzten Auffllens
+	uint32_t seq; // sequenceId der nchsten Zeile (RFC 5424, 7.3.1)
+	syslog_stats stats;
+} syslog_ring;
+
+extern volatile uint8_t syslog_threshold; // Zeilen mit kleinerem Schweregrad werden geschrieben
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void syslog_init(syslog_ring* ring_addr, ip_address* src_ip);
+
+int syslog_start(ip_address collector, uint16_t port, uint32_t budget);
+
+void syslog_stop(void);
+
+void syslog_set_level(uint8_t severity);
+
+void syslog_write(uint8_t severity, const char* format, ...);
+
+void syslog_vwrite(uint8_t severity, const char* format, va_list args);
+
+void syslog_tick(void);
+
+const syslog_stats* syslog_get_stats(void);
+
+#endif /* __SYSLOG_H */
\ No newline at end of file
@@ -0,0 +1,81 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "eth.h"
+#include "udp.h"
+
+/* Defines ------------------------------------------------------------------*/
+// Gre des Rings fr ungesendete Datenstze in Bytes (Zweierpotenz)
+#ifndef TELEMETRY_RING_SIZE
+#define TELEMETRY_RING_SIZE 2048
+#endif
+#define TELEMETRY_MASK (TELEMETRY_RING_SIZE - 1)
+// Maximale Lnge eines Datensatzes
+#ifndef TELEMETRY_RECORD_MAX
+#define TELEMETRY_RECORD_MAX 64
+#endif
+// Standardfrist in ms: so lange darf ein Datensatz hchstens auf weitere warten
+#ifndef TELEMETRY_DEADLINE
+#define TELEMETRY_DEADLINE 20
+#endif
+// Nutzdaten eines Datagramms (ohne Fragmentierung)
+#ifndef TELEMETRY_PAYLOAD
+#define TELEMETRY_PAYLOAD (IPV4_MTU - sizeof(ipv4_header) - sizeof(udp_header))
+#endif
+
+// Jeder Datensatz: Lnge (1 Byte) und Zeitstempel in ms (2 Byte, Big Endian), dann die Daten.
+// Im Ring und im Datagramm identisch, damit direkt aus dem Ring gesendet werden kann.
+#define TELEMETRY_RECORD_HEADER 3
+
+typedef struct {
+	uint32_t seq; // Big Endian; Lcken zeigen dem Empfnger verlorene Datagramme
+	uint16_t records; // Big Endian; Anzahl der Datenstze
+	uint16_t dropped; // Big Endian; seit dem vorigen Datagramm lokal verworfene Datenstze
+} __attribute__((packed)) telemetry_header;
+
+typedef struct {
+	uint32_t samples; // Angenommene Datenstze
+	uint32_t dropped; // Verworfen (Drop-Oldest bei vollem Ring oder zu lang)
+	uint32_t datagrams;
+	uint32_t records_sent;
+	uint32_t delay_sum; // Summe der Wartezeiten gesendeter Datenstze in ms
+	uint32_t samples_per_s; // Raten der letzten vollen Sekunde
+	uint32_t datagrams_per_s;
+	uint32_t mean_delay; // Mittlere Wartezeit bis zum Senden in ms
+} telemetry_stats;
+
+typedef struct {
+	uint8_t ring[TELEMETRY_RING_SIZE];
+	uint16_t head; // Schreibposition (freilaufend, modulo TELEMETRY_RING_SIZE)
+	uint16_t tail; // ltester ungesendeter Datensatz
+	uint8_t sending; // 1, whrend Datenstze aus dem Ring gesendet werden (dann kein Drop-Oldest)
+	uint8_t active;
+	int sock;
+	ip_address collector;
+	uint16_t port; // Little Endian
+	uint16_t deadline; // ms
+	uint32_t seq;
+	uint16_t dropped_since; // Seit dem letzten Datagramm verworfen
+	uint32_t rate_time; // HAL-Tick des Beginns des Messfensters
+	uint32_t rate_samples; // Zhlerstnde zu Beginn des Messfensters
+	uint32_t rate_datagrams;
+	telemetry_stats stats;
+} telemetry_stream;
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void telemetry_init(telemetry_stream* stream_addr);
+
+int telemetry_start(ip_address collector, uint16_t port, uint16_t deadline);
+
+void telemetry_stop(void);
+
+int telemetry_publish(const uint8_t* data, uint8_t len);
+
+void telemetry_tick(void);
+
+const telemetry_stats* telemetry_get_stats(void);
+
+#endif /* __TELEMETRY_H */
\ No newline at end of file
@@ -0,0 +1,126 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TFTP_H
+#define __TFTP_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "eth.h"
+#include "udp.h"
+#include "syslog.h"
+
+/* Defines ------------------------------------------------------------------*/
+//Little Endian
+#define TFTP_PORT 0x4500 // Port 69
+
+// Opcodes (RFC 1350, RFC 2347)
+#define TFTP_RRQ 1
+#define TFTP_WRQ 2
+#define TFTP_DATA 3
+#define TFTP_ACK 4
+#define TFTP_ERROR 5
+#define TFTP_OACK 6
+
+// Fehlercodes
+#define TFTP_ERR_UNDEFINED 0
+#define TFTP_ERR_NOT_FOUND 1
+#define TFTP_ERR_ACCESS 2
+#define TFTP_ERR_DISK_FULL 3
+#define TFTP_ERR_ILLEGAL 4
+#define TFTP_ERR_UNKNOWN_TID 5
+#define TFTP_ERR_OPTION 8
+
+// Blockgre ohne Optionen (RFC 1350) und grte Blockgre ohne IP-Fragmentierung (RFC 2348)
+#define TFTP_BLKSIZE_DEFAULT 512
+#define TFTP_BLKSIZE_MAX (IPV4_MTU - sizeof(ipv4_header) - sizeof(udp_header) - 4)
+// Angefragte bzw. hchstens angenommene Blockgre (bis TFTP_BLKSIZE_MAX; Zweierpotenz: die Blcke teilen die Puffer ohne Rest)
+#ifndef TFTP_BLKSIZE
+#define TFTP_BLKSIZE 1024
+#endif
+// Gre jedes der beiden Puffer vor der Senke, z.B. zwei Flash-Pages
+#ifndef TFTP_BUF_SIZE
+#define TFTP_BUF_SIZE 4096
+#endif
+// Angefragte bzw. hchstens angenommene Fenstergre in Blcken (RFC 7440). Ein Fenster wird
+// zustzlich auf TFTP_BUF_SIZE begrenzt, damit es nach dem ACK sicher in die Puffer passt.
+#ifndef TFTP_WINDOWSIZE
+#define TFTP_WINDOWSIZE 8
+#endif
+// Wartezeit in ms bis zur Wiederholung des letzten ACK bzw. der Anfrage
+#ifndef TFTP_TIMEOUT
+#define TFTP_TIMEOUT 1000
+#endif
+#ifndef TFTP_RETRIES
+#define TFTP_RETRIES 5
+#endif
+#define TFTP_NAME_MAX 64
+
+// Zustnde einer bertragung
+#define TFTP_IDLE 0
+#define TFTP_REQUEST 1 // RRQ gesendet, warten auf OACK oder den ersten Block
+#define TFTP_TRANSFER 2
+#define TFTP_FLUSH 3 // Letzter Block empfangen, die Senke schreibt noch
+#define TFTP_DONE 4
+#define TFTP_FAILED 5
+
+#define TFTP_NO_BUF 0xFF
+
+// Ziel der empfangenen Daten, z.B. ein Flash-Schreiber
+typedef struct {
+	int (*open)(const char* name); // 0 = annehmen, -1 = ablehnen
+	int (*write)(uint32_t offset, const uint8_t* data, uint16_t len); // Startet das Schreiben eines Puffers; 0 = ok
+	int (*busy)(void); // 1, solange der letzte write luft (NULL = write arbeitet synchron)
+	void (*close)(int ok); // Ende der bertragung; ok = 0 nach einem Fehler
+} tftp_sink;
+
+typedef struct {
+	uint32_t bytes;
+	uint32_t blocks;
+	uint32_t timeouts; // Wiederholte ACKs bzw. Anfragen nach TFTP_TIMEOUT
+	uint32_t out_of_order; // Blcke mit unerwarteter Nummer (verworfen, Fenster wird ab dem letzten guten neu angefordert)
+	uint32_t stalls; // Blcke verworfen, weil beide Puffer belegt waren
+	uint32_t deferred; // Fenster-ACKs, die bis zum Ende eines Schreibvorgangs der Senke zurckgehalten wurden
+	uint32_t duration; // Dauer der letzten bertragung in ms
+} tftp_stats;
+
+typedef struct {
+	const tftp_sink* sink;
+	const tftp_sink* server_sink; // Senke fr WRQ an den Server (NULL = Server aus)
+	int server_sock;
+	int sock; // Socket der laufenden bertragung (eigene TID)
+	uint8_t state;
+	ip_address peer;
+	uint16_t peer_port; // Little Endian; 0 = noch unbekannt (Client vor der ersten Antwort)
+	uint16_t blksize;
+	uint16_t windowsize;
+	uint16_t block; // Letzter in Reihenfolge empfangener Block
+	uint16_t window_count; // Blcke seit dem letzten ACK
+	uint8_t gap_acked; // Nach einer Lcke wurde das ACK des letzten guten Blocks bereits gesendet
+	uint8_t stalled; // Das nchste ACK wartet, bis die Senke einen Puffer freigibt
+	uint8_t retries;
+	uint32_t last_time; // HAL-Tick der letzten Aktivitt
+	uint32_t start_time;
+	uint8_t buf[2][TFTP_BUF_SIZE]; // Doppelpuffer: einer wird gefllt, der andere von der Senke geschrieben
+	uint8_t cur; // Puffer, der gerade gefllt wird
+	uint8_t writing; // Puffer, den die Senke gerade schreibt (TFTP_NO_BUF = keiner)
+	uint16_t fill;
+	uint32_t offset; // Dateiposition des Pufferbeginns von cur
+	char name[TFTP_NAME_MAX];
+	tftp_stats stats;
+} tftp_session;
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void tftp_init(tftp_session* session_addr);
+
+int tftp_server_start(const tftp_sink* sink);
+
+void tftp_server_stop(void);
+
+int tftp_get(ip_address server, const char* name, const tftp_sink* sink);
+
+void tftp_tick(void);
+
+uint8_t tftp_get_state(void);
+
+const tftp_stats* tftp_get_stats(void);
+
+#endif /* __TFTP_H */
\ No newline at end of file
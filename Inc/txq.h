@@ -0,0 +1,114 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TXQ_H
+#define __TXQ_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "eth.h"
+#include "enc28_j60.h"
+
+/* Defines ------------------------------------------------------------------*/
+// Priorittsklassen, 0 ist die hchste
+#define TXQ_PRIO_CONTROL 0 // ARP, IGMP, Routing (DSCP CS6/CS7)
+#define TXQ_PRIO_EXPEDITED 1 // Steuerantworten (DSCP EF, CS4/CS5, AF4x)
+#define TXQ_PRIO_DEFAULT 2 // Best Effort (DSCP 0)
+#define TXQ_PRIO_BULK 3 // Telemetrie, Massendaten (DSCP CS1, AF1x)
+#define TXQ_CLASSES 4
+
+// Frames je Priorittsklasse
+#ifndef TXQ_DEPTH
+#define TXQ_DEPTH 8
+#endif
+// Nach so vielen Frames hherer Klassen wird eine wartende niedrigere Klasse einmal bedient
+#ifndef TXQ_STARVATION_LIMIT
+#define TXQ_STARVATION_LIMIT 16
+#endif
+
+// Der bertragungspuffer wird in Blcken zu TXQ_GRANULE Bytes vergeben
+#define TXQ_GRANULE 256
+#define TXQ_GRANULES ((TXSTOP_INIT + 1 - TXSTART_INIT) / TXQ_GRANULE)
+// Kontrollbyte vor und Statusvektor nach dem Frame (FIGURE 7-2)
+#define TXQ_FRAME_OVERHEAD (1 + 7)
+// Ein Stapel (txq_batch_begin) belegt hchstens die Hlfte des bertragungspuffers
+#define TXQ_BATCH_MAX (TXQ_GRANULES * TXQ_GRANULE / 2)
+
+typedef struct {
+	uint16_t addr; // Startadresse im bertragungspuffer (Kontrollbyte)
+	uint16_t len; // Lnge des Frames
+	uint32_t timestamp; // HAL-Tick des Einreihens
+	uint8_t first; // Erster belegter Block
+	uint8_t count; // Anzahl der belegten Blcke
+} txq_frame;
+
+typedef struct {
+	uint32_t enqueued;
+	uint32_t sent;
+	uint32_t starvation; // Wegen TXQ_STARVATION_LIMIT vor hheren Klassen gesendet
+	uint32_t latency_sum; // Summe der Wartezeiten in ms (Einreihen bis Sendebeginn)
+	uint32_t latency_max; // Lngste Wartezeit in ms
+	uint16_t depth; // Aktuell wartende Frames
+	uint16_t max_depth;
+} txq_class_stats;
+
+typedef struct {
+	txq_class_stats classes[TXQ_CLASSES];
+	uint32_t blocked; // Sendeaufrufe, die auf freien Pufferspeicher warten mussten
+	uint32_t dropped; // Frames lnger als MAX_FRAMELEN
+	uint32_t tx_errors; // Vom ENC28J60 abgebrochene bertragungen
+} txq_stats;
+
+typedef struct {
+	txq_frame ring[TXQ_DEPTH];
+	uint8_t head;
+	uint8_t count;
+	uint8_t starved; // Frames hherer Klassen seit der letzten Bedienung dieser Klasse
+} txq_class;
+
+typedef struct {
+	txq_class classes[TXQ_CLASSES];
+	uint32_t granules; // Belegte Blcke des bertragungspuffers (ein Bit je Block)
+	txq_frame pending; // Frame zwischen txq_begin und txq_end
+	uint8_t pending_prio;
+	txq_frame batch; // Belegter Bereich zwischen txq_batch_begin und txq_batch_end
+	uint8_t batch_frames; // Bisher mit txq_batch_add begonnene Frames des Stapels
+	txq_frame in_flight; // Frame, der gerade gesendet wird
+	uint8_t busy;
+	txq_stats stats;
+} txq_queues;
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void txq_init(txq_queues* queues_addr);
+
+int txq_begin(uint16_t len, uint8_t prio);
+
+void txq_write(uint16_t len, const uint8_t* data);
+
+void txq_copy_rx(uint16_t len);
+
+void txq_patch(uint16_t offset, uint16_t len, const uint8_t* data);
+
+void txq_seek(uint16_t offset);
+
+void txq_trim(uint16_t len);
+
+void txq_abort(void);
+
+void txq_end(void);
+
+int txq_send(uint16_t len, const uint8_t* frame, uint8_t prio);
+
+int txq_batch_begin(uint16_t total, uint8_t frames, uint8_t prio);
+
+void txq_batch_add(uint16_t len);
+
+void txq_batch_end(void);
+
+void txq_poll(void);
+
+uint8_t txq_prio_from_tos(uint8_t tos);
+
+uint8_t txq_tos(uint8_t prio);
+
+const txq_stats* txq_get_stats(void);
+
+#endif /* __TXQ_H */
\ No newline at end of file
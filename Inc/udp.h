@@ -7,21 +7,95 @@
 #include "eth.h"
 #include "ipv4.h"
 #include "arp.h"
+#include "pbuf.h"
 
 /* Defines ------------------------------------------------------------------*/
-#define UDP_SERVICES_SIZE 2
+// Anzahl der Sockets (einschlielich der Dienste aus udp_add_type, z.B. DHCP), hchstens 255
+#ifndef UDP_SOCKETS
+#define UDP_SOCKETS 9
+#endif
+// Datagramme, die ein Socket ohne Handler hchstens zwischenspeichert
+#ifndef UDP_RING_SIZE
+#define UDP_RING_SIZE 4
+#endif
 //Little Endian
 #define UDP_TYPE 	0x11
 
+// udp_bind mit Port 0 vergibt einen freien Port aus dem dynamischen Bereich (RFC 6335)
+#define UDP_PORT_ANY 0x0000
+#ifndef UDP_EPHEMERAL_FIRST
+#define UDP_EPHEMERAL_FIRST 49152
+#endif
+#ifndef UDP_EPHEMERAL_LAST
+#define UDP_EPHEMERAL_LAST 65535
+#endif
+#define UDP_NO_SOCKET 0xFF
+
+// Prfung der UDP-Prfsumme beim Empfang, je Socket
+#define UDP_CSUM_VERIFY 0 // Prfen; Datagramme ohne Prfsumme (Feld 0) verwerfen
+#define UDP_CSUM_ZERO_OK 1 // Prfen; Datagramme ohne Prfsumme annehmen (RFC 768, Standard)
+#define UDP_CSUM_TRUST 2 // Nicht prfen (z.B. wenn die Anwendung eigene Prfsummen fhrt)
+
+// Verarbeitet ein Datagramm synchron im Empfangspfad: offset = Beginn der UDP-Nutzdaten im Frame,
+// len = ihre Lnge (von handle_udp gegen den Frame geprft), src und sport (Little Endian) = Absender
+typedef int (*udp_handler)(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport);
+
+typedef struct {
+	pbuf* buf; // Referenz auf den empfangenen Frame
+	uint16_t offset; // Beginn der Nutzdaten im Frame
+	uint16_t len; // Lnge der Nutzdaten
+	ip_address src;
+	uint16_t sport; // Little Endian
+} udp_datagram;
+
+typedef struct {
+	uint32_t received; // Zugestellte bzw. eingereihte Datagramme
+	uint32_t dropped_full; // Verworfen, weil der Ring voll war (Anwendung zu langsam)
+	uint32_t dropped_nobuf; // Verworfen, weil sonst kein Empfangspuffer frei geblieben wre
+	uint32_t bad_checksum; // Verworfen wegen falscher Prfsumme
+	uint32_t no_checksum; // Ohne Prfsumme empfangen (je nach Richtlinie angenommen oder verworfen)
+} udp_socket_stats;
+
 typedef struct {
-	uint16_t lport;
-	int (*func)(const uint8_t* buf, uint16_t length);
-} udp_serivce;
+	uint16_t lport; // Little Endian
+	uint8_t in_use;
+	uint8_t prio; // Priorittsklasse fr udp_sendto
+	uint8_t csum_policy; // UDP_CSUM_*
+	udp_handler func; // NULL = Datagramme im Ring ablegen
+	udp_datagram ring[UDP_RING_SIZE];
+	uint8_t head;
+	uint8_t count;
+	udp_socket_stats stats;
+} udp_socket;
 
 typedef struct {
-	udp_serivce serivces[UDP_SERVICES_SIZE];
-	uint8_t idx;
-} udp_serivces;
+	ip_address dst;
+	uint16_t dport; // Little Endian
+	const uint8_t* data;
+	uint16_t len;
+	int8_t status; // Ergebnis wie bei udp_send (1 eingereiht, 0 ARP-Auflsung luft, -1 verworfen)
+} udp_msg;
+
+typedef struct {
+	ip_address dst;
+	uint16_t dport; // Little Endian
+	uint16_t len; // Bisher geschriebene Nutzdaten
+	uint16_t max_len; // Bei udp_alloc reservierte Nutzdaten
+	uint32_t sum; // Laufende Prfsumme der geschriebenen Nutzdaten
+	uint8_t sock;
+	uint8_t active; // 1 zwischen udp_alloc und udp_commit bzw. udp_abort
+} udp_writer;
+
+typedef struct {
+	udp_socket sockets[UDP_SOCKETS];
+	uint16_t ports[UDP_SOCKETS]; // Ports der belegten Sockets aufsteigend (Host-Byte-Order), Schlssel der binren Suche
+	uint8_t index[UDP_SOCKETS]; // Socket zum Port an derselben Position in ports
+	uint8_t bound; // Anzahl der Eintrge in ports und index
+	uint8_t wildcard; // Socket fr Datagramme an Ports ohne eigenen Socket (UDP_NO_SOCKET = keiner)
+	uint16_t next_ephemeral; // Nchster Kandidat fr einen dynamischen Port (Host-Byte-Order)
+	udp_writer tx; // Datagramm, das gerade direkt im bertragungspuffer entsteht
+	uint32_t no_socket; // Datagramme an Ports ohne Socket
+} udp_sockets;
 
 typedef struct{
 	uint16_t src;
@@ -32,13 +106,41 @@ typedef struct{
 
 
 /* Exported functions prototypes ---------------------------------------------*/
-void udp_init(udp_serivces* types_addr);
+void udp_init(udp_sockets* sockets_addr);
 
 void udp_add_type(uint16_t lport, void* func);
 
-uint16_t udp_checksum(ipv4_header *ip_header, udp_header *udp_header, uint8_t *payload, size_t payload_size);
+int udp_bind(uint16_t lport, udp_handler func);
+
+void udp_close(int sock);
+
+void udp_set_wildcard(int sock);
+
+uint16_t udp_get_port(int sock);
+
+int udp_recvfrom(int sock, uint8_t* data, uint16_t size, ip_address* src, uint16_t* sport);
+
+int udp_sendto(int sock, const uint8_t* data, uint16_t len, ip_address dst, uint16_t dport);
+
+int udp_sendmmsg(int sock, udp_msg* msgs, uint8_t count);
+
+int udp_alloc(int sock, ip_address dst, uint16_t dport, uint16_t max_len);
+
+uint16_t udp_write(const uint8_t* data, uint16_t len);
+
+int udp_commit(void);
+
+void udp_abort(void);
+
+void udp_set_priority(int sock, uint8_t prio);
+
+void udp_set_checksum_policy(int sock, uint8_t policy);
+
+const udp_socket_stats* udp_get_stats(int sock);
+
+int udp_send(ip_address dst, uint16_t sport, uint16_t dport, const uint8_t* payload, uint16_t len, uint8_t prio);
 
-//void send_udp(ip_address target_ip, uint16_t src, uint16_t dest, uint8_t* payload);
+uint16_t udp_checksum(ipv4_header *ip_header, udp_header *header, uint8_t *payload, size_t payload_size);
 
 //int handle_udp(uint8_t* buf, uint16_t length);
 
@@ -7,8 +7,21 @@ static mac_address my_mac;
 
 /* Private functions prototypes ---------------------------------------------*/
 int handle_arp(const uint8_t* buf, uint16_t length);
-void add_to_arp_table(arp_entry entry);
+static uint16_t arp_hash(uint32_t ip);
+static uint16_t arp_find(uint32_t ip);
+static void arp_lru_unlink(uint16_t idx);
+static void arp_lru_push_front(uint16_t idx);
+static void arp_remove(uint16_t idx);
+static uint16_t arp_alloc(uint32_t ip);
+static uint16_t arp_age(uint16_t idx);
+static void arp_pending_unlink(uint16_t idx);
+static void arp_request(uint16_t idx);
+static void arp_retry(uint16_t idx);
+static void arp_queue_drop(uint16_t idx);
+static void arp_queue_flush(uint16_t idx);
+void add_to_arp_table(ip_address ip, mac_address mac);
 int get_mac_from_table(ip_address ip, mac_address* mac);
+static int arp_merge(const uint8_t* buf);
 void get_arp_rep(const uint8_t* buf);
 void send_arp_req(ip_address src_ip, mac_address src_mac, ip_address target_ip);
 void send_arp_rep(ip_address src_ip, mac_address src_mac, ip_address target_ip, mac_address target_mac);
@@ -33,107 +46,441 @@ void arp_table_init(arp_table* table_adr, ip_address* src_ip, mac_address src_ma
 	my_ip_addr = src_ip;
 	my_mac = src_mac;
 	
-  table->tail = 0;
+	// Alle Buckets leeren
+	for (uint16_t i = 0; i < ARP_HASH_SIZE; i++) {
+		table->buckets[i] = ARP_NONE;
+	}
+	
+	// Alle Eintrge als frei markieren und in die Freiliste einhngen
+	for (uint16_t i = 0; i < ARP_TABLE_SIZE; i++) {
+		table->data[i].state = ARP_STATE_FREE;
+		table->data[i].hash_next = (i + 1 < ARP_TABLE_SIZE) ? i + 1 : ARP_NONE;
+	}
+	table->free_head = 0;
+	table->pending_head = ARP_NONE;
+	
+	// Alle Pltze der Warteschlange in die Freiliste einhngen
+	for (uint16_t i = 0; i < ARP_QUEUE_SIZE; i++) {
+		table->queue[i].owner = ARP_NONE;
+		table->queue[i].next = (i + 1 < ARP_QUEUE_SIZE) ? i + 1 : ARP_NONE;
+	}
+	table->queue_free = 0;
+	
+	table->lru_head = ARP_NONE;
+	table->lru_tail = ARP_NONE;
+	table->count = 0;
+	table->stats = (arp_stats){0};
+}
+
+/**
+ * Berechnet den Hash-Bucket fr eine IP-Adresse (multiplikatives Hashing nach Knuth).
+ *
+ * @param ip Die IP-Adresse als 32-Bit-Wert.
+ * @return Der Index des Buckets.
+ */
+static uint16_t arp_hash(uint32_t ip) {
+	return (uint16_t)((ip * 2654435761u) >> (32 - ARP_HASH_BITS));
+}
+
+/**
+ * Sucht den Eintrag zu einer IP-Adresse ber den Hash-Index.
+ *
+ * @param ip Die IP-Adresse als 32-Bit-Wert.
+ * @return Der Index des Eintrags oder ARP_NONE, wenn kein Eintrag existiert.
+ */
+static uint16_t arp_find(uint32_t ip) {
+	uint16_t idx = table->buckets[arp_hash(ip)];
+	
+	// Durchluft die (kurze) Kette des Buckets
+	while (idx != ARP_NONE) {
+		if (table->data[idx].ip == ip) {
+			return idx;
+		}
+		idx = table->data[idx].hash_next;
+	}
+	return ARP_NONE;
+}
+
+/**
+ * Entfernt einen Eintrag aus der LRU-Liste.
+ *
+ * @param idx Der Index des Eintrags.
+ */
+static void arp_lru_unlink(uint16_t idx) {
+	arp_entry* e = &table->data[idx];
+	
+	if (e->lru_prev != ARP_NONE) {
+		table->data[e->lru_prev].lru_next = e->lru_next;
+	} else {
+		table->lru_head = e->lru_next;
+	}
+	if (e->lru_next != ARP_NONE) {
+		table->data[e->lru_next].lru_prev = e->lru_prev;
+	} else {
+		table->lru_tail = e->lru_prev;
+	}
+}
+
+/**
+ * Hngt einen Eintrag als zuletzt benutzten Eintrag an den Anfang der LRU-Liste.
+ *
+ * @param idx Der Index des Eintrags.
+ */
+static void arp_lru_push_front(uint16_t idx) {
+	arp_entry* e = &table->data[idx];
+	
+	e->lru_prev = ARP_NONE;
+	e->lru_next = table->lru_head;
+	if (table->lru_head != ARP_NONE) {
+		table->data[table->lru_head].lru_prev = idx;
+	} else {
+		table->lru_tail = idx;
+	}
+	table->lru_head = idx;
+}
+
+/**
+ * Entfernt einen Eintrag aus Hash-Index und LRU-Liste und gibt ihn frei.
+ *
+ * @param idx Der Index des Eintrags.
+ */
+static void arp_remove(uint16_t idx) {
+	arp_entry* e = &table->data[idx];
+	uint16_t* link = &table->buckets[arp_hash(e->ip)];
+	
+	// Eintrag aus der Kette des Buckets aushngen
+	while (*link != idx) {
+		link = &table->data[*link].hash_next;
+	}
+	*link = e->hash_next;
+	
+	arp_lru_unlink(idx);
+	
+	// Laufende Auflsung beenden; noch wartende Frames knnen nicht mehr zugestellt werden
+	if (e->state == ARP_STATE_INCOMPLETE) {
+		arp_pending_unlink(idx);
+	}
+	arp_queue_drop(idx);
+	
+	// Eintrag in die Freiliste zurcklegen
+	e->state = ARP_STATE_FREE;
+	e->hash_next = table->free_head;
+	table->free_head = idx;
+	table->count--;
+}
+
+/**
+ * Legt einen neuen Eintrag fr die angegebene IP-Adresse an. Ist die Tabelle voll,
+ * wird der am lngsten unbenutzte Eintrag verdrngt.
+ *
+ * @param ip Die IP-Adresse als 32-Bit-Wert.
+ * @return Der Index des neuen Eintrags.
+ */
+static uint16_t arp_alloc(uint32_t ip) {
+	// Tabelle voll: LRU-Eintrag verdrngen
+	if (table->free_head == ARP_NONE) {
+		arp_remove(table->lru_tail);
+		table->stats.evictions++;
+	}
+	
+	uint16_t idx = table->free_head;
+	arp_entry* e = &table->data[idx];
+	table->free_head = e->hash_next;
+	
+	// In den Hash-Index einhngen
+	uint16_t bucket = arp_hash(ip);
+	e->ip = ip;
+	e->req_time = HAL_GetTick(); // Nicht den Wert des verdrngten Eintrags bernehmen
+	e->retries = 0;
+	e->queue_head = ARP_NONE;
+	e->queue_len = 0;
+	e->hash_next = table->buckets[bucket];
+	table->buckets[bucket] = idx;
+	
+	arp_lru_push_front(idx);
+	table->count++;
+	return idx;
+}
+
+/**
+ * Aktualisiert den Zustand eines Eintrags anhand seines Alters.
+ * REACHABLE wird nach ARP_REACHABLE_TIME zu STALE, STALE- und FAILED-Eintrge
+ * werden nach ARP_STALE_TIME bzw. ARP_NEGATIVE_TIME verworfen.
+ * INCOMPLETE-Eintrge werden ber arp_retry behandelt.
+ *
+ * @param idx Der Index des Eintrags.
+ * @return Der Index des Eintrags oder ARP_NONE, wenn er verworfen wurde.
+ */
+static uint16_t arp_age(uint16_t idx) {
+	arp_entry* e = &table->data[idx];
+	uint32_t age = HAL_GetTick() - e->timestamp;
+	
+	if (e->state == ARP_STATE_REACHABLE && age >= ARP_REACHABLE_TIME) {
+		e->state = ARP_STATE_STALE;
+	}
+	if ((e->state == ARP_STATE_STALE && age >= ARP_STALE_TIME) ||
+	    (e->state == ARP_STATE_FAILED && age >= ARP_NEGATIVE_TIME)) {
+		arp_remove(idx);
+		return ARP_NONE;
+	}
+	return idx;
+}
+
+/**
+ * Entfernt einen Eintrag aus der Liste der laufenden Auflsungen.
+ *
+ * @param idx Der Index des Eintrags.
+ */
+static void arp_pending_unlink(uint16_t idx) {
+	uint16_t* link = &table->pending_head;
+	
+	while (*link != ARP_NONE) {
+		if (*link == idx) {
+			*link = table->data[idx].pending_next;
+			return;
+		}
+		link = &table->data[*link].pending_next;
+	}
+}
+
+/**
+ * Sendet eine ARP-Anfrage fr den angegebenen Eintrag und merkt sich den Zeitpunkt.
+ *
+ * @param idx Der Index des Eintrags.
+ */
+static void arp_request(uint16_t idx) {
+	arp_entry* e = &table->data[idx];
+	
+	e->req_time = HAL_GetTick();
+	send_arp_req(*my_ip_addr, my_mac, uint32_to_ip(e->ip));
+	table->stats.requests++;
 }
 
+/**
+ * Wiederholt die ARP-Anfrage einer laufenden Auflsung, sobald das aktuelle Intervall abgelaufen ist.
+ * Das Intervall beginnt bei ARP_RETRY_INTERVAL und verdoppelt sich mit jeder Anfrage.
+ * Nach ARP_MAX_RETRIES unbeantworteten Anfragen wird das Ziel als unerreichbar (FAILED) gespeichert
+ * und die wartenden Frames werden verworfen.
+ *
+ * @param idx Der Index eines Eintrags im Zustand INCOMPLETE.
+ */
+static void arp_retry(uint16_t idx) {
+	arp_entry* e = &table->data[idx];
+	uint32_t interval = (uint32_t)ARP_RETRY_INTERVAL << (e->retries - 1);
+	
+	// Innerhalb des Intervalls keine weitere Anfrage senden
+	if (HAL_GetTick() - e->req_time < interval) {
+		return;
+	}
+	
+	if (e->retries >= ARP_MAX_RETRIES) {
+		// Ziel antwortet nicht: negativ cachen
+		arp_pending_unlink(idx);
+		arp_queue_drop(idx);
+		e->state = ARP_STATE_FAILED;
+		e->timestamp = HAL_GetTick();
+		table->stats.failures++;
+		return;
+	}
+	
+	e->retries++;
+	arp_request(idx);
+}
 
 /**
  * Fgt einen ARP-Eintrag zur ARP-Tabelle hinzu oder aktualisiert einen vorhandenen Eintrag.
+ * Der Eintrag wird anhand der IP-Adresse gesucht und gilt danach als REACHABLE.
  *
- * @param entry Der ARP-Eintrag, der zur Tabelle hinzugefgt oder aktualisiert werden soll.
+ * @param ip Die IP-Adresse des Eintrags.
+ * @param mac Die zugehrige MAC-Adresse.
  */
-void add_to_arp_table(arp_entry entry) {
-		// Durchsucht die ARP-Tabelle, um einen Eintrag mit derselben Ziel-MAC-Adresse zu finden
-	  for (int i = 0; i <= table->tail; i++) {
-			// berprft, ob die Ziel-MAC-Adresse mit dem aktuellen Eintrag in der Tabelle bereinstimmt
-			if (table->data[i].dest_mac.octet[0] == entry.dest_mac.octet[0] &&
-           table->data[i].dest_mac.octet[1] == entry.dest_mac.octet[1] &&
-           table->data[i].dest_mac.octet[2] == entry.dest_mac.octet[2] &&
-           table->data[i].dest_mac.octet[3] == entry.dest_mac.octet[3] &&
-           table->data[i].dest_mac.octet[4] == entry.dest_mac.octet[4] &&
-           table->data[i].dest_mac.octet[5] == entry.dest_mac.octet[5]){
-					 // Aktualisiert den vorhandenen Eintrag mit den neuen Informationen
-           table->data[i] = entry;
-					 return;
-        }
-				
-    }
-		 // Wenn kein bereinstimmender Eintrag gefunden wird, fge den bereitgestellten Eintrag zur ARP-Tabelle hinzu
-    table->data[table->tail] = entry;
+void add_to_arp_table(ip_address ip, mac_address mac) {
+	uint32_t key = ip_to_uint32(ip);
+	
+	// Sucht einen vorhandenen Eintrag zur IP-Adresse, sonst wird ein neuer angelegt
+	uint16_t idx = arp_find(key);
+	if (idx == ARP_NONE) {
+		idx = arp_alloc(key);
+	} else {
+		arp_lru_unlink(idx);
+		arp_lru_push_front(idx);
 		
-		// Aktualisiert das Ende der Tabelle, wenn Platz verfgbar ist
-    if(table->tail < ARP_TABLE_SIZE - 1) {
-			table->tail += 1;
+		// Eine laufende Auflsung ist hiermit abgeschlossen
+		if (table->data[idx].state == ARP_STATE_INCOMPLETE) {
+			arp_pending_unlink(idx);
 		}
+	}
+	
+	// Aktualisiert den Eintrag mit den neuen Informationen
+	table->data[idx].dest_mac = mac;
+	table->data[idx].state = ARP_STATE_REACHABLE;
+	table->data[idx].timestamp = HAL_GetTick();
+	
+	// Vorgefertigte Header im Next-Hop-Cache nachziehen
+	route_cache_update(ip, mac);
+	
+	// Sendet die Frames, die auf diese Auflsung gewartet haben
+	arp_queue_flush(idx);
+}
+
+/**
+ * Lernt eine IP/MAC-Zuordnung aus empfangenem Verkehr (ARP, DHCP, IPv4).
+ * Ohne create wird nur ein bereits vorhandener Eintrag aktualisiert, so dass fremder
+ * Verkehr die Tabelle nicht fllt.
+ *
+ * @param ip Die IP-Adresse des Absenders.
+ * @param mac Die MAC-Adresse des Absenders.
+ * @param create 1, wenn ein fehlender Eintrag angelegt werden soll; 0, wenn nur aktualisiert wird.
+ * @return 1, wenn ein Eintrag angelegt oder aktualisiert wurde; sonst 0.
+ */
+int arp_learn(ip_address ip, mac_address mac, uint8_t create) {
+	uint32_t key = ip_to_uint32(ip);
+	
+	// Unspezifizierte Absender (ARP-Probe), die eigene Adresse und Gruppen-MACs nicht bernehmen
+	if (key == 0 || key == 0xFFFFFFFF || key == ip_to_uint32(*my_ip_addr) || (mac.octet[0] & 0x01)) {
+		return 0;
+	}
+	if (!create && arp_find(key) == ARP_NONE) {
+		return 0;
+	}
+	add_to_arp_table(ip, mac);
+	return 1;
+}
+
+/**
+ * Verwirft alle Frames, die auf die Auflsung des angegebenen Eintrags warten.
+ *
+ * @param idx Der Index des Eintrags.
+ */
+static void arp_queue_drop(uint16_t idx) {
+	arp_entry* e = &table->data[idx];
+	
+	while (e->queue_head != ARP_NONE) {
+		arp_queued_frame* f = &table->queue[e->queue_head];
+		uint16_t next = f->next;
+		
+		// Platz in die Freiliste zurcklegen
+		f->owner = ARP_NONE;
+		f->next = table->queue_free;
+		table->queue_free = e->queue_head;
+		
+		e->queue_head = next;
+		table->stats.queue_timeouts++;
+	}
+	e->queue_len = 0;
+}
+
+/**
+ * Sendet alle Frames, die auf die Auflsung des angegebenen Eintrags warten,
+ * mit der nun bekannten Ziel-MAC-Adresse.
+ *
+ * @param idx Der Index des Eintrags.
+ */
+static void arp_queue_flush(uint16_t idx) {
+	arp_entry* e = &table->data[idx];
+	
+	while (e->queue_head != ARP_NONE) {
+		arp_queued_frame* f = &table->queue[e->queue_head];
+		uint16_t next = f->next;
+		
+		// Ziel-MAC im MAC-Header eintragen und Frame senden
+		((mac_header*)f->data)->dest_mac = e->dest_mac;
+		txq_send(f->len, f->data, txq_prio_from_tos(f->data[sizeof(mac_header) + 1])); // TOS des IPv4-Headers
+		table->stats.queue_flushed++;
+		
+		// Platz in die Freiliste zurcklegen
+		f->owner = ARP_NONE;
+		f->next = table->queue_free;
+		table->queue_free = e->queue_head;
+		
+		e->queue_head = next;
+	}
+	e->queue_len = 0;
 }
 
 
 /**
  * Sucht in der ARP-Tabelle nach einer MAC-Adresse fr die angegebene Ziel-IP-Adresse.
+ * Ein Treffer wird an den Anfang der LRU-Liste verschoben; STALE-Eintrge bleiben nutzbar.
  *
  * @param ip Die Ziel-IP-Adresse, fr die die MAC-Adresse gesucht wird.
  * @param mac Ein Pointer auf die MAC-Adresse, die gefunden wurde (falls vorhanden).
  * @return 1, wenn die MAC-Adresse gefunden wurde; 0, wenn keine bereinstimmung gefunden wurde.
  */
 int get_mac_from_table(ip_address ip, mac_address* mac) {
+	uint16_t idx = arp_find(ip_to_uint32(ip));
 	
-    int foundIndex = -1;
-
-		// Durchsucht die ARP-Tabelle, um einen Eintrag mit der angegebenen Ziel-IP-Adresse zu finden
-    for (int i = 0; i <= table->tail; i++) {
-				// berprft, ob die Ziel-IP-Adresse mit dem aktuellen Eintrag in der Tabelle bereinstimmt
-        if (table->data[i].dest_ip.octet[0] == ip.octet[0] &&
-            table->data[i].dest_ip.octet[1] == ip.octet[1] &&
-            table->data[i].dest_ip.octet[2] == ip.octet[2] &&
-            table->data[i].dest_ip.octet[3] == ip.octet[3]) {
-						// Speichert den Index des gefundenen Eintrags und bricht die Schleife ab
-            foundIndex = i;
-            break; 
-        }
-    }
-
-		// Wenn ein bereinstimmender Eintrag gefunden wurde, tauscht seine Position mit dem vorherigen Eintrag (falls vorhanden)
-    if (foundIndex >= 0) {
-        if (foundIndex > 0) {
-            int prevIndex = (foundIndex - 1);
-            arp_entry temp = table->data[foundIndex];
-            table->data[foundIndex] = table->data[prevIndex];
-            table->data[prevIndex] = temp;
-        }
-				
-				// Gibt die MAC-Adresse zurck, die dem gefundenen Eintrag entspricht
-        *mac = table->data[foundIndex].dest_mac; 
-        return 1;
-    }
-		// Gibt 0 zurck, wenn kein bereinstimmender Eintrag und keine MAC-Adresse gefunden wurden
-    return 0;
+	// Abgelaufene Eintrge vor der Verwendung altern lassen
+	if (idx != ARP_NONE) {
+		idx = arp_age(idx);
+	}
+	
+	if (idx != ARP_NONE && (table->data[idx].state == ARP_STATE_REACHABLE || table->data[idx].state == ARP_STATE_STALE)) {
+		// Eintrag als zuletzt benutzt markieren
+		arp_lru_unlink(idx);
+		arp_lru_push_front(idx);
+		
+		// STALE-Eintrge bleiben nutzbar, werden aber (hchstens einmal je Intervall) neu angefragt
+		if (table->data[idx].state == ARP_STATE_STALE && HAL_GetTick() - table->data[idx].req_time >= ARP_RETRY_INTERVAL) {
+			arp_request(idx);
+		}
+		
+		// Gibt die MAC-Adresse zurck, die dem gefundenen Eintrag entspricht
+		*mac = table->data[idx].dest_mac;
+		table->stats.hits++;
+		return 1;
+	}
+	// Gibt 0 zurck, wenn kein aufgelster Eintrag gefunden wurde
+	table->stats.misses++;
+	return 0;
 }
 
 /**
- * Verarbeitet eine ARP-Antwort (Reply) und aktualisiert oder fgt den entsprechenden Eintrag zur ARP-Tabelle hinzu.
+ * bernimmt die Absenderadressen eines ARP-Pakets nach den Merge-Regeln aus RFC 826:
+ * Ein vorhandener Eintrag zur Absender-IP wird immer aktualisiert, ein neuer Eintrag
+ * wird nur angelegt, wenn das Paket an die eigene IP-Adresse gerichtet ist.
  *
- * @param buf Ein Pointer auf den Puffer, der die ARP-Antwort enthlt.
+ * @param buf Ein Pointer auf den Puffer, der das ARP-Paket enthlt.
+ * @return 1, wenn das Paket an die eigene IP-Adresse gerichtet ist; sonst 0.
  */
-void get_arp_rep(const uint8_t* buf){
+static int arp_merge(const uint8_t* buf) {
+	ip_address sender_ip;
+	mac_address sender_mac;
 	
-	arp_entry entry;
+	// Extrahiert die Absender-MAC-Adresse aus dem ARP-Paket
+	sender_mac.octet[0] = buf[22];
+	sender_mac.octet[1] = buf[23];
+	sender_mac.octet[2] = buf[24];
+	sender_mac.octet[3] = buf[25];
+	sender_mac.octet[4] = buf[26];
+	sender_mac.octet[5] = buf[27];
 	
-	// Extrahiert die Ziel-MAC-Adresse aus der ARP-Antwort
-	entry.dest_mac.octet[0] = buf[22];
-	entry.dest_mac.octet[1] = buf[23];
-	entry.dest_mac.octet[2] = buf[24];
-	entry.dest_mac.octet[3] = buf[25];
-	entry.dest_mac.octet[4] = buf[26];
-	entry.dest_mac.octet[5] = buf[27];
+	// Extrahiert die Absender-IP-Adresse aus dem ARP-Paket
+	sender_ip.octet[0] = buf[28];
+	sender_ip.octet[1] = buf[29];
+	sender_ip.octet[2] = buf[30];
+	sender_ip.octet[3] = buf[31];
 	
-	// Extrahiert die Ziel-MAC-Adresse aus der ARP-Antwort
-	entry.dest_ip.octet[0] = buf[28];
-	entry.dest_ip.octet[1] = buf[29];
-	entry.dest_ip.octet[2] = buf[30];
-	entry.dest_ip.octet[3] = buf[31];
+	// berprft, ob das Paket an die eigene (bereits vergebene) IP-Adresse gerichtet ist
+	uint32_t me = ip_to_uint32(*my_ip_addr);
+	int for_me = me != 0 &&
+	             my_ip_addr->octet[0] == buf[38] &&
+	             my_ip_addr->octet[1] == buf[39] &&
+	             my_ip_addr->octet[2] == buf[40] &&
+	             my_ip_addr->octet[3] == buf[41];
 	
+	arp_learn(sender_ip, sender_mac, for_me);
+	return for_me;
+}
+
+/**
+ * Verarbeitet eine ARP-Antwort (Reply) und aktualisiert oder fgt den entsprechenden Eintrag zur ARP-Tabelle hinzu.
+ *
+ * @param buf Ein Pointer auf den Puffer, der die ARP-Antwort enthlt.
+ */
+void get_arp_rep(const uint8_t* buf){
 	 // Fgt den ARP-Eintrag zur ARP-Tabelle hinzu oder aktualisiert ihn
-	add_to_arp_table(entry);
+	arp_merge(buf);
 }
 
 
@@ -171,7 +518,7 @@ void send_arp_req(ip_address src_ip, mac_address src_mac, ip_address target_ip){
 	req.arp_package.target_ip = target_ip;
 	
 	// Sendet das ARP-Anfragepaket
-	enc28_packetSend(sizeof(req), (uint8_t*)&req); //sizeof()
+	txq_send(sizeof(req), (uint8_t*)&req, TXQ_PRIO_CONTROL);
 }
 
 
@@ -211,7 +558,7 @@ void send_arp_rep(ip_address src_ip, mac_address src_mac, ip_address target_ip,
 	rep.arp_package.target_ip = target_ip;
 	
 	// Sendet das ARP-Antwortpaket
-	enc28_packetSend(sizeof(rep), (uint8_t*)&rep); //sizeof()
+	txq_send(sizeof(rep), (uint8_t*)&rep, TXQ_PRIO_CONTROL);
 }
 
 /**
@@ -223,30 +570,32 @@ void send_arp_rep(ip_address src_ip, mac_address src_mac, ip_address target_ip,
  * @param my_mac Die eigene MAC-Adresse des Gerts.
  */
 void get_arp_req(const uint8_t* buf, ip_address *my_ip, mac_address my_mac) {
-	// berprft, ob die ARP-Anfrage an die angegebene IP-Adresse (my_ip) gerichtet ist
-	if (my_ip->octet[0] == buf[38] &&
-      my_ip->octet[1] == buf[39] &&
-      my_ip->octet[2] == buf[40] &&
-      my_ip->octet[3] == buf[41]) {
+	// bernimmt den Absender und berprft, ob die ARP-Anfrage an die angegebene IP-Adresse (my_ip) gerichtet ist.
+	// Der Anfragende wird so ohne eigene ARP-Anfrage gelernt, da er in Krze angesprochen wird.
+	if (arp_merge(buf)) {
 			
 			// Extrahiert Informationen aus der ARP-Anfrage
-			arp_entry entry;
-			entry.dest_mac.octet[0] = buf[22];
-			entry.dest_mac.octet[1] = buf[23];
-			entry.dest_mac.octet[2] = buf[24];
-			entry.dest_mac.octet[3] = buf[25];
-			entry.dest_mac.octet[4] = buf[26];
-			entry.dest_mac.octet[5] = buf[27];
-	
-			entry.dest_ip.octet[0] = buf[28];
-			entry.dest_ip.octet[1] = buf[29];
-			entry.dest_ip.octet[2] = buf[30];
-			entry.dest_ip.octet[3] = buf[31];	
+			ip_address sender_ip;
+			mac_address sender_mac;
+			sender_mac.octet[0] = buf[22];
+			sender_mac.octet[1] = buf[23];
+			sender_mac.octet[2] = buf[24];
+			sender_mac.octet[3] = buf[25];
+			sender_mac.octet[4] = buf[26];
+			sender_mac.octet[5] = buf[27];
+	
+			sender_ip.octet[0] = buf[28];
+			sender_ip.octet[1] = buf[29];
+			sender_ip.octet[2] = buf[30];
+			sender_ip.octet[3] = buf[31];	
 				
 			ip_address ip = *my_ip;
+			if (!ratelimit_allow(RATELIMIT_ARP_REPLY)) {
+				return;
+			}
 			
 			 // Sendet eine ARP-Antwort an die Quell-MAC- und IP-Adressen zurck
-			send_arp_rep(ip, my_mac, entry.dest_ip, entry.dest_mac);
+			send_arp_rep(ip, my_mac, sender_ip, sender_mac);
 			}
 			return;
 }
@@ -256,6 +605,8 @@ void get_arp_req(const uint8_t* buf, ip_address *my_ip, mac_address my_mac) {
  * Versucht, die MAC-Adresse fr die angegebene IP-Adresse zu erhalten.
  * Wenn die MAC-Adresse bereits in der ARP-Tabelle vorhanden ist, wird sie zurckgegeben.
  * Andernfalls wird eine ARP-Anfrage (Request) gesendet, um die MAC-Adresse zu ermitteln.
+ * Luft fr das Ziel bereits eine Auflsung, wird frhestens nach Ablauf des Wiederholungsintervalls
+ * erneut angefragt; als unerreichbar gespeicherte Ziele werden bis zum Ablauf nicht angefragt.
  *
  * @param ip Die Ziel-IP-Adresse, fr die die MAC-Adresse abgerufen werden soll.
  * @param mac_addr Ein Pointer auf die MAC-Adresse, die zurckgegeben wird, wenn gefunden.
@@ -266,9 +617,121 @@ int get_mac(ip_address ip, mac_address* mac_addr){
 	if(get_mac_from_table(ip, mac_addr)) {
 		return 1; // MAC-Adresse in der ARP-Tabelle gefunden
 	}
-	// Falls nicht gefunden, sendet eine ARP-Anfrage, um die MAC-Adresse zu erhalten
-	send_arp_req(*my_ip_addr, my_mac, ip);
-	return 0; // ARP-Anfrage gesendet, die ARP-Antwort wird die ARP-Tabelle aktualisieren
+	
+	uint32_t key = ip_to_uint32(ip);
+	uint16_t idx = arp_find(key);
+	
+	if (idx == ARP_NONE) {
+		// Neue Auflsung: INCOMPLETE-Eintrag anlegen und erste ARP-Anfrage senden
+		idx = arp_alloc(key);
+		arp_entry* e = &table->data[idx];
+		e->state = ARP_STATE_INCOMPLETE;
+		e->timestamp = HAL_GetTick();
+		e->retries = 1;
+		e->pending_next = table->pending_head;
+		table->pending_head = idx;
+		arp_request(idx);
+	} else if (table->data[idx].state == ARP_STATE_FAILED) {
+		// Ziel ist als unerreichbar gespeichert: keine weitere Anfrage bis zum Ablauf
+		table->stats.negative_hits++;
+	} else {
+		// Auflsung luft bereits: nur nach Ablauf des Intervalls erneut anfragen
+		arp_retry(idx);
+	}
+	return 0; // Die ARP-Antwort wird die ARP-Tabelle aktualisieren
+}
+
+/**
+ * Puffert einen Ethernet-Frame an die angegebene IP-Adresse des nchsten Hops, bis die ARP-Antwort
+ * eintrifft oder die Auflsung abluft. Aufzurufen, nachdem get_mac (ber route_lookup) die MAC-Adresse
+ * nicht liefern konnte; die Auflsung luft dann bereits, eine zweite Suche entfllt.
+ *
+ * @param ip Die IP-Adresse des nchsten Hops.
+ * @param len Die Lnge des Frames.
+ * @param frame Ein Pointer auf den Frame, beginnend mit dem MAC-Header.
+ * @return 0, wenn der Frame gepuffert wurde; -1, wenn er verworfen wurde.
+ */
+int arp_output(ip_address ip, uint16_t len, uint8_t* frame) {
+	// Frames an unerreichbare Ziele sofort verwerfen
+	uint16_t idx = arp_find(ip_to_uint32(ip));
+	if (idx == ARP_NONE || table->data[idx].state != ARP_STATE_INCOMPLETE) {
+		table->stats.queue_timeouts++;
+		return -1;
+	}
+	arp_entry* e = &table->data[idx];
+	
+	// Frame an den INCOMPLETE-Eintrag der laufenden Auflsung anhngen
+	if (len > ARP_QUEUE_FRAME_SIZE || table->queue_free == ARP_NONE || e->queue_len >= ARP_QUEUE_PER_ENTRY) {
+		table->stats.queue_overflows++;
+		return -1;
+	}
+	
+	// Freien Platz entnehmen und den Frame hineinkopieren
+	uint16_t q = table->queue_free;
+	arp_queued_frame* f = &table->queue[q];
+	table->queue_free = f->next;
+	f->owner = idx;
+	f->next = ARP_NONE;
+	f->len = len;
+	for (uint16_t i = 0; i < len; i++) {
+		f->data[i] = frame[i];
+	}
+	
+	// Am Ende der Warteschlange des Eintrags anhngen, damit die Reihenfolge erhalten bleibt
+	uint16_t* link = &e->queue_head;
+	while (*link != ARP_NONE) {
+		link = &table->queue[*link].next;
+	}
+	*link = q;
+	e->queue_len++;
+	table->stats.queued++;
+	return 0;
+}
+
+/**
+ * Fordert eine erneute Besttigung der Zuordnung fr die angegebene IP-Adresse an, bevor der
+ * Eintrag veraltet. Ohne Eintrag wird eine neue Auflsung gestartet. Anfragen an dasselbe Ziel
+ * erfolgen hchstens einmal je ARP_RETRY_INTERVAL.
+ *
+ * @param ip Die IP-Adresse, deren Zuordnung aufgefrischt werden soll.
+ */
+void arp_refresh(ip_address ip) {
+	uint16_t idx = arp_find(ip_to_uint32(ip));
+	
+	if (idx == ARP_NONE) {
+		mac_address mac;
+		get_mac(ip, &mac);
+		return;
+	}
+	
+	arp_entry* e = &table->data[idx];
+	if ((e->state == ARP_STATE_REACHABLE || e->state == ARP_STATE_STALE) &&
+	    HAL_GetTick() - e->req_time >= ARP_RETRY_INTERVAL) {
+		arp_request(idx);
+	}
+}
+
+/**
+ * Treibt die laufenden ARP-Auflsungen voran: wiederholt fllige Anfragen und gibt
+ * Ziele nach ARP_MAX_RETRIES auf. Wird zyklisch aus der Hauptschleife aufgerufen.
+ */
+void arp_tick(void) {
+	// Nur die Eintrge mit laufender Auflsung durchlaufen, nicht die gesamte Tabelle
+	uint16_t idx = table->pending_head;
+	while (idx != ARP_NONE) {
+		uint16_t next = table->data[idx].pending_next;
+		arp_retry(idx);
+		idx = next;
+	}
+}
+
+/**
+ * Gibt die Zhler des Neighbor-Caches zurck.
+ *
+ * @return Ein Pointer auf die Treffer-, Fehltreffer- und Verdrngungszhler.
+ */
+const arp_stats* arp_get_stats(void) {
+	return &table->stats;
 }
 
 /**
@@ -279,6 +742,11 @@ int get_mac(ip_address ip, mac_address* mac_addr){
  * @return Gibt 0 zurck, um anzuzeigen, dass die Verarbeitung erfolgreich war.
  */
 int handle_arp(const uint8_t* buf, uint16_t length){
+		// Nur vollstndige ARP-Pakete fr Ethernet/IPv4 verarbeiten
+		if (length < sizeof(mac_header) + sizeof(arp_package) ||
+		    (buf[14] + (buf[15] << 8)) != ARP_HW_TYPE || (buf[16] + (buf[17] << 8)) != ARP_PR_TYPE) {
+			return 1;
+		}
 		// Extrahiere ARP-Opcode aus dem Paket
 		if ((buf[20]  + (buf[21] << 8)) == ARP_REQ){get_arp_req(buf, my_ip_addr, my_mac);}  // ARP-Anfrage: Verarbeiten und ARP-Antwort senden
 		if ((buf[20]  + (buf[21] << 8)) == ARP_REPLY){get_arp_rep(buf);} // ARP-Antwort: Fge die IP- und MAC-Adresse des Absenders zur ARP-Tabelle hinzu
@@ -0,0 +1,236 @@
+/* Includes ------------------------------------------------------------------*/
+#include "checksum.h"
+
+/* Private functions prototypes ---------------------------------------------*/
+static uint16_t checksum_swap(uint16_t value);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Vertauscht die beiden Bytes eines 16-Bit-Wertes. Im Einerkomplement entspricht das einer
+ * Rotation um 8 Bit, daher lsst sich eine mit vertauschten Byte-Positionen gebildete Summe
+ * nachtrglich korrigieren.
+ */
+static uint16_t checksum_swap(uint16_t value) {
+	return (uint16_t)((value << 8) | (value >> 8));
+}
+
+
+/**
+ * Faltet eine 32-Bit-Summe auf 16 Bit (bertrge werden addiert). Das Ergebnis ist nicht invertiert.
+ *
+ * @param sum Die aufsummierten Daten (z.B. von checksum_partial).
+ * @return Die gefaltete 16-Bit-Summe.
+ */
+uint16_t checksum_fold(uint32_t sum) {
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	return (uint16_t)sum;
+}
+
+
+/**
+ * Summiert Daten als 16-Bit-Worte im Einerkomplement. Die Daten drfen beliebig ausgerichtet sein:
+ * bis zur nchsten 32-Bit-Grenze wird byteweise summiert, danach mit ausgerichteten 32-Bit-Zugriffen
+ * (der Cortex-M0+ erlaubt keine unausgerichteten Zugriffe). Beginnen die Daten an einer ungeraden
+ * Adresse, liegen die Bytes der Wortsumme vertauscht und werden einmalig am Ende zurckgetauscht.
+ * bertrge werden erst am Ende gefaltet; bis 64 KB kann die 32-Bit-Summe nicht berlaufen.
+ *
+ * Die Summe kann ber mehrere Aufrufe fortgefhrt werden; dabei mssen alle Teile auer dem
+ * letzten eine gerade Lnge haben.
+ *
+ * @param data Ein Pointer auf die Daten.
+ * @param length Die Lnge der Daten in Bytes.
+ * @param sum Die bisherige Summe (0 fr den ersten Teil).
+ * @return Die ungefaltete Summe (mit checksum_fold abschlieen).
+ */
+uint32_t checksum_partial(const void* data, uint16_t length, uint32_t sum) {
+	const uint8_t* p = data;
+	uint32_t bytes = (sum & 0xFFFF) + (sum >> 16);
+	uint32_t words = 0;
+	uint8_t odd = 0; // Das nchste Byte liegt an einer ungeraden Position (oberes Byte des Wortes)
+
+	// Bis zur 32-Bit-Grenze byteweise (Little Endian: gerade Position = unteres Byte)
+	while (length > 0 && ((uintptr_t)p & 3) != 0) {
+		bytes += odd ? (uint32_t)(*p << 8) : *p;
+		odd ^= 1;
+		p++;
+		length--;
+	}
+
+	// Ausgerichtete 32-Bit-Worte, vierfach entrollt
+	const uint32_t* w = (const uint32_t*)p;
+	while (length >= 16) {
+		uint32_t a = w[0], b = w[1], c = w[2], d = w[3];
+		words += (a & 0xFFFF) + (a >> 16) + (b & 0xFFFF) + (b >> 16);
+		words += (c & 0xFFFF) + (c >> 16) + (d & 0xFFFF) + (d >> 16);
+		w += 4;
+		length -= 16;
+	}
+	while (length >= 4) {
+		uint32_t a = *w++;
+		words += (a & 0xFFFF) + (a >> 16);
+		length -= 4;
+	}
+	p = (const uint8_t*)w;
+
+	// Bei ungeradem Beginn der Worte liegen die Bytes vertauscht
+	words = checksum_fold(words);
+	if (odd) {
+		words = checksum_swap(words);
+	}
+
+	// Restliche Bytes
+	while (length > 0) {
+		bytes += odd ? (uint32_t)(*p << 8) : *p;
+		odd ^= 1;
+		p++;
+		length--;
+	}
+	return bytes + words;
+}
+
+
+/**
+ * Kopiert Daten und bildet dabei ihre Summe (ein Durchlauf statt Kopie plus Prfsumme).
+ * Haben Quelle und Ziel dieselbe Ausrichtung modulo 4, wird mit 32-Bit-Zugriffen kopiert,
+ * sonst byteweise.
+ *
+ * @param dst Das Ziel der Kopie.
+ * @param src Die Quelle der Kopie.
+ * @param length Die Lnge der Daten in Bytes.
+ * @param sum Die bisherige Summe (0 fr den ersten Teil).
+ * @return Die ungefaltete Summe der kopierten Daten (wie checksum_partial).
+ */
+uint32_t checksum_copy(void* dst, const void* src, uint16_t length, uint32_t sum) {
+	const uint8_t* s = src;
+	uint8_t* d = dst;
+	uint32_t bytes = (sum & 0xFFFF) + (sum >> 16);
+	uint32_t words = 0;
+	uint8_t odd = 0;
+
+	if ((((uintptr_t)s ^ (uintptr_t)d) & 3) == 0) {
+		while (length > 0 && ((uintptr_t)s & 3) != 0) {
+			uint8_t b = *s++;
+			*d++ = b;
+			bytes += odd ? (uint32_t)(b << 8) : b;
+			odd ^= 1;
+			length--;
+		}
+
+		const uint32_t* ws = (const uint32_t*)s;
+		uint32_t* wd = (uint32_t*)d;
+		while (length >= 4) {
+			uint32_t a = *ws++;
+			*wd++ = a;
+			words += (a & 0xFFFF) + (a >> 16);
+			length -= 4;
+		}
+		s = (const uint8_t*)ws;
+		d = (uint8_t*)wd;
+	}
+
+	words = checksum_fold(words);
+	if (odd) {
+		words = checksum_swap(words);
+	}
+
+	while (length > 0) {
+		uint8_t b = *s++;
+		*d++ = b;
+		bytes += odd ? (uint32_t)(b << 8) : b;
+		odd ^= 1;
+		length--;
+	}
+	return bytes + words;
+}
+
+
+/**
+ * Setzt eine Summe mit einem Teil fort, der an beliebiger (auch ungerader) Position der
+ * Gesamtdaten beginnt. Fr Daten, die stckweise entstehen, z.B. beim Schreiben in den
+ * bertragungspuffer; anders als bei checksum_partial drfen alle Teile ungerade lang sein.
+ *
+ * @param data Ein Pointer auf den Teil.
+ * @param length Die Lnge des Teils in Bytes.
+ * @param position Die Position des Teils innerhalb der Gesamtdaten.
+ * @param sum Die bisherige Summe (0 fr den ersten Teil).
+ * @return Die ungefaltete Summe (mit checksum_fold abschlieen).
+ */
+uint32_t checksum_stream(const void* data, uint16_t length, uint16_t position, uint32_t sum) {
+	uint16_t part = checksum_fold(checksum_partial(data, length, 0));
+	
+	// Ab ungerader Position liegt jedes Byte in der anderen Hlfte des Wortes
+	if (position & 1) {
+		part = checksum_swap(part);
+	}
+	return sum + part;
+}
+
+
+/**
+ * Bildet die Summe des IPv4-Pseudo-Headers fr die UDP- bzw. TCP-Prfsumme.
+ *
+ * @param src Die Quelladresse.
+ * @param dst Die Zieladresse.
+ * @param prtcl Das Layer-4-Protokoll.
+ * @param length Die Lnge von Layer-4-Header und Nutzdaten (Host-Byte-Order).
+ * @return Die ungefaltete Summe, die mit checksum_partial fortgefhrt wird.
+ */
+uint32_t checksum_pseudo(ip_address src, ip_address dst, uint8_t prtcl, uint16_t length) {
+	uint8_t pseudo[12];
+
+	for (uint8_t i = 0; i < 4; i++) {
+		pseudo[i] = src.octet[i];
+		pseudo[4 + i] = dst.octet[i];
+	}
+	pseudo[8] = 0;
+	pseudo[9] = prtcl;
+	pseudo[10] = length >> 8;
+	pseudo[11] = length & 0xFF;
+	return checksum_partial(pseudo, sizeof(pseudo), 0);
+}
+
+
+/**
+ * Berechnet die Internet-Prfsumme (RFC 1071) ber die bergebenen Daten.
+ *
+ * @param data Ein Pointer auf die Daten, fr die die Prfsumme berechnet werden soll.
+ * @param length Die Lnge der Daten in Bytes.
+ * @return Die Prfsumme, direkt in das Prfsummenfeld schreibbar.
+ */
+uint16_t checksum(const void* data, uint16_t length) {
+	return (uint16_t)~checksum_fold(checksum_partial(data, length, 0));
+}
+
+
+/**
+ * Passt eine Prfsumme an ein gendertes 16-Bit-Feld an (RFC 1624, Gleichung 3:
+ * HC' = ~(~HC + ~m + m')), z.B. nach dem ndern von TTL, Identifikation oder Port.
+ * Alle Werte in Speicher-Byte-Order, wie sie im Header stehen.
+ *
+ * @param check Die bisherige Prfsumme.
+ * @param old_value Der bisherige Wert des Feldes.
+ * @param new_value Der neue Wert des Feldes.
+ * @return Die angepasste Prfsumme.
+ */
+uint16_t checksum_update16(uint16_t check, uint16_t old_value, uint16_t new_value) {
+	uint32_t sum = (uint16_t)~check + (uint16_t)~old_value + new_value;
+	return (uint16_t)~checksum_fold(sum);
+}
+
+
+/**
+ * Passt eine Prfsumme an ein gendertes 32-Bit-Feld an, z.B. eine IP-Adresse (RFC 1624).
+ *
+ * @param check Die bisherige Prfsumme.
+ * @param old_value Der bisherige Wert des Feldes (Speicher-Byte-Order).
+ * @param new_value Der neue Wert des Feldes (Speicher-Byte-Order).
+ * @return Die angepasste Prfsumme.
+ */
+uint16_t checksum_update32(uint16_t check, uint32_t old_value, uint32_t new_value) {
+	uint32_t sum = (uint16_t)~check;
+	sum += (uint16_t)~(old_value & 0xFFFF) + (uint16_t)~(old_value >> 16);
+	sum += (new_value & 0xFFFF) + (new_value >> 16);
+	return (uint16_t)~checksum_fold(sum);
+}
\ No newline at end of file
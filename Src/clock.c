@@ -0,0 +1,228 @@
+/* Includes ------------------------------------------------------------------*/
+#include "clock.h"
+
+/* Private variables ---------------------------------------------------------*/
+static clock_state* clk;
+
+/* Private functions prototypes ---------------------------------------------*/
+static uint64_t clock_at(uint32_t raw, uint32_t* frac);
+static void clock_rebase(uint32_t raw);
+static int32_t clock_clamp(int64_t value, int32_t limit);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Startet TIM2 als freilaufenden 32-Bit-Zhler mit 1 MHz und setzt die disziplinierte Uhr
+ * zurck. Bis zur ersten Messung von SNTP zhlt sie ab 1970 (clock_synced liefert 0).
+ * Der Timertakt ist PCLK, das mit APB-Vorteiler 1 (SystemClock_Config) dem Systemtakt entspricht.
+ *
+ * @param state_addr Ein Pointer auf den Zustand der Uhr (Bezugspunkt und Korrekturen).
+ */
+void clock_init(clock_state* state_addr) {
+	__HAL_RCC_TIM2_CLK_ENABLE();
+	TIM2->CR1 = 0;
+	TIM2->PSC = SystemCoreClock / 1000000 - 1;
+	TIM2->ARR = 0xFFFFFFFF;
+	TIM2->EGR = TIM_EGR_UG; // Vorteiler sofort bernehmen, Zhler auf 0
+	TIM2->CR1 = TIM_CR1_CEN;
+
+	if (state_addr != NULL) {
+		clk = state_addr;
+
+		clk->base_utc = 0;
+		clk->base_frac = 0;
+		clk->base_uptime = 0;
+		clk->base_raw = TIM2->CNT;
+		clk->freq = 0;
+		clk->slew = 0;
+		clk->slew_left = 0;
+		clk->update_time = HAL_GetTick();
+		clk->synced = 0;
+		clk->stats = (clock_stats) {0};
+	}
+}
+
+
+/**
+ * Liefert einen Zeitstempel in s, z.B. fr Laufzeitmessungen und Zeitstempel an Frames.
+ * Ein einziger Registerzugriff, aus Interrupts aufrufbar. Der Wert ist die unkorrigierte
+ * Timerzeit und luft nach etwa 71 Minuten ber; Differenzen bleiben mit vorzeichenloser
+ * Arithmetik korrekt.
+ *
+ * @return Die Zeit seit dem Start in s.
+ */
+uint32_t clock_now_us(void) {
+	return TIM2->CNT;
+}
+
+
+/**
+ * Rechnet einen Zhlerstand in disziplinierte Zeit um: Timerzeit seit dem Bezugspunkt plus
+ * Frequenzkorrektur und, solange sie luft, Phasenkorrektur. Der Bruchteil der s wird
+ * mitgefhrt, damit sich beim Nachziehen des Bezugspunkts keine Rundungsfehler aufsummieren.
+ *
+ * @param raw Der Zhlerstand (hchstens 2^32 s nach dem Bezugspunkt).
+ * @param frac Ausgabe: Bruchteil der s in 2^-32.
+ * @return Die disziplinierte Zeit in s seit 1970.
+ */
+static uint64_t clock_at(uint32_t raw, uint32_t* frac) {
+	uint32_t elapsed = raw - clk->base_raw;
+	uint32_t slewed = (elapsed < clk->slew_left) ? elapsed : clk->slew_left;
+	int64_t correction = (int64_t)elapsed * clk->freq + (int64_t)slewed * clk->slew + clk->base_frac;
+
+	*frac = (uint32_t)correction;
+	return clk->base_utc + elapsed + (correction >> 32);
+}
+
+
+/**
+ * Liefert die monotone Zeit seit dem Start in s (Timerzeit ohne Korrektur, 64 Bit).
+ * Aus Interrupts aufrufbar.
+ *
+ * @return Die Zeit seit clock_init in s.
+ */
+uint64_t clock_uptime_us(void) {
+	return clk->base_uptime + (uint32_t)(TIM2->CNT - clk->base_raw);
+}
+
+
+/**
+ * Liefert die disziplinierte Zeit in s seit 1970 (UTC), z.B. fr Zeitstempel in Log-Zeilen.
+ * Sie luft gleichmig und monoton; nur die erste Messung und Abweichungen ber
+ * CLOCK_STEP_THRESHOLD setzen sie sprunghaft. Aus Interrupts aufrufbar: der Bezugspunkt wird
+ * nur in der Hauptschleife und dort unter PRIMASK verndert.
+ *
+ * @return Die Zeit in s seit 1970-01-01 00:00:00 UTC.
+ */
+uint64_t clock_utc_us(void) {
+	uint32_t frac;
+
+	return clock_at(TIM2->CNT, &frac);
+}
+
+
+/**
+ * Gibt an, ob die Uhr bereits einmal von SNTP gestellt wurde. Auch vor clock_init aufrufbar.
+ *
+ * @return 1, wenn clock_utc_us eine echte Uhrzeit liefert; sonst 0.
+ */
+uint8_t clock_synced(void) {
+	return clk != NULL && clk->synced;
+}
+
+
+/**
+ * Zieht den Bezugspunkt auf einen neuen Zhlerstand nach, damit die Zeit seit dem Bezugspunkt
+ * klein bleibt. Nur mit gesperrten Interrupts aufrufen.
+ *
+ * @param raw Der aktuelle Zhlerstand.
+ */
+static void clock_rebase(uint32_t raw) {
+	uint32_t elapsed = raw - clk->base_raw;
+	uint32_t frac;
+
+	clk->base_utc = clock_at(raw, &frac);
+	clk->base_frac = frac;
+	clk->base_uptime += elapsed;
+	clk->base_raw = raw;
+	if (clk->slew_left > elapsed) {
+		clk->slew_left -= elapsed;
+	} else {
+		clk->slew_left = 0;
+		clk->slew = 0;
+	}
+}
+
+
+/**
+ * Begrenzt einen Wert auf limit.
+ */
+static int32_t clock_clamp(int64_t value, int32_t limit) {
+	if (value > limit) {
+		return limit;
+	}
+	if (value < -limit) {
+		return -limit;
+	}
+	return (int32_t)value;
+}
+
+
+/**
+ * bernimmt eine gemessene Abweichung (Serverzeit minus eigene Zeit), z.B. von SNTP.
+ *
+ * Die erste Messung und Abweichungen ber CLOCK_STEP_THRESHOLD stellen die Uhr sprunghaft.
+ * Kleinere werden wie mit adjtime mit CLOCK_SLEW_PPM abgebaut, die Zeit bleibt dabei monoton.
+ * Liegt die vorige Messung mindestens CLOCK_FLL_MIN_INTERVAL zurck, wird auerdem die
+ * Frequenz nachgefhrt (FLL): die Abweichung, die seitdem neu entstanden ist, geteilt durch
+ * den Abstand ergibt den verbleibenden Gangfehler des Taktes. Der noch nicht abgebaute Teil
+ * der vorigen Phasenkorrektur steckt in der Messung, stammt aber nicht aus der Frequenz und
+ * wird dafr abgezogen.
+ *
+ * @param offset Die Abweichung in s (positiv: die eigene Uhr geht nach).
+ */
+void clock_adjust(int64_t offset) {
+	uint32_t now = HAL_GetTick();
+	uint32_t interval = now - clk->update_time;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	clock_rebase(TIM2->CNT);
+
+	// Frequenz
+	int64_t pending = ((int64_t)clk->slew_left * clk->slew) >> 32;
+	int64_t drift = offset - pending;
+	if (clk->synced && interval >= CLOCK_FLL_MIN_INTERVAL && drift > -0x7FFFFFFF && drift < 0x7FFFFFFF) {
+		int64_t error = (drift * 4294967296LL) / ((int64_t)interval * 1000);
+		clk->freq = clock_clamp(clk->freq + (error >> CLOCK_FLL_SHIFT), CLOCK_FREQ_MAX_PPM * CLOCK_PPM);
+	}
+
+	// Phase
+	if (!clk->synced || offset > CLOCK_STEP_THRESHOLD || offset < -CLOCK_STEP_THRESHOLD) {
+		clk->base_utc += offset;
+		clk->slew = 0;
+		clk->slew_left = 0;
+		clk->synced = 1;
+		clk->stats.steps++;
+	} else if (offset != 0) {
+		uint64_t magnitude = (offset < 0) ? -offset : offset;
+		clk->slew = (offset < 0) ? -(CLOCK_SLEW_PPM * CLOCK_PPM) : CLOCK_SLEW_PPM * CLOCK_PPM;
+		clk->slew_left = (magnitude << 32) / (CLOCK_SLEW_PPM * CLOCK_PPM);
+		clk->stats.slews++;
+	} else {
+		clk->slew = 0;
+		clk->slew_left = 0;
+	}
+	__set_PRIMASK(primask);
+
+	clk->update_time = now;
+	clk->stats.updates++;
+	clk->stats.offset = clock_clamp(offset, 0x7FFFFFFF);
+	clk->stats.freq_ppb = ((int64_t)clk->freq * 1000000000) >> 32;
+}
+
+
+/**
+ * Zieht den Bezugspunkt jede Sekunde nach. Wird regelmig aus der Hauptschleife aufgerufen,
+ * mindestens alle 71 Minuten (berlauf des Zhlers seit dem Bezugspunkt).
+ */
+void clock_tick(void) {
+	if (clk == NULL || (uint32_t)(TIM2->CNT - clk->base_raw) < CLOCK_REBASE_US) {
+		return;
+	}
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	clock_rebase(TIM2->CNT);
+	__set_PRIMASK(primask);
+}
+
+
+/**
+ * Liefert die Zhler und die aktuelle Korrektur der Uhr.
+ *
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden).
+ */
+const clock_stats* clock_get_stats(void) {
+	return &clk->stats;
+}
\ No newline at end of file
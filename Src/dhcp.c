@@ -8,19 +8,24 @@ static ip_address *my_gateway_addr;
 static ip_address *my_dhcp_server_addr;
 static uint8_t *dhcp_rdy_addr;
 static mac_address my_mac;
+static uint32_t xid; // Transaction ID der laufenden Anfrage (Netzwerk-Byte-Reihenfolge)
 
 /* Private functions prototypes ---------------------------------------------*/
-int handle_dhcp(const uint8_t* buf, uint16_t length);
-static uint16_t calculate_checksum(const void* data, size_t length);
+int handle_dhcp(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport);
 uint32_t rand(uint32_t* seed);
 uint32_t generateID();
+static const uint8_t* dhcp_find_option(const uint8_t *buffer, uint16_t length, uint8_t code, uint8_t *option_length);
 void extract_option_1(const uint8_t *buffer, uint16_t length, option_1 *result);
 void extract_option_3(const uint8_t *buffer, uint16_t length, option_3 *result);
 void extract_option_53(const uint8_t *buffer, uint16_t length, option_53 *result);
 void extract_option_54(const uint8_t *buffer, uint16_t length, option_54 *result);
+void extract_routes(const uint8_t *buffer, uint16_t length);
+void extract_servers(const uint8_t *buffer, uint16_t length);
 void send_dhcp_req();
-void get_dhcp_offer(const uint8_t* buf, uint16_t length);
-void get_dhcp_ack(const uint8_t* buf, uint16_t length, uint8_t* dhcp_rdy);
+void get_dhcp_offer(const uint8_t* buf, uint16_t length, uint16_t offset);
+void get_dhcp_ack(const uint8_t* buf, uint16_t length, uint16_t offset, uint8_t* dhcp_rdy);
+void learn_dhcp_server(const uint8_t* buf, uint16_t offset, ip_address src);
+static int dhcp_is_reply(const uint8_t* buf, uint16_t offset);
 
 /* Functions -----------------------------------------------------------------*/
 
@@ -79,32 +84,62 @@ uint32_t generateID() {
 
 
 /**
- * Extrahiert die Informationen aus Option 1 eines DHCP-Paketes.
+ * Sucht eine Option in einem DHCP-Paket. Pad (0) wird bersprungen, die Suche endet mit
+ * End (255) oder bei einer Option, die ber das Paketende hinausreicht.
  *
- * @param buffer Der Puffer, der das DHCP-Paket enthlt.
- * @param length Die Lnge des Puffers.
- * @param result Ein Pointer auf eine Option-1-Struktur, in der das Ergebnis gespeichert wird.
- *               Wenn die Option nicht gefunden wird, wird `result->option_type` auf 0 gesetzt.
+ * @param buffer Der Puffer, beginnend mit dem DHCP-Header.
+ * @param length Die Lnge der DHCP-Nachricht.
+ * @param code Der Typ der gesuchten Option.
+ * @param option_length Ausgabe: Die Lnge der Optionsdaten (ohne Typ und Lnge).
+ * @return Ein Pointer auf die Optionsdaten; NULL, wenn die Option nicht vorhanden ist.
  */
-void extract_option_1(const uint8_t *buffer, uint16_t length, option_1 *result) {
-		// Startoffset fr die DHCP-Optionen nach dem DHCP-Header
-    uint16_t offset = sizeof(mac_header) + sizeof(ipv4_header) + sizeof(udp_header) + sizeof(dhcp_header);
-		// Durchlaufe die Optionen im DHCP-Paket
-    while (offset < length) {
+static const uint8_t* dhcp_find_option(const uint8_t *buffer, uint16_t length, uint8_t code, uint8_t *option_length) {
+    // Startoffset fr die DHCP-Optionen nach dem DHCP-Header
+    uint16_t offset = sizeof(dhcp_header);
+
+    // Durchlaufe die Optionen im DHCP-Paket
+    while (offset + 1 < length) {
         uint8_t option_type = buffer[offset];
-        uint8_t option_length = buffer[offset + 1];
-
-				// berprfe, ob es sich um Option-1 (Subnetzmaske) handelt
-        if (option_type == 1 && (option_length + 2) == sizeof(option_1)) {
-						// Option-1 gefunden, speichere die Informationen in der Ergebnisstruktur
-            result->option_type = option_type;
-            result->length = option_length;
-            result->subnet_mask = *(ip_address*)(buffer + offset + 2);
-            return;
+
+        if (option_type == 255) {
+            break;
+        }
+        if (option_type == 0) {
+            offset++; // Pad
+            continue;
+        }
+        if (offset + 2 + buffer[offset + 1] > length) {
+            break;
+        }
+        if (option_type == code) {
+            *option_length = buffer[offset + 1];
+            return buffer + offset + 2;
         }
 
         // Zum nchsten Optionsfeld bewegen
-        offset += 2 + option_length;
+        offset += 2 + buffer[offset + 1];
+    }
+    return NULL;
+}
+
+/**
+ * Extrahiert die Informationen aus Option 1 eines DHCP-Paketes.
+ *
+ * @param buffer Der Puffer, beginnend mit dem DHCP-Header.
+ * @param length Die Lnge der DHCP-Nachricht.
+ * @param result Ein Pointer auf eine Option-1-Struktur, in der das Ergebnis gespeichert wird.
+ *               Wenn die Option nicht gefunden wird, wird `result->option_type` auf 0 gesetzt.
+ */
+void extract_option_1(const uint8_t *buffer, uint16_t length, option_1 *result) {
+    uint8_t option_length;
+    const uint8_t* data = dhcp_find_option(buffer, length, 1, &option_length);
+
+    // berprfe, ob Option-1 (Subnetzmaske) vorhanden ist und die erwartete Lnge hat
+    if (data != NULL && (option_length + 2) == sizeof(option_1)) {
+        result->option_type = 1;
+        result->length = option_length;
+        result->subnet_mask = *(ip_address*)data;
+        return;
     }
 
     // Option nicht gefunden
@@ -116,30 +151,21 @@ void extract_option_1(const uint8_t *buffer, uint16_t length, option_1 *result)
 /**
  * Extrahiert die Informationen aus Option 3 eines DHCP-Paketes.
  *
- * @param buffer Der Puffer, der das DHCP-Paket enthlt.
- * @param length Die Lnge des Puffers.
+ * @param buffer Der Puffer, beginnend mit dem DHCP-Header.
+ * @param length Die Lnge der DHCP-Nachricht.
  * @param result Ein Pointer auf eine Option-3-Struktur, in der das Ergebnis gespeichert wird.
  *               Wenn die Option nicht gefunden wird, wird `result->option_type` auf 0 gesetzt.
  */
 void extract_option_3(const uint8_t *buffer, uint16_t length, option_3 *result) {
-	// Startoffset fr die DHCP-Optionen nach dem DHCP-Header
-    uint16_t offset = sizeof(mac_header) + sizeof(ipv4_header) + sizeof(udp_header) + sizeof(dhcp_header); // DHCP header size + magic cookie size
-		// Durchlaufe die Optionen im DHCP-Paket
-    while (offset < length) {
-        uint8_t option_type = buffer[offset];
-        uint8_t option_length = buffer[offset + 1];
-				// berprfe, ob es sich um Option-3 (Router) handelt
-        if (option_type == 3 && (option_length + 2) == sizeof(option_3)) {
-
-            result->option_type = option_type;
-            result->length = option_length;
-
-            result->router = *(ip_address*)(buffer + offset + 2);
-            return;
-        }
-
-        // Zum nchsten Optionsfeld bewegen
-        offset += 2 + option_length;
+    uint8_t option_length;
+    const uint8_t* data = dhcp_find_option(buffer, length, 3, &option_length);
+
+    // Option 3 darf mehrere Router enthalten, bernommen wird der erste (bevorzugte)
+    if (data != NULL && option_length >= 4 && (option_length % 4) == 0) {
+        result->option_type = 3;
+        result->length = option_length;
+        result->router = *(ip_address*)data;
+        return;
     }
 
     // Option nicht gefunden
@@ -151,30 +177,21 @@ void extract_option_3(const uint8_t *buffer, uint16_t length, option_3 *result)
 /**
  * Extrahiert die Informationen aus Option 53 eines DHCP-Paketes.
  *
- * @param buffer Der Puffer, der das DHCP-Paket enthlt.
- * @param length Die Lnge des Puffers.
+ * @param buffer Der Puffer, beginnend mit dem DHCP-Header.
+ * @param length Die Lnge der DHCP-Nachricht.
  * @param result Ein Pointer auf eine Option-53-Struktur, in der das Ergebnis gespeichert wird.
  *               Wenn die Option nicht gefunden wird, wird `result->option_type` auf 0 gesetzt.
  */
 void extract_option_53(const uint8_t *buffer, uint16_t length, option_53 *result) {
-		// Startoffset fr die DHCP-Optionen nach dem DHCP-Header
-    uint16_t offset = sizeof(mac_header) + sizeof(ipv4_header) + sizeof(udp_header) + sizeof(dhcp_header); // DHCP header size + magic cookie size
-		// Durchlaufe die Optionen im DHCP-Paket
-    while (offset < length) {
-        uint8_t option_type = buffer[offset];
-        uint8_t option_length = buffer[offset + 1];
-				// berprfe, ob es sich um Option-53 (DHCP Identifier) handelt
-        if (option_type == 53 && (option_length + 2) == sizeof(option_53)) {
-
-            result->option_type = option_type;
-            result->length = option_length;
-
-            result->dhcp_option = *(uint8_t*)(buffer + offset + 2);
-            return;
-        }
-
-        // Zum nchsten Optionsfeld bewegen
-        offset += 2 + option_length;
+    uint8_t option_length;
+    const uint8_t* data = dhcp_find_option(buffer, length, 53, &option_length);
+
+    // berprfe, ob Option-53 (DHCP Message Type) vorhanden ist
+    if (data != NULL && (option_length + 2) == sizeof(option_53)) {
+        result->option_type = 53;
+        result->length = option_length;
+        result->dhcp_option = data[0];
+        return;
     }
 
     // Option nicht gefunden
@@ -187,30 +204,21 @@ void extract_option_53(const uint8_t *buffer, uint16_t length, option_53 *result
 /**
  * Extrahiert die Informationen aus Option 54 eines DHCP-Paketes.
  *
- * @param buffer Der Puffer, der das DHCP-Paket enthlt.
- * @param length Die Lnge des Puffers.
+ * @param buffer Der Puffer, beginnend mit dem DHCP-Header.
+ * @param length Die Lnge der DHCP-Nachricht.
  * @param result Ein Pointer auf eine Option-54-Struktur, in der das Ergebnis gespeichert wird.
  *               Wenn die Option nicht gefunden wird, wird `result->option_type` auf 0 gesetzt.
  */
 void extract_option_54(const uint8_t *buffer, uint16_t length, option_54 *result) {
-		// Startoffset fr die DHCP-Optionen nach dem DHCP-Header
-    uint16_t offset = sizeof(mac_header) + sizeof(ipv4_header) + sizeof(udp_header) + sizeof(dhcp_header); // DHCP header size + magic cookie size
-		// Durchlaufe die Optionen im DHCP-Paket
-    while (offset < length) {
-        uint8_t option_type = buffer[offset];
-        uint8_t option_length = buffer[offset + 1];
-				// berprfe, ob es sich um Option-54 (DHCP Server) handelt
-        if (option_type == 54 && (option_length + 2) == sizeof(option_54)) {
-
-            result->option_type = option_type;
-            result->length = option_length;
-
-            result->ip_addr = *(ip_address*)(buffer + offset + 2);
-            return;
-        }
-
-        // Zum nchsten Optionsfeld bewegen
-        offset += 2 + option_length;
+    uint8_t option_length;
+    const uint8_t* data = dhcp_find_option(buffer, length, 54, &option_length);
+
+    // berprfe, ob Option-54 (DHCP Server) vorhanden ist
+    if (data != NULL && (option_length + 2) == sizeof(option_54)) {
+        result->option_type = 54;
+        result->length = option_length;
+        result->ip_addr = *(ip_address*)data;
+        return;
     }
 
     // Option nicht gefunden
@@ -219,6 +227,72 @@ void extract_option_54(const uint8_t *buffer, uint16_t length, option_54 *result
     result->ip_addr = (ip_address) {0};
 }
 
+/**
+ * bernimmt die Routen einer DHCP-Lease in die Routingtabelle. Ist Option 121 (Classless Static Route)
+ * vorhanden, wird Option 3 nach RFC 3442 ignoriert; sonst wird fr jeden Router aus Option 3 eine
+ * Default-Route angelegt, wobei die Metrik mit der Position in der Liste steigt.
+ * Die Routen der vorherigen Lease werden zuvor entfernt.
+ *
+ * @param buffer Der Puffer, beginnend mit dem DHCP-Header.
+ * @param length Die Lnge der DHCP-Nachricht.
+ */
+void extract_routes(const uint8_t *buffer, uint16_t length) {
+    uint8_t option_length;
+    const uint8_t* data;
+
+    route_del_origin(ROUTE_ORIGIN_DHCP);
+
+    data = dhcp_find_option(buffer, length, DHCP_OP_121, &option_length);
+    if (data != NULL) {
+        // Je Route: Prfixlnge, signifikante Oktette des Ziels, Router
+        uint16_t pos = 0;
+        while (pos < option_length) {
+            uint8_t width = data[pos++];
+            uint8_t octets = (width + 7) / 8;
+            if (width > 32 || pos + octets + 4 > option_length) {
+                break;
+            }
+            ip_address prefix = {0};
+            for (uint8_t i = 0; i < octets; i++) {
+                prefix.octet[i] = data[pos + i];
+            }
+            pos += octets;
+            route_add(prefix, width, *(ip_address*)(data + pos), ROUTE_METRIC_DHCP, ROUTE_ORIGIN_DHCP);
+            pos += 4;
+        }
+        return;
+    }
+
+    data = dhcp_find_option(buffer, length, 3, &option_length);
+    if (data != NULL) {
+        uint8_t count = option_length / 4;
+        for (uint8_t i = 0; i < count; i++) {
+            route_add((ip_address){0}, 0, *(ip_address*)(data + i * 4), ROUTE_METRIC_DHCP + i, ROUTE_ORIGIN_DHCP);
+        }
+    }
+}
+
+/**
+ * bergibt die DNS-Server aus Option 6 an den DNS-Resolver und die NTP-Server aus Option 42
+ * an den SNTP-Client (jeweils in der Reihenfolge der Lease).
+ *
+ * @param buffer Der Puffer, beginnend mit dem DHCP-Header.
+ * @param length Die Lnge der DHCP-Nachricht.
+ */
+void extract_servers(const uint8_t *buffer, uint16_t length) {
+    uint8_t option_length;
+    const uint8_t* data;
+
+    data = dhcp_find_option(buffer, length, DHCP_OP_6, &option_length);
+    if (data != NULL && option_length >= 4) {
+        dns_set_servers((const ip_address*)data, option_length / 4);
+    }
+    data = dhcp_find_option(buffer, length, DHCP_OP_42, &option_length);
+    if (data != NULL && option_length >= 4) {
+        sntp_set_servers((const ip_address*)data, option_length / 4);
+    }
+}
+
 /**
  * Sendet eine DHCP Discover-Nachricht ber das Netzwerk.
  */
@@ -236,7 +310,7 @@ void send_dhcp_disc(){
 		option_50 dhcp_50;
 		option_55 dhcp_55;
 		option_255 dhcp_255;
-		uint8_t padding[7];
+		uint8_t padding[6];
 		} payload;
 	};
 	// Initialisiere das DHCP Discover-Paket
@@ -250,7 +324,7 @@ void send_dhcp_disc(){
 	disc.mac_header.ether_type = IPV4_TYPE;
 	// Layer 3 (IPv4)
 	disc.ipv4_header.version_length = IPV4_VERSION;
-	disc.ipv4_header.service_field = 0x00;
+	disc.ipv4_header.service_field = txq_tos(TXQ_PRIO_CONTROL);
 	disc.ipv4_header.total_length = swapEndian16(sizeof(disc) - sizeof(disc.mac_header));
 	disc.ipv4_header.ident = calculate_next_id();
 	disc.ipv4_header.flags = 0x00;
@@ -268,7 +342,8 @@ void send_dhcp_disc(){
 	disc.payload.dhcp_header.hw_type = 0x01;
 	disc.payload.dhcp_header.hw_len = 0x06;
 	disc.payload.dhcp_header.hops = 0x00;
-	disc.payload.dhcp_header.id = swapEndian32(generateID());
+	xid = swapEndian32(generateID());
+	disc.payload.dhcp_header.id = xid;
 	disc.payload.dhcp_header.secs = 0x0000;
 	disc.payload.dhcp_header.flags = 0x0000;
 	disc.payload.dhcp_header.ip_client = (ip_address){0x00,0x00,0x00,0x00};
@@ -295,20 +370,21 @@ void send_dhcp_disc(){
 	disc.payload.dhcp_50.ip_addr = (ip_address){0x00,0x00,0x00,0x00};
 	// DHCP Option 55
 	disc.payload.dhcp_55.option_type = 0x37;
-	disc.payload.dhcp_55.length = 0x04;
+	disc.payload.dhcp_55.length = 0x05;
 	disc.payload.dhcp_55.sub_mask = 0x01;
 	disc.payload.dhcp_55.router = 0x03;
 	disc.payload.dhcp_55.dns = 0x06;
 	disc.payload.dhcp_55.ntps = 0x2a;
+	disc.payload.dhcp_55.classless_routes = DHCP_OP_121;
 	// DHCP Option 255
 	disc.payload.dhcp_255.option_type = 0xff;
 	
 	// Berechne die Prfsummen
-	disc.ipv4_header.header_checksum = calculate_checksum(&disc.ipv4_header, sizeof(disc.ipv4_header));
+	disc.ipv4_header.header_checksum = checksum(&disc.ipv4_header, sizeof(disc.ipv4_header));
 	//disc.udp_header.checksum = 0x0000;
-	disc.udp_header.checksum = swapEndian16(udp_checksum(&disc.ipv4_header, &disc.udp_header, (uint8_t*) &disc.payload, sizeof(disc.payload))); //(pseudoheader + udp data)
+	disc.udp_header.checksum = udp_checksum(&disc.ipv4_header, &disc.udp_header, (uint8_t*) &disc.payload, sizeof(disc.payload)); //(pseudoheader + udp data)
 	// Sende das DHCP Discover-Paket
-	enc28_packetSend(sizeof(disc), (uint8_t*)&disc);
+	txq_send(sizeof(disc), (uint8_t*)&disc, TXQ_PRIO_CONTROL);
 }
 
 void send_dhcp_req(){
@@ -326,12 +402,11 @@ void send_dhcp_req(){
 		option_54 dhcp_54;
 		option_55 dhcp_55;
 		option_255 dhcp_255;
-		uint8_t padding[1];
 		} payload;
 	};
-	// Initialisiere das DHCP Request-Paket
+	// Initialisiere das DHCP Request-Paket (Optionen fllen die Nutzdaten bereits auf eine gerade Lnge)
 	struct package req = {
-	.payload.padding = {0x00}
+	.payload.dhcp_255 = {0xff}
 	};
 
 	// Layer 2 (Ethernet)
@@ -340,7 +415,7 @@ void send_dhcp_req(){
 	req.mac_header.ether_type = IPV4_TYPE;
 	// Layer 3 (IPv4)
 	req.ipv4_header.version_length = IPV4_VERSION;
-	req.ipv4_header.service_field = 0x00;
+	req.ipv4_header.service_field = txq_tos(TXQ_PRIO_CONTROL);
 	req.ipv4_header.total_length = swapEndian16(sizeof(req) - sizeof(req.mac_header));
 	req.ipv4_header.ident = calculate_next_id();
 	req.ipv4_header.flags = 0x00;
@@ -358,7 +433,7 @@ void send_dhcp_req(){
 	req.payload.dhcp_header.hw_type = 0x01;
 	req.payload.dhcp_header.hw_len = 0x06;
 	req.payload.dhcp_header.hops = 0x00;
-	req.payload.dhcp_header.id = swapEndian32(generateID());
+	req.payload.dhcp_header.id = xid; // Dieselbe Transaction ID wie Discover und Offer (RFC 2131, 4.4.1)
 	req.payload.dhcp_header.secs = 0x0000;
 	req.payload.dhcp_header.flags = 0x0000;
 	req.payload.dhcp_header.ip_client = (ip_address){0x00,0x00,0x00,0x00};
@@ -389,20 +464,21 @@ void send_dhcp_req(){
 	req.payload.dhcp_54.ip_addr = *my_dhcp_server_addr; //dhcp_server_ip;
 	// DHCP Option 55
 	req.payload.dhcp_55.option_type = 0x37;
-	req.payload.dhcp_55.length = 0x04;
+	req.payload.dhcp_55.length = 0x05;
 	req.payload.dhcp_55.sub_mask = 0x01;
 	req.payload.dhcp_55.router = 0x03;
 	req.payload.dhcp_55.dns = 0x06;
 	req.payload.dhcp_55.ntps = 0x2a;
+	req.payload.dhcp_55.classless_routes = DHCP_OP_121;
 	// DHCP Option 255
 	req.payload.dhcp_255.option_type = 0xff;
 	
 	// Berechne die Prfsummen
-	req.ipv4_header.header_checksum = calculate_checksum(&req.ipv4_header, sizeof(req.ipv4_header));
+	req.ipv4_header.header_checksum = checksum(&req.ipv4_header, sizeof(req.ipv4_header));
 	//req.udp_header.checksum = 0x0000;
-	req.udp_header.checksum = swapEndian16(udp_checksum(&req.ipv4_header, &req.udp_header, (uint8_t*) &req.payload, sizeof(req.payload))); //(pseudoheader + udp data)
+	req.udp_header.checksum = udp_checksum(&req.ipv4_header, &req.udp_header, (uint8_t*) &req.payload, sizeof(req.payload)); //(pseudoheader + udp data)
 	// Sende das DHCP Request-Paket
-	enc28_packetSend(sizeof(req), (uint8_t*)&req);
+	txq_send(sizeof(req), (uint8_t*)&req, TXQ_PRIO_CONTROL);
 }
 
 /**
@@ -410,28 +486,32 @@ void send_dhcp_req(){
  * 
  * @param buf Pointer auf den empfangenen Netzwerkpaket-Puffer
  * @param length Lnge des empfangenen Netzwerkpakets
+ * @param offset Beginn des DHCP-Headers im Puffer
  */
-void get_dhcp_offer(const uint8_t* buf, uint16_t length){
+void get_dhcp_offer(const uint8_t* buf, uint16_t length, uint16_t offset){
 			// Extrahiere die neue IP-Adresse aus dem empfangenen Paket
-			my_ip_addr->octet[0] = buf[58];
-			my_ip_addr->octet[1] = buf[59];
-			my_ip_addr->octet[2] = buf[60];
-			my_ip_addr->octet[3] = buf[61];
+			my_ip_addr->octet[0] = buf[offset + 16];
+			my_ip_addr->octet[1] = buf[offset + 17];
+			my_ip_addr->octet[2] = buf[offset + 18];
+			my_ip_addr->octet[3] = buf[offset + 19];
 	
 			 // Extrahiere DHCP Option 1 (Subnet Mask) und aktualisiere die Subnetzadresse
 			option_1 result_1;
-			extract_option_1(buf, length, &result_1);
+			extract_option_1(buf + offset, length - offset, &result_1);
 			*my_subnet_addr = result_1.subnet_mask;
 	
 			// Extrahiere DHCP Option 3 (Router) und aktualisiere die Gateway-Adresse
 			option_3 result_3;
-			extract_option_3(buf, length, &result_3);
+			extract_option_3(buf + offset, length - offset, &result_3);
 			*my_gateway_addr = result_3.router;
 			
 			// Extrahiere DHCP Option 54 (DHCP Server) und aktualisiere die DHCP-Server-Adresse
 			option_54 result_54;
-			extract_option_54(buf, length, &result_54);
+			extract_option_54(buf + offset, length - offset, &result_54);
 			*my_dhcp_server_addr = result_54.ip_addr;
+			
+			// Adresse oder Subnetz haben sich gendert: Route des eigenen Subnetzes neu ableiten
+			route_rebuild();
 
 			// Sende eine DHCP Request-Nachricht, um die zugewiesenen Konfigurationen zu besttigen
 			send_dhcp_req();
@@ -443,25 +523,26 @@ void get_dhcp_offer(const uint8_t* buf, uint16_t length){
  * 
  * @param buf Pointer auf den empfangenen Netzwerkpaket-Puffer
  * @param length Lnge des empfangenen Netzwerkpakets
+ * @param offset Beginn des DHCP-Headers im Puffer
  * @param dhcp_rdy Ein Pointer auf den Status des DHCP-Dienstes.
  */
-void get_dhcp_ack(const uint8_t* buf, uint16_t length, uint8_t* dhcp_rdy){
+void get_dhcp_ack(const uint8_t* buf, uint16_t length, uint16_t offset, uint8_t* dhcp_rdy){
 	
 	// Extrahiere DHCP Option 1 (Subnetzmaske)
 	option_1 result_1;
-	extract_option_1(buf, length, &result_1);
+	extract_option_1(buf + offset, length - offset, &result_1);
 	// Extrahiere DHCP Option 3 (Router)
 	option_3 result_3;
-	extract_option_3(buf, length, &result_3);
+	extract_option_3(buf + offset, length - offset, &result_3);
 	// Extrahiere DHCP Option 54 (DHCP Server)
 	option_54 result_54;
-	extract_option_54(buf, length, &result_54);
+	extract_option_54(buf + offset, length - offset, &result_54);
 	// berprfe, ob die erhaltenen Konfigurationen mit den erwarteten bereinstimmen
 	if(
-			my_ip_addr->octet[0] == buf[58] &&
-			my_ip_addr->octet[1] == buf[59] &&
-			my_ip_addr->octet[2] == buf[60] &&
-			my_ip_addr->octet[3] == buf[61] &&
+			my_ip_addr->octet[0] == buf[offset + 16] &&
+			my_ip_addr->octet[1] == buf[offset + 17] &&
+			my_ip_addr->octet[2] == buf[offset + 18] &&
+			my_ip_addr->octet[3] == buf[offset + 19] &&
 	
 			my_subnet_addr->octet[0] == result_1.subnet_mask.octet[0] &&
 			my_subnet_addr->octet[1] == result_1.subnet_mask.octet[1] &&
@@ -480,59 +561,97 @@ void get_dhcp_ack(const uint8_t* buf, uint16_t length, uint8_t* dhcp_rdy){
 	){
 		// Setze den DHCP-Bereitschaftsstatus auf 1 (Abgeschlossen)
 		*dhcp_rdy = 0x01;
+		// Lease besttigt: Routen aus Option 3 bzw. 121 bernehmen
+		extract_routes(buf + offset, length - offset);
+		// DNS- und NTP-Server aus Option 6 bzw. 42 bernehmen
+		extract_servers(buf + offset, length - offset);
+		SYSLOG(SYSLOG_INFO, "dhcp: lease %u.%u.%u.%u/%u.%u.%u.%u gw %u.%u.%u.%u",
+			my_ip_addr->octet[0], my_ip_addr->octet[1], my_ip_addr->octet[2], my_ip_addr->octet[3],
+			my_subnet_addr->octet[0], my_subnet_addr->octet[1], my_subnet_addr->octet[2], my_subnet_addr->octet[3],
+			my_gateway_addr->octet[0], my_gateway_addr->octet[1], my_gateway_addr->octet[2], my_gateway_addr->octet[3]);
 	}
 			return;
 }
 
 
+/**
+ * Prft, ob eine DHCP-Nachricht die Antwort eines Servers auf die eigene Anfrage ist: BOOTREPLY,
+ * Transaction ID (xid) der letzten Anfrage und die eigene MAC als Client-Adresse (chaddr).
+ *
+ * @param buf Pointer auf den empfangenen Netzwerkpaket-Puffer
+ * @param offset Beginn des DHCP-Headers im Puffer
+ * @return 1, wenn die Nachricht fr uns bestimmt ist; sonst 0.
+ */
+static int dhcp_is_reply(const uint8_t* buf, uint16_t offset){
+	const dhcp_header* header = (const dhcp_header*)(buf + offset);
+	
+	if (header->type != 0x02 || header->id != xid) {
+		return 0;
+	}
+	for (uint8_t i = 0; i < 6; i++) {
+		if (header->mac_addr.octet[i] != my_mac.octet[i]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+/**
+ * bernimmt die Absender-MAC eines DHCP Offer/Ack in die ARP-Tabelle. Der Frame stammt entweder
+ * direkt vom DHCP-Server oder, wenn das Relay-Feld (giaddr) gesetzt ist, vom Relay-Agent, der in der
+ * Regel auch das Gateway ist. So entfllt nach dem Boot die erste ARP-Auflsung zum Server bzw. Gateway.
+ * Nur fr Nachrichten aufrufen, die dhcp_is_reply geprft hat, damit fremde Antworten keine
+ * Eintrge berschreiben.
+ *
+ * @param buf Pointer auf den empfangenen Netzwerkpaket-Puffer
+ * @param offset Beginn des DHCP-Headers im Puffer
+ * @param src Die Absenderadresse aus dem IPv4-Header
+ */
+void learn_dhcp_server(const uint8_t* buf, uint16_t offset, ip_address src){
+	// Absender-MAC aus dem Ethernet-Header
+	mac_address mac;
+	for (uint8_t i = 0; i < 6; i++) {
+		mac.octet[i] = buf[6 + i];
+	}
+	
+	// Relay-Adresse (giaddr) aus dem DHCP-Header
+	uint16_t giaddr = offset + 24;
+	ip_address relay = *(ip_address*)(buf + giaddr);
+	
+	if (ip_to_uint32(relay) != 0) {
+		arp_learn(relay, mac, 1);
+	} else {
+		// Kein Relay: der Absender im IPv4-Header ist der Server selbst
+		arp_learn(src, mac, 1);
+	}
+}
+
+
 /**
  * Verarbeitet ein DHCP-Paket und ruft die entsprechenden Funktionen basierend auf der DHCP-Option 53 auf.
  * 
  * @param buf Pointer auf den empfangenen Netzwerkpaket-Puffer
- * @param length Lnge des empfangenen Netzwerkpakets
+ * @param offset Beginn des DHCP-Headers im Puffer (UDP-Nutzdaten)
+ * @param len Lnge der DHCP-Nachricht (von handle_udp geprft)
+ * @param src Absenderadresse (Server oder Relay)
+ * @param sport Absenderport (Little Endian)
  * 
  * @return Rckgabewert 0 fr erfolgreiche Verarbeitung
  */
-int handle_dhcp(const uint8_t* buf,uint16_t length){
+int handle_dhcp(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport){
+		if (len < sizeof(dhcp_header)) {return 1;}
+		uint16_t length = offset + len; // Ende der DHCP-Nachricht im Puffer
+		if (!dhcp_is_reply(buf, offset)) {return 1;} // Nur Antworten auf die eigene Anfrage (xid und chaddr)
 		// Extrahiere DHCP Option 53 (DHCP Message Type)
 		option_53 result;
-		extract_option_53(buf, length, &result);
+		extract_option_53(buf + offset, length - offset, &result);
 	
 		// berprfe, ob die DHCP Option 53 vorhanden ist
 		if (result.option_type == 53){
-			if (result.dhcp_option == DHCP_OFFER){get_dhcp_offer(buf, length);} // Verarbeite DHCP Offer
-			if (result.dhcp_option == DHCP_ACK){get_dhcp_ack(buf, length, dhcp_rdy_addr);} // Verarbeite DHCP Acknowledgment
+			if (result.dhcp_option == DHCP_OFFER || result.dhcp_option == DHCP_ACK){learn_dhcp_server(buf, offset, src);} // MAC des Servers bzw. Relays lernen
+			if (result.dhcp_option == DHCP_OFFER){get_dhcp_offer(buf, length, offset);} // Verarbeite DHCP Offer
+			if (result.dhcp_option == DHCP_ACK){get_dhcp_ack(buf, length, offset, dhcp_rdy_addr);} // Verarbeite DHCP Acknowledgment
 		}
 		return 0;
-}
-
-
-/**
- * Berechnet die 16-Bit-Prfsumme (Checksum) fr die bergebenen Daten.
- *
- * @param data Ein Pointer auf die Daten, fr die die Prfsumme berechnet werden soll.
- * @param length Die Lnge der Daten in Bytes.
- * @return Die berechnete 16-Bit-Prfsumme.
- */
-static uint16_t calculate_checksum(const void* data, size_t length) {
-    const uint16_t* p = data;
-    uint32_t sum = 0;
-
-    // Summation der 16-Bit-Werte im Datenbereich
-    while (length > 1) {
-        sum += *p++;
-        length -= 2;
-    }
-
-    // Falls die Lnge ungerade ist, fge das letzte Byte hinzu
-    if (length > 0) {
-        sum += *(uint8_t*)p;
-    }
-
-    // Fge die bertrge hinzu
-    sum = (sum >> 16) + (sum & 0xFFFF);
-    sum += (sum >> 16);
-
-    // Invertiere die Bits, um die Prfsumme zu erhalten
-    return (uint16_t)~sum;
 }
\ No newline at end of file
@@ -0,0 +1,634 @@
+/* Includes ------------------------------------------------------------------*/
+#include "dns.h"
+#include "clock.h"
+
+/* Private variables ---------------------------------------------------------*/
+static dns_resolver* resolver;
+
+/* Private functions prototypes ---------------------------------------------*/
+static int dns_input(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport);
+static int dns_normalize(const char* name, char* out);
+static uint32_t dns_hash(const char* name);
+static int dns_parse_ipv4(const char* name, ip_address* addr);
+static int dns_name_equal(const char* a, const char* b);
+static dns_cache_entry* dns_cache_find(const char* name, uint32_t hash, uint32_t now);
+static void dns_cache_store(const dns_query* q, ip_address addr, int8_t status, uint32_t ttl);
+static uint16_t dns_random(void);
+static void dns_send(dns_query* q);
+static void dns_failover(dns_query* q);
+static void dns_complete(dns_query* q, ip_address addr, int status);
+static uint16_t dns_read_name(const uint8_t* msg, uint16_t len, uint16_t pos, char* out);
+static uint32_t dns_read32(const uint8_t* p);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Initialisiert den DNS-Resolver und ffnet seinen Socket (dynamischer Port). Die Server
+ * kommen aus DHCP Option 6 oder von dns_set_servers.
+ *
+ * @param resolver_addr Ein Pointer auf den Zustand (Cache und ausstehende Anfragen).
+ */
+void dns_init(dns_resolver* resolver_addr) {
+	if (resolver_addr != NULL) {
+		resolver = resolver_addr;
+		
+		resolver->server_count = 0;
+		resolver->preferred = 0;
+		resolver->seed = clock_now_us() ^ 0x9E3779B9;
+		for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+			resolver->cache[i].valid = 0;
+		}
+		for (uint8_t i = 0; i < DNS_PENDING; i++) {
+			resolver->pending[i].in_use = 0;
+		}
+		resolver->stats = (dns_stats) {0};
+		resolver->sock = udp_bind(UDP_PORT_ANY, &dns_input);
+	}
+}
+
+
+/**
+ * Setzt die DNS-Server, z.B. aus DHCP Option 6. Der Cache bleibt erhalten.
+ *
+ * @param servers Die Adressen der Server in absteigender Prioritt.
+ * @param count Ihre Anzahl (hchstens DNS_SERVERS werden bernommen).
+ */
+void dns_set_servers(const ip_address* servers, uint8_t count) {
+	if (count > DNS_SERVERS) {
+		count = DNS_SERVERS;
+	}
+	for (uint8_t i = 0; i < count; i++) {
+		resolver->servers[i] = servers[i];
+	}
+	resolver->server_count = count;
+	resolver->preferred = 0;
+	
+	for (uint8_t i = 0; i < DNS_PENDING; i++) {
+		if (resolver->pending[i].server >= count) {
+			resolver->pending[i].server = 0;
+		}
+	}
+}
+
+
+/**
+ * Prft einen Namen und legt ihn in Kleinbuchstaben ohne abschlieenden Punkt ab.
+ *
+ * @param name Der Name, z.B. "Update.Example.com.".
+ * @param out Ausgabe mit Platz fr DNS_NAME_MAX Zeichen.
+ * @return Die Lnge des Namens; -1, wenn er zu lang ist oder ein Label leer bzw. lnger als 63 Zeichen ist.
+ */
+static int dns_normalize(const char* name, char* out) {
+	uint16_t len = 0;
+	uint8_t label = 0;
+	
+	for (uint16_t i = 0; name[i] != '\0'; i++) {
+		char c = name[i];
+		if (c == '.') {
+			if (label == 0) {
+				return -1;
+			}
+			if (name[i + 1] == '\0') {
+				break; // Abschlieender Punkt (absoluter Name)
+			}
+			label = 0;
+		} else if (++label > 63) {
+			return -1;
+		}
+		if (c >= 'A' && c <= 'Z') {
+			c += 'a' - 'A';
+		}
+		if (len >= DNS_NAME_MAX - 1) {
+			return -1;
+		}
+		out[len++] = c;
+	}
+	out[len] = '\0';
+	return (len > 0 && label > 0) ? len : -1;
+}
+
+
+/**
+ * Bildet den Hash eines normalisierten Namens (FNV-1a), damit beim Suchen im Cache und in den
+ * ausstehenden Anfragen nur bei gleichem Hash Zeichen verglichen werden.
+ */
+static uint32_t dns_hash(const char* name) {
+	uint32_t hash = 2166136261u;
+	
+	while (*name != '\0') {
+		hash = (hash ^ (uint8_t)*name++) * 16777619u;
+	}
+	return hash;
+}
+
+
+/**
+ * Erkennt eine Adresse in Punktschreibweise; sie wird ohne Anfrage zurckgegeben.
+ *
+ * @return 1, wenn der Name eine IPv4-Adresse ist; sonst 0.
+ */
+static int dns_parse_ipv4(const char* name, ip_address* addr) {
+	uint8_t octet = 0;
+	uint16_t value = 0;
+	uint8_t digits = 0;
+	
+	for (uint8_t i = 0; ; i++) {
+		char c = name[i];
+		if (c >= '0' && c <= '9') {
+			value = value * 10 + (c - '0');
+			if (++digits > 3 || value > 255) {
+				return 0;
+			}
+		} else if ((c == '.' || c == '\0') && digits > 0 && octet < 4) {
+			addr->octet[octet++] = value;
+			value = 0;
+			digits = 0;
+			if (c == '\0') {
+				return octet == 4;
+			}
+		} else {
+			return 0;
+		}
+	}
+}
+
+
+/**
+ * Vergleicht zwei normalisierte Namen.
+ */
+static int dns_name_equal(const char* a, const char* b) {
+	while (*a != '\0' && *a == *b) {
+		a++;
+		b++;
+	}
+	return *a == *b;
+}
+
+
+/**
+ * Sucht einen gltigen Cache-Eintrag; abgelaufene Eintrge werden dabei freigegeben.
+ *
+ * @return Der Eintrag oder NULL.
+ */
+static dns_cache_entry* dns_cache_find(const char* name, uint32_t hash, uint32_t now) {
+	for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+		dns_cache_entry* e = &resolver->cache[i];
+		
+		if (!e->valid || e->hash != hash || !dns_name_equal(e->name, name)) {
+			continue;
+		}
+		if ((int32_t)(e->expires - now) <= 0) {
+			e->valid = 0;
+			return NULL;
+		}
+		return e;
+	}
+	return NULL;
+}
+
+
+/**
+ * Legt ein Ergebnis im Cache ab. Verdrngt wird ein freier bzw. abgelaufener Eintrag, sonst der
+ * am lngsten nicht verwendete.
+ *
+ * @param q Die beantwortete Anfrage (Name und Hash).
+ * @param addr Die Adresse (nur bei DNS_OK).
+ * @param status DNS_OK oder DNS_ERR_NOT_FOUND.
+ * @param ttl Die Gltigkeit in s (0 = nicht cachen).
+ */
+static void dns_cache_store(const dns_query* q, ip_address addr, int8_t status, uint32_t ttl) {
+	uint32_t now = HAL_GetTick();
+	dns_cache_entry* victim = NULL;
+	
+	if (ttl == 0) {
+		return;
+	}
+	if (ttl > DNS_TTL_MAX) {
+		ttl = DNS_TTL_MAX;
+	}
+	
+	for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+		dns_cache_entry* e = &resolver->cache[i];
+		
+		if (!e->valid || (int32_t)(e->expires - now) <= 0 || (e->hash == q->hash && dns_name_equal(e->name, q->name))) {
+			victim = e;
+			break;
+		}
+		if (victim == NULL || (now - e->used) > (now - victim->used)) {
+			victim = e;
+		}
+	}
+	
+	for (uint8_t i = 0; i < DNS_NAME_MAX; i++) {
+		victim->name[i] = q->name[i];
+		if (q->name[i] == '\0') {
+			break;
+		}
+	}
+	victim->hash = q->hash;
+	victim->addr = addr;
+	victim->status = status;
+	victim->expires = now + ttl * 1000;
+	victim->used = now;
+	victim->valid = 1;
+}
+
+
+/**
+ * Liefert eine zufllige Transaktions-ID (xorshift, mit dem s-Zhler nachgemischt), damit
+ * geflschte Antworten nicht einfach erraten werden knnen.
+ */
+static uint16_t dns_random(void) {
+	uint32_t x = resolver->seed ^ clock_now_us();
+	
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	resolver->seed = x;
+	return (uint16_t)(x ^ (x >> 16));
+}
+
+
+/**
+ * Sendet eine Anfrage (Typ A, Rekursion erwnscht) an den aktuellen Server der Anfrage.
+ */
+static void dns_send(dns_query* q) {
+	uint8_t msg[12 + DNS_NAME_MAX + 1 + 4];
+	uint16_t len = 12;
+	
+	msg[0] = q->id >> 8;
+	msg[1] = q->id & 0xFF;
+	msg[2] = DNS_FLAG_RD >> 8;
+	msg[3] = 0;
+	msg[4] = 0;
+	msg[5] = 1; // QDCOUNT
+	for (uint8_t i = 6; i < 12; i++) {
+		msg[i] = 0;
+	}
+	
+	// Name als Labels: "a.bc" -> 1 'a' 2 'b' 'c' 0
+	uint16_t label = len++;
+	for (uint8_t i = 0; q->name[i] != '\0'; i++) {
+		if (q->name[i] == '.') {
+			msg[label] = len - label - 1;
+			label = len++;
+		} else {
+			msg[len++] = q->name[i];
+		}
+	}
+	msg[label] = len - label - 1;
+	msg[len++] = 0;
+	
+	msg[len++] = 0;
+	msg[len++] = DNS_TYPE_A;
+	msg[len++] = 0;
+	msg[len++] = DNS_CLASS_IN;
+	
+	udp_sendto(resolver->sock, msg, len, resolver->servers[q->server], DNS_PORT);
+	q->sent = HAL_GetTick();
+	resolver->stats.queries++;
+}
+
+
+/**
+ * Wiederholt eine Anfrage beim nchsten Server. Nach jedem Durchlauf ber alle Server
+ * verdoppelt sich die Wartezeit; nach DNS_ATTEMPTS Versuchen schlgt die Anfrage fehl.
+ */
+static void dns_failover(dns_query* q) {
+	if (++q->attempts >= DNS_ATTEMPTS || resolver->server_count == 0) {
+		resolver->stats.timeouts++;
+		dns_complete(q, (ip_address) {0}, DNS_ERR_TIMEOUT);
+		return;
+	}
+	resolver->stats.failovers++;
+	q->server = (q->server + 1) % resolver->server_count;
+	q->timeout = (uint32_t)DNS_TIMEOUT << (q->attempts / resolver->server_count);
+	dns_send(q);
+}
+
+
+/**
+ * Schliet eine Anfrage ab und meldet das Ergebnis allen Wartenden. Die Anfrage ist vor den
+ * Aufrufen bereits frei, die Handler drfen also neue Anfragen stellen.
+ */
+static void dns_complete(dns_query* q, ip_address addr, int status) {
+	char name[DNS_NAME_MAX];
+	dns_handler waiters[DNS_WAITERS];
+	uint8_t count = q->waiter_count;
+	
+	for (uint8_t i = 0; i < DNS_NAME_MAX; i++) {
+		name[i] = q->name[i];
+		if (name[i] == '\0') {
+			break;
+		}
+	}
+	for (uint8_t i = 0; i < count; i++) {
+		waiters[i] = q->waiters[i];
+	}
+	q->in_use = 0;
+	
+	for (uint8_t i = 0; i < count; i++) {
+		waiters[i](name, addr, status);
+	}
+}
+
+
+/**
+ * Lst einen Namen in eine IPv4-Adresse auf. Treffer im Cache (auch negative) werden sofort
+ * beantwortet, ohne Netzwerkverkehr. Sonst wird eine Anfrage gestellt bzw. an eine laufende
+ * Anfrage fr denselben Namen angehngt; das Ergebnis kommt dann ber den Handler.
+ *
+ * @param name Der Name oder eine Adresse in Punktschreibweise.
+ * @param addr Ausgabe bei DNS_OK (darf NULL sein).
+ * @param func Handler fr das sptere Ergebnis (NULL = nur den Cache fllen).
+ * @return DNS_OK, DNS_IN_PROGRESS oder ein Fehler DNS_ERR_*.
+ */
+int dns_resolve(const char* name, ip_address* addr, dns_handler func) {
+	char key[DNS_NAME_MAX];
+	ip_address literal;
+	uint32_t now = HAL_GetTick();
+	
+	resolver->stats.lookups++;
+	
+	if (dns_parse_ipv4(name, &literal)) {
+		if (addr != NULL) {
+			*addr = literal;
+		}
+		return DNS_OK;
+	}
+	if (dns_normalize(name, key) < 0) {
+		return DNS_ERR_NAME;
+	}
+	uint32_t hash = dns_hash(key);
+	
+	dns_cache_entry* e = dns_cache_find(key, hash, now);
+	if (e != NULL) {
+		e->used = now;
+		if (e->status != DNS_OK) {
+			resolver->stats.negative_hits++;
+			return e->status;
+		}
+		resolver->stats.hits++;
+		if (addr != NULL) {
+			*addr = e->addr;
+		}
+		return DNS_OK;
+	}
+	
+	// Gleiche Anfrage luft bereits: nur anhngen
+	dns_query* q = NULL;
+	for (uint8_t i = 0; i < DNS_PENDING; i++) {
+		dns_query* p = &resolver->pending[i];
+		if (p->in_use && p->hash == hash && dns_name_equal(p->name, key)) {
+			if (func != NULL) {
+				if (p->waiter_count >= DNS_WAITERS) {
+					return DNS_ERR_BUSY;
+				}
+				p->waiters[p->waiter_count++] = func;
+			}
+			resolver->stats.coalesced++;
+			return DNS_IN_PROGRESS;
+		}
+		if (!p->in_use && q == NULL) {
+			q = p;
+		}
+	}
+	
+	if (resolver->server_count == 0 || resolver->sock < 0) {
+		return DNS_ERR_NO_SERVER;
+	}
+	if (q == NULL) {
+		return DNS_ERR_BUSY;
+	}
+	
+	for (uint8_t i = 0; i < DNS_NAME_MAX; i++) {
+		q->name[i] = key[i];
+		if (key[i] == '\0') {
+			break;
+		}
+	}
+	q->hash = hash;
+	q->id = dns_random();
+	q->server = resolver->preferred;
+	q->attempts = 0;
+	q->timeout = DNS_TIMEOUT;
+	q->waiter_count = 0;
+	if (func != NULL) {
+		q->waiters[q->waiter_count++] = func;
+	}
+	q->in_use = 1;
+	dns_send(q);
+	return DNS_IN_PROGRESS;
+}
+
+
+/**
+ * Liest einen 32-Bit-Wert in Network Byte Order.
+ */
+static uint32_t dns_read32(const uint8_t* p) {
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+
+/**
+ * Liest einen Namen aus einer Nachricht und folgt dabei Kompressionszeigern (RFC 1035, 4.1.4).
+ *
+ * @param msg Die DNS-Nachricht.
+ * @param len Ihre Lnge.
+ * @param pos Beginn des Namens.
+ * @param out Ausgabe des Namens in Kleinbuchstaben mit Platz fr DNS_NAME_MAX Zeichen (NULL = berspringen).
+ * @return Die Position hinter dem Namen an seiner ursprnglichen Stelle; 0 bei einem Fehler.
+ */
+static uint16_t dns_read_name(const uint8_t* msg, uint16_t len, uint16_t pos, char* out) {
+	uint16_t end = 0;
+	uint16_t n = 0;
+	uint8_t jumps = 0;
+	
+	while (pos < len) {
+		uint8_t label = msg[pos];
+		
+		if (label == 0) {
+			if (out != NULL) {
+				out[n] = '\0';
+			}
+			return end ? end : pos + 1;
+		}
+		if ((label & 0xC0) == 0xC0) {
+			if (pos + 1 >= len || ++jumps > 16) {
+				return 0;
+			}
+			if (end == 0) {
+				end = pos + 2;
+			}
+			pos = ((label & 0x3F) << 8) | msg[pos + 1];
+			continue;
+		}
+		if (label > 63 || pos + 1 + label > len) {
+			return 0;
+		}
+		if (out != NULL) {
+			if (n + label + 1 >= DNS_NAME_MAX) {
+				return 0;
+			}
+			if (n > 0) {
+				out[n++] = '.';
+			}
+			for (uint8_t i = 0; i < label; i++) {
+				char c = msg[pos + 1 + i];
+				out[n++] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+			}
+		}
+		pos += 1 + label;
+	}
+	return 0;
+}
+
+
+/**
+ * Verarbeitet Antworten der DNS-Server. Die Antwort muss von einem der Server stammen und in
+ * ID und Frage zu einer ausstehenden Anfrage passen. Die TTL einer positiven Antwort ist die
+ * kleinste der CNAME-Kette und des A-Records; negative Antworten werden nach RFC 2308 so lange
+ * gecacht, wie der SOA-Record der Authority-Sektion angibt.
+ */
+static int dns_input(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport) {
+	const uint8_t* msg = buf + offset;
+	
+	// Absender muss einer der Server sein
+	uint8_t server = DNS_SERVERS;
+	for (uint8_t i = 0; i < resolver->server_count; i++) {
+		ip_address s = resolver->servers[i];
+		if (s.octet[0] == src.octet[0] && s.octet[1] == src.octet[1] && s.octet[2] == src.octet[2] && s.octet[3] == src.octet[3]) {
+			server = i;
+			break;
+		}
+	}
+	if (server == DNS_SERVERS || sport != DNS_PORT || len < 12) {
+		resolver->stats.bad_answers++;
+		return 1;
+	}
+	
+	uint16_t id = (msg[0] << 8) | msg[1];
+	uint16_t flags = (msg[2] << 8) | msg[3];
+	uint16_t qdcount = (msg[4] << 8) | msg[5];
+	uint16_t ancount = (msg[6] << 8) | msg[7];
+	uint16_t nscount = (msg[8] << 8) | msg[9];
+	
+	dns_query* q = NULL;
+	for (uint8_t i = 0; i < DNS_PENDING; i++) {
+		if (resolver->pending[i].in_use && resolver->pending[i].id == id) {
+			q = &resolver->pending[i];
+			break;
+		}
+	}
+	if (q == NULL || !(flags & DNS_FLAG_QR) || qdcount != 1) {
+		resolver->stats.bad_answers++;
+		return 1;
+	}
+	
+	// Die Frage muss exakt der gestellten entsprechen
+	char qname[DNS_NAME_MAX];
+	uint16_t pos = dns_read_name(msg, len, 12, qname);
+	if (pos == 0 || pos + 4 > len || !dns_name_equal(qname, q->name) ||
+		msg[pos] != 0 || msg[pos + 1] != DNS_TYPE_A || msg[pos + 2] != 0 || msg[pos + 3] != DNS_CLASS_IN) {
+		resolver->stats.bad_answers++;
+		return 1;
+	}
+	pos += 4;
+	
+	uint8_t rcode = flags & DNS_RCODE_MASK;
+	if ((flags & DNS_FLAG_TC) || (rcode != 0 && rcode != DNS_RCODE_NXDOMAIN)) {
+		// Gekrzt (kein TCP), SERVFAIL, REFUSED usw.: nchster Server
+		dns_failover(q);
+		return 0;
+	}
+	resolver->preferred = server;
+	resolver->stats.answers++;
+	
+	// Antworten: A-Record suchen, kleinste TTL der Kette merken
+	ip_address addr = {0};
+	uint8_t found = 0;
+	uint32_t ttl = DNS_TTL_MAX;
+	for (uint16_t i = 0; i < ancount + nscount; i++) {
+		pos = dns_read_name(msg, len, pos, NULL);
+		if (pos == 0 || pos + 10 > len) {
+			break;
+		}
+		uint16_t type = (msg[pos] << 8) | msg[pos + 1];
+		uint16_t class = (msg[pos + 2] << 8) | msg[pos + 3];
+		uint32_t rr_ttl = dns_read32(&msg[pos + 4]);
+		uint16_t rdlength = (msg[pos + 8] << 8) | msg[pos + 9];
+		pos += 10;
+		if (pos + rdlength > len) {
+			break;
+		}
+		
+		if (class == DNS_CLASS_IN && i < ancount && rcode == 0) {
+			if (type == DNS_TYPE_A && rdlength == 4 && !found) {
+				for (uint8_t k = 0; k < 4; k++) {
+					addr.octet[k] = msg[pos + k];
+				}
+				found = 1;
+			}
+			if ((type == DNS_TYPE_A || type == DNS_TYPE_CNAME) && rr_ttl < ttl) {
+				ttl = rr_ttl;
+			}
+		}
+		if (type == DNS_TYPE_SOA && i >= ancount && !found) {
+			// Negative TTL: Minimum aus TTL des SOA und seinem MINIMUM-Feld (RFC 2308, 5)
+			uint16_t soa = dns_read_name(msg, len, pos, NULL);
+			soa = soa ? dns_read_name(msg, len, soa, NULL) : 0;
+			if (soa != 0 && soa + 20 <= pos + rdlength) {
+				uint32_t minimum = dns_read32(&msg[soa + 16]);
+				ttl = (rr_ttl < minimum) ? rr_ttl : minimum;
+				found = 2;
+			}
+		}
+		pos += rdlength;
+	}
+	
+	if (found == 1) {
+		dns_cache_store(q, addr, DNS_OK, ttl);
+		dns_complete(q, addr, DNS_OK);
+	} else {
+		resolver->stats.not_found++;
+		dns_cache_store(q, addr, DNS_ERR_NOT_FOUND, (found == 2) ? ttl : DNS_NEG_TTL);
+		dns_complete(q, addr, DNS_ERR_NOT_FOUND);
+	}
+	return 0;
+}
+
+
+/**
+ * Leert den Cache, z.B. nach einem Wechsel des Netzes.
+ */
+void dns_cache_flush(void) {
+	for (uint8_t i = 0; i < DNS_CACHE_SIZE; i++) {
+		resolver->cache[i].valid = 0;
+	}
+}
+
+
+/**
+ * Wiederholt unbeantwortete Anfragen nach ihrer Wartezeit beim nchsten Server.
+ * Wird regelmig aus der Hauptschleife aufgerufen.
+ */
+void dns_tick(void) {
+	uint32_t now = HAL_GetTick();
+	
+	for (uint8_t i = 0; i < DNS_PENDING; i++) {
+		dns_query* q = &resolver->pending[i];
+		if (q->in_use && (now - q->sent) >= q->timeout) {
+			dns_failover(q);
+		}
+	}
+}
+
+
+/**
+ * Liefert die Zhler des Resolvers.
+ *
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden).
+ */
+const dns_stats* dns_get_stats(void) {
+	return &resolver->stats;
+}
\ No newline at end of file
@@ -6,6 +6,12 @@
 extern SPI_HandleTypeDef hspi1;
 static uint8_t enc28_bank;
 static uint16_t nextPacketPtr;
+static uint16_t heldPacketPtr; // Beginn des zuletzt empfangenen Frames (MAC-Header) im Empfangspuffer
+static uint16_t heldLength; // Lnge des zuletzt empfangenen Frames; 0 = kein Frame gehalten
+static const uint8_t* heldBuf; // Puffer, in den der gehaltene Frame kopiert wurde
+static int (*rxFilter)(const uint8_t* header, uint16_t len); // Vorprfung anhand der Header (NULL = keine)
+static enc28_rx_sum rxSum; // Beim Lesen des zuletzt empfangenen Frames gebildete Summe
+static int (*rxSumFilter)(const uint8_t* header, uint16_t len); // Entscheidet, ob beim Lesen summiert wird (NULL = nie)
 
 /* Private functions prototypes ---------------------------------------------*/
 uint8_t enc28J60_TransceiveByte(uint8_t data);
@@ -23,6 +29,9 @@ uint16_t enc28_readPhy(uint8_t addr);
 void enc28_writeBuf(uint16_t len, uint8_t* data);
 void enc28_readBuf(uint16_t len, uint8_t *data);
 uint16_t enc28_readBuf16();
+static uint32_t enc28_readBufSum(uint16_t len, uint8_t *data, uint16_t pos);
+static uint8_t enc28_hashIndex(mac_address mac);
+static void enc28_packetRelease(void);
 
 /* Functions -----------------------------------------------------------------*/
 
@@ -248,6 +257,33 @@ void enc28_readBuf(uint16_t len, uint8_t *data) {
 	enc28J60_DisableChip();
 }
 
+/**
+ * Liest Daten aus dem Puffer des ENC28J60 und bildet dabei ihre Internet-Summe (wie checksum_partial).
+ * Die Summe entsteht im selben Durchlauf wie die Kopie, whrend ohnehin auf das nchste SPI-Byte
+ * gewartet wird; die Daten mssen danach nicht erneut gelesen werden.
+ *
+ * @param len Die Anzahl der zu lesenden Bytes.
+ * @param data Ein Pointer auf den Puffer, in dem die gelesenen Daten gespeichert werden.
+ * @param pos Die Position des ersten Bytes im Frame (bestimmt die Lage der Bytes im 16-Bit-Wort).
+ * @return Die ungefaltete Summe in Speicher-Byte-Order.
+ */
+static uint32_t enc28_readBufSum(uint16_t len, uint8_t *data, uint16_t pos) {
+	uint32_t sum = 0;
+	uint8_t odd = pos & 1;
+	
+	enc28J60_EnableChip();
+	enc28J60_TransceiveByte(ENC28_READ_BUF_MEM);
+	while (len--) {
+		uint8_t b = enc28J60_TransceiveByte(0x00);
+		*data++ = b;
+		// Little Endian: gerade Position = unteres Byte des Wortes
+		sum += odd ? (uint32_t)(b << 8) : b;
+		odd ^= 1;
+	}
+	enc28J60_DisableChip();
+	return sum;
+}
+
 /**
  * Liest einen 16-Bit-Wert aus dem Puffer des ENC28J60 Ethernet-Controllers.
  *
@@ -338,40 +374,153 @@ void enc28_init(mac_address mac) {
 
 
 
-// FIGURE 7-2: SAMPLE TRANSMIT PACKET LAYOUT
+/**
+ * Berechnet die Position einer MAC-Adresse in der 64-Bit-Hash-Tabelle des Empfangsfilters
+ * (Abschnitt 8.3: Bits 28:23 der CRC-32 ber die Zieladresse, Datenbits LSB zuerst).
+ *
+ * @param mac Die Ziel-MAC-Adresse.
+ * @return Die Bitposition (0 = Bit 0 von EHT0, 63 = Bit 7 von EHT7).
+ */
+static uint8_t enc28_hashIndex(mac_address mac) {
+	uint32_t crc = 0xFFFFFFFF;
+	
+	for (uint8_t i = 0; i < 6; i++) {
+		uint8_t data = mac.octet[i];
+		for (uint8_t j = 0; j < 8; j++) {
+			uint8_t next = ((crc >> 31) ^ data) & 0x01;
+			crc <<= 1;
+			if (next) {
+				crc ^= 0x04C11DB7;
+			}
+			data >>= 1;
+		}
+	}
+	return (crc >> 23) & 0x3F;
+}
 
 /**
- * Sendet ein Paket ber den ENC28J60 Ethernet-Controller.
+ * Programmiert den Hash-Tabellen-Filter (EHT0-EHT7) fr die angegebenen Multicast-MAC-Adressen.
+ * Der Filter ist ODER-verknpft mit Unicast- und Broadcast-Filter; Frames an andere Gruppen
+ * erreichen den Mikrocontroller nur noch bei einer Hash-Kollision. Ohne Adressen wird der
+ * Hash-Filter abgeschaltet.
  *
- * @param len Die Lnge des zu sendenden Pakets.
- * @param dataBuf Ein Pointer auf den Puffer mit den zu sendenden Daten.
+ * @param macs Die Multicast-MAC-Adressen der abonnierten Gruppen.
+ * @param count Die Anzahl der Adressen.
  */
-void enc28_packetSend(uint16_t len, uint8_t* dataBuf) {
+void enc28_setMulticastFilter(const mac_address* macs, uint8_t count) {
+	const uint8_t registers[8] = {EHT0, EHT1, EHT2, EHT3, EHT4, EHT5, EHT6, EHT7};
+	uint8_t table[8] = {0};
+	uint8_t filter = ERXFCON_UCEN | ERXFCON_BCEN | ERXFCON_CRCEN;
+	
+	for (uint8_t i = 0; i < count; i++) {
+		uint8_t idx = enc28_hashIndex(macs[i]);
+		table[idx >> 3] |= 1 << (idx & 0x07);
+	}
+	for (uint8_t i = 0; i < 8; i++) {
+		enc28_writeReg8(registers[i], table[i]);
+	}
+	
+	// REGISTER 8-1: ERXFCON_HTEN, Pakete werden akzeptiert, wenn ihr Bit in der Hash-Tabelle gesetzt ist.
+	if (count > 0) {
+		filter |= ERXFCON_HTEN;
+	}
+	enc28_writeReg8(ERXFCON, filter);
+}
 
-	while (enc28_readOp(ENC28J60_READ_CTRL_REG, ECON1) & ECON1_TXRTS) {
 
-		if ((enc28_readReg8(EIR) & EIR_TXERIF)) {
-			enc28_writeOp(ENC28J60_BIT_FIELD_SET, ECON1, ECON1_TXRST);
-			enc28_writeOp(ENC28J60_BIT_FIELD_CLR, ECON1, ECON1_TXRST);
-		}
-	}
-		
-	// Setzt den Pointer auf den Anfang des bertragungspufferbereichs
-	enc28_writeReg16(EWRPT, TXSTART_INIT);
-	 // Setzt den TXND-Pointer so, dass er der gegebenen Paketgre entspricht
-	enc28_writeReg16(ETXND, (TXSTART_INIT + len));
+// FIGURE 7-2: SAMPLE TRANSMIT PACKET LAYOUT
+
+/**
+ * Beginnt ein Paket im bertragungspuffer des ENC28J60 an der angegebenen Adresse. Setzt den
+ * Schreibpointer und schreibt das per-Paket-Kontrollbyte. Der Inhalt folgt ber enc28_packetWrite,
+ * gesendet wird mit enc28_packetTransmit. Der Bereich darf nicht gerade gesendet werden (siehe txq).
+ *
+ * @param addr Die Startadresse des Pakets im bertragungspuffer (Kontrollbyte).
+ */
+void enc28_packetBegin(uint16_t addr) {
+	// Setzt den Pointer auf den Anfang des Pakets
+	enc28_writeReg16(EWRPT, addr);
 	
 	// FIGURE 7-1: FORMAT FOR PER PACKET CONTROL BYTES
 	// Schreibt das per-Paket-Kontrollbyte (0xFF)
 	enc28_writeOp(ENC28_WRITE_BUF_MEM, 0, 0xFF);
-	// Kopiert das Paket in den bertragungspuffer
-	enc28_writeBuf(len, dataBuf);
+}
+
+/**
+ * Hngt Daten an das mit enc28_packetBegin begonnene Paket an. Kann beliebig oft aufgerufen
+ * werden, sodass ein Frame aus mehreren Teilen (Header, Nutzdaten) ohne Zwischenpuffer entsteht.
+ *
+ * @param len Die Lnge der anzuhngenden Daten.
+ * @param data Ein Pointer auf die anzuhngenden Daten.
+ */
+void enc28_packetWrite(uint16_t len, const uint8_t* data) {
+	enc28_writeBuf(len, (uint8_t*)data);
+}
+
+/**
+ * Startet die bertragung eines zuvor geschriebenen Pakets. Der Controller sendet direkt aus
+ * dem Puffer; nach dem Frame legt er den 7 Byte langen Statusvektor ab (FIGURE 7-2).
+ *
+ * @param addr Die Startadresse des Pakets (Kontrollbyte).
+ * @param len Die Lnge des Frames ohne Kontrollbyte.
+ */
+void enc28_packetTransmit(uint16_t addr, uint16_t len) {
+	enc28_writeReg16(ETXST, addr);
+	// ETXND zeigt auf das letzte Byte des Frames
+	enc28_writeReg16(ETXND, addr + len);
 	// Sendet den Inhalt des bertragungspuffers ins Netzwerk
 	enc28_writeOp(ENC28J60_BIT_FIELD_SET, ECON1, ECON1_TXRTS);
 }
 
+/**
+ * Prft, ob die laufende bertragung abgeschlossen ist. Bei einem bertragungsfehler wird die
+ * Sendelogik zurckgesetzt (Errata: TXRST setzen und lschen) und die bertragung abgebrochen.
+ *
+ * @return 1, wenn keine bertragung luft; 0, solange gesendet wird; -1, wenn sie wegen eines Fehlers abgebrochen wurde.
+ */
+int enc28_packetDone(void) {
+	if ((enc28_readOp(ENC28J60_READ_CTRL_REG, ECON1) & ECON1_TXRTS) == 0) {
+		return 1;
+	}
+	if (enc28_readReg8(EIR) & EIR_TXERIF) {
+		enc28_writeOp(ENC28J60_BIT_FIELD_SET, ECON1, ECON1_TXRST);
+		enc28_writeOp(ENC28J60_BIT_FIELD_CLR, ECON1, ECON1_TXRST);
+		enc28_writeOp(ENC28J60_BIT_FIELD_CLR, ECON1, ECON1_TXRTS);
+		enc28_writeOp(ENC28J60_BIT_FIELD_CLR, EIR, EIR_TXERIF);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Gibt den zuletzt empfangenen Frame im Empfangspuffer frei. Der Frame bleibt bis zum nchsten
+ * enc28_packetReceive im Controller, damit er whrend der Verarbeitung per DMA kopiert werden kann.
+ */
+static void enc28_packetRelease(void) {
+	if (heldBuf == NULL) {
+		return;
+	}
+	heldBuf = NULL;
+	heldLength = 0;
+	
+	// Setzt den Lesepointer fr den Empfangspuffer zurck
+	enc28_writeReg16(ERXRDPT, nextPacketPtr);
+	
+	// berprft, ob der nchste Punkt auerhalb des gltigen Bereichs liegt
+	if ((nextPacketPtr - 1 < RXSTART_INIT)|| (nextPacketPtr - 1 > RXSTOP_INIT)) {
+		enc28_writeReg16(ERXRDPT, RXSTOP_INIT);
+	} else {
+		enc28_writeReg16(ERXRDPT, (nextPacketPtr - 1));
+	}
+	
+	// Dekrementiert den Paketzhler, um anzuzeigen, dass das Paket verarbeitet wurde
+	enc28_writeOp(ENC28J60_BIT_FIELD_SET, ECON2, ECON2_PKTDEC);
+}
+
 /**
  * Empfngt ein Paket ber den ENC28J60 Ethernet-Controller und speichert es im angegebenen Puffer.
+ * Der vorherige Frame wird dabei freigegeben; der neue bleibt bis zum nchsten Aufruf im
+ * Empfangspuffer des Controllers (siehe enc28_packetCopyRx).
  *
  * @param maxlen Die maximale Lnge des zu empfangenden Pakets.
  * @param dataBuf Ein Pointer auf den Puffer, in dem das empfangene Paket gespeichert wird.
@@ -380,12 +529,16 @@ void enc28_packetSend(uint16_t len, uint8_t* dataBuf) {
 uint16_t enc28_packetReceive(uint16_t maxlen, uint8_t* dataBuf) {
 	uint16_t rxstat;
 	uint16_t len;
+	uint16_t packetPtr = nextPacketPtr;
+	
+	enc28_packetRelease();
+	
 	// berprft, ob keine Pakete im Puffer vorhanden sind
 	if (enc28_readReg8(EPKTCNT) == 0) {
 		return 0;
 	}
 	// Setzt den Lesepointer fr den nchsten Puffer
-	enc28_writeReg16(ERDPT, nextPacketPtr);
+	enc28_writeReg16(ERDPT, packetPtr);
 	nextPacketPtr = enc28_readBuf16();
 	
 	// Liest die Lnge des empfangenen Pakets und subtrahiert 4 Bytes (CRC)
@@ -394,6 +547,16 @@ uint16_t enc28_packetReceive(uint16_t maxlen, uint8_t* dataBuf) {
 	// Liest den Status des empfangenen Pakets
 	rxstat = enc28_readBuf16();
 	
+	// Der Frame beginnt hinter dem 6 Byte langen Empfangsvektor (FIGURE 7-3), ggf. nach dem Umlauf
+	heldPacketPtr = packetPtr + 6;
+	if (heldPacketPtr > RXSTOP_INIT) {
+		heldPacketPtr -= RXSTOP_INIT - RXSTART_INIT + 1;
+	}
+	// Nur vollstndig kopierte Frames drfen per DMA weiterverwendet werden
+	heldLength = (len > maxlen - 1) ? 0 : len;
+	heldBuf = dataBuf;
+	rxSum = (enc28_rx_sum) {0};
+	
 	// Begrenzt die Lnge auf die maximale Lnge minus 1 (fr Nullterminierung)
 	if (len > maxlen - 1) {
 		len = maxlen - 1;
@@ -403,22 +566,120 @@ uint16_t enc28_packetReceive(uint16_t maxlen, uint8_t* dataBuf) {
 	if ((rxstat & 0x80) == 0) {
 		// Ungltig
 		len = 0;
+		heldLength = 0;
 	} else {
-		// Kopiert das Paket aus dem Empfangspuffer in den angegebenen Puffer
-		enc28_readBuf(len, dataBuf);
+		// Erst die Header lesen; verwirft die Vorprfung den Frame, bleibt der Rest ungelesen
+		uint16_t peek = (len < ENC28_PEEK_SIZE) ? len : ENC28_PEEK_SIZE;
+		enc28_readBuf(peek, dataBuf);
+		if (rxFilter != NULL && !rxFilter(dataBuf, peek)) {
+			heldLength = 0;
+			return 0;
+		}
+		// Kopiert den Rest des Pakets aus dem Empfangspuffer in den angegebenen Puffer; nur Frames, deren
+		// Prfsumme oben tatschlich geprft wird, werden dabei summiert (siehe enc28_packetSum)
+		if (rxSumFilter != NULL && rxSumFilter(dataBuf, peek)) {
+			rxSum.sum = enc28_readBufSum(len - peek, dataBuf + peek, peek);
+			rxSum.from = peek;
+			rxSum.to = len;
+		} else {
+			enc28_readBuf(len - peek, dataBuf + peek);
+		}
 	}
-	// Setzt den Lesepointer fr den Empfangspuffer zurck
-	enc28_writeReg16(ERXRDPT, nextPacketPtr);
+	// Gibt die Lnge des empfangenen Pakets zurck
+	return len;
+}
+
+/**
+ * Liefert die beim Empfang gebildete Summe ber den Teil des Frames hinter den ENC28_PEEK_SIZE
+ * Bytes der Vorprfung. Eine Prfsumme ber den ganzen Frame muss damit nur noch den vorderen
+ * Teil im RAM summieren.
+ *
+ * @param dataBuf Der Puffer, der geprft werden soll.
+ * @return Die Summe mit ihrem Bereich im Frame; NULL, wenn dataBuf nicht der zuletzt empfangene Frame ist.
+ */
+const enc28_rx_sum* enc28_packetSum(const uint8_t* dataBuf) {
+	if (dataBuf == NULL || dataBuf != heldBuf) {
+		return NULL;
+	}
+	return &rxSum;
+}
+
+/**
+ * Meldet eine Prfung an, die anhand der ersten ENC28_PEEK_SIZE Bytes entscheidet, ob der Rest
+ * des Frames beim Lesen summiert wird (z.B. udp_rx_sum_wanted). Frames ohne Prfung ihrer
+ * Prfsumme werden so ohne Mehraufwand gelesen.
+ *
+ * @param filter Die Prffunktion; liefert 1 zum Summieren (NULL = nie summieren).
+ */
+void enc28_setRxSumFilter(int (*filter)(const uint8_t* header, uint16_t len)) {
+	rxSumFilter = filter;
+}
+
+/**
+ * Meldet eine Vorprfung an, die jeden gltigen Frame anhand seiner ersten ENC28_PEEK_SIZE Bytes
+ * annehmen oder verwerfen kann (z.B. ratelimit_peek). Verworfene Frames werden nicht vollstndig
+ * ber SPI gelesen.
+ *
+ * @param filter Die Prffunktion; liefert 1 zum Annehmen und 0 zum Verwerfen (NULL = keine Prfung).
+ */
+void enc28_setRxFilter(int (*filter)(const uint8_t* header, uint16_t len)) {
+	rxFilter = filter;
+}
+
+/**
+ * Prft, ob ein Frame unverndert als zuletzt empfangener Frame im Empfangspuffer des
+ * Controllers liegt, z.B. weil er nicht aus Fragmenten zusammengesetzt wurde.
+ *
+ * @param dataBuf Der Puffer, in dem der Frame verarbeitet wird.
+ * @param len Die Lnge des Frames (ohne Ethernet-Padding).
+ * @return 1, wenn der Frame mit enc28_packetCopyRx kopiert werden kann; sonst 0.
+ */
+int enc28_packetHeld(const uint8_t* dataBuf, uint16_t len) {
+	return heldBuf != NULL && dataBuf == heldBuf && len <= heldLength;
+}
+
+/**
+ * Kopiert den Anfang des gehaltenen Frames mit der DMA des ENC28J60 in den bertragungspuffer
+ * (Abschnitt 13.1). Die Daten laufen nicht ber SPI; ein Umlauf im Empfangspuffer wird von der
+ * DMA selbst behandelt.
+ *
+ * @param addr Die Zieladresse im bertragungspuffer.
+ * @param len Die Anzahl der zu kopierenden Bytes ab dem MAC-Header (hchstens die Framelnge).
+ */
+void enc28_packetCopyRx(uint16_t addr, uint16_t len) {
+	uint16_t end = heldPacketPtr + len - 1;
 	
-	// berprft, ob der nchste Punkt auerhalb des gltigen Bereichs liegt
-	if ((nextPacketPtr - 1 < RXSTART_INIT)|| (nextPacketPtr - 1 > RXSTOP_INIT)) {
-		enc28_writeReg16(ERXRDPT, RXSTOP_INIT);
-	} else {
-		enc28_writeReg16(ERXRDPT, (nextPacketPtr - 1));
+	if (end > RXSTOP_INIT) {
+		end -= RXSTOP_INIT - RXSTART_INIT + 1;
 	}
+	enc28_writeReg16(EDMAST, heldPacketPtr);
+	enc28_writeReg16(EDMAND, end);
+	enc28_writeReg16(EDMADST, addr);
 	
-	// Dekrementiert den Paketzhler, um anzuzeigen, dass das Paket verarbeitet wurde
-	enc28_writeOp(ENC28J60_BIT_FIELD_SET, ECON2, ECON2_PKTDEC);
-	// Gibt die Lnge des empfangenen Pakets zurck
-	return len;
+	// Kopie starten (CSUMEN gelscht) und warten, bis DMAST von der Hardware gelscht wird
+	enc28_writeOp(ENC28J60_BIT_FIELD_SET, ECON1, ECON1_DMAST);
+	while (enc28_readOp(ENC28J60_READ_CTRL_REG, ECON1) & ECON1_DMAST);
+}
+
+/**
+ * berschreibt Bytes im Pufferspeicher des ENC28J60, z.B. einzelne Header-Felder eines per DMA
+ * kopierten Frames.
+ *
+ * @param addr Die Adresse im Pufferspeicher.
+ * @param len Die Anzahl der Bytes.
+ * @param data Ein Pointer auf die neuen Daten.
+ */
+void enc28_packetPatch(uint16_t addr, uint16_t len, const uint8_t* data) {
+	enc28_writeReg16(EWRPT, addr);
+	enc28_writeBuf(len, (uint8_t*)data);
+}
+
+/**
+ * Setzt den Schreibpointer im Pufferspeicher, ohne Daten zu schreiben. Folgende Aufrufe von
+ * enc28_packetWrite schreiben ab dieser Adresse (z.B. Nutzdaten vor den erst spter bekannten Headern).
+ *
+ * @param addr Die Adresse im Pufferspeicher.
+ */
+void enc28_packetSeek(uint16_t addr) {
+	enc28_writeReg16(EWRPT, addr);
 }
@@ -104,4 +104,32 @@ uint32_t swapEndian32(uint32_t value) {
 uint16_t swapEndian16(uint16_t value) {
     return ((value & 0xFF00) >> 8) |
            ((value & 0x00FF) << 8);
+}
+
+/**
+ * Wandelt eine IP-Adresse in einen 32-Bit-Wert um (octet[0] im hchstwertigen Byte).
+ *
+ * @param ip Die umzuwandelnde IP-Adresse.
+ * @return Die IP-Adresse als 32-Bit-Wert.
+ */
+uint32_t ip_to_uint32(ip_address ip) {
+    return ((uint32_t)ip.octet[0] << 24) |
+           ((uint32_t)ip.octet[1] << 16) |
+           ((uint32_t)ip.octet[2] << 8) |
+           ((uint32_t)ip.octet[3]);
+}
+
+/**
+ * Wandelt einen 32-Bit-Wert (octet[0] im hchstwertigen Byte) in eine IP-Adresse um.
+ *
+ * @param value Der umzuwandelnde 32-Bit-Wert.
+ * @return Die zugehrige IP-Adresse.
+ */
+ip_address uint32_to_ip(uint32_t value) {
+    ip_address ip;
+    ip.octet[0] = value >> 24;
+    ip.octet[1] = value >> 16;
+    ip.octet[2] = value >> 8;
+    ip.octet[3] = value;
+    return ip;
 }
\ No newline at end of file
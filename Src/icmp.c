@@ -2,15 +2,14 @@
 #include "icmp.h"
 
 static ip_address *my_ip_addr;
-static ip_address *my_subnet_addr;
-static ip_address *my_gateway_addr;
 static mac_address my_mac;
+static icmp_reply_handler reply_handler;
 
 /* Private functions prototypes ---------------------------------------------*/
-int handle_icmp(const uint8_t* buf, uint16_t length);
-static uint16_t calculate_checksum(const void* data, size_t length);
-void send_icmp_rep(ip_address target_ip, uint16_t ident, uint16_t seq, uint8_t ttl);
-void get_icmp_req(const uint8_t* buf);
+int handle_icmp(const uint8_t* buf, uint16_t length, uint16_t offset);
+void send_icmp_rep(const uint8_t* buf, uint16_t length, uint16_t offset);
+void icmp_rep_in_chip(const uint8_t* buf, uint16_t length, uint16_t offset);
+void get_icmp_req(const uint8_t* buf, uint16_t length, uint16_t offset);
 
 /* Functions -----------------------------------------------------------------*/
 
@@ -18,161 +17,167 @@ void get_icmp_req(const uint8_t* buf);
  * Initialisiert das Internet Control Message Protocol (ICMP) fr die Verarbeitung von IPv4-Paketen.
  *
  * @param src_ip Die lokale IP-Adresse des Gerts.
- * @param my_subnet Die Subnetzmaske des Gerts.
- * @param my_gateway Die Gateway-IP-Adresse des Gerts.
- * @param src_mac Die MAC-Adresse des Gerts.
+ * @param src_mac Die lokale MAC-Adresse (Absender der im ENC28J60 erzeugten Echo-Antworten).
  */
-void icmp_init(ip_address* src_ip, ip_address *my_subnet,ip_address *my_gateway, mac_address src_mac) {
+void icmp_init(ip_address* src_ip, mac_address src_mac) {
 	// Fgt ICMP als untersttztes Layer-3-Protokoll hinzu und verknpft es mit der Handler-Funktion
 	ipv4_add_type(ICMP_TYPE, &handle_icmp);
 	
-	// Setzt die lokale IP-Adresse und MAC-Adresse fr die ICMP-Paketverarbeitung
+	// Setzt die lokale IP-Adresse fr die ICMP-Paketverarbeitung (MAC-Header und Routing bernimmt ipv4_output)
 	my_ip_addr = src_ip;
-	my_subnet_addr = my_subnet;
-	my_gateway_addr = my_gateway;
 	my_mac = src_mac;
 }
 
 
+/**
+ * Meldet die Funktion an, die empfangene Echo-Antworten erhlt (z.B. der Ping-Client).
+ *
+ * @param handler Die Verarbeitungsfunktion (NULL = Antworten ignorieren).
+ */
+void icmp_set_reply_handler(icmp_reply_handler handler) {
+	reply_handler = handler;
+}
+
+
 /**
  * Sendet ein ICMP (Internet Control Message Protocol) Anfragepaket an die angegebene Ziel-IP-Adresse.
+ * Die Nutzdaten werden nicht kopiert; groe Anfragen werden von ipv4_send fragmentiert.
  *
  * @param target_ip Die IP-Adresse des Zielgerts, an das die ICMP-Anfrage gesendet werden soll.
- *
- * @note Wird in diesem System nicht bentigt.
+ * @param ident Der Identifikator (Host-Byte-Order), mit dem die Antwort zugeordnet wird.
+ * @param seq Die Sequenznummer (Host-Byte-Order).
+ * @param data Die Nutzdaten der Anfrage.
+ * @param len Die Lnge der Nutzdaten.
+ * @return Der Rckgabewert von ipv4_send (1 gesendet, 0 ARP-Auflsung luft, -1 verworfen).
  */
-void send_icmp_req(ip_address target_ip){
-	// Struktur erstellen, um die Schichten des ICMP-Anfragepakets zu halten
-	struct package {
-		mac_header mac_header;
-		ipv4_header ipv4_header;
-		icmp_package icmp_package;
-	};
+int send_icmp_req(ip_address target_ip, uint16_t ident, uint16_t seq, const uint8_t* data, uint16_t len){
+	icmp_package req;
 	
-	struct package req;
-		
-	ip_address ip_dst = target_ip;
+	req.type = ICMP_REQ;
+	req.code = ICMP_CODE;
+	req.checksum = 0;
+	req.ident = swapEndian16(ident);
+	req.seq = swapEndian16(seq);
+	// Prfsumme ber Header und Nutzdaten, ohne sie zusammenzukopieren
+	req.checksum = ~checksum_fold(checksum_partial(data, len, checksum_partial(&req, sizeof(req), 0)));
 	
-	// berprfen, ob die Ziel-IP im gleichen Netzwerk ist; andernfalls Gateway verwenden
-	if(!isInSameNetwork(my_ip_addr, &ip_dst, my_subnet_addr)){ip_dst = *my_gateway_addr;};
+	// ICMP-Anfrage senden; Routing und MAC-Header bernimmt ipv4_send
+	return ipv4_send(target_ip, ICMP_TYPE, (uint8_t*)&req, sizeof(req), data, len, TXQ_PRIO_DEFAULT);
+}
+
+
+/**
+ * Sendet die Echo-Antwort auf eine Anfrage, die nicht mehr im Empfangspuffer des ENC28J60 liegt
+ * (aus Fragmenten zusammengesetzt). Die Nutzdaten der Anfrage werden unverndert zurckgesendet
+ * und bei Bedarf von ipv4_send fragmentiert; die ICMP-Prfsumme wird nur an den Typ angepasst.
+ *
+ * @param buf Der Puffer mit der empfangenen Echo-Anfrage.
+ * @param length Die Lnge des Frames.
+ * @param offset Der Beginn des ICMP-Headers im Puffer.
+ */
+void send_icmp_rep(const uint8_t* buf, uint16_t length, uint16_t offset){
+	const uint8_t* ip = buf + sizeof(mac_header);
+	uint8_t header[sizeof(icmp_package)];
 	
-	// MAC-Adresse des Ziel-IP abrufen
-	mac_address dest_mac;
-	if(get_mac(ip_dst, &dest_mac) != 1){
-		// MAC-Adresse konnte nicht abgerufen werden; ohne Senden der ICMP-Antwort zurckkehren
-		return;
+	// ICMP-Header bernehmen, Typ auf Echo-Antwort setzen
+	for (uint8_t i = 0; i < sizeof(header); i++) {
+		header[i] = buf[offset + i];
 	}
+	header[0] = ICMP_REPLY;
+	uint16_t check = checksum_update16(header[2] | (header[3] << 8), ICMP_REQ | (header[1] << 8), ICMP_REPLY | (header[1] << 8));
+	header[2] = check & 0xFF;
+	header[3] = check >> 8;
 	
-	
-	// Layer 2
-	req.mac_header.dest_mac = dest_mac;
-	req.mac_header.src_mac = my_mac;
-	req.mac_header.ether_type = IPV4_TYPE;
-	
-	// Layer 3 (IPv4)
-	req.ipv4_header.version_length = IPV4_VERSION;
-	req.ipv4_header.service_field = 0x00;
-	req.ipv4_header.total_length = swapEndian16(sizeof(req) - sizeof(req.mac_header));
-	req.ipv4_header.ident = calculate_next_id();
-	req.ipv4_header.flags = 0x00;
-	req.ipv4_header.ttl = 0xff;
-	req.ipv4_header.prtcl = 0x01; // ICMP-Protokoll
-	req.ipv4_header.src = *my_ip_addr;
-	req.ipv4_header.dst = target_ip;
-	req.ipv4_header.header_checksum = calculate_checksum(&req.ipv4_header, sizeof(req.ipv4_header));
-	
-	// ICMP-Paket
-	req.icmp_package.type = ICMP_REQ;
-	req.icmp_package.code = ICMP_CODE;
-	req.icmp_package.ident = ICMP_IDENT;
-	req.icmp_package.seq = ICMP_SEQ;
-	req.icmp_package.data = (payload) {0x61,0x62,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6a,0x6b,0x6c,0x6d,0x6e,0x6f,0x70,0x71,0x72,0x73,0x74,0x75,0x76,0x77,0x61,0x62,0x63,0x64,0x65,0x66,0x67,0x68,0x69};
-	req.icmp_package.checksum = calculate_checksum(&req.icmp_package, sizeof(req.icmp_package));
-		
-	// ICMP-Anfrage senden
-	enc28_packetSend(sizeof(req), (uint8_t*)&req);
+	// ICMP-Antwort senden; Routing und MAC-Header bernimmt ipv4_send
+	ipv4_send(*(ip_address*)(ip + 12), ICMP_TYPE, header, sizeof(header), buf + offset + sizeof(header), length - offset - sizeof(header), txq_prio_from_tos(ip[1]));
 }
 
 
 /**
- * Sendet ein ICMP (Internet Control Message Protocol) Antwortpaket als Reaktion auf eine ICMP-Anfrage an die angegebene Ziel-IP-Adresse.
+ * Erzeugt die Echo-Antwort im ENC28J60: Die Anfrage wird per DMA aus dem Empfangspuffer in den
+ * bertragungspuffer kopiert, danach werden nur MAC-Adressen, TTL, IP-Adressen und ICMP-Typ
+ * berschrieben. Beide Prfsummen werden inkrementell angepasst (RFC 1624), sodass unabhngig von
+ * der Gre der Nutzdaten nur 28 Bytes ber SPI geschrieben werden.
  *
- * @param target_ip Die IP-Adresse des Zielgerts, an das die ICMP-Antwort gesendet werden soll.
- * @param ident Der Identifikator, der von der empfangenen ICMP-Echo-Anfrage bernommen wird.
- * @param seq Die Sequenznummer, die von der empfangenen ICMP-Echo-Anfrage bernommen wird.
- * @param ttl Die Time-to-Live (TTL)-Wert, der fr das ICMP-Antwortpaket festgelegt werden soll.
+ * @param buf Der Puffer mit der empfangenen Echo-Anfrage (noch im Empfangspuffer gehalten).
+ * @param length Die Lnge des Frames.
+ * @param offset Der Beginn des ICMP-Headers im Puffer.
  */
-void send_icmp_rep(ip_address target_ip, uint16_t ident, uint16_t seq, uint8_t ttl){
-	// Struktur erstellen, um die Schichten des ICMP-Antwortpakets zu halten
-	struct package {
-		mac_header mac_header;
-		ipv4_header ipv4_header;
-		icmp_package icmp_package;
-	};
-	
-	struct package rep;
+void icmp_rep_in_chip(const uint8_t* buf, uint16_t length, uint16_t offset){
+	const uint8_t* ip = buf + sizeof(mac_header);
+	uint8_t mac[12];
+	uint8_t ip_patch[12];
+	uint8_t icmp_patch[4];
 	
-	ip_address ip_dst = target_ip;
+	if (txq_begin(length, txq_prio_from_tos(ip[1])) < 0) {
+		return;
+	}
+	txq_copy_rx(length);
 	
-	// berprfen, ob die Ziel-IP im gleichen Netzwerk ist; andernfalls Gateway verwenden
-	if(!isInSameNetwork(my_ip_addr, &ip_dst, my_subnet_addr)){ip_dst = *my_gateway_addr;};
+	// Layer 2: an den Absender der Anfrage (bzw. den Router, ber den sie kam)
+	for (uint8_t i = 0; i < 6; i++) {
+		mac[i] = buf[6 + i];
+		mac[6 + i] = my_mac.octet[i];
+	}
+	txq_patch(0, sizeof(mac), mac);
 	
-	// MAC-Adresse des Ziel-IP abrufen
-	mac_address dest_mac;
-	if(get_mac(ip_dst, &dest_mac) != 1){
-		// MAC-Adresse konnte nicht abgerufen werden; ohne Senden der ICMP-Antwort zurckkehren
-		return;
+	// Layer 3: TTL neu setzen; Quelle ist die eigene Adresse (auch bei Broadcast-Anfragen), Ziel der Absender
+	uint32_t old_dst = ip[16] | (ip[17] << 8) | (ip[18] << 16) | ((uint32_t)ip[19] << 24);
+	uint32_t new_src = my_ip_addr->octet[0] | (my_ip_addr->octet[1] << 8) | (my_ip_addr->octet[2] << 16) | ((uint32_t)my_ip_addr->octet[3] << 24);
+	uint16_t check = ip[10] | (ip[11] << 8);
+	check = checksum_update16(check, ip[8] | (ip[9] << 8), IPV4_TTL | (ip[9] << 8));
+	// Die Summe der vertauschten Adressen ndert sich nur um das ersetzte Ziel
+	check = checksum_update32(check, old_dst, new_src);
+	ip_patch[0] = IPV4_TTL;
+	ip_patch[1] = ip[9];
+	ip_patch[2] = check & 0xFF;
+	ip_patch[3] = check >> 8;
+	for (uint8_t i = 0; i < 4; i++) {
+		ip_patch[4 + i] = my_ip_addr->octet[i];
+		ip_patch[8 + i] = ip[12 + i];
 	}
-	// Layer 2 - MAC-Header
-	rep.mac_header.dest_mac = dest_mac;
-	rep.mac_header.src_mac = my_mac;
-	rep.mac_header.ether_type = IPV4_TYPE;
-	// Layer 3 (IPv4)
-	rep.ipv4_header.version_length = IPV4_VERSION;
-	rep.ipv4_header.service_field = 0x00;
-	rep.ipv4_header.total_length = swapEndian16(sizeof(rep) - sizeof(rep.mac_header));
-	rep.ipv4_header.ident = calculate_next_id();
-	rep.ipv4_header.flags = 0x00;
-	rep.ipv4_header.ttl = ttl /2;
-	rep.ipv4_header.prtcl = 0x01;
-	rep.ipv4_header.src = *my_ip_addr;
-	rep.ipv4_header.dst = target_ip;
-	rep.ipv4_header.header_checksum = calculate_checksum(&rep.ipv4_header, sizeof(rep.ipv4_header));
-	// Layer 4 (ICMP)
-	rep.icmp_package.type = ICMP_REPLY;
-	rep.icmp_package.code = ICMP_CODE;
-	rep.icmp_package.ident = ident; // Den Identifikator von der empfangenen ICMP-Echo-Anfrage bernehmen
-	rep.icmp_package.seq = seq; // Die Sequenznummer von der empfangenen ICMP-Echo-Anfrage bernehmen
-	rep.icmp_package.data = (payload) {0x61,0x62,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6a,0x6b,0x6c,0x6d,0x6e,0x6f,0x70,0x71,0x72,0x73,0x74,0x75,0x76,0x77,0x61,0x62,0x63,0x64,0x65,0x66,0x67,0x68,0x69};
-	rep.icmp_package.checksum = calculate_checksum(&rep.icmp_package, sizeof(rep.icmp_package));
-	// ICMP-Antwort senden
-	enc28_packetSend(sizeof(rep), (uint8_t*)&rep);
+	txq_patch(sizeof(mac_header) + 8, sizeof(ip_patch), ip_patch);
+	
+	// Layer 4: Typ und Prfsumme
+	check = checksum_update16(buf[offset + 2] | (buf[offset + 3] << 8), ICMP_REQ | (buf[offset + 1] << 8), ICMP_REPLY | (buf[offset + 1] << 8));
+	icmp_patch[0] = ICMP_REPLY;
+	icmp_patch[1] = buf[offset + 1];
+	icmp_patch[2] = check & 0xFF;
+	icmp_patch[3] = check >> 8;
+	txq_patch(offset, sizeof(icmp_patch), icmp_patch);
+	
+	txq_end();
 }
 
 
 /**
- * Verarbeitet eine eingehende ICMP (Internet Control Message Protocol) Echo-Anforderung und sendet eine ICMP Echo-Antwort.
+ * Verarbeitet eine eingehende ICMP (Internet Control Message Protocol) Echo-Anforderung und sendet eine ICMP Echo-Antwort
+ * mit denselben Nutzdaten. Liegt die Anfrage noch im Empfangspuffer des ENC28J60, wird die Antwort dort erzeugt.
  *
  * @param buf Der Puffer, der die empfangenen ICMP-Anforderungsdaten enthlt.
+ * @param length Die Lnge des Frames.
+ * @param offset Der Beginn des ICMP-Headers im Puffer.
  */
-void get_icmp_req(const uint8_t* buf){
-			// Ziel-IP-Adresse aus dem empfangenen Paket extrahiere
-			ip_address dest_ip;
-			dest_ip.octet[0] = buf[26];
-			dest_ip.octet[1] = buf[27];
-			dest_ip.octet[2] = buf[28];
-			dest_ip.octet[3] = buf[29];
+void get_icmp_req(const uint8_t* buf, uint16_t length, uint16_t offset){
+	const uint8_t* ip = buf + sizeof(mac_header);
 	
-			 // TTL (Time-to-Live) aus dem empfangenen Paket extrahieren
-			uint8_t ttl = buf[22];
+	// Die Antwort bernimmt die Prfsumme der Anfrage, diese muss daher stimmen
+	if (checksum_fold(checksum_partial(buf + offset, length - offset, 0)) != 0xFFFF) {
+		return;
+	}
+	// Keine Antwort an unbestimmte, Broadcast- oder Multicast-Absender
+	if (ip[12] == 0 || ip[12] >= 0xE0) {
+		return;
+	}
+	if (!ratelimit_allow(RATELIMIT_ICMP_ECHO)) {
+		return;
+	}
 	
-			// Identifikator und Sequenznummer aus dem empfangenen Paket extrahieren
-			icmp_package pkg;
-			pkg.ident = (buf[38]  + (buf[39] << 8));
-			pkg.seq = (buf[40]  + (buf[41] << 8));
-			 // ICMP-Antwort senden
-			send_icmp_rep(dest_ip, pkg.ident, pkg.seq, ttl);
-			return;
+	if (enc28_packetHeld(buf, length)) {
+		icmp_rep_in_chip(buf, length, offset);
+	} else {
+		send_icmp_rep(buf, length, offset);
+	}
 }
 
 /**
@@ -180,41 +185,18 @@ void get_icmp_req(const uint8_t* buf){
  *
  * @param buf Pointer auf den empfangenen Netzwerkpaket-Puffer
  * @param length Die Lnge der empfangenen Daten im Puffer.
- * @return Gibt 0 zurck.
+ * @param offset Der Beginn des ICMP-Headers im Puffer (hinter eventuellen IP-Optionen).
+ * @return Gibt 0 zurck; 1, wenn das Paket zu kurz ist.
  */
-int handle_icmp(const uint8_t* buf, uint16_t length){
+int handle_icmp(const uint8_t* buf, uint16_t length, uint16_t offset){
+		if (length < offset + sizeof(icmp_package)) {return 1;}
 		// berprfen den Typ des ICMP-Pakets
-		if (buf[34] == ICMP_REQ){get_icmp_req(buf);}
-		if (buf[34] == ICMP_REPLY){return 0;} //(Nicht Implementiert)
+		if (buf[offset] == ICMP_REQ){get_icmp_req(buf, length, offset);}
+		if (buf[offset] == ICMP_REPLY && reply_handler != NULL){
+			// Echo-Antwort an den Ping-Client weitergeben, wenn die Prfsumme stimmt
+			if (checksum_fold(checksum_partial(buf + offset, length - offset, 0)) == 0xFFFF) {
+				reply_handler(buf, length, offset);
+			}
+		}
 		return 0;
-}
-
-/**
- * Berechnet die 16-Bit-Prfsumme (Checksum) fr die bergebenen Daten.
- *
- * @param data Ein Pointer auf die Daten, fr die die Prfsumme berechnet werden soll.
- * @param length Die Lnge der Daten in Bytes.
- * @return Die berechnete 16-Bit-Prfsumme.
- */
-static uint16_t calculate_checksum(const void* data, size_t length) {
-    const uint16_t* p = data;
-    uint32_t sum = 0;
-
-    // Summation der 16-Bit-Werte im Datenbereich
-    while (length > 1) {
-        sum += *p++;
-        length -= 2;
-    }
-
-    // Falls die Lnge ungerade ist, fge das letzte Byte hinzu
-    if (length > 0) {
-        sum += *(uint8_t*)p;
-    }
-
-    // Fge die bertrge hinzu
-    sum = (sum >> 16) + (sum & 0xFFFF);
-    sum += (sum >> 16);
-
-    // Invertiere die Bits, um die Prfsumme zu erhalten
-    return (uint16_t)~sum;
 }
\ No newline at end of file
@@ -0,0 +1,298 @@
+/* Includes ------------------------------------------------------------------*/
+#include "igmp.h"
+
+/* Private variables ---------------------------------------------------------*/
+static igmp_groups* groups;
+static ip_address *my_ip_addr;
+
+/* Private functions prototypes ---------------------------------------------*/
+int handle_igmp(const uint8_t* buf, uint16_t length, uint16_t offset);
+static void igmp_send(uint8_t type, uint32_t group, uint32_t dst);
+static void igmp_update_filter(void);
+static uint32_t igmp_random(uint32_t range);
+static igmp_group* igmp_find(uint32_t key);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Initialisiert IGMPv2 (RFC 2236). Registriert den Handler bei der IPv4-Schicht und programmiert
+ * den Hash-Filter des ENC28J60 fr die Gruppe aller Hosts (224.0.0.1), an die Queries gesendet werden.
+ *
+ * @param groups_addr Ein Pointer auf die Struktur der Gruppenmitgliedschaften.
+ * @param src_ip Die lokale IP-Adresse.
+ * @param src_mac Die lokale MAC-Adresse (Startwert fr die zufllige Antwortverzgerung).
+ */
+void igmp_init(igmp_groups* groups_addr, ip_address* src_ip, mac_address src_mac) {
+	if (groups_addr != NULL) {
+		ipv4_add_type(IGMP_TYPE, &handle_igmp);
+		
+		groups = groups_addr;
+		my_ip_addr = src_ip;
+		
+		for (uint8_t i = 0; i < IPV4_GROUPS_SIZE; i++) {
+			groups->data[i].in_use = 0;
+		}
+		groups->stats = (igmp_stats) {0};
+		
+		// Stationen mit gleicher Firmware sollen nicht gleichzeitig antworten
+		groups->seed = HAL_GetTick() ^ ((uint32_t)src_mac.octet[2] << 24) ^ ((uint32_t)src_mac.octet[3] << 16)
+				^ ((uint32_t)src_mac.octet[4] << 8) ^ src_mac.octet[5];
+		if (groups->seed == 0) {
+			groups->seed = 1;
+		}
+		
+		igmp_update_filter();
+	}
+}
+
+
+/**
+ * Liefert eine Pseudozufallszahl (Xorshift32) im Bereich 0 bis range - 1.
+ *
+ * @param range Die obere Grenze (exklusiv, grer 0).
+ * @return Die Zufallszahl.
+ */
+static uint32_t igmp_random(uint32_t range) {
+	uint32_t x = groups->seed;
+	
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	groups->seed = x;
+	return x % range;
+}
+
+
+/**
+ * Sucht die Mitgliedschaft einer Gruppe.
+ *
+ * @param key Die Gruppe als 32-Bit-Schlssel.
+ * @return Ein Pointer auf die Mitgliedschaft; NULL, wenn die Gruppe nicht abonniert ist.
+ */
+static igmp_group* igmp_find(uint32_t key) {
+	for (uint8_t i = 0; i < IPV4_GROUPS_SIZE; i++) {
+		if (groups->data[i].in_use && groups->data[i].group == key) {
+			return &groups->data[i];
+		}
+	}
+	return NULL;
+}
+
+
+/**
+ * Programmiert den Hash-Filter des ENC28J60 mit den MAC-Adressen aller abonnierten Gruppen
+ * und der Gruppe aller Hosts.
+ */
+static void igmp_update_filter(void) {
+	mac_address macs[IPV4_GROUPS_SIZE + 1];
+	uint8_t count = 0;
+	
+	macs[count++] = ipv4_multicast_mac(uint32_to_ip(IPV4_ALL_HOSTS));
+	for (uint8_t i = 0; i < IPV4_GROUPS_SIZE; i++) {
+		if (groups->data[i].in_use) {
+			macs[count++] = ipv4_multicast_mac(uint32_to_ip(groups->data[i].group));
+		}
+	}
+	enc28_setMulticastFilter(macs, count);
+}
+
+
+/**
+ * Sendet eine IGMPv2-Nachricht. Der IP-Header trgt die Router-Alert-Option (RFC 2113) und
+ * TTL 1, wie von RFC 2236 gefordert.
+ *
+ * @param type Der Nachrichtentyp (IGMP_V2_REPORT oder IGMP_LEAVE).
+ * @param group Die betroffene Gruppe als 32-Bit-Schlssel.
+ * @param dst Die Zieladresse als 32-Bit-Schlssel.
+ */
+static void igmp_send(uint8_t type, uint32_t group, uint32_t dst) {
+	struct package {
+		mac_header mac_header;
+		ipv4_header ipv4_header;
+		uint8_t router_alert[4];
+		igmp_package igmp_package;
+	} __attribute__((packed));
+	
+	struct package pkg;
+	
+	// Layer 3 (IPv4) mit Router Alert, IHL = 6
+	pkg.ipv4_header.version_length = IPV4_VERSION + 1;
+	pkg.ipv4_header.service_field = 0xC0; // Internetwork Control
+	pkg.ipv4_header.total_length = swapEndian16(sizeof(pkg) - sizeof(pkg.mac_header));
+	pkg.ipv4_header.ident = calculate_next_id();
+	pkg.ipv4_header.flags = 0x00;
+	pkg.ipv4_header.ttl = 1;
+	pkg.ipv4_header.prtcl = IGMP_TYPE;
+	pkg.ipv4_header.header_checksum = 0;
+	pkg.ipv4_header.src = *my_ip_addr;
+	pkg.ipv4_header.dst = uint32_to_ip(dst);
+	pkg.router_alert[0] = 0x94;
+	pkg.router_alert[1] = 0x04;
+	pkg.router_alert[2] = 0x00;
+	pkg.router_alert[3] = 0x00;
+	pkg.ipv4_header.header_checksum = checksum(&pkg.ipv4_header, sizeof(pkg.ipv4_header) + sizeof(pkg.router_alert));
+	
+	// IGMP
+	pkg.igmp_package.type = type;
+	pkg.igmp_package.max_resp = 0;
+	pkg.igmp_package.checksum = 0;
+	pkg.igmp_package.group = uint32_to_ip(group);
+	pkg.igmp_package.checksum = checksum(&pkg.igmp_package, sizeof(pkg.igmp_package));
+	
+	// Den MAC-Header (Gruppen-MAC-Adresse) setzt ipv4_output
+	ipv4_output(sizeof(pkg), (uint8_t*)&pkg);
+}
+
+
+/**
+ * Tritt einer Multicast-Gruppe bei. Die Gruppe wird in der IPv4-Schicht und im Hash-Filter
+ * des ENC28J60 eingetragen, ein Report sofort gesendet und innerhalb von IGMP_UNSOLICITED_INTERVAL
+ * einmal wiederholt, falls der erste verloren geht. UDP-Pakete an die Gruppe werden anschlieend
+ * wie Unicast an den Dienst des Zielports zugestellt.
+ *
+ * @param group Die Adresse der Multicast-Gruppe (224.0.0.0/4, nicht 224.0.0.1).
+ * @return 0, wenn die Gruppe abonniert ist; -1, wenn die Adresse ungltig ist oder kein Platz frei ist.
+ */
+int igmp_join(ip_address group) {
+	uint32_t key = ip_to_uint32(group);
+	igmp_group* entry = NULL;
+	
+	if (key == IPV4_ALL_HOSTS || ipv4_add_group(group) != 0) {
+		return -1;
+	}
+	if (igmp_find(key) != NULL) {
+		return 0; // Bereits Mitglied
+	}
+	for (uint8_t i = 0; i < IPV4_GROUPS_SIZE; i++) {
+		if (!groups->data[i].in_use) {
+			entry = &groups->data[i];
+			break;
+		}
+	}
+	if (entry == NULL) {
+		ipv4_del_group(group);
+		return -1;
+	}
+	
+	entry->group = key;
+	entry->in_use = 1;
+	entry->last_reporter = 1;
+	entry->state = IGMP_DELAYING;
+	entry->report_time = HAL_GetTick() + 1 + igmp_random(IGMP_UNSOLICITED_INTERVAL);
+	
+	igmp_update_filter();
+	igmp_send(IGMP_V2_REPORT, key, key);
+	groups->stats.reports_sent++;
+	return 0;
+}
+
+
+/**
+ * Verlsst eine Multicast-Gruppe. War diese Station die letzte, die einen Report gesendet hat,
+ * wird eine Leave-Nachricht an alle Router gesendet (RFC 2236, Abschnitt 6).
+ *
+ * @param group Die Adresse der Multicast-Gruppe.
+ */
+void igmp_leave(ip_address group) {
+	igmp_group* entry = igmp_find(ip_to_uint32(group));
+	
+	if (entry == NULL) {
+		return;
+	}
+	if (entry->last_reporter) {
+		igmp_send(IGMP_LEAVE, entry->group, IGMP_ALL_ROUTERS);
+		groups->stats.leaves_sent++;
+	}
+	entry->in_use = 0;
+	ipv4_del_group(group);
+	igmp_update_filter();
+}
+
+
+/**
+ * Sendet die Reports, deren zufllige Verzgerung abgelaufen ist.
+ * Wird regelmig aus der Hauptschleife aufgerufen.
+ */
+void igmp_tick(void) {
+	uint32_t now = HAL_GetTick();
+	
+	for (uint8_t i = 0; i < IPV4_GROUPS_SIZE; i++) {
+		igmp_group* entry = &groups->data[i];
+		
+		if (entry->in_use && entry->state == IGMP_DELAYING && (int32_t)(now - entry->report_time) >= 0) {
+			igmp_send(IGMP_V2_REPORT, entry->group, entry->group);
+			groups->stats.reports_sent++;
+			entry->state = IGMP_IDLE;
+			entry->last_reporter = 1;
+		}
+	}
+}
+
+
+/**
+ * Verarbeitet eine empfangene IGMP-Nachricht. Auf eine Query wird fr jede betroffene Gruppe
+ * ein Report mit zuflliger Verzgerung bis zur maximalen Antwortzeit geplant; ein bereits frher
+ * geplanter Report bleibt bestehen. Sendet ein anderes Mitglied vorher einen Report fr die Gruppe,
+ * entfllt der eigene.
+ *
+ * @param buf Pointer auf den empfangenen Frame.
+ * @param length Die Lnge des Frames.
+ * @param offset Der Beginn der IGMP-Nachricht im Puffer.
+ * @return 0, wenn die Nachricht verarbeitet wurde; 1, wenn sie ungltig ist.
+ */
+int handle_igmp(const uint8_t* buf, uint16_t length, uint16_t offset) {
+	if (length < offset + sizeof(igmp_package)) {
+		return 1;
+	}
+	if (checksum_fold(checksum_partial(buf + offset, length - offset, 0)) != 0xFFFF) {
+		groups->stats.bad_checksum++;
+		return 1;
+	}
+	
+	uint8_t type = buf[offset];
+	uint32_t group = ((uint32_t)buf[offset + 4] << 24) | ((uint32_t)buf[offset + 5] << 16) | ((uint32_t)buf[offset + 6] << 8) | buf[offset + 7];
+	uint32_t now = HAL_GetTick();
+	
+	if (type == IGMP_QUERY) {
+		groups->stats.queries++;
+		// Maximale Antwortzeit in ms; IGMPv1-Queries tragen 0 und meinen 10 s
+		uint32_t max_delay = buf[offset + 1] ? buf[offset + 1] * 100 : 10000;
+		
+		for (uint8_t i = 0; i < IPV4_GROUPS_SIZE; i++) {
+			igmp_group* entry = &groups->data[i];
+			
+			if (!entry->in_use || (group != 0 && group != entry->group)) {
+				continue;
+			}
+			if (entry->state == IGMP_DELAYING && (int32_t)(entry->report_time - now) <= (int32_t)max_delay) {
+				continue;
+			}
+			entry->state = IGMP_DELAYING;
+			entry->report_time = now + igmp_random(max_delay);
+		}
+		return 0;
+	}
+	
+	if (type == IGMP_V1_REPORT || type == IGMP_V2_REPORT) {
+		igmp_group* entry = igmp_find(group);
+		
+		if (entry != NULL) {
+			if (entry->state == IGMP_DELAYING) {
+				groups->stats.suppressed++;
+			}
+			entry->state = IGMP_IDLE;
+			entry->last_reporter = 0;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * Liefert die Zhler von IGMP.
+ *
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden).
+ */
+const igmp_stats* igmp_get_stats(void) {
+	return &groups->stats;
+}
\ No newline at end of file
@@ -3,9 +3,14 @@
 
 /* Private variables ---------------------------------------------------------*/
 static prtcl_types* types;
+static ip_address *my_ip_addr;
+static ip_address *my_subnet_addr;
 
 /* Private functions prototypes ---------------------------------------------*/
 int handle_ipv4(const uint8_t* buf, uint16_t length);
+static int ipv4_is_for_us(uint32_t dst);
+static void ipv4_stream(const uint8_t* header, uint16_t header_len, const uint8_t* payload, uint16_t offset, uint16_t len);
+static void ipv4_fill_header(ipv4_header* header, ip_address dst, uint8_t prtcl, uint16_t total_length, uint16_t flags, uint8_t prio);
 
 /* Functions -----------------------------------------------------------------*/
 
@@ -15,8 +20,10 @@ int handle_ipv4(const uint8_t* buf, uint16_t length);
  * und initialisiert den Index auf Null, um anzuzeigen, dass noch keine Layer-3-Protokolle hinzugefgt wurden.
  *
  * @param types_addr Ein Pointer auf die Struktur der Layer-3-Protokolltypen.
+ * @param src_ip Die lokale IP-Adresse (0.0.0.0, solange DHCP noch luft).
+ * @param my_subnet Die Subnetzmaske (fr gerichtete Broadcasts).
  */
-void ipv4_init(prtcl_types* types_addr) {
+void ipv4_init(prtcl_types* types_addr, ip_address* src_ip, ip_address* my_subnet) {
 	// berprft, ob der bereitgestellte Pointer nicht NULL ist
 	if (types_addr != NULL) {
 		// Fgt den IPv4-EtherType und die zugehrige Verarbeitungsfunktion zur Ethernet-Schicht hinzu
@@ -26,6 +33,16 @@ void ipv4_init(prtcl_types* types_addr) {
 		types = types_addr;
 		
 		types->idx = 0;
+		types->pending.active = 0;
+		
+		// Noch keine Multicast-Gruppen abonniert, Zhler zurcksetzen
+		for (uint8_t i = 0; i < IPV4_GROUPS_SIZE; i++) {
+			types->groups[i] = 0;
+		}
+		types->stats = (ipv4_stats) {0};
+		
+		my_ip_addr = src_ip;
+		my_subnet_addr = my_subnet;
 	}
 }
 
@@ -50,29 +67,526 @@ void ipv4_add_type(uint8_t type, void* func){
 }
 
 /**
- * Verarbeitet IPv4-Pakete, indem der Protokolltyp (prtcl_type) aus dem IPv4-Paketheader extrahiert wird
- * und dann die registrierten Protokolltypen durchgegangen werden, um die entsprechende Verarbeitungsfunktion aufzurufen.
+ * Abonniert eine Multicast-Gruppe, damit an sie adressierte Pakete angenommen werden.
+ *
+ * @param group Die Adresse der Multicast-Gruppe (224.0.0.0/4).
+ * @return 0, wenn die Gruppe abonniert ist; -1, wenn die Adresse keine Gruppe ist oder kein Platz frei ist.
+ */
+int ipv4_add_group(ip_address group) {
+	uint32_t key = ip_to_uint32(group);
+	int free_idx = -1;
+	
+	if ((key >> 28) != 0xE) {
+		return -1;
+	}
+	for (uint8_t i = 0; i < IPV4_GROUPS_SIZE; i++) {
+		if (types->groups[i] == key) {
+			return 0; // Bereits abonniert
+		}
+		if (types->groups[i] == 0 && free_idx < 0) {
+			free_idx = i;
+		}
+	}
+	if (free_idx < 0) {
+		return -1;
+	}
+	types->groups[free_idx] = key;
+	return 0;
+}
+
+
+/**
+ * Kndigt eine abonnierte Multicast-Gruppe.
+ *
+ * @param group Die Adresse der Multicast-Gruppe.
+ */
+void ipv4_del_group(ip_address group) {
+	uint32_t key = ip_to_uint32(group);
+	
+	for (uint8_t i = 0; i < IPV4_GROUPS_SIZE; i++) {
+		if (types->groups[i] == key) {
+			types->groups[i] = 0;
+		}
+	}
+}
+
+
+/**
+ * Liefert die Zhler der IPv4-Empfangsprfung.
+ *
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden).
+ */
+const ipv4_stats* ipv4_get_stats(void) {
+	return &types->stats;
+}
+
+
+/**
+ * Bildet die Ethernet-Adresse einer Multicast-Gruppe (RFC 1112, Abschnitt 6.4):
+ * 01:00:5e gefolgt von den unteren 23 Bit der Gruppenadresse.
+ *
+ * @param group Die Adresse der Multicast-Gruppe.
+ * @return Die zugehrige Multicast-MAC-Adresse.
+ */
+mac_address ipv4_multicast_mac(ip_address group) {
+	return (mac_address){0x01, 0x00, 0x5e, group.octet[1] & 0x7F, group.octet[2], group.octet[3]};
+}
+
+
+/**
+ * Prft, ob ein Paket an diese Station adressiert ist. Die eigene Adresse wird zuerst
+ * verglichen, da sie der hufigste Fall ist; alle Vergleiche laufen auf 32-Bit-Werten.
+ *
+ * @param dst Die Zieladresse des Pakets als 32-Bit-Wert (siehe ip_to_uint32).
+ * @return 1, wenn das Paket angenommen wird; 0, wenn nicht.
+ */
+static int ipv4_is_for_us(uint32_t dst) {
+	uint32_t local = ip_to_uint32(*my_ip_addr);
+	
+	if (dst == local || dst == IPV4_BROADCAST) {
+		return 1;
+	}
+	// Multicast: alle Hosts oder eine abonnierte Gruppe. Der Hash-Filter des ENC28J60 lsst auch
+	// Gruppen mit gleichem Hash-Bit durch; diese werden hier verworfen und gezhlt.
+	if ((dst >> 28) == 0xE) {
+		if (dst == IPV4_ALL_HOSTS) {
+			types->stats.multicast++;
+			return 1;
+		}
+		for (uint8_t i = 0; i < IPV4_GROUPS_SIZE; i++) {
+			if (types->groups[i] == dst) {
+				types->stats.multicast++;
+				return 1;
+			}
+		}
+		types->stats.multicast_leaked++;
+		return 0;
+	}
+	// Ohne Adresse (DHCP luft noch) wird jedes Paket angenommen, z.B. ein Unicast-Offer an yiaddr
+	if (local == 0) {
+		return 1;
+	}
+	// Gerichteter Broadcast in das eigene Subnetz
+	uint32_t host_mask = ~ip_to_uint32(*my_subnet_addr);
+	if (host_mask != 0 && (dst & host_mask) == host_mask && ((dst ^ local) & ~host_mask) == 0) {
+		return 1;
+	}
+	return 0;
+}
+/**
+ * Prft ein empfangenes IPv4-Paket und verteilt es an das registrierte Layer-4-Protokoll.
+ * Die Prfungen sind nach Kosten sortiert: Version/Headerlnge und Lngenangaben, dann die
+ * Zieladresse und zuletzt die Header-Prfsumme. Fremde oder fehlerhafte Pakete werden so frh
+ * wie mglich verworfen und je Grund gezhlt. Die Lnge wird auf die Gesamtlnge des Pakets
+ * gekrzt (Ethernet-Padding), und der Handler erhlt den Beginn des Layer-4-Headers, sodass
+ * IP-Optionen korrekt bersprungen werden. Fragmente werden an ipv4_frag bergeben; der Handler
+ * sieht nur vollstndige Datagramme, die dann im Reassemblierungs-Slot liegen.
  *
  * @param buf Ein Pointer auf den Puffer, der das empfangene IPv4-Paket enthlt.
- * @param length Die Lnge des empfangenen IPv4-Pakets.
- * @return 0, wenn die Verarbeitung erfolgreich war; 1, wenn kein passender Protokolltyp und Handler gefunden wurde.
+ * @param length Die Lnge des empfangenen Frames einschlielich MAC-Header.
+ * @return Den Rckgabewert des Handlers; 1, wenn das Paket verworfen wurde oder kein passender Handler gefunden wurde.
  */
 int handle_ipv4(const uint8_t* buf, uint16_t length) {
-	uint8_t typ = buf[23]; // Extrahiert den Protokolltyp (prtcl_type) aus dem IPv4-Paketheader
+	const uint8_t* ip = buf + sizeof(mac_header);
+	
+	types->stats.received++;
+	
+	if (length < sizeof(mac_header) + sizeof(ipv4_header)) {
+		types->stats.bad_length++;
+		return 1;
+	}
+	
+	// Version 4 und Headerlnge (IHL in 32-Bit-Worten) von mindestens 20 Bytes
+	uint8_t version = ip[0] >> 4;
+	uint16_t header_length = (ip[0] & 0x0F) * 4;
+	if (version != 4 || header_length < sizeof(ipv4_header)) {
+		types->stats.bad_header++;
+		return 1;
+	}
+	
+	// Die Gesamtlnge muss den Header umfassen und vollstndig im Frame liegen
+	uint16_t total_length = (ip[2] << 8) | ip[3];
+	if (total_length < header_length || sizeof(mac_header) + total_length > length) {
+		types->stats.bad_length++;
+		return 1;
+	}
+	
+	// Zieladresse als 32-Bit-Wert (byteweise, der Puffer ist nicht ausgerichtet)
+	uint32_t dst = ((uint32_t)ip[16] << 24) | ((uint32_t)ip[17] << 16) | ((uint32_t)ip[18] << 8) | ip[19];
+	if (!ipv4_is_for_us(dst)) {
+		types->stats.not_for_us++;
+		return 1;
+	}
+	
+	// ber einen korrekten Header (einschlielich Prfsumme) ergibt die Summe 0xFFFF
+	if (checksum_fold(checksum_partial(ip, header_length, 0)) != 0xFFFF) {
+		types->stats.bad_checksum++;
+		return 1;
+	}
+	
+	// Ethernet-Padding abschneiden
+	length = sizeof(mac_header) + total_length;
+	
+#if ARP_LEARN_FROM_IPV4
+	// Besttigt einen vorhandenen ARP-Eintrag des Absenders (z.B. Antworten auf eigenen Verkehr)
+	arp_learn(*(ip_address*)(ip + 12), *(mac_address*)(buf + 6), 0);
+#endif
+	
+	// Fragment (MF gesetzt oder Offset ungleich 0): erst das vollstndige Datagramm wird zugestellt
+	if ((ip[6] & 0x3F) != 0 || ip[7] != 0) {
+		types->stats.fragments++;
+		buf = ipv4_frag_input(buf, header_length, total_length, &length);
+		if (buf == NULL) {
+			return 0;
+		}
+		ip = buf + sizeof(mac_header);
+		// Das Datagramm trgt den Header des ersten Fragments, nicht den des zuletzt empfangenen
+		header_length = (ip[0] & 0x0F) * 4;
+	}
+	
+	uint8_t typ = ip[9]; // Protokolltyp (prtcl_type) aus dem IPv4-Header
 	
 	// Durchluft die registrierten Protokolltypen in der prtcl_types-Struktur
 	for(uint8_t i = 0; i < PRTCL_TYPE_SIZE; i++) { 
 		// berprft, ob der Protokolltyp (prtcl_type) des Pakets mit einem registrierten Protokolltyp bereinstimmt
-		if (typ == types->types[i].prtcl_type){
+		if (typ == types->types[i].prtcl_type && types->types[i].func != NULL){
+			types->stats.delivered++;
+			
+			// Ruft die entsprechende Verarbeitungsfunktion mit dem Beginn des Layer-4-Headers auf
+			return types->types[i].func(buf, length, sizeof(mac_header) + header_length);
+		}
+	}
+	types->stats.no_protocol++;
+	return 1;
+}
+
+
+/**
+ * Sendet ein vollstndig aufgebautes IPv4-Paket in der Priorittsklasse seines TOS-Bytes.
+ * Der MAC-Header wird ber den Next-Hop-Cache gesetzt; ist die MAC-Adresse des nchsten Hops noch unbekannt, bernimmt die ARP-Schicht
+ * den Frame bis zur Auflsung.
+ *
+ * @param len Die Lnge des Frames einschlielich MAC-Header.
+ * @param frame Ein Pointer auf den Frame, beginnend mit dem (noch leeren) MAC-Header.
+ * @return 1, wenn der Frame gesendet wurde; 0, wenn er auf die ARP-Auflsung wartet; -1, wenn er verworfen wurde.
+ */
+int ipv4_output(uint16_t len, uint8_t* frame) {
+	ipv4_header* header = (ipv4_header*)(frame + sizeof(mac_header));
+	ip_address next_hop;
+	
+	int result = route_lookup(header->dst, (mac_header*)frame, &next_hop);
+	if (result == 1) {
+		// Die Priorittsklasse folgt aus dem DSCP des Pakets
+		return txq_send(len, frame, txq_prio_from_tos(header->service_field));
+	}
+	if (result < 0) {
+		return -1;
+	}
+	return arp_output(next_hop, len, frame);
+}
+/**
+ * Bildet die Summe des Pseudo-Headers fr ein Datagramm von der eigenen Adresse an dst.
+ *
+ * @param dst Die Zieladresse.
+ * @param prtcl Das Layer-4-Protokoll.
+ * @param length Die Lnge von Layer-4-Header und Nutzdaten.
+ * @return Die ungefaltete Summe (siehe checksum_pseudo).
+ */
+uint32_t ipv4_pseudo_checksum(ip_address dst, uint8_t prtcl, uint16_t length) {
+	return checksum_pseudo(*my_ip_addr, dst, prtcl, length);
+}
+
+
+/**
+ * Schreibt einen Ausschnitt der Nutzdaten eines Datagramms in den bertragungspuffer. Die Nutzdaten
+ * bestehen aus dem Layer-4-Header und den Anwendungsdaten, die nicht zusammenhngend im Speicher liegen mssen.
+ *
+ * @param header Der Layer-4-Header.
+ * @param header_len Die Lnge des Layer-4-Headers.
+ * @param payload Die Anwendungsdaten.
+ * @param offset Der Beginn des Ausschnitts innerhalb von Header und Anwendungsdaten.
+ * @param len Die Lnge des Ausschnitts.
+ */
+static void ipv4_stream(const uint8_t* header, uint16_t header_len, const uint8_t* payload, uint16_t offset, uint16_t len) {
+	if (offset < header_len) {
+		uint16_t n = header_len - offset;
+		if (n > len) {
+			n = len;
+		}
+		txq_write(n, header + offset);
+		offset += n;
+		len -= n;
+	}
+	if (len > 0) {
+		txq_write(len, payload + (offset - header_len));
+	}
+}
+
+
+/**
+ * Fllt einen IPv4-Header ohne Optionen fr ein Datagramm von der eigenen Adresse
+ * einschlielich Prfsumme.
+ *
+ * @param header Der zu fllende Header.
+ * @param dst Die Zieladresse.
+ * @param prtcl Das Layer-4-Protokoll.
+ * @param total_length Die Gesamtlnge des Pakets (Host-Byte-Order).
+ * @param flags Flags und Fragment-Offset (Host-Byte-Order).
+ * @param prio Die Priorittsklasse, bestimmt den DSCP.
+ */
+static void ipv4_fill_header(ipv4_header* header, ip_address dst, uint8_t prtcl, uint16_t total_length, uint16_t flags, uint8_t prio) {
+	header->version_length = IPV4_VERSION;
+	header->service_field = txq_tos(prio);
+	header->total_length = swapEndian16(total_length);
+	header->ident = calculate_next_id();
+	header->flags = swapEndian16(flags);
+	header->ttl = IPV4_TTL;
+	header->prtcl = prtcl;
+	header->header_checksum = 0;
+	header->src = *my_ip_addr;
+	header->dst = dst;
+	header->header_checksum = checksum(header, sizeof(ipv4_header));
+}
+
+
+/**
+ * Sendet ein Datagramm an die angegebene Adresse und fragmentiert es, wenn es nicht in die
+ * Link-MTU passt. Jedes Fragment wird direkt aus Header und Anwendungsdaten in den bertragungspuffer
+ * des ENC28J60 geschrieben, das Datagramm wird also nie vollstndig im RAM aufgebaut. Die Prfsumme
+ * des IPv4-Headers wird einmal berechnet und fr jedes weitere Fragment nur an Gesamtlnge und
+ * Fragment-Offset angepasst. Die Priorittsklasse bestimmt Sendewarteschlange und DSCP.
+ *
+ * @param dst Die Zieladresse.
+ * @param prtcl Das Layer-4-Protokoll (z.B. UDP_TYPE).
+ * @param header Der Layer-4-Header (darf NULL sein, wenn header_len 0 ist).
+ * @param header_len Die Lnge des Layer-4-Headers.
+ * @param payload Die Anwendungsdaten.
+ * @param payload_len Die Lnge der Anwendungsdaten.
+ * @param prio Die Priorittsklasse (TXQ_PRIO_*).
+ * @return 1, wenn das Datagramm gesendet wurde; 0, wenn der nchste Hop noch per ARP aufgelst wird
+ *         (das Datagramm wird nicht gepuffert); -1, wenn es verworfen wurde.
+ */
+int ipv4_send(ip_address dst, uint8_t prtcl, const uint8_t* header, uint16_t header_len, const uint8_t* payload, uint16_t payload_len, uint8_t prio) {
+	struct package {
+		mac_header mac_header;
+		ipv4_header ipv4_header;
+	} __attribute__((packed));
+	
+	struct package pkg;
+	ip_address next_hop;
+	uint32_t length = (uint32_t)header_len + payload_len;
+	// Nutzdaten je Fragment: Vielfaches von 8 Bytes (Einheit des Fragment-Offsets)
+	uint16_t max_chunk = (IPV4_MTU - sizeof(ipv4_header)) & ~7;
+	
+	if (length + sizeof(ipv4_header) > 0xFFFF) {
+		return -1;
+	}
+	
+	int result = route_lookup(dst, &pkg.mac_header, &next_hop);
+	if (result <= 0) {
+		return result;
+	}
+	
+	uint16_t chunk = (length > max_chunk) ? max_chunk : length;
+	uint16_t total_length = sizeof(ipv4_header) + chunk;
+	uint16_t flags = (chunk < length) ? IPV4_FLAG_MORE : 0;
+	
+	// Layer 3 (IPv4) fr das erste Fragment
+	ipv4_fill_header(&pkg.ipv4_header, dst, prtcl, total_length, flags, prio);
+	
+	uint16_t offset = 0;
+	while (1) {
+		if (txq_begin(sizeof(pkg) + chunk, prio) < 0) {
+			return -1;
+		}
+		txq_write(sizeof(pkg), (uint8_t*)&pkg);
+		ipv4_stream(header, header_len, payload, offset, chunk);
+		txq_end();
+		
+		offset += chunk;
+		if (offset >= length) {
+			break;
+		}
+		
+		// Nchstes Fragment: nur Gesamtlnge und Flags/Offset ndern sich
+		chunk = (length - offset > max_chunk) ? max_chunk : length - offset;
+		uint16_t next_length = sizeof(ipv4_header) + chunk;
+		uint16_t next_flags = (offset / 8) | ((offset + chunk < length) ? IPV4_FLAG_MORE : 0);
+		
+		pkg.ipv4_header.header_checksum = checksum_update16(pkg.ipv4_header.header_checksum, pkg.ipv4_header.total_length, swapEndian16(next_length));
+		pkg.ipv4_header.header_checksum = checksum_update16(pkg.ipv4_header.header_checksum, pkg.ipv4_header.flags, swapEndian16(next_flags));
+		pkg.ipv4_header.total_length = swapEndian16(next_length);
+		pkg.ipv4_header.flags = swapEndian16(next_flags);
+	}
+	return 1;
+}
+
+
+/**
+ * Sendet mehrere Datagramme als Stapel: je bis zu TXQ_DEPTH Frames werden mit einem einzigen
+ * Setzen des Schreibpointers hintereinander in den bertragungspuffer geschrieben und gemeinsam
+ * eingereiht (txq_batch_begin). Datagramme werden nicht fragmentiert; zu lange erhalten Status -1.
+ *
+ * @param dgrams Die Datagramme; status wird fr jedes gesetzt.
+ * @param count Die Anzahl der Datagramme.
+ * @param prio Die Priorittsklasse (TXQ_PRIO_*).
+ * @return Die Anzahl der eingereihten Datagramme.
+ */
+int ipv4_send_batch(ipv4_datagram* dgrams, uint8_t count, uint8_t prio) {
+	struct package {
+		mac_header mac_header;
+		ipv4_header ipv4_header;
+	} __attribute__((packed));
+	
+	mac_header macs[TXQ_DEPTH];
+	uint8_t idx[TXQ_DEPTH];
+	ip_address next_hop;
+	int sent = 0;
+	uint8_t i = 0;
+	
+	while (i < count) {
+		uint8_t n = 0;
+		uint16_t total = 0;
+		
+		// Stapel zusammenstellen, solange Warteschlange und Stapelgre reichen
+		while (i < count && n < TXQ_DEPTH) {
+			ipv4_datagram* d = &dgrams[i];
+			uint32_t length = (uint32_t)d->header_len + d->payload_len;
+			
+			if (length > IPV4_MTU - sizeof(ipv4_header)) {
+				d->status = -1;
+				i++;
+				continue;
+			}
+			uint16_t frame_len = sizeof(struct package) + length + TXQ_FRAME_OVERHEAD;
+			if (total + frame_len > TXQ_BATCH_MAX) {
+				break;
+			}
+			d->status = route_lookup(d->dst, &macs[n], &next_hop);
+			if (d->status <= 0) {
+				i++;
+				continue;
+			}
+			idx[n++] = i++;
+			total += frame_len;
+		}
+		if (n == 0) {
+			continue;
+		}
+		if (txq_batch_begin(total, n, prio) < 0) {
+			// Von txq abgelehnt (als dropped gezhlt): keines der Datagramme wurde eingereiht
+			for (uint8_t k = 0; k < n; k++) {
+				dgrams[idx[k]].status = -1;
+			}
+			continue;
+		}
+		
+		for (uint8_t k = 0; k < n; k++) {
+			ipv4_datagram* d = &dgrams[idx[k]];
+			uint16_t length = d->header_len + d->payload_len;
+			struct package pkg;
+			
+			pkg.mac_header = macs[k];
+			ipv4_fill_header(&pkg.ipv4_header, d->dst, d->prtcl, sizeof(ipv4_header) + length, 0, prio);
 			
-			// Ruft die entsprechende Verarbeitungsfunktion fr den bereinstimmenden Protokolltyp auf
-			return types->types[i].func(buf, length);
+			txq_batch_add(sizeof(pkg) + length);
+			txq_write(sizeof(pkg), (uint8_t*)&pkg);
+			txq_write(d->header_len, d->header);
+			if (d->payload_len > 0) {
+				txq_write(d->payload_len, d->payload);
+			}
 		}
+		txq_batch_end();
+		sent += n;
+	}
+	return sent;
+}
+
+
+/**
+ * Beginnt ein Datagramm direkt im bertragungspuffer des ENC28J60. Der Platz fr MAC- und
+ * IPv4-Header wird bersprungen; Layer-4-Header und Nutzdaten werden anschlieend mit txq_write
+ * bzw. txq_patch geschrieben (Position 0 = Beginn des Layer-4-Headers ist
+ * sizeof(mac_header) + sizeof(ipv4_header)). Die Header folgen erst mit ipv4_commit, wenn die
+ * tatschliche Lnge feststeht. Das Datagramm wird nicht fragmentiert, max_len ist daher
+ * durch die MTU begrenzt. Bis zu ipv4_commit darf kein anderer Frame gesendet werden.
+ *
+ * @param dst Die Zieladresse.
+ * @param prtcl Das Layer-4-Protokoll.
+ * @param max_len Die Obergrenze fr Layer-4-Header und Nutzdaten.
+ * @param prio Die Priorittsklasse (TXQ_PRIO_*).
+ * @return 1, wenn das Datagramm begonnen wurde; 0, wenn der nchste Hop noch per ARP aufgelst
+ *         wird; -1, wenn es zu lang ist oder kein Weg zum Ziel besteht.
+ */
+int ipv4_begin(ip_address dst, uint8_t prtcl, uint16_t max_len, uint8_t prio) {
+	ipv4_pending* p = &types->pending;
+	ip_address next_hop;
+	
+	if (p->active || max_len > IPV4_MTU - sizeof(ipv4_header)) {
+		return -1;
+	}
+	
+	int result = route_lookup(dst, &p->mac_header, &next_hop);
+	if (result <= 0) {
+		return result;
 	}
+	if (txq_begin(sizeof(mac_header) + sizeof(ipv4_header) + max_len, prio) < 0) {
+		return -1;
+	}
+	txq_seek(sizeof(mac_header) + sizeof(ipv4_header));
+	
+	p->dst = dst;
+	p->prtcl = prtcl;
+	p->prio = prio;
+	p->max_len = max_len;
+	p->active = 1;
 	return 1;
 }
 
 
+/**
+ * Schliet das mit ipv4_begin begonnene Datagramm ab: MAC- und IPv4-Header werden an den
+ * Anfang des Frames geschrieben, der Frame auf seine Lnge gekrzt und eingereiht.
+ *
+ * @param len Die tatschliche Lnge von Layer-4-Header und Nutzdaten (hchstens max_len).
+ */
+void ipv4_commit(uint16_t len) {
+	struct package {
+		mac_header mac_header;
+		ipv4_header ipv4_header;
+	} __attribute__((packed));
+	
+	ipv4_pending* p = &types->pending;
+	struct package pkg;
+	
+	if (!p->active) {
+		return;
+	}
+	if (len > p->max_len) {
+		len = p->max_len;
+	}
+	
+	pkg.mac_header = p->mac_header;
+	ipv4_fill_header(&pkg.ipv4_header, p->dst, p->prtcl, sizeof(ipv4_header) + len, 0, p->prio);
+	
+	txq_patch(0, sizeof(pkg), (uint8_t*)&pkg);
+	txq_trim(sizeof(pkg) + len);
+	txq_end();
+	p->active = 0;
+}
+
+
+/**
+ * Verwirft das mit ipv4_begin begonnene Datagramm.
+ */
+void ipv4_abort(void) {
+	if (types->pending.active) {
+		txq_abort();
+		types->pending.active = 0;
+	}
+}
+
+
 /**
  * Berechnet und gibt eine eindeutige 16-Bit-Identifier (ID) zurck.
  * Verwendet einen statischen Zhler, um die Identifikationsnummer zu verfolgen,
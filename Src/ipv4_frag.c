@@ -0,0 +1,270 @@
+/* Includes ------------------------------------------------------------------*/
+#include "ipv4_frag.h"
+
+/* Private variables ---------------------------------------------------------*/
+static ipv4_frag_pool* pool;
+
+/* Private functions prototypes ---------------------------------------------*/
+static ipv4_frag_slot* ipv4_frag_find(uint32_t src, uint32_t dst, uint16_t ident, uint8_t prtcl, uint32_t now);
+static void ipv4_frag_release(ipv4_frag_slot* slot);
+static const uint8_t* ipv4_frag_complete(ipv4_frag_slot* slot, uint16_t* frame_length);
+static uint8_t ipv4_frag_beyond(const ipv4_frag_slot* slot, uint32_t total);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Initialisiert die Fragment-Reassemblierung. Der gesamte Speicher liegt im bergebenen Pool
+ * (IPV4_FRAG_SLOTS Slots zu je IPV4_FRAG_MAX_SIZE Nutzdaten), es wird nichts dynamisch angelegt.
+ *
+ * @param pool_addr Ein Pointer auf den Pool der Reassemblierungs-Slots.
+ */
+void ipv4_frag_init(ipv4_frag_pool* pool_addr) {
+	if (pool_addr != NULL) {
+		pool = pool_addr;
+
+		for (uint8_t i = 0; i < IPV4_FRAG_SLOTS; i++) {
+			pool->slots[i].in_use = 0;
+		}
+		pool->stats = (ipv4_frag_stats) {0};
+	}
+}
+
+
+/**
+ * Gibt einen Slot frei.
+ *
+ * @param slot Ein Pointer auf den freizugebenden Slot.
+ */
+static void ipv4_frag_release(ipv4_frag_slot* slot) {
+	slot->in_use = 0;
+}
+
+
+/**
+ * Sucht den Slot eines Datagramms (Absender, Ziel, Identifikation, Protokoll nach RFC 791).
+ * Abgelaufene Slots werden dabei freigegeben; wird kein Slot gefunden, wird ein freier belegt.
+ *
+ * @param src Der Absender als 32-Bit-Wert.
+ * @param dst Das Ziel als 32-Bit-Wert.
+ * @param ident Die Identifikation des Datagramms.
+ * @param prtcl Das Layer-4-Protokoll.
+ * @param now Der aktuelle HAL-Tick.
+ * @return Ein Pointer auf den Slot; NULL, wenn alle Slots belegt sind.
+ */
+static ipv4_frag_slot* ipv4_frag_find(uint32_t src, uint32_t dst, uint16_t ident, uint8_t prtcl, uint32_t now) {
+	ipv4_frag_slot* free_slot = NULL;
+
+	for (uint8_t i = 0; i < IPV4_FRAG_SLOTS; i++) {
+		ipv4_frag_slot* slot = &pool->slots[i];
+
+		if (slot->in_use && (now - slot->timestamp) >= IPV4_FRAG_TIMEOUT) {
+			ipv4_frag_release(slot);
+			pool->stats.timeouts++;
+		}
+		if (!slot->in_use) {
+			if (free_slot == NULL) {
+				free_slot = slot;
+			}
+			continue;
+		}
+		if (slot->ident == ident && slot->src == src && slot->dst == dst && slot->prtcl == prtcl) {
+			return slot;
+		}
+	}
+
+	if (free_slot == NULL) {
+		return NULL;
+	}
+
+	// Neues Datagramm: Slot belegen und Blockbitmap leeren
+	free_slot->src = src;
+	free_slot->dst = dst;
+	free_slot->ident = ident;
+	free_slot->prtcl = prtcl;
+	free_slot->in_use = 1;
+	free_slot->header_length = 0;
+	free_slot->total = 0;
+	free_slot->blocks = 0;
+	free_slot->timestamp = now;
+	for (uint16_t i = 0; i < sizeof(free_slot->bitmap); i++) {
+		free_slot->bitmap[i] = 0;
+	}
+	return free_slot;
+}
+
+
+/**
+ * Prft, ob bereits Blcke hinter dem Ende eines Datagramms empfangen wurden. Sie wrden
+ * in slot->blocks mitgezhlt und das Datagramm vorzeitig als vollstndig erscheinen lassen.
+ *
+ * @param slot Ein Pointer auf den Slot.
+ * @param total Die Nutzdatenlnge laut letztem Fragment.
+ * @return 1, wenn ein Block ab (total + 7) / 8 markiert ist; sonst 0.
+ */
+static uint8_t ipv4_frag_beyond(const ipv4_frag_slot* slot, uint32_t total) {
+	for (uint16_t block = (total + 7) / 8; block < IPV4_FRAG_BLOCKS; block++) {
+		if (slot->bitmap[block >> 3] & (1 << (block & 7))) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * Schliet ein vollstndiges Datagramm ab: Gesamtlnge, Flags und Prfsumme des IP-Headers
+ * werden fr das zusammengesetzte Datagramm neu gesetzt und der Slot freigegeben.
+ *
+ * @param slot Ein Pointer auf den vollstndigen Slot.
+ * @param frame_length Ausgabe: Lnge des Frames einschlielich MAC-Header.
+ * @return Ein Pointer auf den Beginn des Frames (MAC-Header) im Slot.
+ */
+static const uint8_t* ipv4_frag_complete(ipv4_frag_slot* slot, uint16_t* frame_length) {
+	uint8_t* frame = slot->frame + IPV4_FRAG_HEADER_MAX - slot->header_length;
+	uint8_t* ip = frame + sizeof(mac_header);
+	uint16_t total_length = slot->header_length + slot->total;
+
+	ip[2] = total_length >> 8;
+	ip[3] = total_length & 0xFF;
+	ip[6] = 0;
+	ip[7] = 0;
+
+	// Header-Prfsumme neu berechnen
+	ip[10] = 0;
+	ip[11] = 0;
+	uint16_t check = checksum(ip, slot->header_length);
+	ip[10] = check & 0xFF;
+	ip[11] = check >> 8;
+
+	// Der Slot wird sofort wieder frei. Die Daten bleiben gltig, bis das nchste Fragment
+	// empfangen wird, also whrend der synchronen Zustellung an die Layer-4-Handler.
+	ipv4_frag_release(slot);
+	pool->stats.reassembled++;
+
+	*frame_length = sizeof(mac_header) + total_length;
+	return frame;
+}
+
+
+/**
+ * bernimmt ein geprftes IPv4-Fragment in den passenden Reassemblierungs-Slot. Die Nutzdaten
+ * werden an ihrer endgltigen Position abgelegt, der Header des ersten Fragments direkt davor.
+ * Empfangene 8-Byte-Blcke werden in einer Bitmap markiert, sodass Fragmente in beliebiger
+ * Reihenfolge und mit berlappungen eintreffen drfen (berlappende Daten werden berschrieben,
+ * aber nur einmal gezhlt).
+ *
+ * @param buf Ein Pointer auf den Frame des Fragments (beginnend mit dem MAC-Header).
+ * @param header_length Die Lnge des IPv4-Headers.
+ * @param total_length Die Gesamtlnge des Fragments laut IPv4-Header.
+ * @param frame_length Ausgabe: Lnge des zusammengesetzten Frames einschlielich MAC-Header.
+ * @return Ein Pointer auf den zusammengesetzten Frame, wenn das Datagramm vollstndig ist; sonst NULL.
+ */
+const uint8_t* ipv4_frag_input(const uint8_t* buf, uint16_t header_length, uint16_t total_length, uint16_t* frame_length) {
+	const uint8_t* ip = buf + sizeof(mac_header);
+	uint16_t flags = ip[6] | (ip[7] << 8);
+	uint8_t more = (flags & IPV4_FLAG_MF) != 0;
+	uint32_t offset = (uint32_t)swapEndian16(flags & IPV4_FRAG_OFFSET_MASK) * 8;
+	uint16_t len = total_length - header_length;
+	uint32_t now = HAL_GetTick();
+
+	pool->stats.fragments++;
+
+	// Bis auf das letzte Fragment mssen alle ein Vielfaches von 8 Bytes tragen
+	if (len == 0 || (more && (len & 7) != 0)) {
+		pool->stats.bad_fragment++;
+		return NULL;
+	}
+
+	uint32_t src = ((uint32_t)ip[12] << 24) | ((uint32_t)ip[13] << 16) | ((uint32_t)ip[14] << 8) | ip[15];
+	uint32_t dst = ((uint32_t)ip[16] << 24) | ((uint32_t)ip[17] << 16) | ((uint32_t)ip[18] << 8) | ip[19];
+	uint16_t ident = ip[4] | (ip[5] << 8);
+
+	ipv4_frag_slot* slot = ipv4_frag_find(src, dst, ident, ip[9], now);
+	if (slot == NULL) {
+		pool->stats.pool_full++;
+		return NULL;
+	}
+
+	// Feste Speicherobergrenze: zu groe Datagramme werden samt bisher empfangener Fragmente verworfen
+	if (offset + len > IPV4_FRAG_MAX_SIZE) {
+		ipv4_frag_release(slot);
+		pool->stats.too_big++;
+		return NULL;
+	}
+
+	if (!more) {
+		// Letztes Fragment: legt die Nutzdatenlnge fest, ein zweites mit anderem Ende ist ungltig
+		if (slot->total != 0 && slot->total != offset + len) {
+			ipv4_frag_release(slot);
+			pool->stats.bad_fragment++;
+			return NULL;
+		}
+		if (slot->total == 0 && ipv4_frag_beyond(slot, offset + len)) {
+			ipv4_frag_release(slot);
+			pool->stats.bad_fragment++;
+			return NULL;
+		}
+		slot->total = offset + len;
+	} else if (slot->total != 0 && offset + len > slot->total) {
+		// Mittleres Fragment hinter dem bereits bekannten Ende
+		ipv4_frag_release(slot);
+		pool->stats.bad_fragment++;
+		return NULL;
+	}
+
+	if (offset == 0 && slot->header_length == 0) {
+		// MAC- und IP-Header (mit Optionen) des ersten Fragments direkt vor den Nutzdaten ablegen
+		uint8_t* header = slot->frame + IPV4_FRAG_HEADER_MAX - header_length;
+		for (uint16_t i = 0; i < sizeof(mac_header) + header_length; i++) {
+			header[i] = buf[i];
+		}
+		slot->header_length = header_length;
+	}
+
+	uint8_t* payload = slot->frame + sizeof(mac_header) + IPV4_FRAG_HEADER_MAX + offset;
+	for (uint16_t i = 0; i < len; i++) {
+		payload[i] = ip[header_length + i];
+	}
+
+	// Empfangene Blcke markieren; bereits vorhandene (berlappungen, Duplikate) nicht erneut zhlen
+	uint16_t last = (offset + len + 7) / 8;
+	for (uint16_t block = offset / 8; block < last; block++) {
+		uint8_t bit = 1 << (block & 7);
+		if ((slot->bitmap[block >> 3] & bit) == 0) {
+			slot->bitmap[block >> 3] |= bit;
+			slot->blocks++;
+		}
+	}
+
+	if (slot->total != 0 && slot->header_length != 0 && slot->blocks == (slot->total + 7) / 8) {
+		return ipv4_frag_complete(slot, frame_length);
+	}
+	return NULL;
+}
+
+
+/**
+ * Verwirft unvollstndige Datagramme, deren erstes Fragment lter als IPV4_FRAG_TIMEOUT ist.
+ * Wird regelmig aus der Hauptschleife aufgerufen.
+ */
+void ipv4_frag_tick(void) {
+	uint32_t now = HAL_GetTick();
+
+	for (uint8_t i = 0; i < IPV4_FRAG_SLOTS; i++) {
+		ipv4_frag_slot* slot = &pool->slots[i];
+		if (slot->in_use && (now - slot->timestamp) >= IPV4_FRAG_TIMEOUT) {
+			ipv4_frag_release(slot);
+			pool->stats.timeouts++;
+		}
+	}
+}
+
+
+/**
+ * Liefert die Zhler der Fragment-Reassemblierung.
+ *
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden).
+ */
+const ipv4_frag_stats* ipv4_frag_get_stats(void) {
+	return &pool->stats;
+}
\ No newline at end of file
@@ -1,14 +1,26 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
-#define BUFFER_SIZE 550
 
 /* Private variables ---------------------------------------------------------*/
 SPI_HandleTypeDef hspi1;
 arp_table table;
+txq_queues txq;
+ratelimit_buckets limits;
+route_table routing;
+route_cache routes;
 ether_types eth_types;
 prtcl_types prot_types;
-udp_serivces services;
-static uint8_t buffer [BUFFER_SIZE + 1];
+ipv4_frag_pool frags;
+udp_sockets sockets;
+igmp_groups igmp;
+ping_session ping;
+telemetry_stream telemetry;
+syslog_ring logbuf; // Zeilen aus SYSLOG(...), auch aus Interrupts
+dns_resolver dns;
+sntp_client sntp;
+clock_state clk; // Disziplinierte Uhr auf TIM2, gestellt von SNTP
+tftp_session tftp; // Enthlt die beiden Empfangspuffer vor der Senke (2 x TFTP_BUF_SIZE)
+pbuf_pool pbufs; // Empfangspuffer in voller Framelnge: gekrzte Pakete wrden von der IPv4-Lngenprfung verworfen
 mac_address my_mac = {0xB8,0x37,0x4A,0x04,0x20,0x0b}; // MAC address: (b8:37:4a:04:20:0b)
 ip_address my_ip = {0x00,0x00,0x00,0x00};
 ip_address my_subnet = {0x00,0x00,0x00,0x00};
@@ -38,10 +50,21 @@ int main(void) {
   /* Initialize all configured peripherals */
   GPIO_Init();
   SPI1_Init();
+	clock_init(&clk); // Initialize s-Zeitbasis (TIM2, 1 MHz)
 	enc28_init(my_mac); // Initialize eth_hw
+	pbuf_init(&pbufs); // Initialize Empfangspuffer
+	txq_init(&txq); // Initialize Sendewarteschlangen
+	ratelimit_init(&limits, &my_ip); // Initialize Begrenzung der Echo- und ARP-Antworten
 	eth_init(&eth_types);// Initialize Layer 2
-	ipv4_init(&prot_types);// Initialize Layer 3 (IPv4)
-	udp_init(&services); // Initialize Layer 4 (UDP)
+	ipv4_init(&prot_types, &my_ip, &my_subnet);// Initialize Layer 3 (IPv4)
+	ipv4_frag_init(&frags); // Initialize IPv4-Reassemblierung
+	arp_table_init(&table, &my_ip, my_mac); // Initialize ARP (lernt bereits whrend DHCP)
+	route_init(&routing, &routes, &my_ip, &my_subnet, my_mac); // Initialize Routing und Next-Hop-Cache
+	//route_add((ip_address){10,20,0,0}, 16, (ip_address){192,168,1,2}, 5, ROUTE_ORIGIN_STATIC); // Statische Route (z.B. Messnetz hinter zweitem Router)
+	udp_init(&sockets); // Initialize Layer 4 (UDP)
+	dns_init(&dns); // Initialize DNS-Resolver vor DHCP, das die Server aus Option 6 bergibt
+	sntp_init(&sntp); // Initialize SNTP-Client (Server aus DHCP Option 42)
+	syslog_init(&logbuf, &my_ip); // Initialize Logging vor DHCP (sammelt ab hier im Ring, gesendet wird nach syslog_start)
 	dhcp_init(&my_ip, &my_subnet, &my_gateway, &my_dhcp_server, &dhcp_rdy, my_mac); // Initialize Layer 7 (DHCP)
 
 HAL_GPIO_WritePin(GPIOC, GPIO_PIN_6, GPIO_PIN_SET); //LED ON
@@ -58,31 +81,64 @@ while (1) { // DHCP Loop
 	){
 		send_dhcp_disc();
 	}
-	uint16_t length = enc28_packetReceive(BUFFER_SIZE, buffer);
-	 if(length){
-			eth_handler(buffer, length); //handel DHCP
+	pbuf* p = pbuf_alloc();
+	if(p){
+		uint16_t length = enc28_packetReceive(PBUF_SIZE, p->data);
+		 if(length){
+				p->len = length;
+				eth_handler(p->data, length); //handel DHCP
+		}
+		pbuf_free(p);
 	}
+	txq_poll();
 	 if(dhcp_rdy){
 			dhcp_rdy = 0x00;
 			break;
 	}
 }
 
-arp_table_init(&table, &my_ip, my_mac); // Initialize ARP
-icmp_init(&my_ip, &my_subnet, &my_gateway, my_mac); // Initialize ICMP
+icmp_init(&my_ip, my_mac); // Initialize ICMP
+ping_init(&ping); // Initialize Ping-Client
+//ping_start(my_gateway, 56, 1000, 0); // Gateway jede Sekunde prfen (Laufzeit und Erreichbarkeit in ping_get_stats)
+igmp_init(&igmp, &my_ip, my_mac); // Initialize IGMP und Multicast-Hash-Filter
+//igmp_join((ip_address){239,1,2,3}); // Gruppe der Sollwerte abonnieren (UDP-Dienst per udp_add_type)
+//int sock = udp_bind(swapEndian16(5000), NULL); // Socket mit Empfangsring, Abholung per udp_recvfrom
+telemetry_init(&telemetry); // Initialize Telemetrie-Dienst
+//telemetry_start((ip_address){192,168,1,2}, swapEndian16(9000), 20); // Messwerte per telemetry_publish an den Collector
+//syslog_start((ip_address){192,168,1,2}, 0, SYSLOG_BUDGET); // nach DHCP an den Syslog-Collector senden
+//dns_resolve("update.example.com", &server_ip, &on_resolved); // DNS_OK aus dem Cache, sonst Ergebnis im Handler
+tftp_init(&tftp); // Initialize TFTP
+//tftp_server_start(&flash_sink); // Firmware per WRQ empfangen, Blcke gehen doppelt gepuffert an den Flash-Schreiber
+//tftp_get((ip_address){192,168,1,2}, "firmware.bin", &flash_sink); // oder vom Server abholen (RRQ)
 	
 	
  while (1)
   {
 
-	uint16_t length = enc28_packetReceive(BUFFER_SIZE, buffer);
-if(length){
-			eth_handler(buffer, length); //handel Netzwerkverkehr
-	 }
+	pbuf* p = pbuf_alloc(); // Bleibt belegt, solange ein UDP-Socket das Datagramm im Ring hlt
+	if(p){
+		uint16_t length = enc28_packetReceive(PBUF_SIZE, p->data);
+	if(length){
+				p->len = length;
+				eth_handler(p->data, length); //handel Netzwerkverkehr
+		 }
+		pbuf_free(p);
+	}
 	if(dhcp_rdy){
 			dhcp_rdy = 0x00;
 	}
-	//send_icmp_req(my_ip);
+	clock_tick(); // Bezugspunkt der disziplinierten Uhr nachziehen
+	txq_poll(); // Nchsten Frame nach Prioritt senden
+	arp_tick(); // Abgelaufene ARP-Auflsungen und wartende Frames verwerfen
+	route_tick(); // Gateway-Eintrag vor Ablauf auffrischen
+	ipv4_frag_tick(); // Unvollstndige Datagramme nach Ablauf verwerfen
+	igmp_tick(); // Verzgerte Membership Reports senden
+	ping_tick(); // Fllige Echo-Anfragen senden, Zeitberschreitungen auswerten
+	telemetry_tick(); // Volle oder fllige Telemetrie-Datagramme senden
+	syslog_tick(); // Gesammelte Log-Zeilen im Rahmen des Budgets senden
+	dns_tick(); // Unbeantwortete DNS-Anfragen beim nchsten Server wiederholen
+	sntp_tick(); // Fllige Zeitmessungen senden und die Uhr nachfhren
+	tftp_tick(); // TFTP: ACK wiederholen, nach Pufferengpass fortsetzen, Senke abschlieen
 	 ///HAL_Delay(2000);
   }
   /* CODE END */
@@ -0,0 +1,113 @@
+/* Includes ------------------------------------------------------------------*/
+#include "pbuf.h"
+
+/* Private variables ---------------------------------------------------------*/
+static pbuf_pool* pool;
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Initialisiert den Pool der Empfangspuffer. Ein Frame wird direkt in einen Puffer empfangen;
+ * Sockets knnen ihn ber einen Referenzzhler behalten, ohne ihn zu kopieren.
+ *
+ * @param pool_addr Ein Pointer auf den Pool.
+ */
+void pbuf_init(pbuf_pool* pool_addr) {
+	if (pool_addr != NULL) {
+		pool = pool_addr;
+		
+		for (uint8_t i = 0; i < PBUF_POOL_SIZE; i++) {
+			pool->bufs[i].ref = 0;
+			pool->bufs[i].len = 0;
+		}
+		pool->stats = (pbuf_stats) {0};
+	}
+}
+
+
+/**
+ * Belegt einen freien Puffer mit einer Referenz.
+ *
+ * @return Ein Pointer auf den Puffer; NULL, wenn alle Puffer belegt sind.
+ */
+pbuf* pbuf_alloc(void) {
+	for (uint8_t i = 0; i < PBUF_POOL_SIZE; i++) {
+		pbuf* p = &pool->bufs[i];
+		
+		if (p->ref == 0) {
+			p->ref = 1;
+			p->len = 0;
+			pool->stats.in_use++;
+			if (pool->stats.in_use > pool->stats.max_in_use) {
+				pool->stats.max_in_use = pool->stats.in_use;
+			}
+			return p;
+		}
+	}
+	pool->stats.alloc_failed++;
+	return NULL;
+}
+
+
+/**
+ * Fgt einem Puffer eine weitere Referenz hinzu.
+ *
+ * @param p Der Puffer.
+ */
+void pbuf_ref(pbuf* p) {
+	p->ref++;
+}
+
+
+/**
+ * Gibt eine Referenz frei; mit der letzten wird der Puffer wieder frei.
+ *
+ * @param p Der Puffer (NULL wird ignoriert).
+ */
+void pbuf_free(pbuf* p) {
+	if (p == NULL || p->ref == 0) {
+		return;
+	}
+	p->ref--;
+	if (p->ref == 0) {
+		pool->stats.in_use--;
+	}
+}
+
+
+/**
+ * Sucht den Puffer, in dem die angegebenen Daten liegen.
+ *
+ * @param data Ein Pointer in einen Frame, z.B. der Puffer eines Layer-4-Handlers.
+ * @return Der Puffer; NULL, wenn die Daten nicht im Pool liegen (z.B. zusammengesetzte Fragmente).
+ */
+pbuf* pbuf_from_data(const uint8_t* data) {
+	for (uint8_t i = 0; i < PBUF_POOL_SIZE; i++) {
+		pbuf* p = &pool->bufs[i];
+		
+		if (data >= p->data && data < p->data + PBUF_SIZE) {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+
+/**
+ * Liefert die Anzahl der freien Puffer.
+ *
+ * @return Die Anzahl der Puffer ohne Referenz.
+ */
+uint8_t pbuf_available(void) {
+	return PBUF_POOL_SIZE - pool->stats.in_use;
+}
+
+
+/**
+ * Liefert die Zhler des Pufferpools.
+ *
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden).
+ */
+const pbuf_stats* pbuf_get_stats(void) {
+	return &pool->stats;
+}
\ No newline at end of file
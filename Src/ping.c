@@ -0,0 +1,209 @@
+/* Includes ------------------------------------------------------------------*/
+#include "ping.h"
+
+/* Private variables ---------------------------------------------------------*/
+static ping_session* session;
+
+/* Private functions prototypes ---------------------------------------------*/
+static void ping_reply(const uint8_t* buf, uint16_t length, uint16_t offset);
+static void ping_expire(uint32_t now);
+static void ping_lost(void);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Initialisiert den Ping-Client und meldet ihn fr Echo-Antworten bei ICMP an.
+ *
+ * @param session_addr Ein Pointer auf die Struktur der Ping-Sitzung.
+ */
+void ping_init(ping_session* session_addr) {
+	if (session_addr != NULL) {
+		session = session_addr;
+		session->active = 0;
+		
+		for (uint16_t i = 0; i < PING_MAX_SIZE; i++) {
+			session->data[i] = 0x61 + (i % 23); // abcdefghijklmnopqrstuvw wie bei Windows
+		}
+		icmp_set_reply_handler(&ping_reply);
+	}
+}
+
+
+/**
+ * Startet eine Ping-Sitzung. Die Anfragen werden asynchron aus ping_tick gesendet, die Antworten
+ * ber Identifikator und Sequenznummer zugeordnet. Mit count = 0 luft die Sitzung als periodische
+ * Erreichbarkeitsprfung, bis ping_stop aufgerufen wird. Die Statistik wird zurckgesetzt.
+ *
+ * @param target Die Zieladresse.
+ * @param size Die Nutzdatenlnge je Anfrage (hchstens PING_MAX_SIZE).
+ * @param interval Der Abstand der Anfragen in ms.
+ * @param count Die Anzahl der Anfragen (0 = ohne Ende).
+ * @return 0, wenn die Sitzung gestartet wurde; -1, wenn die Nutzdaten zu lang sind.
+ */
+int ping_start(ip_address target, uint16_t size, uint32_t interval, uint16_t count) {
+	if (size > PING_MAX_SIZE) {
+		return -1;
+	}
+	
+	session->target = target;
+	session->size = size;
+	session->interval = interval;
+	session->remaining = count;
+	session->endless = (count == 0);
+	// Neuer Identifikator je Sitzung, damit versptete Antworten lterer Sitzungen nicht zhlen
+	session->ident = (uint16_t)(clock_now_us() ^ (session->ident + 1));
+	session->seq = 0;
+	session->next_time = HAL_GetTick();
+	session->active = 1;
+	for (uint8_t i = 0; i < PING_WINDOW; i++) {
+		session->window[i].valid = 0;
+	}
+	session->stats = (ping_stats) {0};
+	session->stats.rtt_min = 0xFFFFFFFF;
+	session->stats.healthy = 1;
+	return 0;
+}
+
+
+/**
+ * Beendet die Ping-Sitzung. Ausstehende Anfragen werden nicht mehr ausgewertet.
+ */
+void ping_stop(void) {
+	session->active = 0;
+}
+
+
+/**
+ * Zhlt eine Anfrage als verloren und markiert das Ziel nach PING_HEALTH_LOSS Verlusten
+ * in Folge als nicht erreichbar.
+ */
+static void ping_lost(void) {
+	session->stats.lost++;
+	session->stats.consecutive_lost++;
+	if (session->stats.consecutive_lost >= PING_HEALTH_LOSS) {
+		session->stats.healthy = 0;
+	}
+}
+
+
+/**
+ * Zhlt ausstehende Anfragen nach PING_TIMEOUT als verloren.
+ *
+ * @param now Der aktuelle HAL-Tick.
+ */
+static void ping_expire(uint32_t now) {
+	for (uint8_t i = 0; i < PING_WINDOW; i++) {
+		ping_request* req = &session->window[i];
+		
+		if (req->valid && (now - req->sent_ms) >= PING_TIMEOUT) {
+			req->valid = 0;
+			ping_lost();
+		}
+	}
+}
+
+
+/**
+ * Sendet fllige Anfragen und wertet Zeitberschreitungen aus. Wird regelmig aus der
+ * Hauptschleife aufgerufen. Luft die ARP-Auflsung des Ziels noch, wird die Anfrage beim
+ * nchsten Aufruf wiederholt; gelingt sie nicht innerhalb von PING_TIMEOUT, zhlt die Anfrage
+ * als verloren.
+ */
+void ping_tick(void) {
+	uint32_t now = HAL_GetTick();
+	
+	if (session == NULL || !session->active) {
+		return;
+	}
+	ping_expire(now);
+	
+	if ((!session->endless && session->remaining == 0) || (int32_t)(now - session->next_time) < 0) {
+		return;
+	}
+	
+	// Zeitstempel direkt vor dem Senden, damit die Laufzeit die Warteschlange einschliet
+	ping_request* req = &session->window[session->seq & (PING_WINDOW - 1)];
+	uint32_t sent_us = clock_now_us();
+	int result = send_icmp_req(session->target, session->ident, session->seq, session->data, session->size);
+	if (result == 0 && (now - session->next_time) < PING_TIMEOUT) {
+		return;
+	}
+	
+	session->stats.sent++;
+	if (result > 0) {
+		// Ein noch belegter Platz gehrt zu einer Anfrage, die PING_WINDOW Anfragen alt ist
+		if (req->valid) {
+			ping_lost();
+		}
+		req->seq = session->seq;
+		req->sent_us = sent_us;
+		req->sent_ms = now;
+		req->valid = 1;
+	} else {
+		// Kein Weg zum Ziel oder ARP-Auflsung gescheitert
+		ping_lost();
+	}
+	session->seq++;
+	session->next_time = now + session->interval;
+	if (!session->endless) {
+		session->remaining--;
+	}
+}
+
+
+/**
+ * Ordnet eine Echo-Antwort ihrer Anfrage zu und aktualisiert Laufzeit, Jitter und Verlustzhler.
+ *
+ * @param buf Der empfangene Frame.
+ * @param length Die Lnge des Frames.
+ * @param offset Der Beginn des ICMP-Headers.
+ */
+static void ping_reply(const uint8_t* buf, uint16_t length, uint16_t offset) {
+	uint32_t now_us = clock_now_us();
+	uint16_t ident = (buf[offset + 4] << 8) | buf[offset + 5];
+	uint16_t seq = (buf[offset + 6] << 8) | buf[offset + 7];
+	
+	if (session == NULL || !session->active || ident != session->ident) {
+		return;
+	}
+	ping_request* req = &session->window[seq & (PING_WINDOW - 1)];
+	if (!req->valid || req->seq != seq || length - offset - sizeof(icmp_package) != session->size) {
+		session->stats.late++;
+		return;
+	}
+	req->valid = 0;
+	
+	ping_stats* stats = &session->stats;
+	uint32_t rtt = now_us - req->sent_us;
+	
+	// Jitter nach RFC 3550: J += (|D| - J) / 16
+	if (stats->received > 0) {
+		int32_t d = (int32_t)(rtt - stats->rtt_last);
+		if (d < 0) {
+			d = -d;
+		}
+		stats->jitter += (d - (int32_t)stats->jitter) / 16;
+	}
+	stats->received++;
+	stats->rtt_last = rtt;
+	stats->rtt_sum += rtt;
+	stats->rtt_avg = (uint32_t)(stats->rtt_sum / stats->received);
+	if (rtt < stats->rtt_min) {
+		stats->rtt_min = rtt;
+	}
+	if (rtt > stats->rtt_max) {
+		stats->rtt_max = rtt;
+	}
+	stats->consecutive_lost = 0;
+	stats->healthy = 1;
+}
+
+
+/**
+ * Liefert die Statistik der laufenden bzw. letzten Ping-Sitzung.
+ *
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden).
+ */
+const ping_stats* ping_get_stats(void) {
+	return &session->stats;
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+/* Includes ------------------------------------------------------------------*/
+#include "ratelimit.h"
+
+/* Private variables ---------------------------------------------------------*/
+static ratelimit_buckets* buckets;
+static ip_address *my_ip_addr;
+
+/* Private functions prototypes ---------------------------------------------*/
+static void ratelimit_refill(ratelimit_bucket* b);
+static int ratelimit_available(uint8_t cls);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Initialisiert die Token-Buckets mit den Voreinstellungen und meldet die Vorprfung beim
+ * ENC28J60 an, sodass berzhlige Anfragen schon nach dem Lesen ihrer Header verworfen werden.
+ *
+ * @param buckets_addr Ein Pointer auf die Struktur der Token-Buckets.
+ * @param src_ip Die lokale IP-Adresse (nur ARP-Anfragen nach ihr werden begrenzt).
+ */
+void ratelimit_init(ratelimit_buckets* buckets_addr, ip_address* src_ip) {
+	if (buckets_addr != NULL) {
+		buckets = buckets_addr;
+		my_ip_addr = src_ip;
+		
+		ratelimit_config(RATELIMIT_ICMP_ECHO, RATELIMIT_ICMP_ECHO_RATE, RATELIMIT_ICMP_ECHO_BURST);
+		ratelimit_config(RATELIMIT_ARP_REPLY, RATELIMIT_ARP_REPLY_RATE, RATELIMIT_ARP_REPLY_BURST);
+		ratelimit_config(RATELIMIT_ICMP_ERROR, RATELIMIT_ICMP_ERROR_RATE, RATELIMIT_ICMP_ERROR_BURST);
+		
+		enc28_setRxFilter(&ratelimit_peek);
+	}
+}
+
+
+/**
+ * Stellt Rate und Burstgre einer Klasse ein. Der Bucket startet voll.
+ *
+ * @param cls Die Klasse (RATELIMIT_*).
+ * @param rate Die erlaubten Antworten je Sekunde (0 = unbegrenzt).
+ * @param burst Die Anzahl der Antworten, die nach einer Pause direkt hintereinander erlaubt sind.
+ */
+void ratelimit_config(uint8_t cls, uint16_t rate, uint16_t burst) {
+	if (cls >= RATELIMIT_CLASSES) {
+		return;
+	}
+	ratelimit_bucket* b = &buckets->data[cls];
+	
+	b->rate = rate;
+	b->burst = burst;
+	b->tokens = (uint32_t)burst * RATELIMIT_TOKEN;
+	b->timestamp = HAL_GetTick();
+	b->stats = (ratelimit_stats) {0};
+}
+
+
+/**
+ * Fllt einen Bucket um rate Token je Sekunde seit dem letzten Aufruf auf, hchstens bis zur
+ * Burstgre.
+ *
+ * @param b Der Bucket (rate ungleich 0).
+ */
+static void ratelimit_refill(ratelimit_bucket* b) {
+	uint32_t now = HAL_GetTick();
+	uint32_t elapsed = now - b->timestamp;
+	uint32_t capacity = (uint32_t)b->burst * RATELIMIT_TOKEN;
+	
+	// Auffllen: rate Token je 1000 ms entsprechen rate Tausendstel je ms
+	if (elapsed > RATELIMIT_MAX_ELAPSED) {
+		elapsed = RATELIMIT_MAX_ELAPSED;
+	}
+	b->tokens += elapsed * b->rate;
+	if (b->tokens > capacity) {
+		b->tokens = capacity;
+	}
+	b->timestamp = now;
+}
+
+
+/**
+ * Entnimmt einer Klasse ein Token. Aufzurufen, wenn die Antwort tatschlich gesendet wird,
+ * also nach der Prfung der Anfrage; ungltige Anfragen verbrauchen so kein Token.
+ *
+ * @param cls Die Klasse (RATELIMIT_*).
+ * @return 1, wenn die Antwort gesendet werden darf; 0, wenn sie verworfen wird.
+ */
+int ratelimit_allow(uint8_t cls) {
+	if (buckets == NULL || cls >= RATELIMIT_CLASSES) {
+		return 1;
+	}
+	ratelimit_bucket* b = &buckets->data[cls];
+	
+	if (b->rate == 0) {
+		b->stats.passed++;
+		return 1;
+	}
+	ratelimit_refill(b);
+	if (b->tokens < RATELIMIT_TOKEN) {
+		b->stats.dropped++;
+		return 0;
+	}
+	b->tokens -= RATELIMIT_TOKEN;
+	b->stats.passed++;
+	return 1;
+}
+
+
+/**
+ * Prft, ob eine Klasse noch ein Token hat, ohne es zu entnehmen. Ist keines vorhanden, zhlt
+ * die Anfrage als verworfen.
+ *
+ * @param cls Die Klasse (RATELIMIT_*).
+ * @return 1, wenn eine Antwort mglich ist; 0, wenn die Anfrage verworfen werden kann.
+ */
+static int ratelimit_available(uint8_t cls) {
+	ratelimit_bucket* b = &buckets->data[cls];
+	
+	if (b->rate == 0) {
+		return 1;
+	}
+	ratelimit_refill(b);
+	if (b->tokens < RATELIMIT_TOKEN) {
+		b->stats.dropped++;
+		return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * Vorprfung eines empfangenen Frames anhand seiner ersten Bytes (siehe enc28_setRxFilter).
+ * Hat die Klasse von Echo-Anfragen bzw. ARP-Anfragen nach der eigenen Adresse kein Token mehr,
+ * wird der Frame verworfen, bevor der Rest ber SPI gelesen wird. Entnommen wird das Token erst
+ * von ICMP bzw. ARP nach der vollstndigen Prfung (ratelimit_allow), damit ungltige oder
+ * nicht fr uns bestimmte Frames den Bucket nicht leeren.
+ *
+ * @param header Die ersten Bytes des Frames.
+ * @param len Die Anzahl der gelesenen Bytes (hchstens ENC28_PEEK_SIZE).
+ * @return 1, wenn der Frame vollstndig gelesen werden soll; 0, wenn er verworfen wird.
+ */
+int ratelimit_peek(const uint8_t* header, uint16_t len) {
+	if (len < sizeof(mac_header) + 20) {
+		return 1;
+	}
+	
+	// ARP-Anfrage (Opcode 1) nach der eigenen Adresse
+	if (header[12] == 0x08 && header[13] == 0x06) {
+		if (len >= 42 && header[20] == 0x00 && header[21] == 0x01 && header[38] == my_ip_addr->octet[0]
+				&& header[39] == my_ip_addr->octet[1] && header[40] == my_ip_addr->octet[2] && header[41] == my_ip_addr->octet[3]) {
+			return ratelimit_available(RATELIMIT_ARP_REPLY);
+		}
+		return 1;
+	}
+	
+	// IPv4, ICMP, erstes Fragment, Typ 8 (Echo-Anfrage) hinter eventuellen IP-Optionen
+	if (header[12] == 0x08 && header[13] == 0x00) {
+		const uint8_t* ip = header + sizeof(mac_header);
+		uint16_t header_length = (ip[0] & 0x0F) * 4;
+		
+		if (ip[9] == 0x01 && (ip[6] & 0x1F) == 0 && ip[7] == 0
+				&& sizeof(mac_header) + header_length < len && ip[header_length] == 0x08) {
+			return ratelimit_available(RATELIMIT_ICMP_ECHO);
+		}
+	}
+	return 1;
+}
+
+
+/**
+ * Liefert die Zhler einer Klasse.
+ *
+ * @param cls Die Klasse (RATELIMIT_*).
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden); NULL bei ungltiger Klasse.
+ */
+const ratelimit_stats* ratelimit_get_stats(uint8_t cls) {
+	if (cls >= RATELIMIT_CLASSES) {
+		return NULL;
+	}
+	return &buckets->data[cls].stats;
+}
\ No newline at end of file
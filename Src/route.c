@@ -0,0 +1,433 @@
+/* Includes ------------------------------------------------------------------*/
+#include "route.h"
+
+/* Private variables ---------------------------------------------------------*/
+static route_table* table;
+static route_cache* cache;
+static ip_address* my_ip_addr;
+static ip_address* my_subnet_addr;
+static mac_address my_mac;
+
+/* Private functions prototypes ---------------------------------------------*/
+static uint16_t route_hash(uint32_t ip);
+static int route_fresh(route_cache_entry* e, uint32_t now);
+static uint8_t route_bit(uint32_t key, uint8_t pos);
+static uint32_t route_mask(uint8_t length);
+static uint8_t route_node_new(uint32_t prefix, uint8_t length, uint8_t route);
+static void route_trie_insert(uint8_t idx);
+static uint8_t route_trie_lookup(uint32_t key);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Initialisiert die Routingtabelle und den Next-Hop-Cache mit den angegebenen Konfigurationen.
+ * Die Tabelle ist anfangs leer; Routen kommen ber route_add (statisch) und DHCP hinzu.
+ *
+ * @param table_addr Ein Pointer auf die Routingtabelle.
+ * @param cache_addr Ein Pointer auf den Next-Hop-Cache.
+ * @param src_ip Die lokale IP-Adresse des Gerts.
+ * @param my_subnet Die Subnetzmaske des Gerts.
+ * @param src_mac Die MAC-Adresse des Gerts.
+ */
+void route_init(route_table* table_addr, route_cache* cache_addr, ip_address* src_ip, ip_address* my_subnet, mac_address src_mac) {
+	table = table_addr;
+	cache = cache_addr;
+	
+	// Setzt die lokale Konfiguration fr die Bestimmung des nchsten Hops
+	my_ip_addr = src_ip;
+	my_subnet_addr = my_subnet;
+	my_mac = src_mac;
+	
+	for (uint8_t i = 0; i <= ROUTE_TABLE_SIZE; i++) {
+		table->routes[i].origin = ROUTE_ORIGIN_NONE;
+	}
+	cache->stats = (route_stats){0};
+	route_rebuild();
+}
+
+/**
+ * Liefert das Bit an Position pos eines 32-Bit-Schlssels (Position 0 = hchstwertiges Bit).
+ */
+static uint8_t route_bit(uint32_t key, uint8_t pos) {
+	return (key >> (31 - pos)) & 1;
+}
+
+/**
+ * Liefert die Netzmaske zu einer Prfixlnge.
+ */
+static uint32_t route_mask(uint8_t length) {
+	return length ? 0xFFFFFFFF << (32 - length) : 0;
+}
+
+/**
+ * Legt einen neuen Knoten im Prfixbaum an.
+ *
+ * @param prefix Das Prfix des Knotens (wird auf length Bit gekrzt).
+ * @param length Die Prfixlnge.
+ * @param route Der Index der Route oder ROUTE_NONE.
+ * @return Der Index des neuen Knotens.
+ */
+static uint8_t route_node_new(uint32_t prefix, uint8_t length, uint8_t route) {
+	route_node* n = &table->nodes[table->node_count];
+	n->prefix = prefix & route_mask(length);
+	n->length = length;
+	n->route = route;
+	n->child[0] = ROUTE_NONE;
+	n->child[1] = ROUTE_NONE;
+	return table->node_count++;
+}
+
+/**
+ * Fgt eine Route in den pfadkomprimierten Prfixbaum ein. Jeder Knoten unterscheidet seine
+ * Unterbume am ersten Bit hinter seinem Prfix; bersprungene Bits werden nicht als eigene
+ * Knoten gespeichert, sodass der Baum hchstens zwei Knoten je Route bentigt.
+ *
+ * @param idx Der Index der Route in der Routingtabelle.
+ */
+static void route_trie_insert(uint8_t idx) {
+	route_entry* r = &table->routes[idx];
+	uint32_t prefix = r->prefix;
+	uint8_t length = r->length;
+	uint8_t node = 0;
+	
+	while (1) {
+		route_node* n = &table->nodes[node];
+		
+		// Gleiches Prfix: die Route mit der kleineren Metrik gewinnt
+		if (n->length == length) {
+			if (n->route == ROUTE_NONE || r->metric < table->routes[n->route].metric) {
+				n->route = idx;
+			}
+			return;
+		}
+		
+		uint8_t b = route_bit(prefix, n->length);
+		uint8_t c = n->child[b];
+		if (c == ROUTE_NONE) {
+			n->child[b] = route_node_new(prefix, length, idx);
+			return;
+		}
+		
+		// Lnge des gemeinsamen Prfixes mit dem Kindknoten bestimmen
+		route_node* cn = &table->nodes[c];
+		uint8_t limit = (length < cn->length) ? length : cn->length;
+		uint32_t diff = prefix ^ cn->prefix;
+		uint8_t common = n->length + 1;
+		while (common < limit && !route_bit(diff, common)) {
+			common++;
+		}
+		
+		// Das Prfix des Kindknotens ist vollstndig enthalten: absteigen
+		if (common == cn->length) {
+			node = c;
+			continue;
+		}
+		
+		if (common == length) {
+			// Die neue Route liegt zwischen dem Knoten und seinem Kind
+			uint8_t m = route_node_new(prefix, length, idx);
+			table->nodes[m].child[route_bit(cn->prefix, length)] = c;
+			table->nodes[node].child[b] = m;
+		} else {
+			// Die Prfixe trennen sich vor dem Ende beider: Verzweigungsknoten einfgen
+			uint8_t m = route_node_new(prefix, common, ROUTE_NONE);
+			uint8_t leaf = route_node_new(prefix, length, idx);
+			table->nodes[m].child[route_bit(prefix, common)] = leaf;
+			table->nodes[m].child[route_bit(cn->prefix, common)] = c;
+			table->nodes[node].child[b] = m;
+		}
+		return;
+	}
+}
+
+/**
+ * Sucht die Route mit dem lngsten passenden Prfix. Je Knoten wird hchstens ein Bit
+ * ausgewertet und ein Maskenvergleich durchgefhrt, der Aufwand ist also durch die Prfixlnge begrenzt.
+ *
+ * @param key Die Ziel-IP als 32-Bit-Wert.
+ * @return Der Index der Route oder ROUTE_NONE.
+ */
+static uint8_t route_trie_lookup(uint32_t key) {
+	uint8_t node = 0;
+	uint8_t best = table->nodes[0].route;
+	
+	while (table->nodes[node].length < 32) {
+		uint8_t c = table->nodes[node].child[route_bit(key, table->nodes[node].length)];
+		if (c == ROUTE_NONE) {
+			break;
+		}
+		route_node* cn = &table->nodes[c];
+		if ((key ^ cn->prefix) & route_mask(cn->length)) {
+			break;
+		}
+		if (cn->route != ROUTE_NONE) {
+			best = cn->route;
+		}
+		node = c;
+	}
+	return best;
+}
+
+/**
+ * Baut den Prfixbaum aus der Routingtabelle und der Route des eigenen Subnetzes neu auf und
+ * verwirft den Next-Hop-Cache. Muss aufgerufen werden, wenn sich Adresse oder Subnetzmaske ndern;
+ * route_add und route_del_origin rufen die Funktion selbst auf.
+ */
+void route_rebuild(void) {
+	route_entry* connected = &table->routes[ROUTE_TABLE_SIZE];
+	uint32_t me = ip_to_uint32(*my_ip_addr);
+	uint32_t mask = ip_to_uint32(*my_subnet_addr);
+	
+	// Route des eigenen Subnetzes aus Adresse und Maske ableiten (erst nach der DHCP-Zuweisung)
+	connected->origin = ROUTE_ORIGIN_NONE;
+	if (me != 0 && mask != 0) {
+		connected->prefix = me & mask;
+		connected->gateway = 0;
+		connected->metric = 0;
+		connected->length = 0;
+		while (connected->length < 32 && route_bit(mask, connected->length)) {
+			connected->length++;
+		}
+		connected->origin = ROUTE_ORIGIN_CONNECTED;
+	}
+	
+	table->node_count = 0;
+	route_node_new(0, 0, ROUTE_NONE);
+	for (uint8_t i = 0; i <= ROUTE_TABLE_SIZE; i++) {
+		if (table->routes[i].origin != ROUTE_ORIGIN_NONE) {
+			route_trie_insert(i);
+		}
+	}
+	route_cache_flush();
+}
+
+/**
+ * Fgt eine Route hinzu bzw. aktualisiert die Metrik einer vorhandenen Route mit gleichem
+ * Prfix, Gateway und gleicher Herkunft.
+ *
+ * @param prefix Die Netzadresse.
+ * @param length Die Prfixlnge (0 = Default-Route).
+ * @param gateway Der nchste Hop; 0.0.0.0, wenn das Netz direkt erreichbar ist.
+ * @param metric Die Metrik (kleiner = bevorzugt).
+ * @param origin Die Herkunft (ROUTE_ORIGIN_STATIC oder ROUTE_ORIGIN_DHCP).
+ * @return 0 bei Erfolg; -1, wenn die Prfixlnge ungltig oder die Tabelle voll ist.
+ */
+int route_add(ip_address prefix, uint8_t length, ip_address gateway, uint16_t metric, uint8_t origin) {
+	uint32_t key = ip_to_uint32(prefix) & route_mask(length);
+	uint32_t gw = ip_to_uint32(gateway);
+	uint8_t free_idx = ROUTE_NONE;
+	
+	if (length > 32 || origin == ROUTE_ORIGIN_NONE) {
+		return -1;
+	}
+	for (uint8_t i = 0; i < ROUTE_TABLE_SIZE; i++) {
+		route_entry* r = &table->routes[i];
+		if (r->origin == ROUTE_ORIGIN_NONE) {
+			if (free_idx == ROUTE_NONE) {
+				free_idx = i;
+			}
+			continue;
+		}
+		if (r->prefix == key && r->length == length && r->gateway == gw && r->origin == origin) {
+			free_idx = i;
+			break;
+		}
+	}
+	if (free_idx == ROUTE_NONE) {
+		return -1;
+	}
+	
+	table->routes[free_idx] = (route_entry){key, gw, metric, length, origin};
+	route_rebuild();
+	return 0;
+}
+
+/**
+ * Entfernt alle Routen einer Herkunft, z.B. die Routen der vorherigen DHCP-Lease.
+ *
+ * @param origin Die Herkunft der zu entfernenden Routen.
+ */
+void route_del_origin(uint8_t origin) {
+	for (uint8_t i = 0; i < ROUTE_TABLE_SIZE; i++) {
+		if (table->routes[i].origin == origin) {
+			table->routes[i].origin = ROUTE_ORIGIN_NONE;
+		}
+	}
+	route_rebuild();
+}
+
+/**
+ * Berechnet den Cache-Platz fr eine Ziel-IP-Adresse (multiplikatives Hashing nach Knuth).
+ *
+ * @param ip Die Ziel-IP-Adresse als 32-Bit-Wert.
+ * @return Der Index im Cache.
+ */
+static uint16_t route_hash(uint32_t ip) {
+	return (uint16_t)((ip * 2654435761u) >> (32 - ROUTE_CACHE_BITS));
+}
+
+/**
+ * berprft, ob ein Cache-Eintrag gltig und noch nicht abgelaufen ist.
+ *
+ * @param e Ein Pointer auf den Cache-Eintrag.
+ * @param now Der aktuelle HAL-Tick.
+ * @return 1, wenn der Eintrag verwendet werden darf; sonst 0.
+ */
+static int route_fresh(route_cache_entry* e, uint32_t now) {
+	return e->valid && (now - e->timestamp) < ROUTE_CACHE_TIMEOUT;
+}
+
+/**
+ * Bestimmt den Ethernet-Header fr ein IPv4-Paket an die angegebene Ziel-IP-Adresse.
+ * Bei einem Cache-Treffer wird der vorgefertigte Header ohne Netzmaskenvergleich und ohne
+ * ARP-Suche kopiert. Andernfalls wird der nchste Hop ber die Route mit dem lngsten passenden
+ * Prfix bestimmt, per ARP aufgelst und bei Erfolg im Cache abgelegt.
+ *
+ * @param dst Die Ziel-IP-Adresse des Pakets.
+ * @param header Ein Pointer auf den zu fllenden MAC-Header.
+ * @param next_hop Ein Pointer auf die IP-Adresse des nchsten Hops (gesetzt, wenn 0 zurckgegeben wird).
+ * @return 1, wenn der Header vollstndig ist; 0, wenn die MAC-Adresse des nchsten Hops noch aufgelst wird;
+ *         -1, wenn es keine Route zum Ziel gibt.
+ */
+int route_lookup(ip_address dst, mac_header* header, ip_address* next_hop) {
+	uint32_t key = ip_to_uint32(dst);
+	uint32_t now = HAL_GetTick();
+	route_cache_entry* e = &cache->data[route_hash(key)];
+	
+	// Schneller Pfad: vorgefertigten Header aus dem Cache bernehmen
+	if (e->valid && e->dst == key) {
+		route_cache_entry* hop = e->via_gateway ? &cache->gateway : e;
+		if (route_fresh(hop, now)) {
+			*header = hop->header;
+			cache->stats.hits++;
+			return 1;
+		}
+	}
+	cache->stats.misses++;
+	
+	uint32_t me = ip_to_uint32(*my_ip_addr);
+	uint32_t mask = ip_to_uint32(*my_subnet_addr);
+	
+	header->src_mac = my_mac;
+	header->ether_type = IPV4_TYPE;
+	
+	// Broadcasts (allgemein und Subnetz) bentigen keine Auflsung
+	if (key == 0xFFFFFFFF || (mask != 0 && ((key ^ me) & mask) == 0 && (key | mask) == 0xFFFFFFFF)) {
+		header->dest_mac = (mac_address){0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+		return 1;
+	}
+	// Multicast wird direkt auf die Gruppen-MAC-Adresse abgebildet
+	if ((key >> 28) == 0xE) {
+		header->dest_mac = ipv4_multicast_mac(dst);
+		return 1;
+	}
+	
+	// Nchsten Hop ber die Routingtabelle bestimmen (lngstes passendes Prfix)
+	uint8_t r = route_trie_lookup(key);
+	if (r == ROUTE_NONE) {
+		cache->stats.no_route++;
+		return -1;
+	}
+	route_entry* route = &table->routes[r];
+	uint32_t hop = route->gateway ? route->gateway : key;
+	// Nur das Gateway der Default-Route wird angepinnt; es wird von den meisten Zielen geteilt
+	uint8_t via_gateway = (route->length == 0 && route->gateway != 0);
+	*next_hop = uint32_to_ip(hop);
+	
+	// MAC-Adresse des nchsten Hops auflsen (sendet bei Bedarf eine ARP-Anfrage)
+	if (!get_mac(*next_hop, &header->dest_mac)) {
+		return 0;
+	}
+	
+	// Ergebnis im Cache ablegen; Ziele hinter dem Default-Gateway verweisen auf den angepinnten Eintrag
+	// (Schlssel des Eintrags ist das Ziel; nur der angepinnte Eintrag gehrt zum Gateway selbst)
+	route_cache_entry* target = via_gateway ? &cache->gateway : e;
+	target->dst = via_gateway ? hop : key;
+	target->next_hop = hop;
+	target->header = *header;
+	target->timestamp = now;
+	target->valid = 1;
+	target->via_gateway = 0;
+	if (via_gateway) {
+		e->dst = key;
+		e->next_hop = hop;
+		e->valid = 1;
+		e->via_gateway = 1;
+	}
+	return 1;
+}
+
+/**
+ * Aktualisiert die Cache-Eintrge, deren nchster Hop die angegebene IP-Adresse ist.
+ * Wird von der ARP-Schicht aufgerufen, sobald eine Zuordnung besttigt oder gendert wird.
+ *
+ * @param ip Die IP-Adresse des nchsten Hops.
+ * @param mac Die (neue) MAC-Adresse des nchsten Hops.
+ */
+void route_cache_update(ip_address ip, mac_address mac) {
+	// Cache erst nach route_init verwenden
+	if (cache == NULL) {
+		return;
+	}
+	
+	uint32_t key = ip_to_uint32(ip);
+	uint32_t now = HAL_GetTick();
+	
+	// Gateway-Eintrag und alle Eintrge mit diesem nchsten Hop auffrischen (auch Ziele hinter weiteren Routern)
+	if (cache->gateway.valid && cache->gateway.next_hop == key) {
+		cache->gateway.header.dest_mac = mac;
+		cache->gateway.timestamp = now;
+	}
+	for (uint16_t i = 0; i < ROUTE_CACHE_SIZE; i++) {
+		route_cache_entry* e = &cache->data[i];
+		if (e->valid && !e->via_gateway && e->next_hop == key) {
+			e->header.dest_mac = mac;
+			e->timestamp = now;
+		}
+	}
+}
+
+/**
+ * Verwirft alle Eintrge des Next-Hop-Caches, einschlielich des Gateway-Eintrags.
+ * Wird von route_rebuild aufgerufen, sobald sich Routen, Adresse oder Subnetz ndern.
+ */
+void route_cache_flush(void) {
+	cache->gateway.valid = 0;
+	for (uint16_t i = 0; i < ROUTE_CACHE_SIZE; i++) {
+		cache->data[i].valid = 0;
+	}
+}
+
+/**
+ * Frischt den angepinnten Gateway-Eintrag kurz vor seinem Ablauf per ARP auf, damit
+ * Pakete ber das Gateway nie auf eine Auflsung warten. Wird zyklisch aus der Hauptschleife aufgerufen.
+ */
+void route_tick(void) {
+	route_cache_entry* gw = &cache->gateway;
+	uint32_t now = HAL_GetTick();
+	
+	if (!gw->valid) {
+		return;
+	}
+	// Abgelaufen: nicht weiter auffrischen, der nchste Sendevorgang lst neu auf
+	if (now - gw->timestamp >= ROUTE_CACHE_TIMEOUT) {
+		gw->valid = 0;
+		return;
+	}
+	// Innerhalb des Auffrischfensters hchstens alle ROUTE_GW_REFRESH / 4 ms anfragen
+	if (now - gw->timestamp >= ROUTE_CACHE_TIMEOUT - ROUTE_GW_REFRESH &&
+	    now - cache->refresh_time >= ROUTE_GW_REFRESH / 4) {
+		cache->refresh_time = now;
+		// Die ARP-Antwort aktualisiert den Eintrag ber route_cache_update
+		arp_refresh(uint32_to_ip(gw->next_hop));
+	}
+}
+
+/**
+ * Gibt die Zhler des Next-Hop-Caches zurck.
+ *
+ * @return Ein Pointer auf die Treffer- und Fehltrefferzhler.
+ */
+const route_stats* route_get_stats(void) {
+	return &cache->stats;
+}
\ No newline at end of file
@@ -0,0 +1,295 @@
+/* Includes ------------------------------------------------------------------*/
+#include "sntp.h"
+
+/* Private variables ---------------------------------------------------------*/
+static sntp_client* client;
+
+/* Private functions prototypes ---------------------------------------------*/
+static int sntp_input(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport);
+static void sntp_send(void);
+static void sntp_failover(uint32_t now);
+static void sntp_finish(uint32_t now);
+static void sntp_write_timestamp(uint8_t* p, uint64_t us);
+static uint64_t sntp_read_timestamp(const uint8_t* p);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Initialisiert den SNTP-Client (RFC 4330) und bindet seinen Socket. Gemessen wird, sobald
+ * Server bekannt sind; sie kommen aus DHCP Option 42 oder von sntp_set_servers. Die Uhr
+ * (clock_init) muss bereits laufen.
+ *
+ * @param client_addr Ein Pointer auf den Zustand des Clients.
+ */
+void sntp_init(sntp_client* client_addr) {
+	if (client_addr != NULL) {
+		client = client_addr;
+
+		client->server_count = 0;
+		client->server = 0;
+		client->state = SNTP_IDLE;
+		client->sent_count = 0;
+		client->samples = 0;
+		client->poll = SNTP_POLL_MIN;
+		client->next = HAL_GetTick();
+		client->stats = (sntp_stats) {0};
+		client->sock = udp_bind(UDP_PORT_ANY, &sntp_input);
+	}
+}
+
+
+/**
+ * Setzt die NTP-Server, z.B. aus DHCP Option 42. Sind es andere als bisher, beginnt sofort
+ * eine neue Messung beim ersten Server; eine Verlngerung der Lease mit denselben Servern
+ * ndert nichts.
+ *
+ * @param servers Die Adressen der Server in absteigender Prioritt.
+ * @param count Ihre Anzahl (hchstens SNTP_SERVERS werden bernommen).
+ */
+void sntp_set_servers(const ip_address* servers, uint8_t count) {
+	uint8_t changed;
+
+	if (count > SNTP_SERVERS) {
+		count = SNTP_SERVERS;
+	}
+	changed = (count != client->server_count);
+	for (uint8_t i = 0; i < count; i++) {
+		for (uint8_t k = 0; k < 4; k++) {
+			if (client->servers[i].octet[k] != servers[i].octet[k]) {
+				changed = 1;
+			}
+		}
+		client->servers[i] = servers[i];
+	}
+	client->server_count = count;
+	if (!changed) {
+		return;
+	}
+
+	client->server = 0;
+	client->state = SNTP_IDLE;
+	client->sent_count = 0;
+	client->samples = 0;
+	client->poll = SNTP_POLL_MIN;
+	client->next = HAL_GetTick();
+}
+
+
+/**
+ * Schreibt einen NTP-Zeitstempel: Sekunden seit 1900 und Bruchteil in 2^-32 s, Big Endian.
+ *
+ * @param p Das Ziel (8 Bytes).
+ * @param us Die Zeit in s seit 1970.
+ */
+static void sntp_write_timestamp(uint8_t* p, uint64_t us) {
+	uint32_t sec = (uint32_t)(us / 1000000 + SNTP_UNIX_OFFSET);
+	uint32_t frac = (uint32_t)(((us % 1000000) << 32) / 1000000);
+
+	for (uint8_t i = 0; i < 4; i++) {
+		p[i] = sec >> (24 - 8 * i);
+		p[4 + i] = frac >> (24 - 8 * i);
+	}
+}
+
+
+/**
+ * Liest einen NTP-Zeitstempel. Sekundenwerte mit gelschtem oberstem Bit gehren zur
+ * NTP-ra 1 ab 2036 (RFC 4330, 3).
+ *
+ * @param p Der Zeitstempel (8 Bytes, Big Endian).
+ * @return Die Zeit in s seit 1970.
+ */
+static uint64_t sntp_read_timestamp(const uint8_t* p) {
+	uint32_t sec = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+	uint32_t frac = ((uint32_t)p[4] << 24) | ((uint32_t)p[5] << 16) | ((uint32_t)p[6] << 8) | p[7];
+	uint64_t seconds = sec;
+
+	if ((sec & 0x80000000) == 0) {
+		seconds += 0x100000000ULL;
+	}
+	return (seconds - SNTP_UNIX_OFFSET) * 1000000 + (((uint64_t)frac * 1000000) >> 32);
+}
+
+
+/**
+ * Sendet eine Anfrage an den aktuellen Server. Der Transmit Timestamp ist die eigene Zeit
+ * beim Senden; der Server gibt ihn als Originate Timestamp zurck, woran die Antwort
+ * erkannt wird.
+ */
+static void sntp_send(void) {
+	uint8_t msg[SNTP_MSG_LEN];
+
+	for (uint8_t i = 0; i < SNTP_MSG_LEN; i++) {
+		msg[i] = 0;
+	}
+	msg[0] = (SNTP_VERSION << 3) | SNTP_MODE_CLIENT;
+
+	client->t1 = clock_utc_us();
+	sntp_write_timestamp(&msg[40], client->t1);
+	for (uint8_t i = 0; i < 8; i++) {
+		client->origin[i] = msg[40 + i];
+	}
+
+	udp_sendto(client->sock, msg, SNTP_MSG_LEN, client->servers[client->server], SNTP_PORT);
+	client->state = SNTP_WAIT;
+	client->sent = HAL_GetTick();
+	client->sent_count++;
+	client->stats.requests++;
+}
+
+
+/**
+ * Bricht die laufende Messung ab und wechselt zum nchsten Server. Nach einem Durchlauf ber
+ * alle Server wird erst nach SNTP_POLL_MIN erneut gefragt.
+ *
+ * @param now Der aktuelle HAL-Tick.
+ */
+static void sntp_failover(uint32_t now) {
+	client->server = (client->server + 1) % client->server_count;
+	client->state = SNTP_IDLE;
+	client->sent_count = 0;
+	client->samples = 0;
+	client->poll = SNTP_POLL_MIN;
+	client->next = (client->server == 0) ? now + SNTP_POLL_MIN : now;
+	client->stats.failovers++;
+}
+
+
+/**
+ * Schliet eine Messung ab: die Antwort mit der krzesten Laufzeit geht an die Uhr, denn bei
+ * ihr ist die Verzgerung durch Warteschlangen am kleinsten und am ehesten symmetrisch.
+ * Solange die Frequenz noch nicht eingeschwungen ist, sind die Abweichungen gro und der
+ * Abstand bleibt kurz; danach wchst er bis SNTP_POLL_MAX.
+ *
+ * @param now Der aktuelle HAL-Tick.
+ */
+static void sntp_finish(uint32_t now) {
+	if (client->samples == 0) {
+		sntp_failover(now);
+		return;
+	}
+
+	int64_t offset = client->best_offset;
+	clock_adjust(offset);
+	client->stats.updates++;
+	client->stats.delay = client->best_delay;
+
+	if (offset > SNTP_POLL_STABLE || offset < -SNTP_POLL_STABLE) {
+		client->poll = (client->poll / 2 > SNTP_POLL_MIN) ? client->poll / 2 : SNTP_POLL_MIN;
+	} else if (client->poll < SNTP_POLL_MAX) {
+		client->poll *= 2;
+	}
+	client->sent_count = 0;
+	client->samples = 0;
+	client->next = now + client->poll;
+}
+
+
+/**
+ * Verarbeitet die Antwort eines Servers. Angenommen wird nur die Antwort auf die letzte
+ * Anfrage (Absender, Port und Originate Timestamp), von einem synchronisierten Server.
+ * Aus den vier Zeitstempeln (T1 Senden, T2 Empfang beim Server, T3 Senden beim Server,
+ * T4 Empfang) ergeben sich Abweichung ((T2 - T1) + (T3 - T4)) / 2 und Laufzeit
+ * (T4 - T1) - (T3 - T2).
+ */
+static int sntp_input(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport) {
+	uint64_t t4 = clock_utc_us();
+	const uint8_t* msg = buf + offset;
+	uint32_t now = HAL_GetTick();
+
+	if (client->state != SNTP_WAIT || sport != SNTP_PORT || len < SNTP_MSG_LEN) {
+		client->stats.rejected++;
+		return 1;
+	}
+	ip_address server = client->servers[client->server];
+	for (uint8_t i = 0; i < 4; i++) {
+		if (server.octet[i] != src.octet[i]) {
+			client->stats.rejected++;
+			return 1;
+		}
+	}
+	for (uint8_t i = 0; i < 8; i++) {
+		if (msg[24 + i] != client->origin[i]) {
+			client->stats.rejected++;
+			return 1;
+		}
+	}
+
+	client->state = SNTP_IDLE;
+	client->next = (client->sent_count >= SNTP_BURST) ? now : client->sent + SNTP_BURST_INTERVAL;
+
+	uint8_t li = msg[0] >> 6;
+	uint8_t version = (msg[0] >> 3) & 0x07;
+	uint8_t stratum = msg[1];
+	if ((msg[0] & 0x07) != SNTP_MODE_SERVER) {
+		client->stats.rejected++;
+		return 0;
+	}
+	if (stratum == 0) {
+		// Kiss-o'-Death (z.B. RATE, DENY): diesen Server nicht weiter fragen
+		client->stats.kiss_of_death++;
+		sntp_failover(now);
+		return 0;
+	}
+	if (li == SNTP_LI_ALARM || stratum > 15 || version < 3 || (msg[40] | msg[41] | msg[42] | msg[43]) == 0) {
+		client->stats.rejected++;
+		return 0;
+	}
+
+	uint64_t t1 = client->t1;
+	uint64_t t2 = sntp_read_timestamp(&msg[32]);
+	uint64_t t3 = sntp_read_timestamp(&msg[40]);
+	int64_t theta = ((int64_t)(t2 - t1) + (int64_t)(t3 - t4)) / 2;
+	int64_t delta = (int64_t)(t4 - t1) - (int64_t)(t3 - t2);
+	if (delta < 0) {
+		delta = 0;
+	}
+	client->stats.responses++;
+
+	if (client->samples == 0 || delta < client->best_delay) {
+		client->best_offset = theta;
+		client->best_delay = (delta > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t)delta;
+	}
+	client->samples++;
+	return 0;
+}
+
+
+/**
+ * Sendet fllige Anfragen, wertet Zeitberschreitungen aus und schliet Messungen ab.
+ * Wird regelmig aus der Hauptschleife aufgerufen.
+ */
+void sntp_tick(void) {
+	if (client == NULL || client->server_count == 0) {
+		return;
+	}
+	uint32_t now = HAL_GetTick();
+
+	if (client->state == SNTP_WAIT) {
+		if (now - client->sent < SNTP_TIMEOUT) {
+			return;
+		}
+		client->state = SNTP_IDLE;
+		client->next = client->sent + SNTP_BURST_INTERVAL;
+		client->stats.timeouts++;
+	}
+	if ((int32_t)(now - client->next) < 0) {
+		return;
+	}
+
+	if (client->sent_count < SNTP_BURST) {
+		sntp_send();
+	} else {
+		sntp_finish(now);
+	}
+}
+
+
+/**
+ * Liefert die Zhler des SNTP-Clients.
+ *
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden).
+ */
+const sntp_stats* sntp_get_stats(void) {
+	return &client->stats;
+}
\ No newline at end of file
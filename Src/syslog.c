@@ -0,0 +1,560 @@
+/* Includes ------------------------------------------------------------------*/
+#include "syslog.h"
+
+/* Private variables ---------------------------------------------------------*/
+static syslog_ring* ring;
+
+volatile uint8_t syslog_threshold = 0; // Bis syslog_init wird nichts geschrieben
+
+/* Private functions prototypes ---------------------------------------------*/
+static uint16_t syslog_format(char* out, uint16_t size, const char* format, va_list args, uint8_t* truncated);
+static uint16_t syslog_snprintf(char* out, uint16_t size, const char* format, ...);
+static int syslog_input(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport);
+static uint32_t syslog_time(uint16_t pos);
+static void syslog_timestamp(char* out, uint32_t time);
+static uint16_t syslog_header(char* out, uint8_t severity, uint32_t time, uint32_t seq);
+static void syslog_refill(uint32_t now);
+static int syslog_flush(uint32_t now);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Initialisiert das Logging. Zeilen werden ab sofort im Ring gesammelt und nach syslog_start
+ * an den Collector gesendet; so gehen auch Meldungen vor DHCP nicht verloren (solange der
+ * Ring reicht).
+ *
+ * @param ring_addr Ein Pointer auf den Zustand (enthlt den Ring der Zeilen).
+ * @param src_ip Ein Pointer auf die eigene IP-Adresse (HOSTNAME der Nachrichten).
+ */
+void syslog_init(syslog_ring* ring_addr, ip_address* src_ip) {
+	if (ring_addr != NULL) {
+		ring = ring_addr;
+		
+		ring->head = 0;
+		ring->tail = 0;
+		ring->dropped_since = 0;
+		ring->active = 0;
+		ring->sock = -1;
+		ring->src_ip = src_ip;
+		ring->budget = SYSLOG_BUDGET;
+		ring->tokens = 0;
+		ring->timestamp = HAL_GetTick();
+		ring->seq = 1;
+		ring->stats = (syslog_stats) {0};
+		syslog_set_level(SYSLOG_LEVEL);
+	}
+}
+
+
+/**
+ * Legt fest, bis zu welchem Schweregrad Zeilen geschrieben werden.
+ *
+ * @param severity Der hchste noch protokollierte Schweregrad (SYSLOG_DEBUG = alles, SYSLOG_OFF = nichts).
+ */
+void syslog_set_level(uint8_t severity) {
+	syslog_threshold = (severity == SYSLOG_OFF) ? 0 : severity + 1;
+}
+
+
+/**
+ * Formatiert eine Zeile nach einer Teilmenge von printf: %d %i %u %x %X %c %s %p %% mit
+ * optionaler Breite, fhrenden Nullen und dem Lngenmodifikator l.
+ *
+ * @param out Der Ausgabepuffer (ohne abschlieende Null).
+ * @param size Seine Gre.
+ * @param format Das Format.
+ * @param args Die Argumente.
+ * @param truncated Ausgabe: 1, wenn die Zeile gekrzt wurde.
+ * @return Die Lnge der Zeile.
+ */
+static uint16_t syslog_format(char* out, uint16_t size, const char* format, va_list args, uint8_t* truncated) {
+	uint16_t n = 0;
+	
+	while (*format != '\0') {
+		char c = *format++;
+		if (c != '%') {
+			if (n < size) {
+				out[n++] = c;
+			} else {
+				*truncated = 1;
+			}
+			continue;
+		}
+		
+		char pad = ' ';
+		uint8_t width = 0;
+		uint8_t is_long = 0;
+		if (*format == '0') {
+			pad = '0';
+			format++;
+		}
+		while (*format >= '0' && *format <= '9') {
+			width = width * 10 + (*format++ - '0');
+		}
+		if (*format == 'l') {
+			is_long = 1;
+			format++;
+		}
+		
+		char digits[12];
+		uint8_t count = 0;
+		const char* text = NULL;
+		uint8_t negative = 0;
+		uint32_t value = 0;
+		uint8_t base = 10;
+		const char* charset = "0123456789abcdef";
+		
+		switch (*format) {
+			case 'd':
+			case 'i': {
+				int32_t v = is_long ? (int32_t)va_arg(args, long) : va_arg(args, int);
+				negative = v < 0;
+				value = negative ? -(uint32_t)v : (uint32_t)v;
+				break;
+			}
+			case 'u':
+				value = is_long ? (uint32_t)va_arg(args, unsigned long) : va_arg(args, unsigned int);
+				break;
+			case 'X':
+				charset = "0123456789ABCDEF";
+				// fall through
+			case 'x':
+				value = is_long ? (uint32_t)va_arg(args, unsigned long) : va_arg(args, unsigned int);
+				base = 16;
+				break;
+			case 'p':
+				value = (uint32_t)(uintptr_t)va_arg(args, void*);
+				base = 16;
+				pad = '0';
+				width = 8;
+				break;
+			case 'c':
+				digits[0] = (char)va_arg(args, int);
+				count = 1;
+				break;
+			case 's':
+				text = va_arg(args, const char*);
+				if (text == NULL) {
+					text = "(null)";
+				}
+				break;
+			case '%':
+				digits[0] = '%';
+				count = 1;
+				break;
+			default:
+				// Unbekannte Umwandlung unverndert ausgeben
+				digits[0] = '%';
+				digits[1] = *format;
+				count = (*format != '\0') ? 2 : 1;
+				break;
+		}
+		if (*format != '\0') {
+			format++;
+		}
+		
+		if (text == NULL && count == 0) {
+			// Zahl: Ziffern rckwrts erzeugen
+			do {
+				digits[count++] = charset[value % base];
+				value /= base;
+			} while (value > 0);
+			if (negative) {
+				if (pad == '0') {
+					if (n < size) {
+						out[n++] = '-';
+					}
+					if (width > 0) {
+						width--;
+					}
+				} else {
+					digits[count++] = '-';
+				}
+			}
+			while (width > count) {
+				if (n < size) {
+					out[n++] = pad;
+				}
+				width--;
+			}
+			while (count > 0) {
+				if (n < size) {
+					out[n++] = digits[--count];
+				} else {
+					*truncated = 1;
+					count = 0;
+				}
+			}
+		} else if (text != NULL) {
+			while (*text != '\0') {
+				if (n < size) {
+					out[n++] = *text++;
+				} else {
+					*truncated = 1;
+					break;
+				}
+			}
+		} else {
+			for (uint8_t i = 0; i < count; i++) {
+				if (n < size) {
+					out[n++] = digits[i];
+				} else {
+					*truncated = 1;
+				}
+			}
+		}
+	}
+	return n;
+}
+
+
+/**
+ * Formatiert wie syslog_format, mit variabler Argumentliste.
+ */
+static uint16_t syslog_snprintf(char* out, uint16_t size, const char* format, ...) {
+	uint8_t truncated = 0;
+	va_list args;
+	
+	va_start(args, format);
+	uint16_t n = syslog_format(out, size, format, args, &truncated);
+	va_end(args);
+	return n;
+}
+
+
+/**
+ * Schreibt eine Zeile in den Ring; aufrufbar aus Interrupts. Formatiert wird auf dem Stack des
+ * Aufrufers, danach wird der Platz im Ring mit einer kurzen PRIMASK-Sperre reserviert (nur das
+ * Verschieben von head, der Cortex-M0+ kennt kein LDREX/STREX). Kopiert wird ohne Sperre, erst
+ * das Setzen von SYSLOG_COMMITTED gibt die Zeile fr den Drain frei. Ein Interrupt kann also
+ * dazwischen eigene Zeilen schreiben, ohne die Reihenfolge im Ring zu stren. Ist der Ring voll,
+ * wird die neue Zeile verworfen und mitgezhlt.
+ *
+ * @param severity Der Schweregrad (SYSLOG_EMERG bis SYSLOG_DEBUG).
+ * @param format Das Format (siehe syslog_format).
+ * @param args Die Argumente.
+ */
+void syslog_vwrite(uint8_t severity, const char* format, va_list args) {
+	char line[SYSLOG_LINE_MAX];
+	uint8_t truncated = 0;
+	uint16_t len = syslog_format(line, sizeof(line), format, args, &truncated);
+	uint16_t size = SYSLOG_RECORD_HEADER + len;
+	uint32_t now = HAL_GetTick();
+	
+	// Reservieren
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint16_t head = ring->head;
+	if ((uint16_t)(head - ring->tail) + size > SYSLOG_RING_SIZE) {
+		ring->dropped_since++;
+		ring->stats.dropped++;
+		__set_PRIMASK(primask);
+		return;
+	}
+	ring->head = head + size;
+	ring->ring[head & SYSLOG_MASK] = len;
+	ring->ring[(head + 1) & SYSLOG_MASK] = SYSLOG_RESERVED;
+	ring->stats.lines++;
+	ring->stats.truncated += truncated;
+	__set_PRIMASK(primask);
+	
+	// Kopieren
+	ring->ring[(head + 2) & SYSLOG_MASK] = severity;
+	for (uint8_t i = 0; i < 4; i++) {
+		ring->ring[(head + 3 + i) & SYSLOG_MASK] = now >> (8 * i);
+	}
+	for (uint16_t i = 0; i < len; i++) {
+		ring->ring[(head + SYSLOG_RECORD_HEADER + i) & SYSLOG_MASK] = line[i];
+	}
+	
+	// Freigeben, erst nachdem alle Bytes im Ring stehen
+	__DMB();
+	ring->ring[(head + 1) & SYSLOG_MASK] = SYSLOG_COMMITTED;
+}
+
+
+/**
+ * Schreibt eine Zeile in den Ring (meist ber das Makro SYSLOG, das den Schweregrad vorher prft).
+ *
+ * @param severity Der Schweregrad.
+ * @param format Das Format (siehe syslog_format).
+ */
+void syslog_write(uint8_t severity, const char* format, ...) {
+	va_list args;
+	
+	va_start(args, format);
+	syslog_vwrite(severity, format, args);
+	va_end(args);
+}
+
+
+/**
+ * Verwirft Datagramme an den Port des Dienstes.
+ */
+static int syslog_input(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport) {
+	return 0;
+}
+
+
+/**
+ * Beginnt das Senden an einen Syslog-Collector (UDP, RFC 5426) in der Priorittsklasse
+ * TXQ_PRIO_BULK.
+ *
+ * @param collector Die Adresse des Collectors.
+ * @param port Der Zielport (Little Endian, 0 = SYSLOG_PORT).
+ * @param budget Das Bandbreitenbudget der Nutzdaten in Byte/s (0 = unbegrenzt).
+ * @return 0, wenn das Senden begonnen hat; -1, wenn kein Socket frei ist.
+ */
+int syslog_start(ip_address collector, uint16_t port, uint32_t budget) {
+	syslog_stop();
+	
+	int sock = udp_bind(UDP_PORT_ANY, &syslog_input);
+	if (sock < 0) {
+		return -1;
+	}
+	udp_set_priority(sock, TXQ_PRIO_BULK);
+	
+	ring->sock = sock;
+	ring->collector = collector;
+	ring->port = port ? port : SYSLOG_PORT;
+	ring->budget = budget;
+	ring->tokens = 0;
+	ring->timestamp = HAL_GetTick();
+	ring->active = 1;
+	return 0;
+}
+
+
+/**
+ * Beendet das Senden. Zeilen werden weiter im Ring gesammelt, bis er voll ist.
+ */
+void syslog_stop(void) {
+	ring->active = 0;
+	if (ring->sock >= 0) {
+		udp_close(ring->sock);
+		ring->sock = -1;
+	}
+}
+
+
+/**
+ * Liest den Zeitstempel einer Zeile im Ring.
+ */
+static uint32_t syslog_time(uint16_t pos) {
+	uint32_t time = 0;
+	
+	for (uint8_t i = 0; i < 4; i++) {
+		time |= (uint32_t)ring->ring[(pos + 3 + i) & SYSLOG_MASK] << (8 * i);
+	}
+	return time;
+}
+
+
+/**
+ * Formatiert den TIMESTAMP einer Zeile (RFC 5424, 6.2.3) in UTC mit Millisekunden, z.B.
+ * 2026-10-18T09:30:00.125Z. Die Uhrzeit der Zeile ergibt sich aus der disziplinierten Uhr
+ * abzglich ihres Alters. Solange SNTP die Uhr noch nicht gestellt hat, bleibt er leer ("-").
+ *
+ * @param out Der Ausgabepuffer (mindestens 25 Zeichen), wird mit Null abgeschlossen.
+ * @param time Der HAL-Tick der Zeile.
+ */
+static void syslog_timestamp(char* out, uint32_t time) {
+	if (!clock_synced()) {
+		out[0] = '-';
+		out[1] = '\0';
+		return;
+	}
+	uint64_t ms = clock_utc_us() / 1000 - (HAL_GetTick() - time);
+	uint32_t sec = (uint32_t)(ms / 1000);
+	uint32_t days = sec / 86400;
+	sec %= 86400;
+	
+	// Tage seit 1970 in ein Datum umrechnen (Jahre ab dem 1. Mrz, damit der Schalttag am Ende liegt)
+	uint32_t z = days + 719468;
+	uint32_t era = z / 146097;
+	uint32_t doe = z - era * 146097;
+	uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	uint32_t mp = (5 * doy + 2) / 153;
+	uint32_t day = doy - (153 * mp + 2) / 5 + 1;
+	uint32_t month = (mp < 10) ? mp + 3 : mp - 9;
+	uint32_t year = yoe + era * 400 + (month <= 2);
+	
+	uint16_t n = syslog_snprintf(out, 24, "%04u-%02u-%02uT%02u:%02u:%02u.%03uZ", (unsigned)year, (unsigned)month, (unsigned)day,
+		(unsigned)(sec / 3600), (unsigned)(sec / 60 % 60), (unsigned)(sec % 60), (unsigned)(ms % 1000));
+	out[n] = '\0';
+}
+
+
+/**
+ * Formatiert den Kopf einer Nachricht nach RFC 5424. Reihenfolge und Alter stehen zustzlich
+ * im Structured Data Element meta (sequenceId, sysUpTime in Hundertstelsekunden), damit sie
+ * auch ohne gestellte Uhr erhalten bleiben.
+ *
+ * @param out Der Ausgabepuffer (SYSLOG_HEADER_MAX Zeichen).
+ * @return Die Lnge des Kopfes einschlielich des trennenden Leerzeichens.
+ */
+static uint16_t syslog_header(char* out, uint8_t severity, uint32_t time, uint32_t seq) {
+	ip_address ip = *ring->src_ip;
+	char timestamp[25];
+	
+	syslog_timestamp(timestamp, time);
+	return syslog_snprintf(out, SYSLOG_HEADER_MAX, "<%u>1 %s %u.%u.%u.%u " SYSLOG_APP_NAME " - - [meta sequenceId=\"%lu\" sysUpTime=\"%lu\"] ",
+		SYSLOG_FACILITY * 8 + severity, timestamp, ip.octet[0], ip.octet[1], ip.octet[2], ip.octet[3],
+		(unsigned long)seq, (unsigned long)(time / 10));
+}
+
+
+/**
+ * Fllt das Bandbreitenbudget auf. Es reicht hchstens fr eine Sekunde, mindestens aber fr
+ * einen vollen Stapel.
+ */
+static void syslog_refill(uint32_t now) {
+	uint32_t elapsed = now - ring->timestamp;
+	uint32_t cap = ((ring->budget > SYSLOG_BATCH_BYTES) ? ring->budget : SYSLOG_BATCH_BYTES) * 1000;
+	
+	ring->timestamp = now;
+	if (elapsed > 60000) {
+		elapsed = 60000;
+	}
+	ring->tokens += elapsed * ring->budget;
+	if (ring->tokens > cap) {
+		ring->tokens = cap;
+	}
+}
+
+
+/**
+ * Sendet einen Stapel von Zeilen, jede als eigenes Datagramm (RFC 5426, 3.1). Gesendet wird, wenn
+ * der Stapel voll ist oder die lteste Zeile SYSLOG_DEADLINE erreicht hat, und nur, wenn das
+ * Budget fr den ganzen Stapel reicht; so fallen Zieladresse und ARP-Auflsung einmal je Stapel
+ * an und die Frames stehen direkt hintereinander in der Sendewarteschlange. Wurden Zeilen
+ * verworfen, beginnt der Stapel mit einer Meldung ber ihre Anzahl.
+ *
+ * @param now Der aktuelle HAL-Tick.
+ * @return 1, wenn ein voller Stapel gesendet wurde und weitere folgen knnen; sonst 0.
+ */
+static int syslog_flush(uint32_t now) {
+	char header[SYSLOG_HEADER_MAX];
+	char notice[24];
+	uint16_t head = ring->head;
+	uint16_t pos = ring->tail;
+	uint16_t bytes = 0;
+	uint8_t messages = 0;
+	uint16_t notice_len = 0;
+	uint8_t full = 0;
+	
+	uint16_t dropped = ring->dropped_since;
+	if (dropped > 0) {
+		notice_len = syslog_snprintf(notice, sizeof(notice), "%u lines dropped", dropped);
+		bytes = syslog_header(header, SYSLOG_WARNING, now, ring->seq) + notice_len;
+		messages = 1;
+	}
+	
+	// Freigegebene Zeilen sammeln, solange sie in den Stapel passen
+	while (pos != head && ring->ring[(pos + 1) & SYSLOG_MASK] == SYSLOG_COMMITTED) {
+		uint8_t len = ring->ring[pos & SYSLOG_MASK];
+		uint16_t size = syslog_header(header, ring->ring[(pos + 2) & SYSLOG_MASK], syslog_time(pos), ring->seq + messages) + len;
+		if (messages == SYSLOG_BATCH || bytes + size > SYSLOG_BATCH_BYTES) {
+			full = 1;
+			break;
+		}
+		bytes += size;
+		messages++;
+		pos += SYSLOG_RECORD_HEADER + len;
+	}
+	if (messages == 0) {
+		return 0;
+	}
+	
+	// Nagle mit Frist, dann Budget fr den ganzen Stapel
+	if (!full && pos != ring->tail && now - syslog_time(ring->tail) < SYSLOG_DEADLINE) {
+		return 0;
+	}
+	syslog_refill(now);
+	if (ring->budget != 0 && ring->tokens < (uint32_t)bytes * 1000) {
+		ring->stats.budget_waits++;
+		return 0;
+	}
+	
+	// Je Nachricht ein Datagramm direkt im bertragungspuffer; luft die ARP-Auflsung noch oder
+	// ist die Sendewarteschlange voll, bleibt der Rest fr den nchsten Aufruf im Ring
+	uint32_t seq = ring->seq;
+	uint16_t sent_bytes = 0;
+	uint16_t lines = 0;
+	uint8_t notice_sent = 0;
+	uint16_t p = ring->tail;
+	if (dropped > 0) {
+		uint16_t n = syslog_header(header, SYSLOG_WARNING, now, seq);
+		if (udp_alloc(ring->sock, ring->collector, ring->port, n + notice_len) <= 0) {
+			return 0;
+		}
+		udp_write((uint8_t*)header, n);
+		udp_write((uint8_t*)notice, notice_len);
+		udp_commit();
+		seq++;
+		sent_bytes += n + notice_len;
+		notice_sent = 1;
+	}
+	while (p != pos) {
+		uint8_t len = ring->ring[p & SYSLOG_MASK];
+		uint16_t n = syslog_header(header, ring->ring[(p + 2) & SYSLOG_MASK], syslog_time(p), seq);
+		if (udp_alloc(ring->sock, ring->collector, ring->port, n + len) <= 0) {
+			break;
+		}
+		udp_write((uint8_t*)header, n);
+		
+		// Text direkt aus dem Ring, ggf. in zwei Teilen
+		uint16_t start = (p + SYSLOG_RECORD_HEADER) & SYSLOG_MASK;
+		uint16_t first = (start + len > SYSLOG_RING_SIZE) ? SYSLOG_RING_SIZE - start : len;
+		udp_write(&ring->ring[start], first);
+		if (first < len) {
+			udp_write(&ring->ring[0], len - first);
+		}
+		udp_commit();
+		seq++;
+		sent_bytes += n + len;
+		lines++;
+		p += SYSLOG_RECORD_HEADER + len;
+	}
+	
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	ring->tail = p;
+	if (notice_sent) {
+		ring->dropped_since -= dropped;
+	}
+	__set_PRIMASK(primask);
+	
+	ring->seq = seq;
+	if (ring->budget != 0) {
+		ring->tokens -= (uint32_t)sent_bytes * 1000;
+	}
+	ring->stats.sent += lines;
+	ring->stats.datagrams += lines + notice_sent;
+	ring->stats.bytes += sent_bytes;
+	return full && p == pos;
+}
+
+
+/**
+ * Sendet fllige Datagramme. Wird regelmig aus der Hauptschleife aufgerufen.
+ */
+void syslog_tick(void) {
+	uint32_t now = HAL_GetTick();
+	
+	if (!ring->active) {
+		return;
+	}
+	while (syslog_flush(now));
+}
+
+
+/**
+ * Liefert die Zhler des Loggings.
+ *
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden).
+ */
+const syslog_stats* syslog_get_stats(void) {
+	return &ring->stats;
+}
\ No newline at end of file
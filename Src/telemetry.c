@@ -0,0 +1,287 @@
+/* Includes ------------------------------------------------------------------*/
+#include "telemetry.h"
+
+/* Private variables ---------------------------------------------------------*/
+static telemetry_stream* stream;
+
+/* Private functions prototypes ---------------------------------------------*/
+static uint32_t telemetry_lock(void);
+static void telemetry_unlock(uint32_t primask);
+static int telemetry_input(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport);
+static void telemetry_rates(uint32_t now);
+static int telemetry_flush(uint32_t now);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Initialisiert den Telemetrie-Dienst. Gesendet wird erst nach telemetry_start.
+ *
+ * @param stream_addr Ein Pointer auf den Zustand des Dienstes (enthlt den Ring der Datenstze).
+ */
+void telemetry_init(telemetry_stream* stream_addr) {
+	if (stream_addr != NULL) {
+		stream = stream_addr;
+		
+		stream->head = 0;
+		stream->tail = 0;
+		stream->sending = 0;
+		stream->active = 0;
+		stream->sock = -1;
+		stream->seq = 0;
+		stream->dropped_since = 0;
+		stream->rate_time = HAL_GetTick();
+		stream->rate_samples = 0;
+		stream->rate_datagrams = 0;
+		stream->stats = (telemetry_stats) {0};
+	}
+}
+
+
+/**
+ * Sperrt Interrupts, damit Erzeuger in Interrupts und die Hauptschleife den Ring nicht
+ * gleichzeitig verndern. Die Sperre umfasst nur das Kopieren eines Datensatzes bzw. das
+ * Verschieben der Indizes.
+ *
+ * @return Der bisherige Zustand von PRIMASK.
+ */
+static uint32_t telemetry_lock(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	return primask;
+}
+
+
+/**
+ * Stellt den Interrupt-Zustand vor telemetry_lock wieder her.
+ *
+ * @param primask Der Rckgabewert von telemetry_lock.
+ */
+static void telemetry_unlock(uint32_t primask) {
+	__set_PRIMASK(primask);
+}
+
+
+/**
+ * Verwirft Datagramme an den Port des Dienstes, damit sie keine Empfangspuffer belegen.
+ */
+static int telemetry_input(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport) {
+	return 0;
+}
+
+
+/**
+ * Beginnt das Senden an einen Collector. Der Dienst erhlt einen dynamischen Port und sendet
+ * in der Priorittsklasse TXQ_PRIO_BULK.
+ *
+ * @param collector Die Adresse des Collectors.
+ * @param port Der Zielport (Little Endian).
+ * @param deadline Die Frist in ms, nach der auch ein nicht volles Datagramm gesendet wird (0 = TELEMETRY_DEADLINE).
+ * @return 0, wenn der Dienst gestartet wurde; -1, wenn kein Socket frei ist.
+ */
+int telemetry_start(ip_address collector, uint16_t port, uint16_t deadline) {
+	telemetry_stop();
+	
+	int sock = udp_bind(UDP_PORT_ANY, &telemetry_input);
+	if (sock < 0) {
+		return -1;
+	}
+	udp_set_priority(sock, TXQ_PRIO_BULK);
+	
+	stream->sock = sock;
+	stream->collector = collector;
+	stream->port = port;
+	stream->deadline = deadline ? deadline : TELEMETRY_DEADLINE;
+	stream->active = 1;
+	return 0;
+}
+
+
+/**
+ * Beendet das Senden; ungesendete Datenstze werden verworfen.
+ */
+void telemetry_stop(void) {
+	uint32_t primask = telemetry_lock();
+	stream->active = 0;
+	stream->tail = stream->head;
+	telemetry_unlock(primask);
+	
+	if (stream->sock >= 0) {
+		udp_close(stream->sock);
+		stream->sock = -1;
+	}
+}
+
+
+/**
+ * Legt einen Datensatz im Ring ab. Blockiert nie und darf auch aus Interrupts aufgerufen werden.
+ * Ist der Ring voll, weil die Verbindung nicht nachkommt, werden die ltesten Datenstze
+ * verworfen (Drop-Oldest); nur whrend gerade aus dem Ring gesendet wird, wird stattdessen
+ * der neue Datensatz verworfen.
+ *
+ * @param data Ein Pointer auf die Daten.
+ * @param len Die Lnge der Daten (1 bis TELEMETRY_RECORD_MAX).
+ * @return 1, wenn der Datensatz abgelegt wurde; 0, wenn dafr ltere verworfen wurden; -1, wenn er verworfen wurde.
+ */
+int telemetry_publish(const uint8_t* data, uint8_t len) {
+	uint16_t need = TELEMETRY_RECORD_HEADER + len;
+	uint16_t now = (uint16_t)HAL_GetTick();
+	int result = 1;
+	
+	uint32_t primask = telemetry_lock();
+	if (!stream->active || len == 0 || len > TELEMETRY_RECORD_MAX) {
+		stream->stats.dropped++;
+		telemetry_unlock(primask);
+		return -1;
+	}
+	
+	// Drop-Oldest, bis der neue Datensatz Platz hat
+	while (TELEMETRY_RING_SIZE - (uint16_t)(stream->head - stream->tail) < need) {
+		stream->stats.dropped++;
+		if (stream->dropped_since < 0xFFFF) {
+			stream->dropped_since++;
+		}
+		if (stream->sending) {
+			telemetry_unlock(primask);
+			return -1;
+		}
+		stream->tail += TELEMETRY_RECORD_HEADER + stream->ring[stream->tail & TELEMETRY_MASK];
+		result = 0;
+	}
+	
+	uint16_t pos = stream->head;
+	stream->ring[pos++ & TELEMETRY_MASK] = len;
+	stream->ring[pos++ & TELEMETRY_MASK] = now >> 8;
+	stream->ring[pos++ & TELEMETRY_MASK] = now & 0xFF;
+	for (uint8_t i = 0; i < len; i++) {
+		stream->ring[pos++ & TELEMETRY_MASK] = data[i];
+	}
+	stream->head = pos;
+	stream->stats.samples++;
+	telemetry_unlock(primask);
+	return result;
+}
+
+
+/**
+ * Aktualisiert die Raten einmal je Sekunde.
+ *
+ * @param now Der aktuelle HAL-Tick.
+ */
+static void telemetry_rates(uint32_t now) {
+	uint32_t elapsed = now - stream->rate_time;
+	
+	if (elapsed < 1000) {
+		return;
+	}
+	stream->stats.samples_per_s = (uint32_t)(((uint64_t)(stream->stats.samples - stream->rate_samples) * 1000) / elapsed);
+	stream->stats.datagrams_per_s = (uint32_t)(((uint64_t)(stream->stats.datagrams - stream->rate_datagrams) * 1000) / elapsed);
+	stream->rate_samples = stream->stats.samples;
+	stream->rate_datagrams = stream->stats.datagrams;
+	stream->rate_time = now;
+}
+
+
+/**
+ * Sendet ein Datagramm, wenn genug Datenstze fr ein volles Datagramm vorliegen oder der lteste
+ * seine Frist erreicht hat. Die Datenstze werden direkt aus dem Ring in den bertragungspuffer
+ * geschrieben (udp_alloc), hchstens in zwei Teilen, wenn sie ber das Ringende laufen.
+ *
+ * @param now Der aktuelle HAL-Tick.
+ * @return 1, wenn ein volles Datagramm gesendet wurde und weitere folgen knnen; sonst 0.
+ */
+static int telemetry_flush(uint32_t now) {
+	telemetry_header header;
+	uint16_t now16 = (uint16_t)now;
+	
+	// Ab hier verwirft telemetry_publish keine Datenstze am Ende des Rings mehr
+	uint32_t primask = telemetry_lock();
+	uint16_t head = stream->head;
+	uint16_t tail = stream->tail;
+	stream->sending = (head != tail);
+	telemetry_unlock(primask);
+	if (head == tail) {
+		return 0;
+	}
+	
+	// Datenstze sammeln, solange sie in ein Datagramm passen
+	uint16_t cap = TELEMETRY_PAYLOAD - sizeof(telemetry_header);
+	uint16_t pos = tail;
+	uint16_t bytes = 0;
+	uint16_t records = 0;
+	uint32_t delay = 0;
+	uint16_t oldest = now16 - ((stream->ring[(tail + 1) & TELEMETRY_MASK] << 8) | stream->ring[(tail + 2) & TELEMETRY_MASK]);
+	
+	while (pos != head) {
+		uint16_t len = TELEMETRY_RECORD_HEADER + stream->ring[pos & TELEMETRY_MASK];
+		if (bytes + len > cap) {
+			break;
+		}
+		delay += (uint16_t)(now16 - ((stream->ring[(pos + 1) & TELEMETRY_MASK] << 8) | stream->ring[(pos + 2) & TELEMETRY_MASK]));
+		bytes += len;
+		records++;
+		pos += len;
+	}
+	uint8_t full = (pos != head) || (cap - bytes <= TELEMETRY_RECORD_HEADER);
+	
+	// Nagle mit Frist: ein nicht volles Datagramm wartet, bis der lteste Datensatz fllig ist
+	if ((!full && oldest < stream->deadline) || udp_alloc(stream->sock, stream->collector, stream->port, sizeof(header) + bytes) <= 0) {
+		stream->sending = 0;
+		return 0;
+	}
+	
+	primask = telemetry_lock();
+	uint16_t dropped = stream->dropped_since;
+	stream->dropped_since = 0;
+	telemetry_unlock(primask);
+	
+	header.seq = swapEndian32(stream->seq);
+	header.records = swapEndian16(records);
+	header.dropped = swapEndian16(dropped);
+	udp_write((uint8_t*)&header, sizeof(header));
+	
+	// Direkt aus dem Ring, ggf. in zwei Teilen
+	uint16_t start = tail & TELEMETRY_MASK;
+	uint16_t first = (start + bytes > TELEMETRY_RING_SIZE) ? TELEMETRY_RING_SIZE - start : bytes;
+	udp_write(&stream->ring[start], first);
+	if (first < bytes) {
+		udp_write(&stream->ring[0], bytes - first);
+	}
+	udp_commit();
+	
+	primask = telemetry_lock();
+	stream->tail = pos;
+	stream->sending = 0;
+	telemetry_unlock(primask);
+	
+	stream->seq++;
+	stream->stats.datagrams++;
+	stream->stats.records_sent += records;
+	stream->stats.delay_sum += delay;
+	stream->stats.mean_delay = stream->stats.delay_sum / stream->stats.records_sent;
+	return full;
+}
+
+
+/**
+ * Sendet fllige Datagramme und aktualisiert die Raten. Wird regelmig aus der Hauptschleife
+ * aufgerufen; volle Datagramme werden sofort nacheinander gesendet.
+ */
+void telemetry_tick(void) {
+	uint32_t now = HAL_GetTick();
+	
+	telemetry_rates(now);
+	if (!stream->active) {
+		return;
+	}
+	while (telemetry_flush(now));
+}
+
+
+/**
+ * Liefert die Zhler des Telemetrie-Dienstes.
+ *
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden).
+ */
+const telemetry_stats* telemetry_get_stats(void) {
+	return &stream->stats;
+}
\ No newline at end of file
@@ -0,0 +1,724 @@
+/* Includes ------------------------------------------------------------------*/
+#include "tftp.h"
+
+/* Private variables ---------------------------------------------------------*/
+static tftp_session* session;
+
+/* Private functions prototypes ---------------------------------------------*/
+static int tftp_input(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport);
+static int tftp_server_input(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport);
+static uint16_t tftp_put_string(uint8_t* p, const char* s);
+static uint16_t tftp_put_number(uint8_t* p, uint16_t value);
+static int tftp_equal(const uint8_t* p, uint16_t len, const char* s);
+static uint16_t tftp_options(const uint8_t* p, uint16_t len, uint16_t* blksize, uint16_t* windowsize);
+static uint16_t tftp_window_limit(uint16_t blksize);
+static void tftp_send_ack(uint16_t block);
+static void tftp_send_rrq(void);
+static void tftp_send_error(int sock, ip_address dst, uint16_t dport, uint16_t code, const char* msg);
+static void tftp_begin(void);
+static int tftp_sink_idle(void);
+static int tftp_handover(void);
+static int tftp_store(const uint8_t* data, uint16_t len);
+static uint16_t tftp_space(void);
+static void tftp_ack_window(void);
+static void tftp_finish(int ok);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Initialisiert TFTP. bertragungen beginnen mit tftp_get (Client) bzw. mit einem WRQ an den
+ * per tftp_server_start gestarteten Server. Es luft hchstens eine bertragung gleichzeitig.
+ *
+ * @param session_addr Ein Pointer auf den Zustand (enthlt die beiden Puffer vor der Senke).
+ */
+void tftp_init(tftp_session* session_addr) {
+	if (session_addr != NULL) {
+		session = session_addr;
+		
+		session->sink = NULL;
+		session->server_sink = NULL;
+		session->server_sock = -1;
+		session->sock = -1;
+		session->state = TFTP_IDLE;
+		session->stats = (tftp_stats) {0};
+	}
+}
+
+
+/**
+ * Schreibt eine nullterminierte Zeichenkette in ein Paket.
+ *
+ * @return Die Anzahl der geschriebenen Bytes einschlielich der Null.
+ */
+static uint16_t tftp_put_string(uint8_t* p, const char* s) {
+	uint16_t i = 0;
+	
+	do {
+		p[i] = s[i];
+	} while (s[i++] != '\0');
+	return i;
+}
+
+
+/**
+ * Schreibt eine Zahl als nullterminierten Dezimaltext in ein Paket (Optionswerte).
+ *
+ * @return Die Anzahl der geschriebenen Bytes einschlielich der Null.
+ */
+static uint16_t tftp_put_number(uint8_t* p, uint16_t value) {
+	char digits[6];
+	uint8_t n = 0;
+	uint16_t i = 0;
+	
+	do {
+		digits[n++] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+	while (n > 0) {
+		p[i++] = digits[--n];
+	}
+	p[i++] = '\0';
+	return i;
+}
+
+
+/**
+ * Vergleicht eine Zeichenkette aus einem Paket ohne Beachtung der Gro-/Kleinschreibung.
+ *
+ * @param p Die Zeichenkette im Paket (ohne Null).
+ * @param len Ihre Lnge.
+ * @param s Die Vergleichszeichenkette in Kleinbuchstaben.
+ * @return 1 bei Gleichheit; sonst 0.
+ */
+static int tftp_equal(const uint8_t* p, uint16_t len, const char* s) {
+	for (uint16_t i = 0; i < len; i++) {
+		uint8_t c = p[i];
+		if (c >= 'A' && c <= 'Z') {
+			c += 'a' - 'A';
+		}
+		if (s[i] == '\0' || c != (uint8_t)s[i]) {
+			return 0;
+		}
+	}
+	return s[len] == '\0';
+}
+
+
+/**
+ * Liest die Optionen blksize und windowsize aus den Paaren "Name\0Wert\0" eines WRQ bzw. OACK.
+ * Unbekannte Optionen werden bergangen (RFC 2347).
+ *
+ * @param p Der Beginn der Optionen.
+ * @param len Die Lnge des Optionsbereichs.
+ * @param blksize Ausgabe: Wert von blksize, unverndert wenn nicht enthalten.
+ * @param windowsize Ausgabe: Wert von windowsize, unverndert wenn nicht enthalten.
+ * @return Die Anzahl der erkannten Optionen.
+ */
+static uint16_t tftp_options(const uint8_t* p, uint16_t len, uint16_t* blksize, uint16_t* windowsize) {
+	uint16_t found = 0;
+	uint16_t pos = 0;
+	
+	while (pos < len) {
+		uint16_t name = pos;
+		while (pos < len && p[pos] != '\0') {
+			pos++;
+		}
+		uint16_t name_len = pos - name;
+		uint16_t value = ++pos;
+		uint32_t number = 0;
+		while (pos < len && p[pos] != '\0') {
+			if (p[pos] >= '0' && p[pos] <= '9' && number <= 0xFFFF) {
+				number = number * 10 + (p[pos] - '0');
+			}
+			pos++;
+		}
+		if (pos >= len || pos == value) {
+			break;
+		}
+		pos++;
+		if (number > 0xFFFF) {
+			number = 0xFFFF;
+		}
+		
+		if (tftp_equal(&p[name], name_len, "blksize")) {
+			*blksize = number;
+			found++;
+		} else if (tftp_equal(&p[name], name_len, "windowsize")) {
+			*windowsize = number;
+			found++;
+		}
+	}
+	return found;
+}
+
+
+/**
+ * Begrenzt die Fenstergre so, dass ein ganzes Fenster in einen Puffer passt.
+ *
+ * @param blksize Die ausgehandelte Blockgre.
+ * @return Die grte zulssige Fenstergre (mindestens 1).
+ */
+static uint16_t tftp_window_limit(uint16_t blksize) {
+	uint16_t limit = TFTP_BUF_SIZE / blksize;
+	
+	if (limit > TFTP_WINDOWSIZE) {
+		limit = TFTP_WINDOWSIZE;
+	}
+	return (limit > 0) ? limit : 1;
+}
+
+
+/**
+ * Sendet ein ACK an die Gegenstelle der laufenden bertragung.
+ *
+ * @param block Die Blocknummer.
+ */
+static void tftp_send_ack(uint16_t block) {
+	uint8_t ack[4] = {0, TFTP_ACK, block >> 8, block & 0xFF};
+	
+	udp_sendto(session->sock, ack, sizeof(ack), session->peer, session->peer_port);
+	session->window_count = 0;
+	session->last_time = HAL_GetTick();
+}
+
+
+/**
+ * Sendet die Leseanfrage des Clients mit den Optionen blksize und windowsize.
+ */
+static void tftp_send_rrq(void) {
+	uint8_t rrq[4 + TFTP_NAME_MAX + 40];
+	uint16_t len = 0;
+	
+	rrq[len++] = 0;
+	rrq[len++] = TFTP_RRQ;
+	len += tftp_put_string(&rrq[len], session->name);
+	len += tftp_put_string(&rrq[len], "octet");
+	len += tftp_put_string(&rrq[len], "blksize");
+	len += tftp_put_number(&rrq[len], TFTP_BLKSIZE);
+	len += tftp_put_string(&rrq[len], "windowsize");
+	len += tftp_put_number(&rrq[len], tftp_window_limit(TFTP_BLKSIZE));
+	
+	udp_sendto(session->sock, rrq, len, session->peer, TFTP_PORT);
+	session->last_time = HAL_GetTick();
+}
+
+
+/**
+ * Sendet ein ERROR-Paket.
+ *
+ * @param sock Der sendende Socket.
+ * @param dst Die Zieladresse.
+ * @param dport Der Zielport (Little Endian).
+ * @param code Der Fehlercode (TFTP_ERR_*).
+ * @param msg Der Fehlertext.
+ */
+static void tftp_send_error(int sock, ip_address dst, uint16_t dport, uint16_t code, const char* msg) {
+	uint8_t error[4 + 32];
+	uint16_t len = 4;
+	
+	error[0] = 0;
+	error[1] = TFTP_ERROR;
+	error[2] = code >> 8;
+	error[3] = code & 0xFF;
+	len += tftp_put_string(&error[len], msg);
+	udp_sendto(sock, error, len, dst, dport);
+}
+
+
+/**
+ * Setzt Puffer und Zhler fr eine neue bertragung zurck.
+ */
+static void tftp_begin(void) {
+	session->blksize = TFTP_BLKSIZE_DEFAULT;
+	session->windowsize = 1;
+	session->block = 0;
+	session->window_count = 0;
+	session->gap_acked = 0;
+	session->stalled = 0;
+	session->retries = 0;
+	session->cur = 0;
+	session->writing = TFTP_NO_BUF;
+	session->fill = 0;
+	session->offset = 0;
+	session->start_time = HAL_GetTick();
+	session->last_time = session->start_time;
+	session->stats = (tftp_stats) {0};
+}
+
+
+/**
+ * Prft, ob die Senke den zuletzt bergebenen Puffer fertig geschrieben hat.
+ *
+ * @return 1, wenn kein Schreibvorgang mehr luft; sonst 0.
+ */
+static int tftp_sink_idle(void) {
+	if (session->writing == TFTP_NO_BUF) {
+		return 1;
+	}
+	if (session->sink->busy != NULL && session->sink->busy()) {
+		return 0;
+	}
+	session->writing = TFTP_NO_BUF;
+	return 1;
+}
+
+
+/**
+ * bergibt den vollen aktuellen Puffer an die Senke und schaltet auf den anderen um.
+ *
+ * @return 0, wenn der Puffer bergeben wurde oder die Senke noch schreibt; -1, wenn die Senke einen Fehler meldet.
+ */
+static int tftp_handover(void) {
+	if (session->fill < TFTP_BUF_SIZE || !tftp_sink_idle()) {
+		return 0;
+	}
+	if (session->sink->write(session->offset, session->buf[session->cur], TFTP_BUF_SIZE) != 0) {
+		return -1;
+	}
+	session->writing = session->cur;
+	session->cur ^= 1;
+	session->offset += TFTP_BUF_SIZE;
+	session->fill = 0;
+	return 0;
+}
+
+
+/**
+ * Kopiert einen Block in den aktuellen Puffer. Ist er voll, wird er der Senke bergeben und
+ * der andere Puffer weiter gefllt, whrend die Senke schreibt (z.B. Flash lschen und
+ * programmieren parallel zum Empfang). Schreibt die Senke den anderen Puffer noch, bleibt der
+ * volle Puffer liegen, bis tftp_tick ihn bergibt; ein Block, der nicht mehr hineinpasst,
+ * wird nicht angenommen.
+ *
+ * @param data Die Daten des Blocks.
+ * @param len Die Lnge (hchstens TFTP_BUF_SIZE).
+ * @return 0, wenn der Block bernommen wurde; -1, wenn kein Puffer frei ist; -2, wenn die Senke einen Fehler meldet.
+ */
+static int tftp_store(const uint8_t* data, uint16_t len) {
+	if (tftp_handover() != 0) {
+		return -2;
+	}
+	if (session->fill + len > TFTP_BUF_SIZE && !tftp_sink_idle()) {
+		return -1;
+	}
+	
+	uint16_t first = TFTP_BUF_SIZE - session->fill;
+	if (first > len) {
+		first = len;
+	}
+	uint8_t* dst = &session->buf[session->cur][session->fill];
+	for (uint16_t i = 0; i < first; i++) {
+		dst[i] = data[i];
+	}
+	session->fill += first;
+	
+	if (tftp_handover() != 0) {
+		return -2;
+	}
+	if (first < len) {
+		dst = session->buf[session->cur];
+		for (uint16_t i = first; i < len; i++) {
+			dst[i - first] = data[i];
+		}
+		session->fill = len - first;
+	}
+	return 0;
+}
+
+
+/**
+ * Liefert, wie viele Bytes ohne Pufferengpass noch angenommen werden knnen.
+ */
+static uint16_t tftp_space(void) {
+	if (!tftp_sink_idle()) {
+		return TFTP_BUF_SIZE - session->fill;
+	}
+	return (TFTP_BUF_SIZE - session->fill) + TFTP_BUF_SIZE;
+}
+
+
+/**
+ * Besttigt ein vollstndiges Fenster. Passt das nchste Fenster nicht mehr in die Puffer, weil
+ * die Senke noch schreibt, wird das ACK zurckgehalten und von tftp_tick gesendet, sobald
+ * wieder genug Platz ist. So bremst die Senke den Sender, statt dass Blcke verworfen werden.
+ */
+static void tftp_ack_window(void) {
+	if (tftp_space() >= (uint32_t)session->windowsize * session->blksize) {
+		tftp_send_ack(session->block);
+		return;
+	}
+	session->stats.deferred++;
+	session->stalled = 1;
+	session->gap_acked = 1; // Wiederholte Blcke lsen bis dahin kein weiteres ACK aus
+	session->window_count = 0;
+}
+
+
+/**
+ * Beendet die laufende bertragung und schliet ihren Socket.
+ *
+ * @param ok 1 bei Erfolg; 0 nach einem Fehler.
+ */
+static void tftp_finish(int ok) {
+	if (session->sink != NULL && session->sink->close != NULL) {
+		session->sink->close(ok);
+	}
+	udp_close(session->sock);
+	session->sock = -1;
+	session->state = ok ? TFTP_DONE : TFTP_FAILED;
+	session->stats.duration = HAL_GetTick() - session->start_time;
+	SYSLOG(ok ? SYSLOG_NOTICE : SYSLOG_ERR, "tftp: %s %s, %lu bytes in %lu ms, %lu timeouts",
+		session->name, ok ? "done" : "failed", (unsigned long)session->stats.bytes,
+		(unsigned long)session->stats.duration, (unsigned long)session->stats.timeouts);
+}
+
+
+/**
+ * Ldt eine Datei von einem TFTP-Server in die Senke (RRQ). Angefragt werden blksize
+ * TFTP_BLKSIZE und windowsize TFTP_WINDOWSIZE; ignoriert der Server die Optionen, wird
+ * im Lock-Step mit 512-Byte-Blcken bertragen. Der Fortschritt luft ber tftp_tick.
+ *
+ * @param server Die Adresse des Servers.
+ * @param name Der Dateiname (hchstens TFTP_NAME_MAX - 1 Zeichen).
+ * @param sink Die Senke der Daten.
+ * @return 0, wenn die Anfrage gesendet wurde; -1, wenn eine bertragung luft, kein Socket frei ist oder die Senke ablehnt.
+ */
+int tftp_get(ip_address server, const char* name, const tftp_sink* sink) {
+	if (session->state == TFTP_REQUEST || session->state == TFTP_TRANSFER || session->state == TFTP_FLUSH) {
+		return -1;
+	}
+	
+	uint8_t i = 0;
+	while (name[i] != '\0' && i < TFTP_NAME_MAX - 1) {
+		session->name[i] = name[i];
+		i++;
+	}
+	session->name[i] = '\0';
+	
+	if (sink->open != NULL && sink->open(session->name) != 0) {
+		return -1;
+	}
+	session->sock = udp_bind(UDP_PORT_ANY, &tftp_input);
+	if (session->sock < 0) {
+		if (sink->close != NULL) {
+			sink->close(0);
+		}
+		return -1;
+	}
+	
+	session->sink = sink;
+	session->peer = server;
+	session->peer_port = 0; // Der Server antwortet von seiner eigenen TID
+	tftp_begin();
+	session->state = TFTP_REQUEST;
+	tftp_send_rrq();
+	return 0;
+}
+
+
+/**
+ * Startet den TFTP-Server auf Port 69. Er nimmt Schreibanfragen (WRQ) an und leitet die Daten
+ * in die Senke; Leseanfragen werden abgelehnt.
+ *
+ * @param sink Die Senke; open erhlt den Dateinamen und kann die bertragung ablehnen.
+ * @return 0, wenn der Server luft; -1, wenn Port 69 belegt ist.
+ */
+int tftp_server_start(const tftp_sink* sink) {
+	if (session->server_sock >= 0) {
+		tftp_server_stop();
+	}
+	session->server_sock = udp_bind(TFTP_PORT, &tftp_server_input);
+	if (session->server_sock < 0) {
+		return -1;
+	}
+	session->server_sink = sink;
+	return 0;
+}
+
+
+/**
+ * Beendet den TFTP-Server; eine laufende bertragung wird nicht abgebrochen.
+ */
+void tftp_server_stop(void) {
+	udp_close(session->server_sock);
+	session->server_sock = -1;
+	session->server_sink = NULL;
+}
+
+
+/**
+ * Verarbeitet Anfragen an Port 69. Bei einem WRQ wird ein Socket mit eigener TID geffnet und
+ * mit OACK (wenn Optionen angefragt wurden) oder ACK 0 geantwortet.
+ */
+static int tftp_server_input(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport) {
+	const uint8_t* p = buf + offset;
+	
+	if (len < 4) {
+		return 1;
+	}
+	uint16_t opcode = (p[0] << 8) | p[1];
+	if (opcode == TFTP_RRQ) {
+		tftp_send_error(session->server_sock, src, sport, TFTP_ERR_ACCESS, "read not supported");
+		return 0;
+	}
+	if (opcode != TFTP_WRQ) {
+		tftp_send_error(session->server_sock, src, sport, TFTP_ERR_ILLEGAL, "illegal operation");
+		return 0;
+	}
+	if (session->state == TFTP_REQUEST || session->state == TFTP_TRANSFER || session->state == TFTP_FLUSH) {
+		tftp_send_error(session->server_sock, src, sport, TFTP_ERR_UNDEFINED, "busy");
+		return 0;
+	}
+	
+	// Dateiname und Modus
+	uint16_t pos = 2;
+	uint8_t i = 0;
+	while (pos < len && p[pos] != '\0') {
+		if (i < TFTP_NAME_MAX - 1) {
+			session->name[i++] = p[pos];
+		}
+		pos++;
+	}
+	session->name[i] = '\0';
+	uint16_t mode = ++pos;
+	while (pos < len && p[pos] != '\0') {
+		pos++;
+	}
+	if (pos >= len || !tftp_equal(&p[mode], pos - mode, "octet")) {
+		tftp_send_error(session->server_sock, src, sport, TFTP_ERR_ILLEGAL, "octet only");
+		return 0;
+	}
+	pos++;
+	
+	const tftp_sink* sink = session->server_sink;
+	if (sink->open != NULL && sink->open(session->name) != 0) {
+		tftp_send_error(session->server_sock, src, sport, TFTP_ERR_ACCESS, "rejected");
+		return 0;
+	}
+	session->sock = udp_bind(UDP_PORT_ANY, &tftp_input);
+	if (session->sock < 0) {
+		tftp_send_error(session->server_sock, src, sport, TFTP_ERR_UNDEFINED, "no socket");
+		if (sink->close != NULL) {
+			sink->close(0);
+		}
+		return 0;
+	}
+	
+	session->sink = sink;
+	session->peer = src;
+	session->peer_port = sport;
+	tftp_begin();
+	session->state = TFTP_TRANSFER;
+	
+	// Optionen aushandeln: angefragte Werte, begrenzt auf die eigenen Hchstwerte
+	uint16_t blksize = 0;
+	uint16_t windowsize = 0;
+	if (tftp_options(&p[pos], len - pos, &blksize, &windowsize) == 0) {
+		tftp_send_ack(0);
+		return 0;
+	}
+	
+	uint8_t oack[2 + 40];
+	uint16_t oack_len = 0;
+	oack[oack_len++] = 0;
+	oack[oack_len++] = TFTP_OACK;
+	if (blksize >= 8) {
+		session->blksize = (blksize > TFTP_BLKSIZE) ? TFTP_BLKSIZE : blksize;
+		oack_len += tftp_put_string(&oack[oack_len], "blksize");
+		oack_len += tftp_put_number(&oack[oack_len], session->blksize);
+	}
+	if (windowsize >= 1) {
+		uint16_t limit = tftp_window_limit(session->blksize);
+		session->windowsize = (windowsize > limit) ? limit : windowsize;
+		oack_len += tftp_put_string(&oack[oack_len], "windowsize");
+		oack_len += tftp_put_number(&oack[oack_len], session->windowsize);
+	}
+	udp_sendto(session->sock, oack, oack_len, session->peer, session->peer_port);
+	session->last_time = HAL_GetTick();
+	return 0;
+}
+
+
+/**
+ * Verarbeitet Pakete an den Socket der laufenden bertragung (OACK, DATA, ERROR). Blcke in
+ * Reihenfolge werden bernommen und je Fenster einmal besttigt. Fehlt ein Block, wird sofort
+ * einmal der letzte gute besttigt, damit der Sender das Fenster ab dort wiederholt (RFC 7440).
+ */
+static int tftp_input(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport) {
+	const uint8_t* p = buf + offset;
+	
+	if (len < 4 ||
+		src.octet[0] != session->peer.octet[0] || src.octet[1] != session->peer.octet[1] ||
+		src.octet[2] != session->peer.octet[2] || src.octet[3] != session->peer.octet[3]) {
+		return 1;
+	}
+	if (session->peer_port == 0) {
+		session->peer_port = sport;
+	} else if (sport != session->peer_port) {
+		tftp_send_error(session->sock, src, sport, TFTP_ERR_UNKNOWN_TID, "unknown transfer id");
+		return 1;
+	}
+	
+	uint16_t opcode = (p[0] << 8) | p[1];
+	uint16_t block = (p[2] << 8) | p[3];
+	
+	if (opcode == TFTP_ERROR) {
+		if (session->state == TFTP_REQUEST || session->state == TFTP_TRANSFER) {
+			tftp_finish(0);
+		}
+		return 0;
+	}
+	
+	if (opcode == TFTP_OACK && session->state == TFTP_REQUEST) {
+		uint16_t blksize = TFTP_BLKSIZE_DEFAULT;
+		uint16_t windowsize = 1;
+		tftp_options(&p[2], len - 2, &blksize, &windowsize);
+		if (blksize < 8 || blksize > TFTP_BLKSIZE || windowsize < 1 || windowsize > tftp_window_limit(blksize)) {
+			tftp_send_error(session->sock, session->peer, session->peer_port, TFTP_ERR_OPTION, "bad option");
+			tftp_finish(0);
+			return 0;
+		}
+		session->blksize = blksize;
+		session->windowsize = windowsize;
+		session->state = TFTP_TRANSFER;
+		session->retries = 0;
+		tftp_send_ack(0);
+		return 0;
+	}
+	
+	if (opcode != TFTP_DATA) {
+		return 1;
+	}
+	if (session->state == TFTP_REQUEST) {
+		// Server ohne Optionen: 512-Byte-Blcke im Lock-Step
+		session->state = TFTP_TRANSFER;
+	}
+	if (session->state == TFTP_FLUSH) {
+		// Letztes ACK verloren: erneut besttigen
+		if (block == session->block) {
+			tftp_send_ack(block);
+		}
+		return 0;
+	}
+	if (session->state != TFTP_TRANSFER) {
+		return 1;
+	}
+	
+	uint16_t data_len = len - 4;
+	if (block != (uint16_t)(session->block + 1) || data_len > session->blksize) {
+		session->stats.out_of_order++;
+		if (!session->gap_acked) {
+			session->gap_acked = 1;
+			tftp_send_ack(session->block);
+		}
+		return 0;
+	}
+	
+	int stored = tftp_store(&p[4], data_len);
+	if (stored == -2) {
+		tftp_send_error(session->sock, session->peer, session->peer_port, TFTP_ERR_DISK_FULL, "write failed");
+		tftp_finish(0);
+		return 0;
+	}
+	if (stored < 0) {
+		// Beide Puffer belegt (Sender hlt sich nicht an das Fenster): tftp_tick fordert ab hier neu an, sobald die Senke frei ist
+		session->stats.stalls++;
+		session->stalled = 1;
+		session->gap_acked = 1;
+		return 0;
+	}
+	
+	session->block = block;
+	session->window_count++;
+	session->gap_acked = 0;
+	session->retries = 0;
+	session->last_time = HAL_GetTick();
+	session->stats.blocks++;
+	session->stats.bytes += data_len;
+	
+	if (data_len < session->blksize) {
+		// Letzter Block: besttigen, Rest schreibt tftp_tick in die Senke
+		tftp_send_ack(block);
+		session->state = TFTP_FLUSH;
+	} else if (session->window_count >= session->windowsize) {
+		tftp_ack_window();
+	}
+	return 0;
+}
+
+
+/**
+ * Treibt die laufende bertragung voran: wiederholt nach TFTP_TIMEOUT das letzte ACK bzw. die
+ * Anfrage, fordert nach einem Pufferengpass das Fenster neu an und schliet die Senke nach dem
+ * letzten Block. Wird regelmig aus der Hauptschleife aufgerufen.
+ */
+void tftp_tick(void) {
+	uint32_t now = HAL_GetTick();
+	
+	if (session->state == TFTP_FLUSH) {
+		if (!tftp_sink_idle()) {
+			return;
+		}
+		if (session->fill > 0) {
+			if (session->sink->write(session->offset, session->buf[session->cur], session->fill) != 0) {
+				tftp_finish(0);
+				return;
+			}
+			session->writing = session->cur;
+			session->offset += session->fill;
+			session->fill = 0;
+			return;
+		}
+		tftp_finish(1);
+		return;
+	}
+	if (session->state != TFTP_REQUEST && session->state != TFTP_TRANSFER) {
+		return;
+	}
+	
+	if (tftp_handover() != 0) {
+		tftp_send_error(session->sock, session->peer, session->peer_port, TFTP_ERR_DISK_FULL, "write failed");
+		tftp_finish(0);
+		return;
+	}
+	if (session->stalled && tftp_space() >= (uint32_t)session->windowsize * session->blksize) {
+		session->stalled = 0;
+		tftp_send_ack(session->block);
+		return;
+	}
+	
+	if (now - session->last_time >= TFTP_TIMEOUT) {
+		session->stats.timeouts++;
+		if (++session->retries > TFTP_RETRIES) {
+			if (session->peer_port != 0) {
+				tftp_send_error(session->sock, session->peer, session->peer_port, TFTP_ERR_UNDEFINED, "timeout");
+			}
+			tftp_finish(0);
+		} else if (session->state == TFTP_REQUEST) {
+			tftp_send_rrq();
+		} else {
+			session->gap_acked = 1;
+			tftp_send_ack(session->block);
+		}
+	}
+}
+
+
+/**
+ * Liefert den Zustand der letzten bzw. laufenden bertragung.
+ *
+ * @return TFTP_IDLE, TFTP_REQUEST, TFTP_TRANSFER, TFTP_FLUSH, TFTP_DONE oder TFTP_FAILED.
+ */
+uint8_t tftp_get_state(void) {
+	return session->state;
+}
+
+
+/**
+ * Liefert die Zhler der letzten bzw. laufenden bertragung.
+ *
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden).
+ */
+const tftp_stats* tftp_get_stats(void) {
+	return &session->stats;
+}
\ No newline at end of file
@@ -0,0 +1,446 @@
+/* Includes ------------------------------------------------------------------*/
+#include "txq.h"
+
+/* Private variables ---------------------------------------------------------*/
+static txq_queues* queues;
+
+// DSCP, mit dem jede Klasse gesendet wird (RFC 4594)
+static const uint8_t txq_dscp[TXQ_CLASSES] = {48, 46, 0, 8}; // CS6, EF, Default, CS1
+
+/* Private functions prototypes ---------------------------------------------*/
+static int txq_alloc(uint8_t count);
+static void txq_free(const txq_frame* frame);
+static int txq_select(void);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Initialisiert die Sendewarteschlangen. Jeder Frame wird direkt in einen eigenen Bereich des
+ * bertragungspuffers im ENC28J60 geschrieben und von dort gesendet, im RAM liegen nur die
+ * Deskriptoren. Frames verschiedener Priorittsklassen knnen so gleichzeitig warten.
+ *
+ * @param queues_addr Ein Pointer auf die Struktur der Sendewarteschlangen.
+ */
+void txq_init(txq_queues* queues_addr) {
+	if (queues_addr != NULL) {
+		queues = queues_addr;
+		
+		for (uint8_t i = 0; i < TXQ_CLASSES; i++) {
+			queues->classes[i].head = 0;
+			queues->classes[i].count = 0;
+			queues->classes[i].starved = 0;
+		}
+		queues->granules = 0;
+		queues->busy = 0;
+		queues->stats = (txq_stats) {0};
+	}
+}
+
+
+/**
+ * Bildet die Priorittsklasse aus dem TOS-Byte eines IPv4-Headers (DSCP in den oberen 6 Bit).
+ *
+ * @param tos Das TOS-Byte (service_field).
+ * @return Die Priorittsklasse.
+ */
+uint8_t txq_prio_from_tos(uint8_t tos) {
+	uint8_t dscp = tos >> 2;
+	
+	if (dscp >= 48) {
+		return TXQ_PRIO_CONTROL; // CS6, CS7
+	}
+	if (dscp >= 32) {
+		return TXQ_PRIO_EXPEDITED; // CS4, AF4x, CS5, EF
+	}
+	if (dscp >= 8 && dscp < 16) {
+		return TXQ_PRIO_BULK; // CS1, AF1x
+	}
+	return TXQ_PRIO_DEFAULT;
+}
+
+
+/**
+ * Liefert das TOS-Byte, mit dem Pakete einer Priorittsklasse gesendet werden, damit
+ * Switches und Router die Prioritt bernehmen.
+ *
+ * @param prio Die Priorittsklasse.
+ * @return Das TOS-Byte (DSCP, ECN = 0).
+ */
+uint8_t txq_tos(uint8_t prio) {
+	if (prio >= TXQ_CLASSES) {
+		prio = TXQ_PRIO_DEFAULT;
+	}
+	return txq_dscp[prio] << 2;
+}
+
+
+/**
+ * Belegt zusammenhngende Blcke des bertragungspuffers (First Fit).
+ *
+ * @param count Die Anzahl der Blcke.
+ * @return Der erste Block; -1, wenn kein ausreichend groer Bereich frei ist.
+ */
+static int txq_alloc(uint8_t count) {
+	uint32_t mask = (1UL << count) - 1;
+	
+	for (uint8_t first = 0; first + count <= TXQ_GRANULES; first++) {
+		if ((queues->granules & (mask << first)) == 0) {
+			queues->granules |= mask << first;
+			return first;
+		}
+	}
+	return -1;
+}
+
+
+/**
+ * Gibt die Blcke eines Frames frei.
+ *
+ * @param frame Der Frame.
+ */
+static void txq_free(const txq_frame* frame) {
+	queues->granules &= ~(((1UL << frame->count) - 1) << frame->first);
+}
+
+
+/**
+ * Beginnt einen Frame in der Sendewarteschlange der angegebenen Klasse. Ist kein Pufferspeicher
+ * oder kein Platz in der Klasse frei, wird gewartet, bis laufende bertragungen abgeschlossen sind.
+ * Der Inhalt folgt ber txq_write, eingereiht wird mit txq_end.
+ *
+ * @param len Die Lnge des Frames.
+ * @param prio Die Priorittsklasse (TXQ_PRIO_*).
+ * @return 0, wenn der Frame begonnen wurde; -1, wenn er zu lang ist.
+ */
+int txq_begin(uint16_t len, uint8_t prio) {
+	uint8_t count = (len + TXQ_FRAME_OVERHEAD + TXQ_GRANULE - 1) / TXQ_GRANULE;
+	int first;
+	
+	if (len > MAX_FRAMELEN) {
+		queues->stats.dropped++;
+		return -1;
+	}
+	if (prio >= TXQ_CLASSES) {
+		prio = TXQ_PRIO_DEFAULT;
+	}
+	
+	if (queues->classes[prio].count >= TXQ_DEPTH || (first = txq_alloc(count)) < 0) {
+		queues->stats.blocked++;
+		// Warten, bis die laufenden bertragungen Speicher freigeben (blockierend wie ein direkter Sendeaufruf)
+		while (queues->classes[prio].count >= TXQ_DEPTH || (first = txq_alloc(count)) < 0) {
+			txq_poll();
+		}
+	}
+	
+	queues->pending.first = first;
+	queues->pending.count = count;
+	queues->pending.addr = TXSTART_INIT + first * TXQ_GRANULE;
+	queues->pending.len = len;
+	queues->pending_prio = prio;
+	enc28_packetBegin(queues->pending.addr);
+	return 0;
+}
+
+
+/**
+ * Hngt Daten an den mit txq_begin begonnenen Frame an.
+ *
+ * @param len Die Lnge der Daten.
+ * @param data Ein Pointer auf die Daten.
+ */
+void txq_write(uint16_t len, const uint8_t* data) {
+	enc28_packetWrite(len, data);
+}
+
+
+/**
+ * bernimmt den zuletzt empfangenen Frame per DMA als Inhalt des begonnenen Frames, ohne ihn ber
+ * SPI zu bertragen. Einzelne Felder werden anschlieend mit txq_patch angepasst.
+ *
+ * @param len Die Lnge des Frames (siehe enc28_packetHeld).
+ */
+void txq_copy_rx(uint16_t len) {
+	enc28_packetCopyRx(queues->pending.addr + 1, len);
+}
+
+
+/**
+ * berschreibt Bytes des begonnenen Frames.
+ *
+ * @param offset Die Position im Frame (0 = Beginn des MAC-Headers).
+ * @param len Die Anzahl der Bytes.
+ * @param data Ein Pointer auf die neuen Daten.
+ */
+void txq_patch(uint16_t offset, uint16_t len, const uint8_t* data) {
+	enc28_packetPatch(queues->pending.addr + 1 + offset, len, data);
+}
+
+
+/**
+ * Setzt die Schreibposition im begonnenen Frame; folgende txq_write-Aufrufe schreiben ab dort.
+ * Damit lassen sich Header berspringen, die erst nach den Nutzdaten per txq_patch folgen.
+ *
+ * @param offset Die Position im Frame (0 = Beginn des MAC-Headers).
+ */
+void txq_seek(uint16_t offset) {
+	enc28_packetSeek(queues->pending.addr + 1 + offset);
+}
+
+
+/**
+ * Krzt den begonnenen Frame auf seine tatschliche Lnge, wenn bei txq_begin nur eine
+ * Obergrenze bekannt war. Nicht mehr bentigte Blcke am Ende werden sofort freigegeben.
+ *
+ * @param len Die tatschliche Lnge des Frames (hchstens die bei txq_begin angegebene).
+ */
+void txq_trim(uint16_t len) {
+	uint8_t count = (len + TXQ_FRAME_OVERHEAD + TXQ_GRANULE - 1) / TXQ_GRANULE;
+	
+	if (len > queues->pending.len) {
+		return;
+	}
+	if (count < queues->pending.count) {
+		txq_frame unused = {.first = queues->pending.first + count, .count = queues->pending.count - count};
+		txq_free(&unused);
+		queues->pending.count = count;
+	}
+	queues->pending.len = len;
+}
+
+
+/**
+ * Verwirft den begonnenen Frame und gibt seinen Pufferspeicher frei.
+ */
+void txq_abort(void) {
+	txq_free(&queues->pending);
+	queues->pending.count = 0;
+}
+
+
+/**
+ * Reiht den begonnenen Frame in seine Klasse ein und startet die bertragung, wenn der
+ * Controller frei ist.
+ */
+void txq_end(void) {
+	txq_class* c = &queues->classes[queues->pending_prio];
+	txq_class_stats* stats = &queues->stats.classes[queues->pending_prio];
+	
+	queues->pending.timestamp = HAL_GetTick();
+	c->ring[(c->head + c->count) % TXQ_DEPTH] = queues->pending;
+	c->count++;
+	
+	stats->enqueued++;
+	stats->depth = c->count;
+	if (c->count > stats->max_depth) {
+		stats->max_depth = c->count;
+	}
+	txq_poll();
+}
+
+
+/**
+ * Reiht einen vollstndigen Frame ein.
+ *
+ * @param len Die Lnge des Frames.
+ * @param frame Ein Pointer auf den Frame, beginnend mit dem MAC-Header.
+ * @param prio Die Priorittsklasse (TXQ_PRIO_*).
+ * @return 1, wenn der Frame eingereiht wurde; -1, wenn er zu lang ist.
+ */
+int txq_send(uint16_t len, const uint8_t* frame, uint8_t prio) {
+	if (txq_begin(len, prio) < 0) {
+		return -1;
+	}
+	txq_write(len, frame);
+	txq_end();
+	return 1;
+}
+
+
+/**
+ * Beginnt einen Stapel von Frames derselben Klasse, die direkt hintereinander im
+ * bertragungspuffer liegen. Der Schreibpointer wird nur einmal gesetzt; zwischen den Frames
+ * werden der Platz fr den Statusvektor und das nchste Kontrollbyte einfach mitgeschrieben.
+ * Die Frames folgen mit txq_batch_add und txq_write und werden erst mit txq_batch_end
+ * gemeinsam eingereiht; danach startet txq_poll jeden direkt nach Abschluss des vorigen.
+ *
+ * @param total Die Summe der Framelngen zuzglich TXQ_FRAME_OVERHEAD je Frame (hchstens TXQ_BATCH_MAX).
+ * @param frames Die Anzahl der Frames (hchstens TXQ_DEPTH).
+ * @param prio Die Priorittsklasse (TXQ_PRIO_*).
+ * @return 0, wenn der Stapel begonnen wurde; -1, wenn er zu gro ist.
+ */
+int txq_batch_begin(uint16_t total, uint8_t frames, uint8_t prio) {
+	uint8_t count = (total + TXQ_GRANULE - 1) / TXQ_GRANULE;
+	int first;
+	
+	if (total > TXQ_BATCH_MAX || frames == 0 || frames > TXQ_DEPTH) {
+		queues->stats.dropped += frames;
+		return -1;
+	}
+	if (prio >= TXQ_CLASSES) {
+		prio = TXQ_PRIO_DEFAULT;
+	}
+	
+	txq_class* c = &queues->classes[prio];
+	if (c->count + frames > TXQ_DEPTH || (first = txq_alloc(count)) < 0) {
+		queues->stats.blocked++;
+		while (c->count + frames > TXQ_DEPTH || (first = txq_alloc(count)) < 0) {
+			txq_poll();
+		}
+	}
+	
+	queues->batch.first = first;
+	queues->batch.count = count;
+	queues->batch.addr = TXSTART_INIT + first * TXQ_GRANULE;
+	queues->batch.len = 0;
+	queues->batch_frames = 0;
+	queues->pending_prio = prio;
+	return 0;
+}
+
+
+/**
+ * Beginnt den nchsten Frame eines Stapels; sein Inhalt folgt ber txq_write.
+ *
+ * @param len Die Lnge des Frames.
+ */
+void txq_batch_add(uint16_t len) {
+	txq_class* c = &queues->classes[queues->pending_prio];
+	txq_frame* frame = &c->ring[(c->head + c->count + queues->batch_frames) % TXQ_DEPTH];
+	
+	if (queues->batch_frames == 0) {
+		frame->addr = queues->batch.addr;
+		enc28_packetBegin(frame->addr);
+	} else {
+		// Statusvektor des vorigen Frames berspringen und Kontrollbyte schreiben, ohne EWRPT neu zu setzen
+		static const uint8_t gap[TXQ_FRAME_OVERHEAD] = {0, 0, 0, 0, 0, 0, 0, 0xFF};
+		txq_frame* prev = &c->ring[(c->head + c->count + queues->batch_frames - 1) % TXQ_DEPTH];
+		frame->addr = prev->addr + prev->len + TXQ_FRAME_OVERHEAD;
+		enc28_packetWrite(sizeof(gap), gap);
+	}
+	frame->len = len;
+	// Die Blcke gehren dem letzten Frame des Stapels und werden mit ihm freigegeben
+	frame->first = 0;
+	frame->count = 0;
+	queues->batch_frames++;
+}
+
+
+/**
+ * Reiht alle Frames des Stapels in ihre Klasse ein und startet die bertragung.
+ */
+void txq_batch_end(void) {
+	txq_class* c = &queues->classes[queues->pending_prio];
+	txq_class_stats* stats = &queues->stats.classes[queues->pending_prio];
+	uint32_t now = HAL_GetTick();
+	
+	if (queues->batch_frames == 0) {
+		txq_free(&queues->batch);
+		return;
+	}
+	for (uint8_t i = 0; i < queues->batch_frames; i++) {
+		c->ring[(c->head + c->count + i) % TXQ_DEPTH].timestamp = now;
+	}
+	txq_frame* last = &c->ring[(c->head + c->count + queues->batch_frames - 1) % TXQ_DEPTH];
+	last->first = queues->batch.first;
+	last->count = queues->batch.count;
+	
+	c->count += queues->batch_frames;
+	stats->enqueued += queues->batch_frames;
+	stats->depth = c->count;
+	if (c->count > stats->max_depth) {
+		stats->max_depth = c->count;
+	}
+	queues->batch_frames = 0;
+	txq_poll();
+}
+
+
+/**
+ * Whlt die nchste Klasse nach strikter Prioritt. Eine Klasse, die TXQ_STARVATION_LIMIT
+ * Frames hherer Klassen abgewartet hat, wird einmal vorgezogen.
+ *
+ * @return Die Klasse; -1, wenn alle Warteschlangen leer sind.
+ */
+static int txq_select(void) {
+	int selected = -1;
+	
+	for (uint8_t i = 0; i < TXQ_CLASSES; i++) {
+		if (queues->classes[i].count > 0 && queues->classes[i].starved >= TXQ_STARVATION_LIMIT) {
+			selected = i;
+			queues->stats.classes[i].starvation++;
+			break;
+		}
+	}
+	if (selected < 0) {
+		for (uint8_t i = 0; i < TXQ_CLASSES; i++) {
+			if (queues->classes[i].count > 0) {
+				selected = i;
+				break;
+			}
+		}
+	}
+	if (selected < 0) {
+		return -1;
+	}
+	
+	// bergangene niedrigere Klassen merken sich die Wartezeit
+	for (uint8_t i = selected + 1; i < TXQ_CLASSES; i++) {
+		if (queues->classes[i].count > 0) {
+			queues->classes[i].starved++;
+		}
+	}
+	queues->classes[selected].starved = 0;
+	return selected;
+}
+
+
+/**
+ * Gibt den Speicher eines gesendeten Frames frei und startet die bertragung des nchsten.
+ * Wird aus der Hauptschleife und beim Einreihen aufgerufen und blockiert nicht.
+ */
+void txq_poll(void) {
+	if (queues->busy) {
+		int done = enc28_packetDone();
+		if (done == 0) {
+			return;
+		}
+		if (done < 0) {
+			queues->stats.tx_errors++;
+		}
+		txq_free(&queues->in_flight);
+		queues->busy = 0;
+	}
+	
+	int prio = txq_select();
+	if (prio < 0) {
+		return;
+	}
+	
+	txq_class* c = &queues->classes[prio];
+	txq_class_stats* stats = &queues->stats.classes[prio];
+	txq_frame* frame = &c->ring[c->head];
+	uint32_t latency = HAL_GetTick() - frame->timestamp;
+	
+	queues->in_flight = *frame;
+	queues->busy = 1;
+	c->head = (c->head + 1) % TXQ_DEPTH;
+	c->count--;
+	
+	stats->sent++;
+	stats->depth = c->count;
+	stats->latency_sum += latency;
+	if (latency > stats->latency_max) {
+		stats->latency_max = latency;
+	}
+	enc28_packetTransmit(queues->in_flight.addr, queues->in_flight.len);
+}
+
+
+/**
+ * Liefert die Zhler der Sendewarteschlangen.
+ *
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden).
+ */
+const txq_stats* txq_get_stats(void) {
+	return &queues->stats;
+}
\ No newline at end of file
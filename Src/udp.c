@@ -2,132 +2,707 @@
 #include "udp.h"
 
 /* Private variables ---------------------------------------------------------*/
-static udp_serivces* serivces;
+static udp_sockets* sockets;
 
 /* Private functions prototypes ---------------------------------------------*/
-int handle_udp(const uint8_t* buf, uint16_t length);
+int handle_udp(const uint8_t* buf, uint16_t length, uint16_t offset);
+static void udp_enqueue(udp_socket* s, const uint8_t* buf, uint16_t length, uint16_t offset, uint16_t len, ip_address src, uint16_t sport);
+static int udp_find(uint16_t port, uint8_t* pos);
+static uint16_t udp_ephemeral(void);
+static int udp_verify(udp_socket* s, const uint8_t* buf, uint16_t offset, uint16_t udp_length);
+static int udp_rx_sum_wanted(const uint8_t* header, uint16_t len);
 
 /* Functions -----------------------------------------------------------------*/
 
 /**
  * Initialisiert den UDP-Layer mit den angegebenen Parametern.
  *
- * @param services_addr Ein Pointer auf die Struktur, die Informationen ber die UDP-Dienste enthlt.
- * @param src_ip Die Quell-IP-Adresse fr den UDP-Layer.
- * @param src_mac Die Quell-MAC-Adresse fr den UDP-Layer.
+ * @param sockets_addr Ein Pointer auf die Struktur der UDP-Sockets.
  */
-void udp_init(udp_serivces* serivces_addr) {
-	// berprfe, ob der Pointer auf die UDP-Services-Struktur nicht NULL ist
-	if (serivces_addr != NULL) {
+void udp_init(udp_sockets* sockets_addr) {
+	// berprfe, ob der Pointer auf die Socket-Struktur nicht NULL ist
+	if (sockets_addr != NULL) {
 		// Fge UDP zu den Protokolltypen der IPv4-Layer hinzu und verknpfe es mit der handle_udp-Funktion
 		ipv4_add_type(UDP_TYPE, &handle_udp); 
-		// Set the pointer to the UDP services structure
-		serivces = serivces_addr;
-		// Set the index to zero, assuming no protocols have been added yet
-		serivces->idx = 0;
+		sockets = sockets_addr;
+		// Nur Datagramme, deren Prfsumme geprft wird, beim Lesen ber SPI summieren lassen
+		enc28_setRxSumFilter(&udp_rx_sum_wanted);
+		
+		// Noch keine Sockets belegt
+		for (uint8_t i = 0; i < UDP_SOCKETS; i++) {
+			sockets->sockets[i].in_use = 0;
+		}
+		sockets->bound = 0;
+		sockets->wildcard = UDP_NO_SOCKET;
+		sockets->next_ephemeral = UDP_EPHEMERAL_FIRST;
+		sockets->tx.active = 0;
+		sockets->no_socket = 0;
 	}
 }
 
 /**
  * Fgt einen UDP-Protokolltyp mit einem lokalen Port und einer zugehrigen Funktion hinzu.
+ * Entspricht udp_bind mit Handler.
  *
  * @param lport Der lokale Port, der dem UDP-Protokolltyp zugeordnet ist.
  * @param func Ein Pointer auf die Funktion, die mit dem UDP-Protokolltyp verknpft ist.
  */
 void udp_add_type(uint16_t lport, void* func){
-	// Setze den lokalen UDP-Port und die zugehrige Funktion in der UDP-Services-Struktur
-	serivces->serivces[serivces->idx].lport = lport;
-	serivces->serivces[serivces->idx].func = func;
+	udp_bind(lport, (udp_handler)func);
+}
+
+
+/**
+ * Sucht einen Port per binrer Suche im sortierten Index, die Kosten wachsen nur logarithmisch
+ * mit der Anzahl der Sockets. Die Schlssel liegen in Host-Byte-Order zusammenhngend in ports,
+ * jeder Schritt ist ein einzelner Vergleich ohne Umweg ber den Socket.
+ *
+ * @param port Der Port in Host-Byte-Order.
+ * @param pos Ausgabe: Position des Ports im Index bzw. Einfgeposition (darf NULL sein).
+ * @return Der Socket; -1, wenn kein Socket an den Port gebunden ist.
+ */
+static int udp_find(uint16_t port, uint8_t* pos) {
+	uint8_t low = 0;
+	uint8_t high = sockets->bound;
+	
+	while (low < high) {
+		uint8_t mid = (low + high) >> 1;
+		if (sockets->ports[mid] < port) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	if (pos != NULL) {
+		*pos = low;
+	}
+	if (low < sockets->bound && sockets->ports[low] == port) {
+		return sockets->index[low];
+	}
+	return -1;
+}
+
+
+/**
+ * Sucht einen freien Port im dynamischen Bereich. Die Vergabe luft reihum weiter,
+ * damit ein gerade geschlossener Port nicht sofort wiederverwendet wird.
+ *
+ * @return Der Port in Host-Byte-Order; 0, wenn der Bereich erschpft ist.
+ */
+static uint16_t udp_ephemeral(void) {
+	uint32_t range = UDP_EPHEMERAL_LAST - UDP_EPHEMERAL_FIRST + 1;
+	
+	for (uint32_t i = 0; i < range && i <= UDP_SOCKETS; i++) {
+		uint16_t port = sockets->next_ephemeral;
+		
+		sockets->next_ephemeral = (port >= UDP_EPHEMERAL_LAST) ? UDP_EPHEMERAL_FIRST : port + 1;
+		if (udp_find(port, NULL) < 0) {
+			return port;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * ffnet einen Socket auf einem lokalen Port. Mit Handler werden Datagramme wie bisher synchron
+ * im Empfangspfad zugestellt. Ohne Handler legt der Socket bis zu UDP_RING_SIZE Datagramme als
+ * Referenz auf ihren Empfangspuffer ab; die Anwendung holt sie mit udp_recvfrom in ihrem eigenen
+ * Takt ab, ohne den Empfang aufzuhalten.
+ * Der Socket wird sortiert in den Port-Index eingefgt.
+ *
+ * @param lport Der lokale Port (Little Endian, z.B. swapEndian16(5000)); UDP_PORT_ANY vergibt einen dynamischen Port.
+ * @param func Der Handler oder NULL fr den Empfangsring.
+ * @return Der Socket (ab 0); -1, wenn der Port belegt oder kein Socket frei ist.
+ */
+int udp_bind(uint16_t lport, udp_handler func) {
+	int free_sock = -1;
+	uint8_t pos;
+	
+	if (sockets->bound >= UDP_SOCKETS) {
+		return -1;
+	}
+	
+	uint16_t port = swapEndian16(lport);
+	if (port == UDP_PORT_ANY) {
+		port = udp_ephemeral();
+		if (port == 0) {
+			return -1;
+		}
+	}
+	if (udp_find(port, &pos) >= 0) {
+		return -1;
+	}
+	
+	for (uint8_t i = 0; i < UDP_SOCKETS; i++) {
+		if (!sockets->sockets[i].in_use) {
+			free_sock = i;
+			break;
+		}
+	}
+	
+	udp_socket* s = &sockets->sockets[free_sock];
+	s->lport = swapEndian16(port);
+	s->func = func;
+	s->prio = TXQ_PRIO_DEFAULT;
+	s->csum_policy = UDP_CSUM_ZERO_OK;
+	s->head = 0;
+	s->count = 0;
+	s->stats = (udp_socket_stats) {0};
+	s->in_use = 1;
+	
+	// An der Einfgeposition Platz schaffen
+	for (uint8_t i = sockets->bound; i > pos; i--) {
+		sockets->ports[i] = sockets->ports[i - 1];
+		sockets->index[i] = sockets->index[i - 1];
+	}
+	sockets->ports[pos] = port;
+	sockets->index[pos] = free_sock;
+	sockets->bound++;
+	return free_sock;
+}
+
+
+/**
+ * Schliet einen Socket und gibt die Puffer noch nicht abgeholter Datagramme frei.
+ *
+ * @param sock Der Socket.
+ */
+void udp_close(int sock) {
+	if (sock < 0 || sock >= UDP_SOCKETS || !sockets->sockets[sock].in_use) {
+		return;
+	}
+	udp_socket* s = &sockets->sockets[sock];
+	uint8_t pos;
+	
+	while (s->count > 0) {
+		pbuf_free(s->ring[s->head].buf);
+		s->head = (s->head + 1) % UDP_RING_SIZE;
+		s->count--;
+	}
+	
+	// Aus dem Port-Index entfernen
+	if (udp_find(swapEndian16(s->lport), &pos) == sock) {
+		sockets->bound--;
+		for (uint8_t i = pos; i < sockets->bound; i++) {
+			sockets->ports[i] = sockets->ports[i + 1];
+			sockets->index[i] = sockets->index[i + 1];
+		}
+	}
+	if (sockets->wildcard == sock) {
+		sockets->wildcard = UDP_NO_SOCKET;
+	}
+	s->in_use = 0;
+}
+
+
+/**
+ * Legt einen Socket als Wildcard fest: er erhlt alle Datagramme an Ports ohne eigenen Socket
+ * (z.B. fr Diagnose oder einen Discovery-Dienst). Ein negativer Wert hebt die Zuordnung auf.
+ *
+ * @param sock Der Socket oder -1.
+ */
+void udp_set_wildcard(int sock) {
+	if (sock >= 0 && sock < UDP_SOCKETS && sockets->sockets[sock].in_use) {
+		sockets->wildcard = sock;
+	} else {
+		sockets->wildcard = UDP_NO_SOCKET;
+	}
+}
+
+
+/**
+ * Liefert den lokalen Port eines Sockets, z.B. nach der Vergabe eines dynamischen Ports.
+ *
+ * @param sock Der Socket.
+ * @return Der Port (Little Endian); 0 bei ungltigem Socket.
+ */
+uint16_t udp_get_port(int sock) {
+	if (sock < 0 || sock >= UDP_SOCKETS || !sockets->sockets[sock].in_use) {
+		return 0;
+	}
+	return sockets->sockets[sock].lport;
+}
+
+
+/**
+ * Holt das lteste Datagramm aus dem Empfangsring eines Sockets. Die Nutzdaten werden in den
+ * Puffer der Anwendung kopiert (zu lange Datagramme werden gekrzt) und der Empfangspuffer freigegeben.
+ *
+ * @param sock Der Socket.
+ * @param data Der Puffer fr die Nutzdaten.
+ * @param size Die Gre des Puffers.
+ * @param src Ausgabe: Absenderadresse (darf NULL sein).
+ * @param sport Ausgabe: Absenderport, Little Endian (darf NULL sein).
+ * @return Die Lnge der kopierten Nutzdaten; -1, wenn kein Datagramm vorliegt.
+ */
+int udp_recvfrom(int sock, uint8_t* data, uint16_t size, ip_address* src, uint16_t* sport) {
+	if (sock < 0 || sock >= UDP_SOCKETS || sockets->sockets[sock].count == 0) {
+		return -1;
+	}
+	udp_socket* s = &sockets->sockets[sock];
+	udp_datagram* d = &s->ring[s->head];
+	uint16_t len = (d->len < size) ? d->len : size;
+	
+	for (uint16_t i = 0; i < len; i++) {
+		data[i] = d->buf->data[d->offset + i];
+	}
+	if (src != NULL) {
+		*src = d->src;
+	}
+	if (sport != NULL) {
+		*sport = d->sport;
+	}
+	
+	pbuf_free(d->buf);
+	s->head = (s->head + 1) % UDP_RING_SIZE;
+	s->count--;
+	return len;
+}
+
+
+/**
+ * Sendet ein Datagramm vom lokalen Port des Sockets.
+ *
+ * @param sock Der Socket.
+ * @param data Die Nutzdaten.
+ * @param len Die Lnge der Nutzdaten.
+ * @param dst Die Zieladresse.
+ * @param dport Der Zielport (Little Endian).
+ * @return Der Rckgabewert von udp_send; -1 bei ungltigem Socket.
+ */
+int udp_sendto(int sock, const uint8_t* data, uint16_t len, ip_address dst, uint16_t dport) {
+	if (sock < 0 || sock >= UDP_SOCKETS || !sockets->sockets[sock].in_use) {
+		return -1;
+	}
+	udp_socket* s = &sockets->sockets[sock];
+	
+	return udp_send(dst, s->lport, dport, data, len, s->prio);
+}
+
+
+/**
+ * Sendet mehrere Datagramme vom lokalen Port des Sockets in einem Aufruf (wie sendmmsg).
+ * Die Frames werden stapelweise hintereinander in den bertragungspuffer geschrieben und
+ * direkt nacheinander gesendet (siehe ipv4_send_batch). Nicht fragmentiert: die Nutzdaten
+ * jeder Nachricht sind auf MTU - IPv4- und UDP-Header begrenzt.
+ *
+ * @param sock Der sendende Socket.
+ * @param msgs Die Nachrichten; status wird fr jede gesetzt.
+ * @param count Die Anzahl der Nachrichten.
+ * @return Die Anzahl der eingereihten Nachrichten; -1 bei ungltigem Socket.
+ */
+int udp_sendmmsg(int sock, udp_msg* msgs, uint8_t count) {
+	udp_header headers[TXQ_DEPTH];
+	ipv4_datagram dgrams[TXQ_DEPTH];
+	int sent = 0;
+	
+	if (sock < 0 || sock >= UDP_SOCKETS || !sockets->sockets[sock].in_use) {
+		return -1;
+	}
+	udp_socket* s = &sockets->sockets[sock];
+	
+	for (uint16_t first = 0; first < count; first += TXQ_DEPTH) {
+		uint8_t n = (count - first > TXQ_DEPTH) ? TXQ_DEPTH : count - first;
+		
+		for (uint8_t k = 0; k < n; k++) {
+			udp_msg* m = &msgs[first + k];
+			udp_header* header = &headers[k];
+			
+			header->src = s->lport;
+			header->dest = m->dport;
+			header->length = swapEndian16(sizeof(udp_header) + m->len);
+			
+			uint32_t sum = ipv4_pseudo_checksum(m->dst, UDP_TYPE, sizeof(udp_header) + m->len);
+			sum = checksum_partial(header, sizeof(udp_header) - sizeof(header->checksum), sum);
+			sum = checksum_partial(m->data, m->len, sum);
+			header->checksum = ~checksum_fold(sum);
+			if (header->checksum == 0) {
+				header->checksum = 0xFFFF;
+			}
+			
+			dgrams[k].dst = m->dst;
+			dgrams[k].prtcl = UDP_TYPE;
+			dgrams[k].header = (uint8_t*)header;
+			dgrams[k].header_len = sizeof(udp_header);
+			dgrams[k].payload = m->data;
+			dgrams[k].payload_len = m->len;
+		}
+		
+		sent += ipv4_send_batch(dgrams, n, s->prio);
+		for (uint8_t k = 0; k < n; k++) {
+			msgs[first + k].status = dgrams[k].status;
+		}
+	}
+	return sent;
+}
+
+
+/**
+ * Beginnt ein Datagramm direkt im bertragungspuffer des ENC28J60 (ohne Kopie im RAM).
+ * Die Nutzdaten werden mit udp_write in beliebig vielen Teilen geschrieben, die Prfsumme luft
+ * dabei mit. udp_commit ergnzt UDP-, IPv4- und MAC-Header und reiht den Frame ein.
+ * Zwischen udp_alloc und udp_commit darf nichts anderes gesendet werden.
+ *
+ * @param sock Der sendende Socket (lokaler Port und Priorittsklasse).
+ * @param dst Die Zieladresse.
+ * @param dport Der Zielport (Little Endian).
+ * @param max_len Die Obergrenze der Nutzdaten (hchstens MTU - IPv4- und UDP-Header, keine Fragmentierung).
+ * @return 1, wenn das Datagramm begonnen wurde; 0, wenn der nchste Hop noch per ARP aufgelst
+ *         wird (spter erneut versuchen); -1 bei ungltigem Socket, zu groem max_len oder fehlender Route.
+ */
+int udp_alloc(int sock, ip_address dst, uint16_t dport, uint16_t max_len) {
+	udp_writer* w = &sockets->tx;
+	
+	if (sock < 0 || sock >= UDP_SOCKETS || !sockets->sockets[sock].in_use || w->active) {
+		return -1;
+	}
+	if (max_len > IPV4_MTU - sizeof(ipv4_header) - sizeof(udp_header)) {
+		return -1;
+	}
+	
+	int result = ipv4_begin(dst, UDP_TYPE, sizeof(udp_header) + max_len, sockets->sockets[sock].prio);
+	if (result <= 0) {
+		return result;
+	}
+	// Der UDP-Header folgt mit udp_commit, die Nutzdaten beginnen direkt dahinter
+	txq_seek(sizeof(mac_header) + sizeof(ipv4_header) + sizeof(udp_header));
+	
+	w->dst = dst;
+	w->dport = dport;
+	w->sock = sock;
+	w->len = 0;
+	w->max_len = max_len;
+	w->sum = 0;
+	w->active = 1;
+	return 1;
+}
+
+
+/**
+ * Hngt Nutzdaten an das mit udp_alloc begonnene Datagramm an und fhrt die Prfsumme fort.
+ * Die Teile drfen beliebig (auch ungerade) lang sein.
+ *
+ * @param data Ein Pointer auf die Daten.
+ * @param len Die Lnge der Daten.
+ * @return Die Anzahl der geschriebenen Bytes (weniger als len, wenn max_len erreicht ist).
+ */
+uint16_t udp_write(const uint8_t* data, uint16_t len) {
+	udp_writer* w = &sockets->tx;
+	
+	if (!w->active) {
+		return 0;
+	}
+	if (len > w->max_len - w->len) {
+		len = w->max_len - w->len;
+	}
+	
+	txq_write(len, data);
+	w->sum = checksum_stream(data, len, w->len, w->sum);
+	w->len += len;
+	return len;
+}
+
+
+/**
+ * Schliet das mit udp_alloc begonnene Datagramm ab: der UDP-Header mit der Prfsumme ber
+ * Pseudo-Header, Header und die mitgelaufene Summe der Nutzdaten wird per wahlfreiem Zugriff
+ * vor die Nutzdaten geschrieben, anschlieend ergnzt ipv4_commit die brigen Header.
+ *
+ * @return 1, wenn das Datagramm eingereiht wurde; -1, wenn keines begonnen wurde.
+ */
+int udp_commit(void) {
+	udp_writer* w = &sockets->tx;
+	udp_header header;
+	
+	if (!w->active) {
+		return -1;
+	}
+	header.src = sockets->sockets[w->sock].lport;
+	header.dest = w->dport;
+	header.length = swapEndian16(sizeof(udp_header) + w->len);
+	
+	uint32_t sum = ipv4_pseudo_checksum(w->dst, UDP_TYPE, sizeof(udp_header) + w->len);
+	sum = checksum_partial(&header, sizeof(udp_header) - sizeof(header.checksum), sum);
+	header.checksum = ~checksum_fold(sum + checksum_fold(w->sum));
+	if (header.checksum == 0) {
+		header.checksum = 0xFFFF;
+	}
+	
+	txq_patch(sizeof(mac_header) + sizeof(ipv4_header), sizeof(header), (uint8_t*)&header);
+	ipv4_commit(sizeof(udp_header) + w->len);
+	w->active = 0;
+	return 1;
+}
+
+
+/**
+ * Verwirft das mit udp_alloc begonnene Datagramm.
+ */
+void udp_abort(void) {
+	if (sockets->tx.active) {
+		ipv4_abort();
+		sockets->tx.active = 0;
+	}
+}
+
+
+/**
+ * Legt die Priorittsklasse (und damit den DSCP) fest, mit der ein Socket sendet.
+ *
+ * @param sock Der Socket.
+ * @param prio Die Priorittsklasse (TXQ_PRIO_*).
+ */
+void udp_set_priority(int sock, uint8_t prio) {
+	if (sock >= 0 && sock < UDP_SOCKETS) {
+		sockets->sockets[sock].prio = prio;
+	}
+}
+
+
+/**
+ * Legt fest, wie ein Socket die Prfsumme empfangener Datagramme behandelt.
+ *
+ * @param sock Der Socket.
+ * @param policy UDP_CSUM_VERIFY, UDP_CSUM_ZERO_OK oder UDP_CSUM_TRUST.
+ */
+void udp_set_checksum_policy(int sock, uint8_t policy) {
+	if (sock >= 0 && sock < UDP_SOCKETS && policy <= UDP_CSUM_TRUST) {
+		sockets->sockets[sock].csum_policy = policy;
+	}
+}
+
+
+/**
+ * Liefert die Zhler eines Sockets.
+ *
+ * @param sock Der Socket.
+ * @return Ein Pointer auf die Statistik (nur lesend verwenden); NULL bei ungltigem Socket.
+ */
+const udp_socket_stats* udp_get_stats(int sock) {
+	if (sock < 0 || sock >= UDP_SOCKETS) {
+		return NULL;
+	}
+	return &sockets->sockets[sock].stats;
+}
+
+
+/**
+ * Legt ein Datagramm im Empfangsring eines Sockets ab. Der Ring hlt nur eine Referenz auf den
+ * Empfangspuffer. Es wird nur eingereiht, wenn danach noch ein Puffer fr den nchsten Empfang
+ * frei bleibt; Datagramme aus zusammengesetzten Fragmenten liegen nicht im Pool und werden kopiert.
+ *
+ * @param s Der Socket.
+ * @param buf Der Frame.
+ * @param length Die Lnge des Frames.
+ * @param offset Der Beginn der Nutzdaten.
+ * @param len Die Lnge der Nutzdaten.
+ * @param src Die Absenderadresse.
+ * @param sport Der Absenderport (Little Endian).
+ */
+static void udp_enqueue(udp_socket* s, const uint8_t* buf, uint16_t length, uint16_t offset, uint16_t len, ip_address src, uint16_t sport) {
+	if (s->count >= UDP_RING_SIZE) {
+		s->stats.dropped_full++;
+		return;
+	}
 	
-	if (serivces->idx + 1 < UDP_SERVICES_SIZE){
-		serivces->idx = serivces->idx + 1;
+	pbuf* p = pbuf_from_data(buf);
+	if (p != NULL && pbuf_available() > 0) {
+		pbuf_ref(p);
+	} else if (p == NULL && pbuf_available() > 1 && length <= PBUF_SIZE) {
+		p = pbuf_alloc();
+		for (uint16_t i = 0; i < length; i++) {
+			p->data[i] = buf[i];
+		}
+		p->len = length;
+	} else {
+		s->stats.dropped_nobuf++;
+		return;
 	}
+	
+	udp_datagram* d = &s->ring[(s->head + s->count) % UDP_RING_SIZE];
+	d->buf = p;
+	d->offset = offset;
+	d->len = len;
+	d->src = src;
+	d->sport = sport;
+	s->count++;
+	s->stats.received++;
 }
 
 
+/**
+ * Prft die Prfsumme eines empfangenen Datagramms nach der Richtlinie des Sockets. Den Teil hinter
+ * den Headern hat enc28_packetReceive bereits beim Lesen ber SPI summiert (udp_rx_sum_wanted); im
+ * RAM wird dann nur noch der vordere Teil summiert. Sonst, z.B. fr zusammengesetzte Fragmente,
+ * wird vollstndig gerechnet.
+ *
+ * @param s Der Socket.
+ * @param buf Der Frame.
+ * @param offset Der Beginn des UDP-Headers.
+ * @param udp_length Die Lnge aus dem UDP-Header.
+ * @return 1, wenn das Datagramm angenommen wird; 0, wenn es verworfen wird.
+ */
+static int udp_verify(udp_socket* s, const uint8_t* buf, uint16_t offset, uint16_t udp_length) {
+	const ipv4_header* ip = (const ipv4_header*)(buf + sizeof(mac_header));
+	uint16_t check = buf[offset + 6] | (buf[offset + 7] << 8);
+	uint16_t end = offset + udp_length;
+	
+	if (s->csum_policy == UDP_CSUM_TRUST) {
+		return 1;
+	}
+	if (check == 0) {
+		s->stats.no_checksum++;
+		return s->csum_policy == UDP_CSUM_ZERO_OK;
+	}
+	
+	uint32_t sum = checksum_pseudo(ip->src, ip->dst, UDP_TYPE, udp_length);
+	const enc28_rx_sum* rx = enc28_packetSum(buf);
+	if (rx != NULL && rx->to == end && rx->from >= offset) {
+		// Vorderer Teil aus dem RAM (gerade Lnge, da UDP-Header und from gerade liegen), Rest vom Empfang
+		sum = checksum_partial(buf + offset, rx->from - offset, sum) + rx->sum;
+	} else {
+		sum = checksum_partial(buf + offset, udp_length, sum);
+	}
+	
+	if (checksum_fold(sum) != 0xFFFF) {
+		s->stats.bad_checksum++;
+		return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * Entscheidet anhand der ersten Bytes eines Frames, ob enc28_packetReceive den Rest beim Lesen
+ * summieren soll (siehe enc28_setRxSumFilter). Das lohnt nur fr unfragmentierte Datagramme mit
+ * Prfsumme an einen Socket, der sie auch prft; alle anderen Frames werden ohne Summe gelesen.
+ *
+ * @param header Die ersten Bytes des Frames.
+ * @param len Die Anzahl der gelesenen Bytes (hchstens ENC28_PEEK_SIZE).
+ * @return 1, wenn summiert werden soll; sonst 0.
+ */
+static int udp_rx_sum_wanted(const uint8_t* header, uint16_t len) {
+	const uint8_t* ip = header + sizeof(mac_header);
+	
+	// IPv4, UDP, kein Fragment (MF und Fragment-Offset 0)
+	if (len < sizeof(mac_header) + sizeof(ipv4_header) || header[12] != 0x08 || header[13] != 0x00
+			|| ip[9] != UDP_TYPE || (ip[6] & 0x3F) != 0 || ip[7] != 0) {
+		return 0;
+	}
+	uint16_t offset = sizeof(mac_header) + (ip[0] & 0x0F) * 4;
+	if (offset + sizeof(udp_header) > len || (header[offset + 6] == 0 && header[offset + 7] == 0)) {
+		return 0;
+	}
+	
+	int sock = udp_find((header[offset + 2] << 8) | header[offset + 3], NULL);
+	if (sock < 0) {
+		sock = (sockets->wildcard != UDP_NO_SOCKET) ? sockets->wildcard : -1;
+	}
+	return sock >= 0 && sockets->sockets[sock].csum_policy != UDP_CSUM_TRUST;
+}
+
 
 /**
- * Verarbeitet ein eingehendes UDP-Paket und ruft die entsprechende registrierte Funktion fr den lokalen Port auf.
+ * Verarbeitet ein eingehendes UDP-Paket und stellt es dem Socket des Zielports zu
+ * (Handler oder Empfangsring). Die UDP-Lnge wird hier einmal gegen den Frame geprft; Handler
+ * erhalten Nutzdatenlnge, Absenderadresse und -port und lesen keine Header-Felder selbst.
  *
  * @param buf Ein Pointer auf den UDP-Paketdatenbereich.
  * @param length Die Lnge des UDP-Pakets.
+ * @param offset Der Beginn des UDP-Headers im Puffer (hinter eventuellen IP-Optionen).
  * @return 0, wenn die Verarbeitung erfolgreich war; andernfalls 1.
  */
-int handle_udp(const uint8_t* buf, uint16_t length) {
-	// Extrahiert den UDP-Zielport aus dem Paket
-	uint16_t lport = (buf[36]  + (buf[37] << 8));
+int handle_udp(const uint8_t* buf, uint16_t length, uint16_t offset) {
+	if (length < offset + sizeof(udp_header)) {
+		return 1;
+	}
+	// Extrahiert den UDP-Zielport (Host-Byte-Order, Schlssel des Index) und die Lnge aus dem Paket
+	uint16_t port = (buf[offset + 2] << 8) | buf[offset + 3];
+	uint16_t udp_length = (buf[offset + 4] << 8) | buf[offset + 5];
+	if (udp_length < sizeof(udp_header) || offset + udp_length > length) {
+		return 1;
+	}
+	uint16_t len = udp_length - sizeof(udp_header);
+	uint16_t sport = buf[offset] | (buf[offset + 1] << 8);
+	ip_address src = *(ip_address*)(buf + sizeof(mac_header) + 12);
 	
-	// Durchluft die UDP-Services, um eine bereinstimmung fr den lokalen Port zu finden
-	for(uint8_t i = 0; i < UDP_SERVICES_SIZE; i++) { 
-		if (lport == serivces->serivces[i].lport){
-			
+	// Socket des Zielports per binrer Suche, sonst der Wildcard-Socket
+	int sock = udp_find(port, NULL);
+	if (sock < 0 && sockets->wildcard != UDP_NO_SOCKET) {
+		sock = sockets->wildcard;
+	}
+	if (sock >= 0) {
+		udp_socket* s = &sockets->sockets[sock];
+		
+		if (!udp_verify(s, buf, offset, udp_length)) {
+			return 1;
+		}
+		if (s->func != NULL) {
+			s->stats.received++;
 			// Ruft die Handler-Funktion fr den identifizierten lokalen Port auf
-			return serivces->serivces[i].func(buf, length);
+			return s->func(buf, offset + sizeof(udp_header), len, src, sport);
 		}
+		udp_enqueue(s, buf, length, offset + sizeof(udp_header), len, src, sport);
+		return 0;
 	}
-	// Kein passender Service fr den UDP-Zielport gefunden
+	// Kein passender Socket fr den UDP-Zielport gefunden
+	sockets->no_socket++;
 	return 1;
 }
 
+/**
+ * Sendet ein UDP-Datagramm. Header und Nutzdaten werden getrennt an ipv4_send bergeben, das
+ * Datagramm darf daher grer als die MTU sein und wird bei Bedarf fragmentiert.
+ *
+ * @param dst Die Ziel-IP-Adresse.
+ * @param sport Der lokale Port (Little Endian, wie bei udp_add_type).
+ * @param dport Der Zielport (Little Endian).
+ * @param payload Ein Pointer auf die Nutzdaten.
+ * @param len Die Lnge der Nutzdaten.
+ * @param prio Die Priorittsklasse (TXQ_PRIO_*), bestimmt auch den DSCP.
+ * @return Der Rckgabewert von ipv4_send (1 gesendet, 0 ARP-Auflsung luft, -1 verworfen).
+ */
+int udp_send(ip_address dst, uint16_t sport, uint16_t dport, const uint8_t* payload, uint16_t len, uint8_t prio) {
+	udp_header header;
+	
+	if (len > 0xFFFF - sizeof(udp_header)) {
+		return -1;
+	}
+	header.src = sport;
+	header.dest = dport;
+	header.length = swapEndian16(sizeof(udp_header) + len);
+	
+	// Prfsumme vorab ber Pseudo-Header, Header und Nutzdaten (die Nutzdaten werden nicht kopiert)
+	uint32_t sum = ipv4_pseudo_checksum(dst, UDP_TYPE, sizeof(udp_header) + len);
+	sum = checksum_partial(&header, sizeof(udp_header) - sizeof(header.checksum), sum);
+	sum = checksum_partial(payload, len, sum);
+	header.checksum = ~checksum_fold(sum);
+	if (header.checksum == 0) {
+		header.checksum = 0xFFFF;
+	}
+	
+	return ipv4_send(dst, UDP_TYPE, (uint8_t*)&header, sizeof(header), payload, len, prio);
+}
+
 /**
  * Berechnet die UDP-Prfsumme unter Verwendung des Pseudo-Headers, des UDP-Headers und der Payload.
+ * Das Prfsummenfeld des Headers wird dabei nicht mitgezhlt.
  *
  * @param ip_header Ein Pointer auf den IPv4-Header.
- * @param udp_header Ein Pointer auf den UDP-Header.
+ * @param header Ein Pointer auf den UDP-Header.
  * @param payload Ein Pointer auf die Payload.
  * @param payload_size Die Gre der Payload in Bytes.
- * @return Die berechnete UDP-Prfsumme.
- */
-uint16_t udp_checksum(ipv4_header *ip_header, udp_header *udp_header, uint8_t *payload, size_t payload_size) {
-    // Pseudoheader fr die Checksummenberechnung
-    struct {
-        uint32_t src;
-        uint32_t dst;
-        uint8_t reserved;
-        uint8_t protocol;
-        uint16_t udp_length;
-    } pseudoheader;
-
-		// Flle den Pseudo-Header mit Informationen (SRC & DST IPv4)
-    pseudoheader.src = (uint32_t)(ip_header->src.octet[0]) << 24 |
-                      (uint32_t)(ip_header->src.octet[1]) << 16 |
-                      (uint32_t)(ip_header->src.octet[2]) << 8 |
-                      (uint32_t)(ip_header->src.octet[3]);
-
-    pseudoheader.dst = (uint32_t)(ip_header->dst.octet[0]) << 24 |
-                      (uint32_t)(ip_header->dst.octet[1]) << 16 |
-                      (uint32_t)(ip_header->dst.octet[2]) << 8 |
-                      (uint32_t)(ip_header->dst.octet[3]);
-
-    pseudoheader.reserved = 0;
-    pseudoheader.protocol = ip_header->prtcl;
-    pseudoheader.udp_length = (sizeof(udp_header) + payload_size);
-
-    // Checksummenberechnung
-    uint32_t sum = 0;
-
-    // Pseudoheader
-    sum += (pseudoheader.src >> 16) + (pseudoheader.src & 0xFFFF);
-    sum += (pseudoheader.dst >> 16) + (pseudoheader.dst & 0xFFFF);
-    sum += pseudoheader.reserved;
-    sum += pseudoheader.protocol;
-    sum += pseudoheader.udp_length;
-
-    // UDP-Header
-    sum += (udp_header->src >> 8) + ((udp_header->src & 0xFF) << 8);
-    sum += (udp_header->dest >> 8) + ((udp_header->dest & 0xFF) << 8);
-    sum += (udp_header->length >> 8) + ((udp_header->length & 0xFF) << 8);
-    sum += udp_header->checksum;
-
-    // Payload
-    for (size_t i = 0; i < payload_size / 2; i++) {
-        sum += (payload[i * 2] << 8) + payload[i * 2 + 1];
-        while (sum >> 16) {
-            sum = (sum & 0xFFFF) + (sum >> 16);
-        }
-    }
-
-    // Abschlieende Bitumkehr und Rckgabe der Checksumme
-    return (uint16_t)~sum - 4; // (CRC)
-}
-
+ * @return Die berechnete UDP-Prfsumme, direkt in das Prfsummenfeld schreibbar.
+ */
+uint16_t udp_checksum(ipv4_header *ip_header, udp_header *header, uint8_t *payload, size_t payload_size) {
+	uint32_t sum = checksum_pseudo(ip_header->src, ip_header->dst, ip_header->prtcl, sizeof(udp_header) + payload_size);
+	
+	// UDP-Header ohne Prfsummenfeld, danach die Payload
+	sum = checksum_partial(header, sizeof(udp_header) - sizeof(header->checksum), sum);
+	sum = checksum_partial(payload, payload_size, sum);
+	
+	uint16_t check = ~checksum_fold(sum);
+	// 0 bedeutet "keine Prfsumme" und wird als 0xFFFF bertragen
+	return check ? check : 0xFFFF;
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+/* Includes ------------------------------------------------------------------*/
+#include <time.h>
+#include "stub.h"
+#include "checksum.h"
+
+/* Defines ------------------------------------------------------------------*/
+#define ROUNDS 200000
+#define LENGTH 1480 // Nutzdaten eines vollen Frames
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t data[LENGTH + 4];
+static uint8_t copy[LENGTH + 4];
+static volatile uint32_t sink; // Verhindert, dass der Compiler die Schleifen entfernt
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * Die frhere Schleife aus icmp.c/dhcp.c: 16-Bit-Zugriffe, bertrge in jedem Schritt gefaltet.
+ */
+static uint16_t calculate_checksum(const uint8_t* p, uint16_t length) {
+	uint32_t sum = 0;
+
+	for (uint16_t i = 0; i + 1 < length; i += 2) {
+		sum += p[i] | (p[i + 1] << 8);
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+	if (length & 1) {
+		sum += p[length - 1];
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+	return (uint16_t)~sum;
+}
+
+
+static double seconds(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+static void report(const char* name, double start) {
+	double t = seconds() - start;
+	printf("  %-28s %8.1f ns/Frame %8.0f MB/s\n", name, t * 1e9 / ROUNDS, (double)ROUNDS * LENGTH / t / 1e6);
+}
+
+
+int main(void) {
+	for (uint16_t i = 0; i < sizeof(data); i++) {
+		data[i] = i * 31 + 7;
+	}
+	printf("bench_checksum: %d Bytes, %d Durchlufe (Host, nur als Vergleich)\n", LENGTH, ROUNDS);
+
+	for (uint8_t offset = 0; offset < 2; offset++) {
+		printf(" Ausrichtung +%u\n", offset);
+		double start = seconds();
+		for (uint32_t i = 0; i < ROUNDS; i++) {
+			sink += calculate_checksum(data + offset, LENGTH);
+		}
+		report("bisher (calculate_checksum)", start);
+
+		start = seconds();
+		for (uint32_t i = 0; i < ROUNDS; i++) {
+			sink += checksum(data + offset, LENGTH);
+		}
+		report("checksum", start);
+
+		start = seconds();
+		for (uint32_t i = 0; i < ROUNDS; i++) {
+			sink += checksum_copy(copy + offset, data + offset, LENGTH, 0);
+		}
+		report("checksum_copy", start);
+	}
+	return 0;
+}
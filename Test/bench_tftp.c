@@ -0,0 +1,447 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include "stub.h"
+#include "tftp.h"
+#include "route.h"
+#include "txq.h"
+#include "ipv4_frag.h"
+
+/* Defines ------------------------------------------------------------------*/
+// Simulierte bertragung: virtuelle Zeit in s, 10 Mbit/s je Richtung, feste Laufzeit
+#define FILE_SIZE (256 * 1024 + 300)
+#define LINK_NS_PER_BYTE 800
+#define STEP_US 20 // Takt der Hauptschleife
+#define QUEUE_SIZE 1024
+#define PEER_TIMEOUT_US 1000000
+#define PEER_TID 0x3930 // Little Endian
+
+typedef struct {
+	uint64_t time; // Ankunft in s
+	uint8_t to_peer;
+	uint16_t len;
+	uint8_t data[1600];
+} packet;
+
+/* Private variables ---------------------------------------------------------*/
+static ether_types eth_types;
+static prtcl_types prot_types;
+static arp_table table;
+static route_table routing;
+static route_cache routes;
+static txq_queues txq;
+static pbuf_pool pbufs;
+static udp_sockets sockets;
+static ipv4_frag_pool frags;
+static tftp_session tftp;
+
+static ip_address my_ip = {{192, 168, 1, 10}};
+static ip_address my_subnet = {{255, 255, 255, 0}};
+static ip_address peer_ip = {{192, 168, 1, 2}};
+static mac_address my_mac = {{0xB8, 0x37, 0x4A, 0x04, 0x20, 0x0B}};
+static mac_address peer_mac = {{0x02, 0x01, 0x01, 0x01, 0x01, 0x01}};
+
+// Strecke
+static uint64_t now_us;
+static uint64_t one_way_us; // Halbe RTT
+static uint32_t loss_permille; // Verlust von DATA-Paketen an das Gert
+static uint64_t link_free[2]; // Ende der laufenden bertragung je Richtung
+static packet queue[QUEUE_SIZE]; // Nach Ankunftszeit sortiert
+static uint16_t queued;
+static uint32_t seed = 1;
+
+// Senke: Flash-Nachbildung, die je 2 KB flash_us_per_2k lang beschftigt ist
+static uint8_t image[FILE_SIZE + TFTP_BUF_SIZE];
+static uint32_t written;
+static uint64_t busy_until;
+static uint64_t flash_us_per_2k = 10000;
+static int closed;
+
+// Gegenstelle (sendet die Datei)
+static uint16_t my_tid;
+static uint8_t peer_options; // 1 = die Gegenstelle beantwortet Optionen mit OACK
+static uint16_t blksize;
+static uint16_t windowsize;
+static uint32_t blocks;
+static uint32_t acked;
+static uint64_t last_send;
+static uint8_t finished;
+static uint16_t ident;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint8_t pattern(uint32_t i) {
+	return (uint8_t)(i * 131 + (i >> 9));
+}
+
+
+/* Strecke -------------------------------------------------------------------*/
+
+/**
+ * Reiht ein Paket mit Serialisierung und Laufzeit ein; DATA an das Gert geht mit loss_permille verloren.
+ */
+static void link_send(uint8_t to_peer, const uint8_t* data, uint16_t len, uint8_t lossy) {
+	uint64_t start = (now_us > link_free[to_peer]) ? now_us : link_free[to_peer];
+	uint64_t arrival = start + (uint64_t)(len + 24) * LINK_NS_PER_BYTE / 1000;
+
+	link_free[to_peer] = arrival;
+	seed = seed * 1103515245 + 12345;
+	if (lossy && ((seed >> 16) % 1000) < loss_permille) {
+		return;
+	}
+	if (queued >= QUEUE_SIZE) {
+		printf("  Warteschlange der Strecke voll\n");
+		return;
+	}
+	arrival += one_way_us;
+
+	uint16_t i = queued++;
+	while (i > 0 && queue[i - 1].time > arrival) {
+		queue[i] = queue[i - 1];
+		i--;
+	}
+	queue[i].time = arrival;
+	queue[i].to_peer = to_peer;
+	queue[i].len = len;
+	memcpy(queue[i].data, data, len);
+}
+
+
+static void device_transmit(const uint8_t* frame, uint16_t len) {
+	link_send(1, frame, len, 0);
+}
+
+
+/* Senke ---------------------------------------------------------------------*/
+
+static int sink_open(const char* name) {
+	written = 0;
+	closed = -1;
+	return 0;
+}
+
+static int sink_write(uint32_t offset, const uint8_t* data, uint16_t len) {
+	memcpy(image + offset, data, len);
+	if (offset + len > written) {
+		written = offset + len;
+	}
+	busy_until = now_us + flash_us_per_2k * len / 2048;
+	return 0;
+}
+
+static int sink_busy(void) {
+	return now_us < busy_until;
+}
+
+static void sink_close(int ok) {
+	closed = ok;
+}
+
+static const tftp_sink sink = {sink_open, sink_write, sink_busy, sink_close};
+
+
+/* Gegenstelle ---------------------------------------------------------------*/
+
+/**
+ * Sendet ein UDP-Datagramm der Gegenstelle an das Gert (mit gltigen Prfsummen).
+ */
+static void peer_send(const uint8_t* payload, uint16_t len, uint16_t sport, uint16_t dport, uint8_t lossy) {
+	uint8_t frame[1600] = {0};
+	uint8_t* ip = frame + sizeof(mac_header);
+	uint8_t* udp = ip + sizeof(ipv4_header);
+	uint16_t udp_length = sizeof(udp_header) + len;
+	uint16_t total_length = sizeof(ipv4_header) + udp_length;
+
+	memcpy(frame, my_mac.octet, 6);
+	memcpy(frame + 6, peer_mac.octet, 6);
+	frame[12] = 0x08;
+	ip[0] = 0x45;
+	ip[2] = total_length >> 8;
+	ip[3] = total_length & 0xFF;
+	ip[4] = ident >> 8;
+	ip[5] = ident++ & 0xFF;
+	ip[8] = 64;
+	ip[9] = UDP_TYPE;
+	memcpy(ip + 12, peer_ip.octet, 4);
+	memcpy(ip + 16, my_ip.octet, 4);
+	uint16_t check = checksum(ip, sizeof(ipv4_header));
+	ip[10] = check & 0xFF;
+	ip[11] = check >> 8;
+
+	udp[0] = sport & 0xFF;
+	udp[1] = sport >> 8;
+	udp[2] = dport & 0xFF;
+	udp[3] = dport >> 8;
+	udp[4] = udp_length >> 8;
+	udp[5] = udp_length & 0xFF;
+	memcpy(udp + sizeof(udp_header), payload, len);
+	uint32_t sum = checksum_pseudo(peer_ip, my_ip, UDP_TYPE, udp_length);
+	check = ~checksum_fold(checksum_partial(udp, udp_length, sum));
+	udp[6] = (check == 0) ? 0xFF : check & 0xFF;
+	udp[7] = (check == 0) ? 0xFF : check >> 8;
+
+	uint16_t frame_length = sizeof(mac_header) + total_length;
+	link_send(0, frame, (frame_length < 60) ? 60 : frame_length, lossy);
+}
+
+
+static void peer_data(uint32_t block) {
+	uint8_t data[4 + 1600];
+	uint32_t offset = (block - 1) * blksize;
+	uint16_t n = (offset + blksize <= FILE_SIZE) ? blksize : FILE_SIZE - offset;
+
+	data[0] = 0;
+	data[1] = TFTP_DATA;
+	data[2] = block >> 8;
+	data[3] = block & 0xFF;
+	for (uint16_t i = 0; i < n; i++) {
+		data[4 + i] = pattern(offset + i);
+	}
+	peer_send(data, 4 + n, PEER_TID, my_tid, 1);
+}
+
+
+static void peer_window(uint32_t from) {
+	for (uint32_t block = from; block < from + windowsize && block <= blocks; block++) {
+		peer_data(block);
+	}
+	last_send = now_us;
+}
+
+
+/**
+ * Liest die Optionen einer Anfrage bzw. eines OACK (Name und Wert als nullterminierte Strings).
+ */
+static void peer_options_parse(const uint8_t* p, const uint8_t* end) {
+	while (p < end && *p) {
+		const char* name = (const char*)p;
+		p += strlen(name) + 1;
+		int value = atoi((const char*)p);
+		p += strlen((const char*)p) + 1;
+		if (strcmp(name, "blksize") == 0) {
+			blksize = value;
+		} else if (strcmp(name, "windowsize") == 0) {
+			windowsize = value;
+		}
+	}
+}
+
+
+/**
+ * Verarbeitet ein Paket des Gerts: RRQ (Gert als Client), OACK (Gert als Server nach WRQ), ACK, ERROR.
+ */
+static void peer_receive(const uint8_t* frame, uint16_t len) {
+	const uint8_t* udp = frame + sizeof(mac_header) + sizeof(ipv4_header);
+	const uint8_t* p = udp + sizeof(udp_header);
+	const uint8_t* end = udp + ((udp[4] << 8) | udp[5]);
+	uint16_t sport = udp[0] | (udp[1] << 8);
+	uint16_t opcode = (p[0] << 8) | p[1];
+
+	if (opcode == TFTP_RRQ) {
+		my_tid = sport;
+		p += 2;
+		p += strlen((const char*)p) + 1; // Dateiname
+		p += strlen((const char*)p) + 1; // Modus
+		blksize = TFTP_BLKSIZE_DEFAULT;
+		windowsize = 1;
+		if (peer_options) {
+			peer_options_parse(p, end);
+		}
+		blocks = FILE_SIZE / blksize + 1;
+		acked = 0;
+		if (peer_options) {
+			uint8_t oack[64];
+			uint16_t k = 2;
+			oack[0] = 0;
+			oack[1] = TFTP_OACK;
+			k += sprintf((char*)oack + k, "blksize") + 1;
+			k += sprintf((char*)oack + k, "%u", blksize) + 1;
+			k += sprintf((char*)oack + k, "windowsize") + 1;
+			k += sprintf((char*)oack + k, "%u", windowsize) + 1;
+			peer_send(oack, k, PEER_TID, my_tid, 0);
+			last_send = now_us;
+		} else {
+			peer_window(1);
+		}
+	} else if (opcode == TFTP_OACK) {
+		my_tid = sport;
+		peer_options_parse(p + 2, end);
+		blocks = FILE_SIZE / blksize + 1;
+		acked = 0;
+		peer_window(1);
+	} else if (opcode == TFTP_ACK) {
+		if (my_tid == 0) {
+			my_tid = sport;
+		}
+		// Blocknummern laufen nach 65535 ber
+		uint32_t ack = (acked & ~0xFFFFu) | ((p[2] << 8) | p[3]);
+		if (ack + 0x8000 < acked) {
+			ack += 0x10000;
+		}
+		if (ack >= blocks) {
+			finished = 1;
+		} else if (ack >= acked) {
+			acked = ack;
+			peer_window(ack + 1);
+		}
+	} else if (opcode == TFTP_ERROR) {
+		printf("  Gegenstelle: ERROR %u %s\n", (p[2] << 8) | p[3], (const char*)(p + 4));
+		finished = 1;
+	}
+}
+
+
+/* Ablauf --------------------------------------------------------------------*/
+
+/**
+ * Luft bis zum Ende der bertragung: Pakete zustellen, Hauptschleife des Gerts, Timeout der Gegenstelle.
+ *
+ * @return Der Endzustand (TFTP_DONE oder TFTP_FAILED); -1 bei Zeitberschreitung der Simulation.
+ */
+static int run_transfer(void) {
+	uint64_t limit = now_us + 600000000ULL;
+	uint8_t started = 0;
+
+	while (now_us < limit) {
+		while (queued > 0 && queue[0].time <= now_us) {
+			packet* k = &queue[0];
+			if (k->to_peer) {
+				peer_receive(k->data, k->len);
+			} else {
+				eth_handler(k->data, k->len);
+			}
+			queued--;
+			memmove(&queue[0], &queue[1], queued * sizeof(packet));
+		}
+		stub_tick = now_us / 1000;
+		tftp_tick();
+		txq_poll();
+		if (!finished && blocks != 0 && now_us - last_send >= PEER_TIMEOUT_US) {
+			peer_window(acked + 1);
+		}
+
+		uint8_t state = tftp_get_state();
+		started |= (state == TFTP_TRANSFER);
+		if (started && (state == TFTP_DONE || state == TFTP_FAILED)) {
+			return state;
+		}
+		now_us += STEP_US;
+	}
+	return -1;
+}
+
+
+static void reset(void) {
+	queued = 0;
+	now_us += 5000000;
+	stub_tick = now_us / 1000;
+	link_free[0] = 0;
+	link_free[1] = 0;
+	memset(image, 0, sizeof(image));
+	finished = 0;
+	blocks = 0;
+	acked = 0;
+	my_tid = 0;
+}
+
+
+/**
+ * Gibt Dauer und Durchsatz aus und prft den Inhalt der Senke.
+ *
+ * @return 0, wenn die Datei vollstndig und unverndert angekommen ist.
+ */
+static int report(const char* name, int state) {
+	const tftp_stats* s = tftp_get_stats();
+	uint32_t wrong = 0;
+
+	for (uint32_t i = 0; i < FILE_SIZE; i++) {
+		wrong += image[i] != pattern(i);
+	}
+	int ok = state == TFTP_DONE && written == FILE_SIZE && wrong == 0 && closed == 1;
+	printf("  %-34s blksize %4u window %2u: %6lu ms %7.1f KB/s, Timeouts %lu, Stalls %lu, %s\n",
+			name, blksize, windowsize, (unsigned long)s->duration, (double)s->bytes / 1.024 / (s->duration ? s->duration : 1),
+			(unsigned long)s->timeouts, (unsigned long)s->stalls, ok ? "ok" : "FEHLER");
+	return !ok;
+}
+
+
+/**
+ * Gert als Client: tftp_get gegen eine Gegenstelle mit bzw. ohne Optionen (ohne = Lock-Step mit 512 Bytes).
+ */
+static int run_get(const char* name, uint8_t options) {
+	reset();
+	peer_options = options;
+	tftp_get(peer_ip, "fw.bin", &sink);
+	return report(name, run_transfer());
+}
+
+
+/**
+ * Gert als Server: die Gegenstelle sendet einen WRQ, mit blksize/windowsize oder ohne Optionen.
+ */
+static int run_put(const char* name, uint16_t request_blksize, uint16_t request_windowsize) {
+	uint8_t wrq[64];
+	uint16_t k = 2;
+
+	reset();
+	wrq[0] = 0;
+	wrq[1] = TFTP_WRQ;
+	k += sprintf((char*)wrq + k, "fw.bin") + 1;
+	k += sprintf((char*)wrq + k, "octet") + 1;
+	blksize = TFTP_BLKSIZE_DEFAULT;
+	windowsize = 1;
+	if (request_blksize != 0) {
+		k += sprintf((char*)wrq + k, "blksize") + 1;
+		k += sprintf((char*)wrq + k, "%u", request_blksize) + 1;
+		k += sprintf((char*)wrq + k, "windowsize") + 1;
+		k += sprintf((char*)wrq + k, "%u", request_windowsize) + 1;
+	} else {
+		blocks = FILE_SIZE / blksize + 1;
+	}
+	peer_send(wrq, k, PEER_TID, TFTP_PORT, 0);
+	return report(name, run_transfer());
+}
+
+
+int main(void) {
+	int failed = 0;
+
+	eth_init(&eth_types);
+	ipv4_init(&prot_types, &my_ip, &my_subnet);
+	arp_table_init(&table, &my_ip, my_mac);
+	route_init(&routing, &routes, &my_ip, &my_subnet, my_mac);
+	txq_init(&txq);
+	pbuf_init(&pbufs);
+	udp_init(&sockets);
+	ipv4_frag_init(&frags);
+	tftp_init(&tftp);
+	stub_on_transmit = &device_transmit;
+	now_us = 1000000;
+	stub_tick = now_us / 1000;
+	arp_learn(peer_ip, peer_mac, 1);
+
+	printf("bench_tftp: %d Bytes, 10 Mbit/s, Flash %lu ms je 2 KB (simulierte Zeit)\n", FILE_SIZE, (unsigned long)(flash_us_per_2k / 1000));
+	static const uint32_t rtts[] = {2000, 20000};
+	for (uint8_t i = 0; i < 2; i++) {
+		one_way_us = rtts[i] / 2;
+		printf(" RTT %lu ms:\n", (unsigned long)(rtts[i] / 1000));
+		failed |= run_get("RRQ Lock-Step (ohne Optionen)", 0);
+		failed |= run_get("RRQ blksize + windowsize", 1);
+	}
+
+	one_way_us = 1000;
+	loss_permille = 10;
+	printf(" RTT 2 ms, 1 %% Verlust der DATA-Pakete:\n");
+	failed |= run_get("RRQ Lock-Step (ohne Optionen)", 0);
+	failed |= run_get("RRQ blksize + windowsize", 1);
+	loss_permille = 0;
+
+	printf(" Server (WRQ an Port 69), RTT 2 ms:\n");
+	tftp_server_start(&sink);
+	failed |= run_put("WRQ ohne Optionen", 0, 0);
+	failed |= run_put("WRQ blksize 1024 windowsize 8", 1024, 8);
+	flash_us_per_2k = 40000;
+	printf(" Langsamer Flash, 40 ms je 2 KB:\n");
+	failed |= run_put("WRQ blksize 1024 windowsize 8", 1024, 8);
+	return failed;
+}
\ No newline at end of file
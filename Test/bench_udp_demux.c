@@ -0,0 +1,121 @@
+/* Includes ------------------------------------------------------------------*/
+#include <time.h>
+#include "stub.h"
+#include "udp.h"
+
+/* Defines ------------------------------------------------------------------*/
+#define ROUNDS 2000000
+#define PAYLOAD 32
+#define OFFSET (sizeof(mac_header) + sizeof(ipv4_header)) // Beginn des UDP-Headers
+
+/* Private variables ---------------------------------------------------------*/
+static ether_types eth_types;
+static prtcl_types prot_types;
+static udp_sockets sockets;
+static ip_address my_ip = {{192, 168, 1, 10}};
+static ip_address my_subnet = {{255, 255, 255, 0}};
+static uint8_t frames[64][OFFSET + sizeof(udp_header) + PAYLOAD];
+static uint16_t ports[64];
+static volatile uint32_t delivered;
+
+/* Private functions ---------------------------------------------------------*/
+int handle_udp(const uint8_t* buf, uint16_t length, uint16_t offset);
+
+static int service(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport) {
+	delivered += buf[offset];
+	return 0;
+}
+
+
+/**
+ * handle_udp mit der frheren Suche: alle Sockets der Reihe nach mit dem Zielport vergleichen.
+ * Die Prfungen davor sind dieselben, damit nur die Suche verglichen wird.
+ */
+static int linear_dispatch(const uint8_t* buf, uint16_t length, uint16_t offset) {
+	if (length < offset + sizeof(udp_header)) {
+		return 1;
+	}
+	uint16_t lport = buf[offset + 2] + (buf[offset + 3] << 8);
+	uint16_t udp_length = (buf[offset + 4] << 8) | buf[offset + 5];
+	if (udp_length < sizeof(udp_header) || offset + udp_length > length) {
+		return 1;
+	}
+	uint16_t len = udp_length - sizeof(udp_header);
+	uint16_t sport = buf[offset] | (buf[offset + 1] << 8);
+	ip_address src = *(ip_address*)(buf + sizeof(mac_header) + 12);
+
+	for (uint8_t i = 0; i < UDP_SOCKETS; i++) {
+		udp_socket* s = &sockets.sockets[i];
+		if (s->in_use && lport == s->lport && s->csum_policy == UDP_CSUM_TRUST) {
+			s->stats.received++;
+			return s->func(buf, offset + sizeof(udp_header), len, src, sport);
+		}
+	}
+	sockets.no_socket++;
+	return 1;
+}
+
+
+/**
+ * Bindet count Dienste an verstreute Ports in ungeordneter Reihenfolge und baut je einen Frame dazu.
+ */
+static void setup(uint8_t count) {
+	udp_init(&sockets);
+	for (uint8_t i = 0; i < count; i++) {
+		ports[i] = 1000 + ((i * 37) % 64) * 101;
+		int sock = udp_bind(swapEndian16(ports[i]), &service);
+		udp_set_checksum_policy(sock, UDP_CSUM_TRUST);
+
+		uint8_t* f = frames[i];
+		uint8_t* udp = f + OFFSET;
+		uint16_t udp_length = sizeof(udp_header) + PAYLOAD;
+		f[sizeof(mac_header)] = 0x45;
+		udp[0] = 0x30;
+		udp[1] = 0x39;
+		udp[2] = ports[i] >> 8;
+		udp[3] = ports[i] & 0xFF;
+		udp[4] = udp_length >> 8;
+		udp[5] = udp_length & 0xFF;
+		udp[8] = i;
+	}
+}
+
+
+static double seconds(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+static double run(uint8_t count, int (*dispatch)(const uint8_t*, uint16_t, uint16_t)) {
+	// ber einen volatile Pointer, damit der Compiler keine der Varianten in die Schleife einbettet
+	int (*volatile call)(const uint8_t*, uint16_t, uint16_t) = dispatch;
+	double start = seconds();
+	for (uint32_t i = 0; i < ROUNDS; i++) {
+		call(frames[i % count], sizeof(frames[0]), OFFSET);
+	}
+	return (seconds() - start) * 1e9 / ROUNDS;
+}
+
+
+int main(void) {
+	static const uint8_t counts[] = {1, 8, 64};
+
+	eth_init(&eth_types);
+	ipv4_init(&prot_types, &my_ip, &my_subnet);
+	printf("bench_udp_demux: %d Datagramme, reihum an alle gebundenen Ports (Host, nur als Vergleich)\n", ROUNDS);
+	printf("  Ports   bisher (linear)   handle_udp (binre Suche)\n");
+
+	for (uint8_t i = 0; i < sizeof(counts); i++) {
+		setup(counts[i]);
+		double linear = run(counts[i], &linear_dispatch);
+		double binary = run(counts[i], &handle_udp);
+		printf("  %5u   %10.1f ns      %10.1f ns\n", counts[i], linear, binary);
+	}
+	if (sockets.no_socket != 0) {
+		printf("  %lu Datagramme nicht zugestellt\n", (unsigned long)sockets.no_socket);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,134 @@
+/* Includes ------------------------------------------------------------------*/
+#include <time.h>
+#include "stub.h"
+#include "udp.h"
+#include "pbuf.h"
+
+/* Defines ------------------------------------------------------------------*/
+#define ROUNDS 50000
+#define PAYLOAD 1472 // Grtes Datagramm ohne Fragmentierung
+#define FRAME_LENGTH (sizeof(mac_header) + sizeof(ipv4_header) + sizeof(udp_header) + PAYLOAD)
+
+/* Private variables ---------------------------------------------------------*/
+static ether_types eth_types;
+static prtcl_types prot_types;
+static arp_table table;
+static udp_sockets sockets;
+static pbuf_pool pbufs;
+static ip_address my_ip = {{192, 168, 1, 10}};
+static ip_address my_subnet = {{255, 255, 255, 0}};
+static ip_address peer = {{192, 168, 1, 2}};
+static mac_address my_mac = {{0xB8, 0x37, 0x4A, 0x04, 0x20, 0x0B}};
+static uint8_t frame[FRAME_LENGTH];
+static volatile uint32_t delivered;
+
+/* Private functions ---------------------------------------------------------*/
+
+static int service(const uint8_t* buf, uint16_t offset, uint16_t len, ip_address src, uint16_t sport) {
+	delivered++;
+	return 0;
+}
+
+
+/**
+ * Baut ein Datagramm an Port 5000 mit gltigen Prfsummen in IPv4- und UDP-Header.
+ */
+static void build(void) {
+	uint8_t* ip = frame + sizeof(mac_header);
+	uint8_t* udp = ip + sizeof(ipv4_header);
+	uint16_t udp_length = sizeof(udp_header) + PAYLOAD;
+	uint16_t total_length = sizeof(ipv4_header) + udp_length;
+
+	for (uint8_t i = 0; i < 6; i++) {
+		frame[i] = my_mac.octet[i];
+		frame[6 + i] = 0x02;
+	}
+	frame[12] = 0x08;
+	ip[0] = 0x45;
+	ip[2] = total_length >> 8;
+	ip[3] = total_length & 0xFF;
+	ip[8] = 64;
+	ip[9] = UDP_TYPE;
+	for (uint8_t i = 0; i < 4; i++) {
+		ip[12 + i] = peer.octet[i];
+		ip[16 + i] = my_ip.octet[i];
+	}
+	uint16_t check = checksum(ip, sizeof(ipv4_header));
+	ip[10] = check & 0xFF;
+	ip[11] = check >> 8;
+
+	udp[0] = 0x30;
+	udp[1] = 0x39;
+	udp[2] = 5000 >> 8;
+	udp[3] = 5000 & 0xFF;
+	udp[4] = udp_length >> 8;
+	udp[5] = udp_length & 0xFF;
+	for (uint16_t i = 0; i < PAYLOAD; i++) {
+		udp[sizeof(udp_header) + i] = i * 13 + 5;
+	}
+	uint32_t sum = checksum_pseudo(peer, my_ip, UDP_TYPE, udp_length);
+	check = ~checksum_fold(checksum_partial(udp, udp_length, sum));
+	udp[6] = check & 0xFF;
+	udp[7] = check >> 8;
+}
+
+
+static double seconds(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+/**
+ * Empfngt den Frame ROUNDS-mal wie die Hauptschleife: enc28_packetReceive in einen Puffer, eth_handler.
+ *
+ * @return Die Zeit je Frame in ns.
+ */
+static double run(int sock, uint8_t policy, uint8_t rx_sum) {
+	udp_set_checksum_policy(sock, policy);
+	stub_rx_sum = rx_sum;
+	delivered = 0;
+
+	double start = seconds();
+	for (uint32_t i = 0; i < ROUNDS; i++) {
+		pbuf* p = pbuf_alloc();
+		stub_receive(frame, FRAME_LENGTH);
+		p->len = enc28_packetReceive(PBUF_SIZE, p->data);
+		eth_handler(p->data, p->len);
+		pbuf_free(p);
+	}
+	double t = (seconds() - start) * 1e9 / ROUNDS;
+	if (delivered != ROUNDS) {
+		printf("  nur %lu von %d Datagrammen zugestellt\n", (unsigned long)delivered, ROUNDS);
+	}
+	return t;
+}
+
+
+int main(void) {
+	pbuf_init(&pbufs);
+	eth_init(&eth_types);
+	ipv4_init(&prot_types, &my_ip, &my_subnet);
+	arp_table_init(&table, &my_ip, my_mac);
+	udp_init(&sockets);
+	int sock = udp_bind(swapEndian16(5000), &service);
+	build();
+
+	printf("bench_udp_rxcsum: %d Bytes Nutzdaten, %d Frames (Host, nur als Vergleich)\n", PAYLOAD, ROUNDS);
+	// Bester von 15 Durchgngen, abwechselnd, damit Strungen auf dem Host alle Varianten gleich treffen
+	double plain = 1e9, fused = 1e9, ram = 1e9;
+	for (uint8_t i = 0; i < 15; i++) {
+		// Wie im Treiber: udp_rx_sum_wanted lsst Frames an TRUST-Sockets ohne Summe lesen
+		double t = run(sock, UDP_CSUM_TRUST, 1);
+		plain = (t < plain) ? t : plain;
+		t = run(sock, UDP_CSUM_VERIFY, 1);
+		fused = (t < fused) ? t : fused;
+		t = run(sock, UDP_CSUM_VERIFY, 0);
+		ram = (t < ram) ? t : ram;
+	}
+	printf("  Empfang ohne Prfung (UDP_CSUM_TRUST)          %7.1f ns/Frame\n", plain);
+	printf("  Prfung mit Summe aus dem Empfang              %7.1f ns/Frame (%+.1f %%)\n", fused, (fused / plain - 1) * 100);
+	printf("  Prfung vollstndig im RAM                     %7.1f ns/Frame (%+.1f %%)\n", ram, (ram / plain - 1) * 100);
+	return udp_get_stats(sock)->bad_checksum != 0;
+}
@@ -0,0 +1,154 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <time.h>
+#include "stub.h"
+#include "udp.h"
+#include "route.h"
+#include "txq.h"
+
+/* Defines ------------------------------------------------------------------*/
+#define ROUNDS 200000
+#define BATCH 8 // Datagramme je Runde
+#define PAYLOAD 64
+
+/* Private variables ---------------------------------------------------------*/
+static ether_types eth_types;
+static prtcl_types prot_types;
+static arp_table table;
+static route_table routing;
+static route_cache routes;
+static txq_queues txq;
+static pbuf_pool pbufs;
+static udp_sockets sockets;
+
+static ip_address my_ip = {{192, 168, 1, 10}};
+static ip_address my_subnet = {{255, 255, 255, 0}};
+static ip_address peer_ip = {{192, 168, 1, 2}};
+static mac_address my_mac = {{0xB8, 0x37, 0x4A, 0x04, 0x20, 0x0B}};
+static mac_address peer_mac = {{0x02, 0x01, 0x01, 0x01, 0x01, 0x01}};
+static uint8_t payload[BATCH][PAYLOAD];
+static stub_frame reference[BATCH];
+
+/* Private functions ---------------------------------------------------------*/
+
+static double seconds(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+/**
+ * Sendet eine Runde einzeln mit udp_sendto.
+ */
+static void round_sendto(int sock) {
+	for (uint8_t k = 0; k < BATCH; k++) {
+		udp_sendto(sock, payload[k], PAYLOAD, peer_ip, swapEndian16(7000 + k));
+		txq_poll();
+	}
+}
+
+
+/**
+ * Sendet eine Runde in einem Aufruf mit udp_sendmmsg.
+ */
+static void round_sendmmsg(int sock) {
+	udp_msg msgs[BATCH];
+
+	for (uint8_t k = 0; k < BATCH; k++) {
+		msgs[k].dst = peer_ip;
+		msgs[k].dport = swapEndian16(7000 + k);
+		msgs[k].data = payload[k];
+		msgs[k].len = PAYLOAD;
+	}
+	udp_sendmmsg(sock, msgs, BATCH);
+}
+
+
+/**
+ * Sendet ROUNDS Runden und leert dabei die Sendewarteschlange (enc28_packetDone meldet sofort fertig).
+ *
+ * @return Die Zeit je Datagramm in ns.
+ */
+static double run(int sock, void (*send_round)(int)) {
+	double start = seconds();
+	for (uint32_t i = 0; i < ROUNDS; i++) {
+		send_round(sock);
+		for (uint8_t k = 0; k <= BATCH; k++) {
+			txq_poll();
+		}
+	}
+	return (seconds() - start) * 1e9 / ((double)ROUNDS * BATCH);
+}
+
+
+/**
+ * Vergleicht die Frames einer Runde ohne Identifikation und Header-Prfsumme des IPv4-Headers,
+ * die von Datagramm zu Datagramm wechseln.
+ *
+ * @return 1, wenn alle Frames bis auf diese Felder gleich sind.
+ */
+static int same_frames(void) {
+	for (uint8_t k = 0; k < BATCH; k++) {
+		const stub_frame* f = &stub_frames[k];
+		const uint8_t* ip = f->data + sizeof(mac_header);
+		const uint8_t* ref = reference[k].data + sizeof(mac_header);
+
+		if (f->len != reference[k].len || memcmp(f->data, reference[k].data, sizeof(mac_header)) != 0
+				|| memcmp(ip, ref, 4) != 0 || memcmp(ip + 6, ref + 6, 4) != 0
+				|| memcmp(ip + 12, ref + 12, f->len - sizeof(mac_header) - 12) != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+int main(void) {
+	eth_init(&eth_types);
+	ipv4_init(&prot_types, &my_ip, &my_subnet);
+	arp_table_init(&table, &my_ip, my_mac);
+	route_init(&routing, &routes, &my_ip, &my_subnet, my_mac);
+	txq_init(&txq);
+	pbuf_init(&pbufs);
+	udp_init(&sockets);
+	arp_learn(peer_ip, peer_mac, 1);
+	int sock = udp_bind(swapEndian16(5000), NULL);
+	for (uint8_t k = 0; k < BATCH; k++) {
+		for (uint8_t i = 0; i < PAYLOAD; i++) {
+			payload[k][i] = k * 31 + i;
+		}
+	}
+
+	// Eine Runde je Variante: Frames und Zugriffe auf den Pufferspeicher des ENC28J60
+	stub_reset();
+	round_sendto(sock);
+	uint32_t sent_single = stub_sent, seeks_single = stub_seeks, writes_single = stub_writes;
+	memcpy(reference, stub_frames, sizeof(reference));
+
+	stub_reset();
+	round_sendmmsg(sock);
+	for (uint8_t k = 0; k <= BATCH; k++) {
+		txq_poll();
+	}
+	uint32_t sent_batch = stub_sent, seeks_batch = stub_seeks, writes_batch = stub_writes;
+	int same = sent_single == BATCH && sent_batch == BATCH && same_frames();
+
+	printf("bench_udp_sendmmsg: %d x %d Bytes Nutzdaten je Runde, %d Runden (Host, nur als Vergleich)\n", BATCH, PAYLOAD, ROUNDS);
+	printf("  Je Runde                      udp_sendto   udp_sendmmsg\n");
+	printf("  Gesendete Frames              %10lu   %12lu\n", (unsigned long)sent_single, (unsigned long)sent_batch);
+	printf("  Schreibzeiger gesetzt         %10lu   %12lu\n", (unsigned long)seeks_single, (unsigned long)seeks_batch);
+	printf("  Schreibzugriffe auf Puffer    %10lu   %12lu\n", (unsigned long)writes_single, (unsigned long)writes_batch);
+	printf("  Frames gleich (ohne IP-ID)    %s\n", same ? "ja" : "NEIN");
+
+	// Bester von 5 Durchgngen, abwechselnd
+	double single = 1e9, batch = 1e9;
+	for (uint8_t i = 0; i < 5; i++) {
+		double t = run(sock, round_sendto);
+		single = (t < single) ? t : single;
+		t = run(sock, round_sendmmsg);
+		batch = (t < batch) ? t : batch;
+	}
+	printf("  CPU-Zeit je Datagramm         %7.1f ns   %9.1f ns\n", single, batch);
+	return !same;
+}
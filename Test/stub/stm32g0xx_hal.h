@@ -0,0 +1,51 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STM32G0XX_HAL_H
+#define __STM32G0XX_HAL_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+/* Defines ------------------------------------------------------------------*/
+// Nachbildung der vom Netzwerkstack verwendeten Teile der HAL fr den Host-Build der Tests.
+// Zeit und Interruptsperre werden von stub.c gestellt, die Tests setzen stub_tick.
+
+typedef enum { HAL_OK = 0, HAL_ERROR } HAL_StatusTypeDef;
+typedef enum { GPIO_PIN_RESET = 0, GPIO_PIN_SET } GPIO_PinState;
+typedef struct { uint32_t dummy; } GPIO_TypeDef;
+typedef struct { void* Instance; } SPI_HandleTypeDef;
+typedef struct { volatile uint32_t CR1, CR2, SMCR, DIER, SR, EGR, CCMR1, CCMR2, CCER, CNT, PSC, ARR; } TIM_TypeDef;
+
+extern GPIO_TypeDef stub_gpio;
+extern TIM_TypeDef stub_tim2;
+extern uint32_t SystemCoreClock;
+
+#define GPIOB (&stub_gpio)
+#define GPIOC (&stub_gpio)
+#define GPIO_PIN_6 0x0040
+#define GPIO_PIN_9 0x0200
+#define TIM2 (&stub_tim2)
+#define TIM_CR1_CEN 0x0001
+#define TIM_EGR_UG 0x0001
+#define __HAL_RCC_TIM2_CLK_ENABLE() do {} while (0)
+#define __DMB() __sync_synchronize()
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint32_t HAL_GetTick(void);
+
+void HAL_Delay(uint32_t delay);
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state);
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef* hspi, uint8_t* tx, uint8_t* rx, uint16_t size, uint32_t timeout);
+
+void __disable_irq(void);
+
+void __enable_irq(void);
+
+uint32_t __get_PRIMASK(void);
+
+void __set_PRIMASK(uint32_t primask);
+
+#endif /* __STM32G0XX_HAL_H */
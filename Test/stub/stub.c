@@ -0,0 +1,245 @@
+/* Includes ------------------------------------------------------------------*/
+#include "stub.h"
+
+/* Private variables ---------------------------------------------------------*/
+GPIO_TypeDef stub_gpio;
+TIM_TypeDef stub_tim2;
+uint32_t SystemCoreClock = 64000000;
+
+uint32_t stub_tick;
+uint32_t stub_checks;
+uint32_t stub_failures;
+uint32_t stub_sent;
+uint32_t stub_seeks;
+uint32_t stub_writes;
+stub_frame stub_frames[STUB_FRAMES];
+void (*stub_on_transmit)(const uint8_t* frame, uint16_t len);
+uint8_t stub_rx_sum = 1;
+
+static uint32_t primask;
+static uint8_t mem[8192]; // Pufferspeicher des ENC28J60
+static uint16_t write_ptr;
+static const uint8_t* rx_frame; // Nchster Frame fr enc28_packetReceive
+static uint16_t rx_length;
+static const uint8_t* held; // Zuletzt empfangener Puffer
+static uint16_t held_ptr; // Beginn des zuletzt empfangenen Frames im Empfangspuffer
+static uint16_t held_len; // Seine Lnge; 0 = nicht vollstndig gelesen
+static uint16_t rx_ptr; // Schreibposition des nchsten Frames im Empfangspuffer (luft ber stub_reset hinweg weiter)
+static enc28_rx_sum rx_sum;
+static int (*rx_sum_filter)(const uint8_t* header, uint16_t len);
+
+/* Functions -----------------------------------------------------------------*/
+
+/**
+ * Setzt Zeit und Sendeprotokoll zurck.
+ */
+void stub_reset(void) {
+	stub_tick = 0;
+	stub_sent = 0;
+	stub_seeks = 0;
+	stub_writes = 0;
+	primask = 0;
+	rx_frame = NULL;
+	held = NULL;
+}
+
+
+/**
+ * Liefert den zuletzt gesendeten Frame.
+ *
+ * @return Ein Pointer auf den Frame; NULL, wenn seit stub_reset nichts gesendet wurde.
+ */
+const stub_frame* stub_last_frame(void) {
+	if (stub_sent == 0) {
+		return NULL;
+	}
+	return &stub_frames[(stub_sent - 1) % STUB_FRAMES];
+}
+
+
+/**
+ * Gibt das Ergebnis eines Testprogramms aus.
+ *
+ * @param name Der Name des Tests.
+ * @return Der Exit-Code (0 = alle Prfungen bestanden).
+ */
+int stub_result(const char* name) {
+	printf("%s: %lu Checks, %lu fehlgeschlagen\n", name, (unsigned long)stub_checks, (unsigned long)stub_failures);
+	return stub_failures != 0;
+}
+
+
+/**
+ * Stellt einen Frame bereit, den der nchste Aufruf von enc28_packetReceive liefert.
+ *
+ * @param frame Der Frame (MAC-Header bis Ende, ohne CRC); muss bis zum Empfang gltig bleiben.
+ * @param len Die Lnge des Frames.
+ */
+void stub_receive(const uint8_t* frame, uint16_t len) {
+	rx_frame = frame;
+	rx_length = len;
+}
+
+
+/* HAL -----------------------------------------------------------------------*/
+
+uint32_t HAL_GetTick(void) {
+	return stub_tick;
+}
+
+void HAL_Delay(uint32_t delay) {
+	stub_tick += delay;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state) {
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef* hspi, uint8_t* tx, uint8_t* rx, uint16_t size, uint32_t timeout) {
+	return HAL_OK;
+}
+
+void __disable_irq(void) {
+	primask = 1;
+}
+
+void __enable_irq(void) {
+	primask = 0;
+}
+
+uint32_t __get_PRIMASK(void) {
+	return primask;
+}
+
+void __set_PRIMASK(uint32_t value) {
+	primask = value;
+}
+
+
+/* ENC28J60 ------------------------------------------------------------------*/
+// Der Pufferspeicher wird im RAM nachgebildet; gesendete Frames landen in stub_frames.
+
+void enc28_init(mac_address mac) {
+}
+
+void enc28_packetBegin(uint16_t addr) {
+	stub_seeks++;
+	write_ptr = addr;
+	mem[write_ptr++ % sizeof(mem)] = 0xFF; // Kontrollbyte
+}
+
+void enc28_packetWrite(uint16_t len, const uint8_t* data) {
+	stub_writes++;
+	for (uint16_t i = 0; i < len; i++) {
+		mem[write_ptr++ % sizeof(mem)] = data[i];
+	}
+}
+
+void enc28_packetTransmit(uint16_t addr, uint16_t len) {
+	stub_frame* f = &stub_frames[stub_sent % STUB_FRAMES];
+
+	f->len = (len < STUB_FRAME_MAX) ? len : STUB_FRAME_MAX;
+	for (uint16_t i = 0; i < f->len; i++) {
+		f->data[i] = mem[(addr + 1 + i) % sizeof(mem)];
+	}
+	stub_sent++;
+	if (stub_on_transmit != NULL) {
+		stub_on_transmit(f->data, f->len);
+	}
+}
+
+int enc28_packetDone(void) {
+	return 1;
+}
+
+void enc28_setRxFilter(int (*filter)(const uint8_t* header, uint16_t len)) {
+}
+
+int enc28_packetHeld(const uint8_t* dataBuf, uint16_t len) {
+	return held != NULL && dataBuf == held && len <= held_len;
+}
+
+// Wie die DMA: ein Umlauf am Ende des Empfangspuffers wird beim Kopieren aufgelst
+void enc28_packetCopyRx(uint16_t addr, uint16_t len) {
+	for (uint16_t i = 0; i < len; i++) {
+		mem[(addr + i) % sizeof(mem)] = mem[RXSTART_INIT + (held_ptr - RXSTART_INIT + i) % (RXSTOP_INIT - RXSTART_INIT + 1)];
+	}
+}
+
+void enc28_packetPatch(uint16_t addr, uint16_t len, const uint8_t* data) {
+	stub_seeks++;
+	write_ptr = addr;
+	enc28_packetWrite(len, data);
+}
+
+void enc28_packetSeek(uint16_t addr) {
+	stub_seeks++;
+	write_ptr = addr;
+}
+
+void enc28_setRxSumFilter(int (*filter)(const uint8_t* header, uint16_t len)) {
+	rx_sum_filter = filter;
+}
+
+const enc28_rx_sum* enc28_packetSum(const uint8_t* dataBuf) {
+	if (!stub_rx_sum || dataBuf == NULL || dataBuf != held) {
+		return NULL;
+	}
+	return &rx_sum;
+}
+
+void enc28_setMulticastFilter(const mac_address* macs, uint8_t count) {
+}
+
+/**
+ * Liefert ein Byte des bereitgestellten Frames, wie enc28J60_TransceiveByte eines ber SPI.
+ * Nicht inline, damit der Empfang wie auf dem Gert Byte fr Byte ber einen Aufruf luft.
+ */
+static __attribute__((noinline)) uint8_t spi_byte(uint16_t pos) {
+	return rx_frame[pos];
+}
+
+// Wie der Treiber: erst ENC28_PEEK_SIZE Bytes, den Rest summiert enc28_readBufSum beim Lesen, wenn die
+// angemeldete Prfung es verlangt (stub_rx_sum = 0 schaltet das Summieren ganz ab)
+uint16_t enc28_packetReceive(uint16_t maxlen, uint8_t* dataBuf) {
+	uint16_t len = rx_length;
+
+	held = NULL;
+	if (rx_frame == NULL) {
+		return 0;
+	}
+	if (len > maxlen - 1) {
+		len = maxlen - 1;
+	}
+	uint16_t peek = (len < ENC28_PEEK_SIZE) ? len : ENC28_PEEK_SIZE;
+	for (uint16_t i = 0; i < peek; i++) {
+		dataBuf[i] = spi_byte(i);
+	}
+	rx_sum = (enc28_rx_sum) {0};
+	if (stub_rx_sum && rx_sum_filter != NULL && rx_sum_filter(dataBuf, peek)) {
+		uint32_t sum = 0;
+		uint8_t odd = peek & 1;
+		for (uint16_t i = peek; i < len; i++) {
+			uint8_t b = spi_byte(i);
+			dataBuf[i] = b;
+			sum += odd ? (uint32_t)(b << 8) : b;
+			odd ^= 1;
+		}
+		rx_sum.sum = sum;
+		rx_sum.from = peek;
+		rx_sum.to = len;
+	} else {
+		for (uint16_t i = peek; i < len; i++) {
+			dataBuf[i] = spi_byte(i);
+		}
+	}
+	// Frame wie der Controller in den Empfangspuffer legen (mit Umlauf), damit enc28_packetCopyRx ihn findet
+	held_ptr = rx_ptr;
+	held_len = (rx_length > maxlen - 1) ? 0 : len;
+	for (uint16_t i = 0; i < len; i++) {
+		mem[RXSTART_INIT + (held_ptr - RXSTART_INIT + i) % (RXSTOP_INIT - RXSTART_INIT + 1)] = rx_frame[i];
+	}
+	rx_ptr = RXSTART_INIT + (held_ptr - RXSTART_INIT + len + 6) % (RXSTOP_INIT - RXSTART_INIT + 1);
+	held = dataBuf;
+	rx_frame = NULL;
+	return len;
+}
@@ -0,0 +1,49 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STUB_H
+#define __STUB_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include "stm32g0xx_hal.h"
+#include "enc28_j60.h"
+
+/* Defines ------------------------------------------------------------------*/
+// Anzahl der gesendeten Frames, die fr die Auswertung aufbewahrt werden
+#define STUB_FRAMES 64
+#define STUB_FRAME_MAX 1536
+
+// Prft eine Bedingung, zhlt Fehlschlge und luft weiter
+#define CHECK(cond) do { \
+	stub_checks++; \
+	if (!(cond)) { \
+		stub_failures++; \
+		printf("%s:%d: CHECK(%s) fehlgeschlagen\n", __FILE__, __LINE__, #cond); \
+	} \
+} while (0)
+
+typedef struct {
+	uint16_t len;
+	uint8_t data[STUB_FRAME_MAX];
+} stub_frame;
+
+extern uint32_t stub_tick; // Wert von HAL_GetTick in ms
+extern uint32_t stub_checks;
+extern uint32_t stub_failures;
+extern uint32_t stub_sent; // Mit enc28_packetTransmit gesendete Frames seit stub_reset
+extern uint32_t stub_seeks; // Gesetzte Schreibzeiger (enc28_packetBegin, enc28_packetSeek, enc28_packetPatch) seit stub_reset
+extern uint32_t stub_writes; // Schreibzugriffe auf den Pufferspeicher (enc28_packetWrite) seit stub_reset
+extern stub_frame stub_frames[STUB_FRAMES]; // Die letzten gesendeten Frames (Index stub_sent % STUB_FRAMES)
+extern void (*stub_on_transmit)(const uint8_t* frame, uint16_t len); // Wird fr jeden gesendeten Frame aufgerufen (NULL = nur aufzeichnen)
+extern uint8_t stub_rx_sum; // 1 = enc28_packetReceive summiert beim Kopieren wie der Treiber (Voreinstellung)
+
+
+/* Exported functions prototypes ---------------------------------------------*/
+void stub_reset(void);
+
+const stub_frame* stub_last_frame(void);
+
+void stub_receive(const uint8_t* frame, uint16_t len);
+
+int stub_result(const char* name);
+
+#endif /* __STUB_H */
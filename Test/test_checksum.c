@@ -0,0 +1,203 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "stub.h"
+#include "checksum.h"
+
+/* Defines ------------------------------------------------------------------*/
+#define MAX_LENGTH 1600
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t data[MAX_LENGTH + 8];
+static uint8_t copy[MAX_LENGTH + 8];
+static uint32_t seed = 1;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t random32(void) {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+
+static void fill(uint8_t* p, uint16_t length) {
+	for (uint16_t i = 0; i < length; i++) {
+		p[i] = random32();
+	}
+}
+
+
+/**
+ * Referenz nach RFC 1071, Abschnitt 4.1: 16-Bit-Worte in Speicher-Byte-Order (wie checksum.h),
+ * ein einzelnes letztes Byte zhlt als unteres Byte, bertrge am Ende gefaltet.
+ */
+static uint16_t reference(const uint8_t* p, uint32_t length) {
+	uint32_t sum = 0;
+
+	while (length > 1) {
+		sum += p[0] | (p[1] << 8);
+		p += 2;
+		length -= 2;
+	}
+	if (length > 0) {
+		sum += p[0];
+	}
+	while (sum >> 16) {
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+	return (uint16_t)~sum;
+}
+
+
+/**
+ * Schliet eine ungefaltete Summe zur Prfsumme ab (wie checksum).
+ */
+static uint16_t finish(uint32_t sum) {
+	return (uint16_t)~checksum_fold(sum);
+}
+
+
+/**
+ * Vergleicht Prfsummen im Einerkomplement (0x0000 und 0xFFFF sind beide Null).
+ */
+static int same(uint16_t a, uint16_t b) {
+	return a == b || (a == 0 && b == 0xFFFF) || (a == 0xFFFF && b == 0);
+}
+
+
+/* Tests ---------------------------------------------------------------------*/
+
+/**
+ * checksum und checksum_partial an jeder Ausrichtung und mit jeder Lnge bis MAX_LENGTH.
+ */
+static void test_checksum(void) {
+	uint32_t wrong = 0;
+
+	for (uint16_t offset = 0; offset < 8; offset++) {
+		for (uint16_t length = 0; length <= MAX_LENGTH; length++) {
+			fill(data + offset, length);
+			wrong += checksum(data + offset, length) != reference(data + offset, length);
+		}
+	}
+	CHECK(wrong == 0);
+
+	// Lauter 0xFF: grtmgliche bertrge
+	memset(data, 0xFF, sizeof(data));
+	for (uint16_t offset = 0; offset < 4; offset++) {
+		CHECK(checksum(data + offset, MAX_LENGTH) == reference(data + offset, MAX_LENGTH));
+		CHECK(checksum(data + offset, MAX_LENGTH - 1) == reference(data + offset, MAX_LENGTH - 1));
+	}
+}
+
+
+/**
+ * checksum_copy bei jeder Kombination der Ausrichtung von Quelle und Ziel.
+ */
+static void test_copy(void) {
+	uint32_t wrong = 0;
+
+	for (uint16_t src = 0; src < 4; src++) {
+		for (uint16_t dst = 0; dst < 4; dst++) {
+			for (uint16_t length = 0; length <= 300; length++) {
+				fill(data + src, length);
+				uint16_t check = finish(checksum_copy(copy + dst, data + src, length, 0));
+				wrong += check != reference(data + src, length);
+				wrong += memcmp(copy + dst, data + src, length) != 0;
+			}
+		}
+	}
+	CHECK(wrong == 0);
+}
+
+
+/**
+ * Fortgesetzte Summen: checksum_partial mit geraden Teilen, checksum_stream mit beliebigen
+ * Teilen an gerader und ungerader Position.
+ */
+static void test_parts(void) {
+	uint32_t wrong = 0;
+
+	for (uint16_t offset = 0; offset < 4; offset++) {
+		for (uint16_t length = 0; length <= 300; length++) {
+			fill(data + offset, length);
+			uint16_t expected = reference(data + offset, length);
+
+			for (uint16_t split = 0; split <= length; split += 2) {
+				uint32_t sum = checksum_partial(data + offset, split, 0);
+				sum = checksum_partial(data + offset + split, length - split, sum);
+				wrong += finish(sum) != expected;
+			}
+			for (uint16_t split = 0; split <= length; split++) {
+				uint32_t sum = checksum_stream(data + offset, split, 0, 0);
+				sum = checksum_stream(data + offset + split, length - split, split, sum);
+				wrong += finish(sum) != expected;
+			}
+		}
+	}
+	CHECK(wrong == 0);
+
+	// Drei Teile mit ungeraden Lngen
+	fill(data, 1000);
+	uint32_t sum = checksum_stream(data, 333, 0, 0);
+	sum = checksum_stream(data + 333, 1, 333, sum);
+	sum = checksum_stream(data + 334, 666, 334, sum);
+	CHECK(finish(sum) == reference(data, 1000));
+}
+
+
+/**
+ * RFC 1624: nach dem ndern eines Feldes stimmt die angepasste Prfsumme mit der neu
+ * berechneten berein (an jeder geraden Position, gerade und ungerade Gesamtlnge).
+ */
+static void test_update(void) {
+	uint32_t wrong = 0;
+
+	for (uint16_t length = 4; length <= 64; length++) {
+		for (uint16_t field = 0; field + 4 <= length; field += 2) {
+			fill(data, length);
+			uint16_t check = reference(data, length);
+			uint16_t old16, new16 = random32();
+			memcpy(&old16, data + field, 2);
+			memcpy(data + field, &new16, 2);
+			wrong += !same(checksum_update16(check, old16, new16), reference(data, length));
+
+			check = reference(data, length);
+			uint32_t old32, new32 = random32();
+			memcpy(&old32, data + field, 4);
+			memcpy(data + field, &new32, 4);
+			wrong += !same(checksum_update32(check, old32, new32), reference(data, length));
+		}
+	}
+	CHECK(wrong == 0);
+
+	// Grenzflle: Feld auf 0 bzw. 0xFFFF
+	memset(data, 0, 20);
+	data[0] = 0x45;
+	uint16_t check = reference(data, 20);
+	data[8] = 0xFF;
+	data[9] = 0xFF;
+	CHECK(same(checksum_update16(check, 0x0000, 0xFFFF), reference(data, 20)));
+}
+
+
+/**
+ * Pseudo-Header (RFC 768): Quelle, Ziel, Null, Protokoll, Lnge.
+ */
+static void test_pseudo(void) {
+	ip_address src = {{192, 168, 1, 10}};
+	ip_address dst = {{10, 0, 0, 255}};
+	uint8_t pseudo[12] = {192, 168, 1, 10, 10, 0, 0, 255, 0, 17, 0x05, 0xDD};
+
+	CHECK(finish(checksum_pseudo(src, dst, 17, 0x05DD)) == reference(pseudo, 12));
+}
+
+
+int main(void) {
+	test_checksum();
+	test_copy();
+	test_parts();
+	test_update();
+	test_pseudo();
+	return stub_result("test_checksum");
+}
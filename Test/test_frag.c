@@ -0,0 +1,457 @@
+/* Includes ------------------------------------------------------------------*/
+#include "stub.h"
+#include "ipv4_frag.h"
+#include "ipv4.h"
+#include "arp.h"
+
+/* Private variables ---------------------------------------------------------*/
+static ipv4_frag_pool frags;
+static uint8_t frame[sizeof(mac_header) + 20 + IPV4_FRAG_MAX_SIZE + 64];
+static ether_types eth_types;
+static prtcl_types prot_types;
+static arp_table table;
+static ip_address my_ip = {127, 0, 0, 1};
+static ip_address my_subnet = {255, 0, 0, 0};
+
+// Vom UDP-Handler des Tests beobachtet
+static uint16_t udp_offset;
+static uint16_t udp_length;
+static uint8_t udp_valid;
+static uint32_t udp_delivered;
+
+/*
+ * Mitschnitt (AF_PACKET auf lo, MTU 600, Linux) eines UDP-Datagramms 127.0.0.1:60792 -> :5000
+ * mit 1200 Bytes Nutzdaten ((i * 7 + 3) & 0xFF) und Record Route (IP_OPTIONS). Das erste Fragment
+ * trgt die ausgefllte Option; Linux ersetzt sie in den weiteren Fragmenten durch NOPs, da
+ * Record Route nicht kopiert wird (RFC 791, Copied-Flag 0). Stacks, die solche Optionen ganz
+ * weglassen, senden die weiteren Fragmente mit 20-Byte-Header (siehe strip_options).
+ */
+static const uint8_t trace_0[610] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x4f, 0x00,
+	0x02, 0x54, 0x58, 0xec, 0x20, 0x00, 0x40, 0x11, 0xe7, 0x04, 0x7f, 0x00, 0x00, 0x01, 0x7f, 0x00,
+	0x00, 0x01, 0x07, 0x27, 0x08, 0x7f, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xaa, 0x34, 0x13, 0x88, 0x04, 0xb8,
+	0xb0, 0xcb, 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34, 0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e,
+	0x65, 0x6c, 0x73, 0x7a, 0x81, 0x88, 0x8f, 0x96, 0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0xc0, 0xc7, 0xce,
+	0xd5, 0xdc, 0xe3, 0xea, 0xf1, 0xf8, 0xff, 0x06, 0x0d, 0x14, 0x1b, 0x22, 0x29, 0x30, 0x37, 0x3e,
+	0x45, 0x4c, 0x53, 0x5a, 0x61, 0x68, 0x6f, 0x76, 0x7d, 0x84, 0x8b, 0x92, 0x99, 0xa0, 0xa7, 0xae,
+	0xb5, 0xbc, 0xc3, 0xca, 0xd1, 0xd8, 0xdf, 0xe6, 0xed, 0xf4, 0xfb, 0x02, 0x09, 0x10, 0x17, 0x1e,
+	0x25, 0x2c, 0x33, 0x3a, 0x41, 0x48, 0x4f, 0x56, 0x5d, 0x64, 0x6b, 0x72, 0x79, 0x80, 0x87, 0x8e,
+	0x95, 0x9c, 0xa3, 0xaa, 0xb1, 0xb8, 0xbf, 0xc6, 0xcd, 0xd4, 0xdb, 0xe2, 0xe9, 0xf0, 0xf7, 0xfe,
+	0x05, 0x0c, 0x13, 0x1a, 0x21, 0x28, 0x2f, 0x36, 0x3d, 0x44, 0x4b, 0x52, 0x59, 0x60, 0x67, 0x6e,
+	0x75, 0x7c, 0x83, 0x8a, 0x91, 0x98, 0x9f, 0xa6, 0xad, 0xb4, 0xbb, 0xc2, 0xc9, 0xd0, 0xd7, 0xde,
+	0xe5, 0xec, 0xf3, 0xfa, 0x01, 0x08, 0x0f, 0x16, 0x1d, 0x24, 0x2b, 0x32, 0x39, 0x40, 0x47, 0x4e,
+	0x55, 0x5c, 0x63, 0x6a, 0x71, 0x78, 0x7f, 0x86, 0x8d, 0x94, 0x9b, 0xa2, 0xa9, 0xb0, 0xb7, 0xbe,
+	0xc5, 0xcc, 0xd3, 0xda, 0xe1, 0xe8, 0xef, 0xf6, 0xfd, 0x04, 0x0b, 0x12, 0x19, 0x20, 0x27, 0x2e,
+	0x35, 0x3c, 0x43, 0x4a, 0x51, 0x58, 0x5f, 0x66, 0x6d, 0x74, 0x7b, 0x82, 0x89, 0x90, 0x97, 0x9e,
+	0xa5, 0xac, 0xb3, 0xba, 0xc1, 0xc8, 0xcf, 0xd6, 0xdd, 0xe4, 0xeb, 0xf2, 0xf9, 0x00, 0x07, 0x0e,
+	0x15, 0x1c, 0x23, 0x2a, 0x31, 0x38, 0x3f, 0x46, 0x4d, 0x54, 0x5b, 0x62, 0x69, 0x70, 0x77, 0x7e,
+	0x85, 0x8c, 0x93, 0x9a, 0xa1, 0xa8, 0xaf, 0xb6, 0xbd, 0xc4, 0xcb, 0xd2, 0xd9, 0xe0, 0xe7, 0xee,
+	0xf5, 0xfc, 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34, 0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e,
+	0x65, 0x6c, 0x73, 0x7a, 0x81, 0x88, 0x8f, 0x96, 0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0xc0, 0xc7, 0xce,
+	0xd5, 0xdc, 0xe3, 0xea, 0xf1, 0xf8, 0xff, 0x06, 0x0d, 0x14, 0x1b, 0x22, 0x29, 0x30, 0x37, 0x3e,
+	0x45, 0x4c, 0x53, 0x5a, 0x61, 0x68, 0x6f, 0x76, 0x7d, 0x84, 0x8b, 0x92, 0x99, 0xa0, 0xa7, 0xae,
+	0xb5, 0xbc, 0xc3, 0xca, 0xd1, 0xd8, 0xdf, 0xe6, 0xed, 0xf4, 0xfb, 0x02, 0x09, 0x10, 0x17, 0x1e,
+	0x25, 0x2c, 0x33, 0x3a, 0x41, 0x48, 0x4f, 0x56, 0x5d, 0x64, 0x6b, 0x72, 0x79, 0x80, 0x87, 0x8e,
+	0x95, 0x9c, 0xa3, 0xaa, 0xb1, 0xb8, 0xbf, 0xc6, 0xcd, 0xd4, 0xdb, 0xe2, 0xe9, 0xf0, 0xf7, 0xfe,
+	0x05, 0x0c, 0x13, 0x1a, 0x21, 0x28, 0x2f, 0x36, 0x3d, 0x44, 0x4b, 0x52, 0x59, 0x60, 0x67, 0x6e,
+	0x75, 0x7c, 0x83, 0x8a, 0x91, 0x98, 0x9f, 0xa6, 0xad, 0xb4, 0xbb, 0xc2, 0xc9, 0xd0, 0xd7, 0xde,
+	0xe5, 0xec, 0xf3, 0xfa, 0x01, 0x08, 0x0f, 0x16, 0x1d, 0x24, 0x2b, 0x32, 0x39, 0x40, 0x47, 0x4e,
+	0x55, 0x5c, 0x63, 0x6a, 0x71, 0x78, 0x7f, 0x86, 0x8d, 0x94, 0x9b, 0xa2, 0xa9, 0xb0, 0xb7, 0xbe,
+	0xc5, 0xcc, 0xd3, 0xda, 0xe1, 0xe8, 0xef, 0xf6, 0xfd, 0x04, 0x0b, 0x12, 0x19, 0x20, 0x27, 0x2e,
+	0x35, 0x3c, 0x43, 0x4a, 0x51, 0x58, 0x5f, 0x66, 0x6d, 0x74, 0x7b, 0x82, 0x89, 0x90, 0x97, 0x9e,
+	0xa5, 0xac, 0xb3, 0xba, 0xc1, 0xc8, 0xcf, 0xd6, 0xdd, 0xe4, 0xeb, 0xf2, 0xf9, 0x00, 0x07, 0x0e,
+	0x15, 0x1c, 0x23, 0x2a, 0x31, 0x38, 0x3f, 0x46, 0x4d, 0x54, 0x5b, 0x62, 0x69, 0x70, 0x77, 0x7e,
+	0x85, 0x8c, 0x93, 0x9a, 0xa1, 0xa8, 0xaf, 0xb6, 0xbd, 0xc4, 0xcb, 0xd2, 0xd9, 0xe0, 0xe7, 0xee,
+	0xf5, 0xfc, 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34, 0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e,
+	0x65, 0x6c,
+};
+static const uint8_t trace_1[610] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x4f, 0x00,
+	0x02, 0x54, 0x58, 0xec, 0x20, 0x43, 0x40, 0x11, 0xe3, 0x54, 0x7f, 0x00, 0x00, 0x01, 0x7f, 0x00,
+	0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x73, 0x7a, 0x81, 0x88, 0x8f, 0x96,
+	0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0xc0, 0xc7, 0xce, 0xd5, 0xdc, 0xe3, 0xea, 0xf1, 0xf8, 0xff, 0x06,
+	0x0d, 0x14, 0x1b, 0x22, 0x29, 0x30, 0x37, 0x3e, 0x45, 0x4c, 0x53, 0x5a, 0x61, 0x68, 0x6f, 0x76,
+	0x7d, 0x84, 0x8b, 0x92, 0x99, 0xa0, 0xa7, 0xae, 0xb5, 0xbc, 0xc3, 0xca, 0xd1, 0xd8, 0xdf, 0xe6,
+	0xed, 0xf4, 0xfb, 0x02, 0x09, 0x10, 0x17, 0x1e, 0x25, 0x2c, 0x33, 0x3a, 0x41, 0x48, 0x4f, 0x56,
+	0x5d, 0x64, 0x6b, 0x72, 0x79, 0x80, 0x87, 0x8e, 0x95, 0x9c, 0xa3, 0xaa, 0xb1, 0xb8, 0xbf, 0xc6,
+	0xcd, 0xd4, 0xdb, 0xe2, 0xe9, 0xf0, 0xf7, 0xfe, 0x05, 0x0c, 0x13, 0x1a, 0x21, 0x28, 0x2f, 0x36,
+	0x3d, 0x44, 0x4b, 0x52, 0x59, 0x60, 0x67, 0x6e, 0x75, 0x7c, 0x83, 0x8a, 0x91, 0x98, 0x9f, 0xa6,
+	0xad, 0xb4, 0xbb, 0xc2, 0xc9, 0xd0, 0xd7, 0xde, 0xe5, 0xec, 0xf3, 0xfa, 0x01, 0x08, 0x0f, 0x16,
+	0x1d, 0x24, 0x2b, 0x32, 0x39, 0x40, 0x47, 0x4e, 0x55, 0x5c, 0x63, 0x6a, 0x71, 0x78, 0x7f, 0x86,
+	0x8d, 0x94, 0x9b, 0xa2, 0xa9, 0xb0, 0xb7, 0xbe, 0xc5, 0xcc, 0xd3, 0xda, 0xe1, 0xe8, 0xef, 0xf6,
+	0xfd, 0x04, 0x0b, 0x12, 0x19, 0x20, 0x27, 0x2e, 0x35, 0x3c, 0x43, 0x4a, 0x51, 0x58, 0x5f, 0x66,
+	0x6d, 0x74, 0x7b, 0x82, 0x89, 0x90, 0x97, 0x9e, 0xa5, 0xac, 0xb3, 0xba, 0xc1, 0xc8, 0xcf, 0xd6,
+	0xdd, 0xe4, 0xeb, 0xf2, 0xf9, 0x00, 0x07, 0x0e, 0x15, 0x1c, 0x23, 0x2a, 0x31, 0x38, 0x3f, 0x46,
+	0x4d, 0x54, 0x5b, 0x62, 0x69, 0x70, 0x77, 0x7e, 0x85, 0x8c, 0x93, 0x9a, 0xa1, 0xa8, 0xaf, 0xb6,
+	0xbd, 0xc4, 0xcb, 0xd2, 0xd9, 0xe0, 0xe7, 0xee, 0xf5, 0xfc, 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26,
+	0x2d, 0x34, 0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c, 0x73, 0x7a, 0x81, 0x88, 0x8f, 0x96,
+	0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0xc0, 0xc7, 0xce, 0xd5, 0xdc, 0xe3, 0xea, 0xf1, 0xf8, 0xff, 0x06,
+	0x0d, 0x14, 0x1b, 0x22, 0x29, 0x30, 0x37, 0x3e, 0x45, 0x4c, 0x53, 0x5a, 0x61, 0x68, 0x6f, 0x76,
+	0x7d, 0x84, 0x8b, 0x92, 0x99, 0xa0, 0xa7, 0xae, 0xb5, 0xbc, 0xc3, 0xca, 0xd1, 0xd8, 0xdf, 0xe6,
+	0xed, 0xf4, 0xfb, 0x02, 0x09, 0x10, 0x17, 0x1e, 0x25, 0x2c, 0x33, 0x3a, 0x41, 0x48, 0x4f, 0x56,
+	0x5d, 0x64, 0x6b, 0x72, 0x79, 0x80, 0x87, 0x8e, 0x95, 0x9c, 0xa3, 0xaa, 0xb1, 0xb8, 0xbf, 0xc6,
+	0xcd, 0xd4, 0xdb, 0xe2, 0xe9, 0xf0, 0xf7, 0xfe, 0x05, 0x0c, 0x13, 0x1a, 0x21, 0x28, 0x2f, 0x36,
+	0x3d, 0x44, 0x4b, 0x52, 0x59, 0x60, 0x67, 0x6e, 0x75, 0x7c, 0x83, 0x8a, 0x91, 0x98, 0x9f, 0xa6,
+	0xad, 0xb4, 0xbb, 0xc2, 0xc9, 0xd0, 0xd7, 0xde, 0xe5, 0xec, 0xf3, 0xfa, 0x01, 0x08, 0x0f, 0x16,
+	0x1d, 0x24, 0x2b, 0x32, 0x39, 0x40, 0x47, 0x4e, 0x55, 0x5c, 0x63, 0x6a, 0x71, 0x78, 0x7f, 0x86,
+	0x8d, 0x94, 0x9b, 0xa2, 0xa9, 0xb0, 0xb7, 0xbe, 0xc5, 0xcc, 0xd3, 0xda, 0xe1, 0xe8, 0xef, 0xf6,
+	0xfd, 0x04, 0x0b, 0x12, 0x19, 0x20, 0x27, 0x2e, 0x35, 0x3c, 0x43, 0x4a, 0x51, 0x58, 0x5f, 0x66,
+	0x6d, 0x74, 0x7b, 0x82, 0x89, 0x90, 0x97, 0x9e, 0xa5, 0xac, 0xb3, 0xba, 0xc1, 0xc8, 0xcf, 0xd6,
+	0xdd, 0xe4, 0xeb, 0xf2, 0xf9, 0x00, 0x07, 0x0e, 0x15, 0x1c, 0x23, 0x2a, 0x31, 0x38, 0x3f, 0x46,
+	0x4d, 0x54, 0x5b, 0x62, 0x69, 0x70, 0x77, 0x7e, 0x85, 0x8c, 0x93, 0x9a, 0xa1, 0xa8, 0xaf, 0xb6,
+	0xbd, 0xc4, 0xcb, 0xd2, 0xd9, 0xe0, 0xe7, 0xee, 0xf5, 0xfc, 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26,
+	0x2d, 0x34, 0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c, 0x73, 0x7a, 0x81, 0x88, 0x8f, 0x96,
+	0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0xc0, 0xc7, 0xce, 0xd5, 0xdc, 0xe3, 0xea, 0xf1, 0xf8, 0xff, 0x06,
+	0x0d, 0x14,
+};
+static const uint8_t trace_2[210] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x4f, 0x00,
+	0x00, 0xc4, 0x58, 0xec, 0x00, 0x86, 0x40, 0x11, 0x04, 0xa2, 0x7f, 0x00, 0x00, 0x01, 0x7f, 0x00,
+	0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x1b, 0x22, 0x29, 0x30, 0x37, 0x3e,
+	0x45, 0x4c, 0x53, 0x5a, 0x61, 0x68, 0x6f, 0x76, 0x7d, 0x84, 0x8b, 0x92, 0x99, 0xa0, 0xa7, 0xae,
+	0xb5, 0xbc, 0xc3, 0xca, 0xd1, 0xd8, 0xdf, 0xe6, 0xed, 0xf4, 0xfb, 0x02, 0x09, 0x10, 0x17, 0x1e,
+	0x25, 0x2c, 0x33, 0x3a, 0x41, 0x48, 0x4f, 0x56, 0x5d, 0x64, 0x6b, 0x72, 0x79, 0x80, 0x87, 0x8e,
+	0x95, 0x9c, 0xa3, 0xaa, 0xb1, 0xb8, 0xbf, 0xc6, 0xcd, 0xd4, 0xdb, 0xe2, 0xe9, 0xf0, 0xf7, 0xfe,
+	0x05, 0x0c, 0x13, 0x1a, 0x21, 0x28, 0x2f, 0x36, 0x3d, 0x44, 0x4b, 0x52, 0x59, 0x60, 0x67, 0x6e,
+	0x75, 0x7c, 0x83, 0x8a, 0x91, 0x98, 0x9f, 0xa6, 0xad, 0xb4, 0xbb, 0xc2, 0xc9, 0xd0, 0xd7, 0xde,
+	0xe5, 0xec, 0xf3, 0xfa, 0x01, 0x08, 0x0f, 0x16, 0x1d, 0x24, 0x2b, 0x32, 0x39, 0x40, 0x47, 0x4e,
+	0x55, 0x5c, 0x63, 0x6a, 0x71, 0x78, 0x7f, 0x86, 0x8d, 0x94, 0x9b, 0xa2, 0xa9, 0xb0, 0xb7, 0xbe,
+	0xc5, 0xcc,
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * Inhalt eines Datagramms an Position i, damit Verschiebungen beim Zusammensetzen auffallen.
+ */
+static uint8_t pattern(uint16_t ident, uint32_t i) {
+	return (uint8_t)(i * 7 + (i >> 8) + ident);
+}
+
+
+/**
+ * Baut ein Fragment (MAC-Header, IPv4-Header ohne Optionen, Nutzdaten) und bergibt es
+ * an ipv4_frag_input.
+ *
+ * @param ident Die Identifikation des Datagramms.
+ * @param offset Die Position der Nutzdaten im Datagramm in Bytes (Vielfaches von 8).
+ * @param len Die Lnge der Nutzdaten des Fragments.
+ * @param more 1, wenn weitere Fragmente folgen (MF).
+ * @param frame_length Ausgabe: Lnge des zusammengesetzten Frames.
+ * @return Das Ergebnis von ipv4_frag_input.
+ */
+static const uint8_t* fragment(uint16_t ident, uint32_t offset, uint16_t len, uint8_t more, uint16_t* frame_length) {
+	uint8_t* ip = frame + sizeof(mac_header);
+	uint16_t total_length = 20 + len;
+	uint16_t field = (offset / 8) | (more ? 0x2000 : 0);
+
+	for (uint8_t i = 0; i < sizeof(mac_header); i++) {
+		frame[i] = i;
+	}
+	ip[0] = 0x45;
+	ip[1] = 0;
+	ip[2] = total_length >> 8;
+	ip[3] = total_length & 0xFF;
+	ip[4] = ident >> 8;
+	ip[5] = ident & 0xFF;
+	ip[6] = field >> 8;
+	ip[7] = field & 0xFF;
+	ip[8] = 64;
+	ip[9] = 17;
+	ip[10] = 0;
+	ip[11] = 0;
+	ip[12] = 10; ip[13] = 0; ip[14] = 0; ip[15] = 1;
+	ip[16] = 10; ip[17] = 0; ip[18] = 0; ip[19] = 5;
+	for (uint16_t i = 0; i < len; i++) {
+		ip[20 + i] = pattern(ident, offset + i);
+	}
+	return ipv4_frag_input(frame, 20, total_length, frame_length);
+}
+
+
+/**
+ * Prft ein zusammengesetztes Datagramm: Lnge, Header (Gesamtlnge, Flags, Prfsumme) und Inhalt.
+ */
+static void check_datagram(const uint8_t* out, uint16_t out_length, uint16_t ident, uint16_t total) {
+	CHECK(out != NULL);
+	if (out == NULL) {
+		return;
+	}
+	const uint8_t* ip = out + sizeof(mac_header);
+	CHECK(out_length == sizeof(mac_header) + 20 + total);
+	CHECK(((ip[2] << 8) | ip[3]) == 20 + total);
+	CHECK(ip[6] == 0 && ip[7] == 0);
+	CHECK(checksum(ip, 20) == 0);
+
+	uint32_t wrong = 0;
+	for (uint16_t i = 0; i < total; i++) {
+		wrong += ip[20 + i] != pattern(ident, i);
+	}
+	CHECK(wrong == 0);
+}
+
+
+static void reset(void) {
+	stub_reset();
+	ipv4_frag_init(&frags);
+}
+
+
+/**
+ * Nimmt das Datagramm auf, das handle_ipv4 zustellt, und prft UDP-Header, Prfsumme und Nutzdaten
+ * ab dem bergebenen Offset.
+ */
+static int udp_probe(const uint8_t* buf, uint16_t length, uint16_t offset) {
+	const uint8_t* ip = buf + sizeof(mac_header);
+	uint16_t len = (buf[offset + 4] << 8) | buf[offset + 5];
+	uint32_t wrong = 0;
+
+	udp_delivered++;
+	udp_offset = offset;
+	udp_length = len;
+	udp_valid = 0;
+	if (offset + len != length || len < 8) {
+		return 1;
+	}
+	uint32_t sum = checksum_pseudo(*(ip_address*)(ip + 12), *(ip_address*)(ip + 16), 17, len);
+	for (uint16_t i = 0; i < len - 8; i++) {
+		wrong += buf[offset + 8 + i] != (uint8_t)((i * 7 + 3) & 0xFF);
+	}
+	udp_valid = checksum_fold(checksum_partial(buf + offset, len, sum)) == 0xFFFF && wrong == 0;
+	return 0;
+}
+
+
+static void reset_ipv4(void) {
+	reset();
+	eth_init(&eth_types);
+	ipv4_init(&prot_types, &my_ip, &my_subnet);
+	ipv4_add_type(17, &udp_probe);
+	arp_table_init(&table, &my_ip, (mac_address){0x02, 0, 0, 0, 0, 0x01});
+	udp_delivered = 0;
+	udp_valid = 0;
+}
+
+
+/**
+ * Kopiert ein Fragment aus dem Mitschnitt ohne IP-Optionen (IHL 5) und passt Gesamtlnge und
+ * Header-Prfsumme an.
+ *
+ * @return Die Lnge des neuen Frames.
+ */
+static uint16_t strip_options(const uint8_t* src, uint16_t len) {
+	uint16_t header_length = (src[sizeof(mac_header)] & 0x0F) * 4;
+	uint8_t* ip = frame + sizeof(mac_header);
+	uint16_t n = 0;
+
+	for (uint16_t i = 0; i < len; i++) {
+		if (i < sizeof(mac_header) + 20 || i >= sizeof(mac_header) + header_length) {
+			frame[n++] = src[i];
+		}
+	}
+	uint16_t total_length = n - sizeof(mac_header);
+	ip[0] = 0x45;
+	ip[2] = total_length >> 8;
+	ip[3] = total_length & 0xFF;
+	ip[10] = 0;
+	ip[11] = 0;
+	uint16_t check = checksum(ip, 20);
+	ip[10] = check & 0xFF;
+	ip[11] = check >> 8;
+	return n;
+}
+
+
+/* Tests ---------------------------------------------------------------------*/
+
+static void test_in_order(void) {
+	const uint8_t* out;
+	uint16_t n;
+	reset();
+	CHECK(fragment(1, 0, 512, 1, &n) == NULL);
+	CHECK(fragment(1, 512, 512, 1, &n) == NULL);
+	out = fragment(1, 1024, 176, 0, &n);
+	check_datagram(out, n, 1, 1200);
+	CHECK(ipv4_frag_get_stats()->reassembled == 1);
+	CHECK(ipv4_frag_get_stats()->fragments == 3);
+}
+
+
+static void test_out_of_order(void) {
+	const uint8_t* out;
+	uint16_t n;
+	reset();
+	CHECK(fragment(2, 1024, 171, 0, &n) == NULL);
+	CHECK(fragment(2, 512, 512, 1, &n) == NULL);
+	out = fragment(2, 0, 512, 1, &n);
+	check_datagram(out, n, 2, 1195);
+
+	// Zwei Datagramme verschrnkt
+	CHECK(fragment(3, 0, 256, 1, &n) == NULL);
+	CHECK(fragment(4, 256, 100, 0, &n) == NULL);
+	CHECK(fragment(3, 256, 8, 0, &n) != NULL);
+	out = fragment(4, 0, 256, 1, &n);
+	check_datagram(out, n, 4, 356);
+	CHECK(ipv4_frag_get_stats()->reassembled == 3);
+}
+
+
+static void test_overlapping(void) {
+	const uint8_t* out;
+	uint16_t n;
+	reset();
+	CHECK(fragment(5, 0, 520, 1, &n) == NULL);
+	CHECK(fragment(5, 512, 512, 1, &n) == NULL);
+	CHECK(fragment(5, 256, 512, 1, &n) == NULL);
+	out = fragment(5, 1016, 184, 0, &n);
+	check_datagram(out, n, 5, 1200);
+	CHECK(ipv4_frag_get_stats()->bad_fragment == 0);
+}
+
+
+static void test_duplicate(void) {
+	const uint8_t* out;
+	uint16_t n;
+	reset();
+	CHECK(fragment(6, 0, 512, 1, &n) == NULL);
+	CHECK(fragment(6, 0, 512, 1, &n) == NULL);
+	CHECK(fragment(6, 1024, 100, 0, &n) == NULL);
+	CHECK(fragment(6, 1024, 100, 0, &n) == NULL);
+	out = fragment(6, 512, 512, 1, &n);
+	check_datagram(out, n, 6, 1124);
+	CHECK(ipv4_frag_get_stats()->reassembled == 1);
+
+	// Ein Duplikat nach dem Abschluss beginnt ein neues Datagramm und wird nicht zugestellt
+	CHECK(fragment(6, 512, 512, 1, &n) == NULL);
+	CHECK(ipv4_frag_get_stats()->reassembled == 1);
+}
+
+
+static void test_oversize(void) {
+	uint16_t n;
+	reset();
+	CHECK(fragment(7, 0, 1024, 1, &n) == NULL);
+	CHECK(fragment(7, IPV4_FRAG_MAX_SIZE - 8, 16, 0, &n) == NULL);
+	CHECK(ipv4_frag_get_stats()->too_big == 1);
+	// Der Slot ist samt erstem Fragment verworfen
+	CHECK(fragment(7, 1024, 8, 0, &n) == NULL);
+	CHECK(ipv4_frag_get_stats()->reassembled == 0);
+}
+
+
+static void test_bad_fragment(void) {
+	uint16_t n;
+	reset();
+	// Ungltige Lngen
+	CHECK(fragment(8, 0, 0, 1, &n) == NULL);
+	CHECK(fragment(8, 0, 100, 1, &n) == NULL);
+	CHECK(ipv4_frag_get_stats()->bad_fragment == 2);
+
+	// Mittleres Fragment hinter dem bekannten Ende
+	CHECK(fragment(9, 512, 100, 0, &n) == NULL);
+	CHECK(fragment(9, 512, 512, 1, &n) == NULL);
+	CHECK(ipv4_frag_get_stats()->bad_fragment == 3);
+	CHECK(fragment(9, 0, 512, 1, &n) == NULL);
+	CHECK(ipv4_frag_get_stats()->reassembled == 0);
+
+	// Letztes Fragment vor bereits empfangenen Blcken: die Blockzahl passt, Daten fehlen aber
+	reset();
+	CHECK(fragment(10, 0, 8, 1, &n) == NULL);
+	CHECK(fragment(10, 1024, 504, 1, &n) == NULL);
+	CHECK(fragment(10, 512, 8, 0, &n) == NULL);
+	CHECK(ipv4_frag_get_stats()->bad_fragment == 1);
+	CHECK(ipv4_frag_get_stats()->reassembled == 0);
+
+	// Zweites letztes Fragment mit anderem Ende
+	reset();
+	CHECK(fragment(11, 512, 100, 0, &n) == NULL);
+	CHECK(fragment(11, 512, 120, 0, &n) == NULL);
+	CHECK(ipv4_frag_get_stats()->bad_fragment == 1);
+}
+
+
+static void test_timeout(void) {
+	const uint8_t* out;
+	uint16_t n;
+	reset();
+	CHECK(fragment(12, 0, 512, 1, &n) == NULL);
+	stub_tick += IPV4_FRAG_TIMEOUT - 1;
+	ipv4_frag_tick();
+	CHECK(ipv4_frag_get_stats()->timeouts == 0);
+	stub_tick += 1;
+	ipv4_frag_tick();
+	CHECK(ipv4_frag_get_stats()->timeouts == 1);
+	CHECK(fragment(12, 512, 100, 0, &n) == NULL);
+	CHECK(ipv4_frag_get_stats()->reassembled == 0);
+
+	// Abgelaufene Slots werden auch ohne ipv4_frag_tick bei der Suche freigegeben
+	reset();
+	for (uint16_t i = 0; i < IPV4_FRAG_SLOTS; i++) {
+		CHECK(fragment(20 + i, 0, 512, 1, &n) == NULL);
+	}
+	CHECK(fragment(30, 0, 512, 1, &n) == NULL);
+	CHECK(ipv4_frag_get_stats()->pool_full == 1);
+	stub_tick += IPV4_FRAG_TIMEOUT;
+	CHECK(fragment(30, 0, 512, 1, &n) == NULL);
+	CHECK(ipv4_frag_get_stats()->timeouts == IPV4_FRAG_SLOTS);
+	out = fragment(30, 512, 40, 0, &n);
+	check_datagram(out, n, 30, 552);
+}
+
+
+static void test_trace_options(void) {
+	uint16_t n;
+
+	// Wie mitgeschnitten: alle Fragmente mit 60-Byte-Header
+	reset_ipv4();
+	CHECK(eth_handler(trace_0, sizeof(trace_0)) == 0);
+	CHECK(eth_handler(trace_1, sizeof(trace_1)) == 0);
+	CHECK(udp_delivered == 0);
+	CHECK(eth_handler(trace_2, sizeof(trace_2)) == 0);
+	CHECK(udp_delivered == 1);
+	CHECK(udp_offset == sizeof(mac_header) + 60);
+	CHECK(udp_length == 1208);
+	CHECK(udp_valid);
+
+	// Weitere Fragmente ohne Optionen: der Offset folgt dem Header des ersten Fragments
+	reset_ipv4();
+	CHECK(eth_handler(trace_0, sizeof(trace_0)) == 0);
+	n = strip_options(trace_1, sizeof(trace_1));
+	CHECK(eth_handler(frame, n) == 0);
+	n = strip_options(trace_2, sizeof(trace_2));
+	CHECK(eth_handler(frame, n) == 0);
+	CHECK(udp_delivered == 1);
+	CHECK(udp_offset == sizeof(mac_header) + 60);
+	CHECK(udp_valid);
+
+	// Umgekehrte Reihenfolge: das erste Fragment (mit Optionen) trifft zuletzt ein
+	reset_ipv4();
+	n = strip_options(trace_2, sizeof(trace_2));
+	CHECK(eth_handler(frame, n) == 0);
+	n = strip_options(trace_1, sizeof(trace_1));
+	CHECK(eth_handler(frame, n) == 0);
+	CHECK(eth_handler(trace_0, sizeof(trace_0)) == 0);
+	CHECK(udp_delivered == 1);
+	CHECK(udp_offset == sizeof(mac_header) + 60);
+	CHECK(udp_valid);
+	CHECK(ipv4_get_stats()->fragments == 3);
+}
+
+
+int main(void) {
+	test_in_order();
+	test_out_of_order();
+	test_overlapping();
+	test_duplicate();
+	test_oversize();
+	test_bad_fragment();
+	test_timeout();
+	test_trace_options();
+	return stub_result("test_frag");
+}
@@ -0,0 +1,141 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "stub.h"
+#include "icmp.h"
+#include "route.h"
+#include "txq.h"
+
+/* Private variables ---------------------------------------------------------*/
+static ether_types eth_types;
+static prtcl_types prot_types;
+static arp_table table;
+static route_table routing;
+static route_cache routes;
+static txq_queues txq;
+
+static ip_address my_ip = {{192, 168, 1, 10}};
+static ip_address my_subnet = {{255, 255, 255, 0}};
+static ip_address peer_ip = {{192, 168, 1, 2}};
+static mac_address my_mac = {{0xB8, 0x37, 0x4A, 0x04, 0x20, 0x0B}};
+static mac_address peer_mac = {{0x02, 0x01, 0x01, 0x01, 0x01, 0x01}};
+
+static uint8_t request[1600];
+static uint8_t rx[1600];
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * Baut eine Echo-Anfrage vom Peer mit gltigen Prfsummen.
+ *
+ * @param dst Die Zieladresse (eigene Adresse oder Broadcast).
+ * @param options Anzahl der 4-Byte-Worte IP-Optionen (NOPs).
+ * @param payload Die Lnge der Nutzdaten.
+ * @return Die Lnge des Frames.
+ */
+static uint16_t build_request(ip_address dst, uint8_t options, uint16_t payload) {
+	uint8_t* ip = request + sizeof(mac_header);
+	uint16_t header_length = 20 + options * 4;
+	uint8_t* icmp = ip + header_length;
+	uint16_t total_length = header_length + sizeof(icmp_package) + payload;
+
+	memset(request, 0, sizeof(request));
+	for (uint8_t i = 0; i < 6; i++) {
+		request[i] = (dst.octet[3] == 255) ? 0xFF : my_mac.octet[i];
+		request[6 + i] = peer_mac.octet[i];
+	}
+	request[12] = 0x08;
+	ip[0] = 0x40 | (header_length / 4);
+	ip[1] = 0x28; // AF11
+	ip[2] = total_length >> 8;
+	ip[3] = total_length & 0xFF;
+	ip[4] = 0x12;
+	ip[5] = 0x34;
+	ip[8] = 128;
+	ip[9] = ICMP_TYPE;
+	for (uint8_t i = 0; i < 4; i++) {
+		ip[12 + i] = peer_ip.octet[i];
+		ip[16 + i] = dst.octet[i];
+	}
+	memset(ip + 20, 0x01, options * 4);
+	uint16_t check = checksum(ip, header_length);
+	ip[10] = check & 0xFF;
+	ip[11] = check >> 8;
+
+	icmp[0] = ICMP_REQ;
+	icmp[4] = 0xBE;
+	icmp[5] = 0xEF;
+	icmp[6] = 0x00;
+	icmp[7] = 0x07;
+	for (uint16_t i = 0; i < payload; i++) {
+		icmp[sizeof(icmp_package) + i] = i * 13 + 5;
+	}
+	check = checksum(icmp, sizeof(icmp_package) + payload);
+	icmp[2] = check & 0xFF;
+	icmp[3] = check >> 8;
+	return sizeof(mac_header) + total_length;
+}
+
+
+/**
+ * Empfngt die Anfrage wie die Hauptschleife und prft die im ENC28J60 erzeugte Antwort Byte
+ * fr Byte: vertauschte Adressen, neue TTL, sonst unverndert, beide Prfsummen gltig.
+ */
+static void check_echo(ip_address dst, uint8_t options, uint16_t payload) {
+	uint16_t len = build_request(dst, options, payload);
+	uint16_t offset = sizeof(mac_header) + 20 + options * 4;
+	const uint8_t* req_ip = request + sizeof(mac_header);
+
+	stub_reset();
+	stub_receive(request, len);
+	uint16_t received = enc28_packetReceive(sizeof(rx), rx);
+	CHECK(received == len);
+	CHECK(enc28_packetHeld(rx, received));
+	eth_handler(rx, received);
+	txq_poll();
+
+	const stub_frame* f = stub_last_frame();
+	CHECK(stub_sent == 1 && f != NULL);
+	if (f == NULL) {
+		return;
+	}
+	const uint8_t* ip = f->data + sizeof(mac_header);
+	const uint8_t* icmp = f->data + offset;
+	CHECK(f->len == len);
+	CHECK(memcmp(f->data, peer_mac.octet, 6) == 0);
+	CHECK(memcmp(f->data + 6, my_mac.octet, 6) == 0);
+	CHECK(f->data[12] == 0x08 && f->data[13] == 0x00);
+
+	// IPv4: Version, ToS, Lnge, ID und Optionen unverndert; TTL neu, Quelle immer die eigene Adresse
+	CHECK(memcmp(ip, req_ip, 8) == 0);
+	CHECK(ip[8] == IPV4_TTL && ip[9] == ICMP_TYPE);
+	CHECK(memcmp(ip + 12, my_ip.octet, 4) == 0);
+	CHECK(memcmp(ip + 16, peer_ip.octet, 4) == 0);
+	CHECK(memcmp(ip + 20, req_ip + 20, options * 4) == 0);
+	CHECK(checksum_fold(checksum_partial(ip, offset - sizeof(mac_header), 0)) == 0xFFFF);
+
+	// ICMP: Typ 0, Identifikator, Sequenz und Nutzdaten unverndert, Prfsumme ber alles gltig
+	CHECK(icmp[0] == ICMP_REPLY && icmp[1] == 0);
+	CHECK(memcmp(icmp + 4, request + offset + 4, len - offset - 4) == 0);
+	CHECK(checksum_fold(checksum_partial(icmp, len - offset, 0)) == 0xFFFF);
+}
+
+
+int main(void) {
+	static const uint16_t sizes[] = {0, 1, 56, 1472, 1472, 1472, 1471};
+	ip_address broadcast = {{192, 168, 1, 255}};
+
+	eth_init(&eth_types);
+	ipv4_init(&prot_types, &my_ip, &my_subnet);
+	arp_table_init(&table, &my_ip, my_mac);
+	route_init(&routing, &routes, &my_ip, &my_subnet, my_mac);
+	txq_init(&txq);
+	icmp_init(&my_ip, my_mac);
+
+	// Hintereinander, damit groe Anfragen am Ende des Empfangspuffers umlaufen
+	for (uint8_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		check_echo(my_ip, 0, sizes[i]);
+	}
+	check_echo(my_ip, 1, 100);
+	check_echo(broadcast, 0, 56);
+	return stub_result("test_icmp");
+}